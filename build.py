@@ -190,8 +190,11 @@ for f in glob.glob(os.path.join(CTX.INPUT_PREFIX, 'catalog', '*.cpp')):
 CTX.INPUT['catalog'] = "\n".join(sorted(catalog_files))
 
 CTX.INPUT['common'] = """
+ Checksum.cpp
+ Compression.cpp
  SegvException.cpp
  SerializableEEException.cpp
+ SharedMemoryChannel.cpp
  SQLException.cpp
  tabletuple.cpp
  TupleSchema.cpp
@@ -207,11 +210,14 @@ CTX.INPUT['common'] = """
 
 CTX.INPUT['execution'] = """
  JNITopend.cpp
+ PlanFragmentProfiler.cpp
+ PlanFragmentStats.cpp
  VoltDBEngine.cpp
 """
 
 CTX.INPUT['executors'] = """
  abstractexecutor.cpp
+ batchpredicate.cpp
  deleteexecutor.cpp
  distinctexecutor.cpp
  executorutil.cpp
@@ -264,6 +270,7 @@ CTX.INPUT['plannodes'] = """
 
 CTX.INPUT['indexes'] = """
  arrayuniqueindex.cpp
+ masstreebulkload.cpp
  tableindex.cpp
  tableindexfactory.cpp
  IndexStats.cpp
@@ -281,6 +288,7 @@ CTX.INPUT['storage'] = """
  PersistentTableUndoDeleteAction.cpp
  PersistentTableUndoInsertAction.cpp
  PersistentTableUndoUpdateAction.cpp
+ ResultTableStream.cpp
  StreamedTableStats.cpp
  streamedtable.cpp
  table.cpp
@@ -289,6 +297,7 @@ CTX.INPUT['storage'] = """
  TableStats.cpp
  tableutil.cpp
  temptable.cpp
+ TupleBlockFormat.cpp
  TupleStreamWrapper.cpp
  RecoveryContext.cpp
  ReadWriteTracker.cpp
@@ -303,6 +312,7 @@ CTX.INPUT['logging'] = """
  JNILogProxy.cpp
  LogManager.cpp
  AriesLogProxy.cpp
+ AriesReplayer.cpp
  Logrecord.cpp
 """
  
@@ -328,11 +338,18 @@ CTX.TESTS['catalog'] = """
 
 CTX.TESTS['logging'] = """
  logging_test
+ aries_log_proxy_test
+ aries_replayer_test
+ logrecord_test
 """
 
 CTX.TESTS['common'] = """
+ checksum_test
+ compression_test
  debuglog_test
+ mmap_memory_manager_test
  serializeio_test
+ shared_memory_channel_test
  undolog_test
  valuearray_test
  nvalue_test
@@ -342,6 +359,7 @@ CTX.TESTS['common'] = """
 
 CTX.TESTS['execution'] = """
  engine_test
+ plan_fragment_profiler_test
 """
 
 CTX.TESTS['expressions'] = """
@@ -350,10 +368,13 @@ CTX.TESTS['expressions'] = """
 
 CTX.TESTS['indexes'] = """
  index_allocatortracker_test
+ index_bulkload_test
  index_key_test
  index_multikey_test
  index_scripted_test
+ index_share_test
  index_test
+ masstree_test
 """
 #index_more_test
 
@@ -363,6 +384,7 @@ CTX.TESTS['storage'] = """
  filter_test
  mmap_persistent_table_test
  persistent_table_log_test
+ persistent_table_undo_test
  serialize_test
  StreamedTable_test
  table_and_indexes_test
@@ -496,6 +518,8 @@ elif CTX.TARGET == "TEST":
     retval = runTests(CTX)
 elif CTX.TARGET == "VOLTDBIPC":
     retval = buildIPC(CTX)
+elif CTX.TARGET == "INDEXBENCH":
+    retval = buildIndexBench(CTX)
 
 if retval != 0:
     sys.exit(-1)
@@ -52,7 +52,7 @@ class BuildContext:
         for arg in [x.strip().upper() for x in args]:
             if arg in ["DEBUG", "RELEASE", "MEMCHECK", "MEMCHECK_NOFREELIST"]:
                 self.LEVEL = arg
-            if arg in ["BUILD", "CLEAN", "BUILDTEST", "TEST", "VOLTRUN", "VOLTDBIPC"]:
+            if arg in ["BUILD", "CLEAN", "BUILDTEST", "TEST", "VOLTRUN", "VOLTDBIPC", "INDEXBENCH"]:
                 self.TARGET = arg
             if arg in ["COVERAGE"]:
                 self.COVERAGE = True
@@ -289,6 +289,11 @@ def buildMakefile(CTX):
     makefile.write("\t$(LINK.cpp) %s -o $@ $^\n" % CTX.TEST_EXTRAFLAGS)
     makefile.write("\n")
 
+    makefile.write("# standalone index micro-benchmark (not part of the test suite)\n")
+    makefile.write("prod/indexbench: ../../%s/indexes/index_benchmark.cpp objects/volt.a\n" % TEST_PREFIX)
+    makefile.write("\t$(LINK.cpp) -std=gnu++0x %s -o $@ $^ %s\n" % (CTX.EXTRAFLAGS, " ".join(CTX.THIRD_PARTY_STATIC_LIBS)))
+    makefile.write("\n")
+
 
     makefile.write(".PHONY: test\n")
     makefile.write("test: ")
@@ -385,6 +390,10 @@ def buildIPC(CTX):
     retval = os.system("make --directory=%s prod/voltdbipc -j4" % (CTX.OUTPUT_PREFIX))
     return retval
 
+def buildIndexBench(CTX):
+    retval = os.system("make --directory=%s prod/indexbench -j4" % (CTX.OUTPUT_PREFIX))
+    return retval
+
 def buildTests(CTX):
     retval = os.system("make --directory=%s test -j4" % (CTX.OUTPUT_PREFIX))
     if retval != 0:
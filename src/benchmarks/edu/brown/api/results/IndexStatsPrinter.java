@@ -48,6 +48,22 @@ public class IndexStatsPrinter implements BenchmarkInterest {
 	new ColumnInfo("IS_UNIQUE", VoltType.INTEGER),
 	new ColumnInfo("ENTRY_COUNT", VoltType.INTEGER),
 	new ColumnInfo("MEMORY_ESTIMATE", VoltType.INTEGER),
+	new ColumnInfo("DEAD_ENTRY_COUNT", VoltType.BIGINT),
+	new ColumnInfo("DEAD_ENTRY_RATIO", VoltType.FLOAT),
+	new ColumnInfo("DYNAMIC_HITS", VoltType.BIGINT),
+	new ColumnInfo("STATIC_HITS", VoltType.BIGINT),
+	new ColumnInfo("LOOKUP_MISSES", VoltType.BIGINT),
+	new ColumnInfo("BLOOM_NEGATIVES", VoltType.BIGINT),
+	new ColumnInfo("BLOOM_FALSE_POSITIVES", VoltType.BIGINT),
+	new ColumnInfo("MERGE_COUNT", VoltType.BIGINT),
+	new ColumnInfo("MERGE_PAUSE_TOTAL", VoltType.BIGINT),
+	new ColumnInfo("MERGE_PAUSE_MAX", VoltType.BIGINT),
+	new ColumnInfo("MERGE_PAUSE_HISTOGRAM", VoltType.STRING),
+	new ColumnInfo("DYNAMIC_BYTES", VoltType.BIGINT),
+	new ColumnInfo("STATIC_BYTES", VoltType.BIGINT),
+	new ColumnInfo("VALUE_BYTES", VoltType.BIGINT),
+	new ColumnInfo("FILTER_BYTES", VoltType.BIGINT),
+	new ColumnInfo("LEAF_FILL_HISTOGRAM", VoltType.STRING),
     };
     
 
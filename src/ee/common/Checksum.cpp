@@ -0,0 +1,141 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/Checksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#define CHECKSUM_HAVE_SSE42_ASM 1
+#endif
+
+namespace voltdb {
+
+namespace {
+
+/*
+ * Slicing-by-8 lookup tables for a reflected polynomial. table[0] is the
+ * classic byte-at-a-time table; table[k] advances a byte through k more
+ * zero bytes, so eight input bytes are folded in with eight lookups.
+ * Assumes a little-endian host like the rest of the EE.
+ */
+struct SlicingTables {
+    uint32_t table[8][256];
+
+    SlicingTables(uint32_t polynomial) {
+        for (uint32_t ii = 0; ii < 256; ii++) {
+            uint32_t crc = ii;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+            }
+            table[0][ii] = crc;
+        }
+        for (uint32_t ii = 0; ii < 256; ii++) {
+            for (int slice = 1; slice < 8; slice++) {
+                const uint32_t prev = table[slice - 1][ii];
+                table[slice][ii] = (prev >> 8) ^ table[0][prev & 0xff];
+            }
+        }
+    }
+
+    uint32_t process(uint32_t crc, const void *data, std::size_t length) const {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+        while (length >= 8) {
+            uint32_t low;
+            uint32_t high;
+            ::memcpy(&low, bytes, 4);
+            ::memcpy(&high, bytes + 4, 4);
+            low ^= crc;
+            crc = table[7][low & 0xff] ^
+                  table[6][(low >> 8) & 0xff] ^
+                  table[5][(low >> 16) & 0xff] ^
+                  table[4][low >> 24] ^
+                  table[3][high & 0xff] ^
+                  table[2][(high >> 8) & 0xff] ^
+                  table[1][(high >> 16) & 0xff] ^
+                  table[0][high >> 24];
+            bytes += 8;
+            length -= 8;
+        }
+        while (length-- > 0) {
+            crc = (crc >> 8) ^ table[0][(crc ^ *bytes++) & 0xff];
+        }
+        return ~crc;
+    }
+};
+
+const SlicingTables crc32Tables(0xEDB88320);
+const SlicingTables crc32cTables(0x82F63B78);
+
+#ifdef CHECKSUM_HAVE_SSE42_ASM
+bool detectSSE42() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ecx & bit_SSE4_2) != 0;
+}
+
+/*
+ * Inline asm rather than the _mm_crc32_* intrinsics so the rest of the
+ * build doesn't need -msse4.2; only called after the cpuid check.
+ */
+uint32_t crc32cHardware(uint32_t crc, const void *data, std::size_t length) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    uint64_t crc64 = ~crc;
+    while (length >= 8) {
+        uint64_t word;
+        ::memcpy(&word, bytes, 8);
+        __asm__("crc32q %1, %0" : "+r"(crc64) : "rm"(word));
+        bytes += 8;
+        length -= 8;
+    }
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    while (length-- > 0) {
+        __asm__("crc32b %1, %0" : "+r"(crc32) : "rm"(*bytes));
+        bytes++;
+    }
+    return ~crc32;
+}
+
+const bool haveSSE42 = detectSSE42();
+#else
+const bool haveSSE42 = false;
+#endif
+
+}
+
+uint32_t Checksum::crc32(uint32_t crc, const void *data, std::size_t length) {
+    return crc32Tables.process(crc, data, length);
+}
+
+uint32_t Checksum::crc32c(uint32_t crc, const void *data, std::size_t length) {
+#ifdef CHECKSUM_HAVE_SSE42_ASM
+    if (haveSSE42) {
+        return crc32cHardware(crc, data, length);
+    }
+#endif
+    return crc32cTables.process(crc, data, length);
+}
+
+bool Checksum::hardwareCRC32C() {
+    return haveSSE42;
+}
+
+}
@@ -0,0 +1,87 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace voltdb
+{
+    /// Identifies the checksum used for a stream of serialized data.
+    /// Stored in the snapshot file header; files written before the
+    /// field existed are CRC32.
+    enum ChecksumType {
+        CHECKSUM_TYPE_CRC32 = 0,
+        CHECKSUM_TYPE_CRC32C = 1
+    };
+
+    /// Checksums over bulk data. CRC32C uses the SSE4.2 crc32
+    /// instruction when the CPU has it and slicing-by-8 tables
+    /// otherwise. CRC32 (the zlib/java.util.zip polynomial) is always
+    /// slicing-by-8 and produces the same values as boost::crc_32_type.
+    ///
+    /// Both functions take and return the finalized checksum, so a
+    /// running value can be continued across calls by passing the
+    /// previous result back in; start with 0.
+    class Checksum
+    {
+    public:
+        static uint32_t crc32(uint32_t crc, const void *data, std::size_t length);
+        static uint32_t crc32c(uint32_t crc, const void *data, std::size_t length);
+
+        static uint32_t compute(ChecksumType type, uint32_t crc,
+                                const void *data, std::size_t length) {
+            return type == CHECKSUM_TYPE_CRC32C ?
+                crc32c(crc, data, length) : crc32(crc, data, length);
+        }
+
+        /// True if crc32c() runs on the SSE4.2 instruction
+        static bool hardwareCRC32C();
+    };
+
+    /// Accumulates a checksum over several non-contiguous blocks, in
+    /// the style of boost::crc_32_type.
+    class ChecksumAccumulator
+    {
+    public:
+        ChecksumAccumulator(ChecksumType type) : m_type(type), m_crc(0) {}
+
+        void process_bytes(const void *data, std::size_t length) {
+            m_crc = Checksum::compute(m_type, m_crc, data, length);
+        }
+
+        void process_block(const void *begin, const void *end) {
+            process_bytes(begin, static_cast<const char*>(end) - static_cast<const char*>(begin));
+        }
+
+        uint32_t checksum() const {
+            return m_crc;
+        }
+
+        ChecksumType type() const {
+            return m_type;
+        }
+
+    private:
+        const ChecksumType m_type;
+        uint32_t m_crc;
+    };
+}
+
+#endif // CHECKSUM_H
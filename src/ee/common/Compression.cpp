@@ -0,0 +1,213 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/Compression.h"
+
+#include <cstring>
+#include <stdint.h>
+
+namespace voltdb {
+
+namespace {
+
+const std::size_t MIN_MATCH = 4;
+const std::size_t MAX_OFFSET = 65535;
+const std::size_t LENGTH_MASK = 15;
+const int HASH_BITS = 12;
+
+inline uint32_t read32(const uint8_t *bytes) {
+    uint32_t value;
+    ::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+inline uint32_t hashOf(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/*
+ * Lengths that don't fit in a token nibble continue in bytes of 255
+ * terminated by a smaller byte.
+ */
+inline std::size_t extraLengthBytes(std::size_t length) {
+    return length < LENGTH_MASK ? 0 : (length - LENGTH_MASK) / 255 + 1;
+}
+
+uint8_t* writeExtraLength(uint8_t *op, std::size_t length) {
+    length -= LENGTH_MASK;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+bool readExtraLength(const uint8_t *&ip, const uint8_t *end, std::size_t &length) {
+    uint8_t byte;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/*
+ * Append literals followed by a back reference. A matchLength of 0 is
+ * the trailing run of literals that ends the block. Returns NULL if
+ * the sequence doesn't fit before limit.
+ */
+uint8_t* writeSequence(uint8_t *op, const uint8_t *limit,
+                       const uint8_t *literals, std::size_t literalLength,
+                       std::size_t offset, std::size_t matchLength) {
+    const std::size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+    std::size_t needed = 1 + extraLengthBytes(literalLength) + literalLength;
+    if (matchLength != 0) {
+        needed += 2 + extraLengthBytes(matchCode);
+    }
+    if (needed > static_cast<std::size_t>(limit - op)) {
+        return NULL;
+    }
+
+    uint8_t *token = op++;
+    *token = static_cast<uint8_t>(
+        ((literalLength < LENGTH_MASK ? literalLength : LENGTH_MASK) << 4) |
+        (matchCode < LENGTH_MASK ? matchCode : LENGTH_MASK));
+    if (literalLength >= LENGTH_MASK) {
+        op = writeExtraLength(op, literalLength);
+    }
+    ::memcpy(op, literals, literalLength);
+    op += literalLength;
+
+    if (matchLength != 0) {
+        *op++ = static_cast<uint8_t>(offset & 0xff);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        if (matchCode >= LENGTH_MASK) {
+            op = writeExtraLength(op, matchCode);
+        }
+    }
+    return op;
+}
+
+}
+
+std::size_t Compression::compress(const char *source, std::size_t length,
+                                  char *dest, std::size_t capacity) {
+    const uint8_t *src = reinterpret_cast<const uint8_t*>(source);
+    const uint8_t *end = src + length;
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    uint8_t *op = reinterpret_cast<uint8_t*>(dest);
+    const uint8_t *limit = op + capacity;
+
+    // last position each hashed 4 byte sequence was seen at
+    uint32_t positions[1 << HASH_BITS];
+    ::memset(positions, 0, sizeof(positions));
+
+    if (length >= MIN_MATCH) {
+        const uint8_t *matchLimit = end - MIN_MATCH;
+        while (ip <= matchLimit) {
+            const uint32_t sequence = read32(ip);
+            const uint32_t hash = hashOf(sequence);
+            const uint8_t *ref = src + positions[hash];
+            positions[hash] = static_cast<uint32_t>(ip - src);
+
+            if (ref >= ip || static_cast<std::size_t>(ip - ref) > MAX_OFFSET ||
+                read32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+
+            std::size_t matchLength = MIN_MATCH;
+            while (ip + matchLength < end && ref[matchLength] == ip[matchLength]) {
+                matchLength++;
+            }
+            op = writeSequence(op, limit, anchor, ip - anchor, ip - ref, matchLength);
+            if (op == NULL) {
+                return 0;
+            }
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+
+    op = writeSequence(op, limit, anchor, end - anchor, 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+    return op - reinterpret_cast<uint8_t*>(dest);
+}
+
+bool Compression::decompress(const char *source, std::size_t length,
+                             char *dest, std::size_t rawLength) {
+    const uint8_t *ip = reinterpret_cast<const uint8_t*>(source);
+    const uint8_t *end = ip + length;
+    uint8_t *start = reinterpret_cast<uint8_t*>(dest);
+    uint8_t *op = start;
+    uint8_t *outEnd = start + rawLength;
+
+    while (ip < end) {
+        const uint8_t token = *ip++;
+
+        std::size_t literalLength = token >> 4;
+        if (literalLength == LENGTH_MASK && !readExtraLength(ip, end, literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<std::size_t>(end - ip) ||
+            literalLength > static_cast<std::size_t>(outEnd - op)) {
+            return false;
+        }
+        ::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // only the last sequence ends without a back reference
+        if (ip == end) {
+            return op == outEnd;
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<std::size_t>(op - start)) {
+            return false;
+        }
+
+        std::size_t matchLength = token & LENGTH_MASK;
+        if (matchLength == LENGTH_MASK && !readExtraLength(ip, end, matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<std::size_t>(outEnd - op)) {
+            return false;
+        }
+
+        // byte at a time, the reference may overlap what it produces
+        const uint8_t *ref = op - offset;
+        for (std::size_t ii = 0; ii < matchLength; ii++) {
+            *op++ = *ref++;
+        }
+    }
+    return false;
+}
+
+}
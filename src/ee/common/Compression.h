@@ -0,0 +1,48 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+
+namespace voltdb
+{
+    /// Fast block compression for serialized tuple data, in the LZ4
+    /// block layout: runs of literals, each followed by a back
+    /// reference of at least four bytes into the previous 64KB.
+    /// Trades ratio for speed; rows of a table repeat a lot of bytes
+    /// (headers, lengths, small integers) so this still pays off on
+    /// the wire. Blocks are limited to 4GB.
+    class Compression
+    {
+    public:
+        /// Compress length bytes of source into dest. Returns the
+        /// compressed length, or 0 if it would not fit in capacity
+        /// bytes (pass length - 1 to only accept a real saving).
+        static std::size_t compress(const char *source, std::size_t length,
+                                    char *dest, std::size_t capacity);
+
+        /// Decompress a block produced by compress() into exactly
+        /// rawLength bytes of dest. Returns false if the block is
+        /// malformed or doesn't expand to rawLength.
+        static bool decompress(const char *source, std::size_t length,
+                               char *dest, std::size_t rawLength);
+    };
+}
+
+#endif // COMPRESSION_H
@@ -26,6 +26,8 @@ class TupleSchema;
 
 class DefaultTupleSerializer : public TupleSerializer {
 public:
+    DefaultTupleSerializer(bool blockCopy = false) : m_blockCopy(blockCopy) {}
+
     /**
      * Serialize the provided tuple to the provide serialize output
      */
@@ -36,7 +38,16 @@ public:
      */
     int getMaxSerializedTupleSize(const TupleSchema *schema);
 
+    /**
+     * Block copy output re-encodes to exactly what serializeTo would have written
+     */
+    bool blockCopyEnabled() {
+        return m_blockCopy;
+    }
+
     virtual ~DefaultTupleSerializer() {}
+private:
+    const bool m_blockCopy;
 };
 }
 
@@ -39,163 +39,150 @@
 
  namespace voltdb {
 
-   pthread_mutex_t MMAPMemoryManager::m_mutex = PTHREAD_MUTEX_INITIALIZER;
-
    const unsigned int DEFAULT_MMAP_SIZE = 256 * 1024 * 1024;
 
+   const size_t MMAP_PAGE_SIZE = 4096;
+
+   // small allocations (STL nodes, strings) share cache line sized classes
+   const size_t MMAP_SMALL_CLASS = 64;
+
+   static size_t roundUp(size_t value, size_t multiple) {
+     return (value + multiple - 1) / multiple * multiple;
+   }
+
    MMAPMemoryManager::MMAPMemoryManager()
-   : m_size(DEFAULT_MMAP_SIZE), m_allocated(0),
-   m_persistent(false), m_index(0)
+   : m_size(DEFAULT_MMAP_SIZE), m_allocated(0), m_lastAsync(0),
+   m_persistent(false), m_fd(-1), m_fileSize(0), m_index(0)
    {
-     init();
+     addExtent(m_size);
    }
 
 
    MMAPMemoryManager::MMAPMemoryManager(size_t size, const std::string fileName, bool persistent)
-   : m_size(size), m_allocated(0),
-   m_fileName(fileName), m_persistent(persistent), m_index(0)
+   : m_size(roundUp(size, MMAP_PAGE_SIZE)), m_allocated(0), m_lastAsync(0),
+   m_fileName(fileName), m_persistent(persistent), m_fd(-1), m_fileSize(0), m_index(0)
    {
-     init();
-   }
-
-   void MMAPMemoryManager::init() {
-
-     // Allocate a big chunk which will be split into smaller chunks later
-     if(m_persistent == false){
-       // Not backed by a file
-       m_base = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-
-       if (m_base == MAP_FAILED) {
-	 VOLT_ERROR("MMAP : initialization error : mmap failed");
-	 throwFatalException("MMAP : initialization error : mmap failed");
-       }
-     }
-     else{
-       // Backed by a file
-
-       int MMAP_fd, ret;
-       std::string MMAP_Dir, MMAP_file_name;
-
+     if(m_persistent){
        if(m_fileName.empty()){
 	 VOLT_ERROR("MMAP : initialization error : empty fileName.");
 	 throwFatalException("MMAP : initialization error : empty fileName");
        }
 
        /** Get an unique file object for the table **/
-       MMAP_file_name  = m_fileName ;
+       std::string MMAP_file_name  = m_fileName ;
        MMAP_file_name += ".nvm" ;
 
        VOLT_WARN("MMAP : MMAP_file_name :: %s ", MMAP_file_name.c_str());
 
-       MMAP_fd = open(MMAP_file_name.c_str(), O_RDWR|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP );
-       if (MMAP_fd < 0) {
+       // kept open so the file can be extended for every new extent
+       m_fd = open(MMAP_file_name.c_str(), O_RDWR|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP );
+       if (m_fd < 0) {
 	 VOLT_ERROR("MMAP : initialization error : open failed.");
 	 throwFatalException("MMAP : initialization error : open failed");
        }
+     }
 
-       ret = ftruncate(MMAP_fd, m_size) ;
-       if(ret < 0){
-	 VOLT_ERROR("MMAP : initialization error : ftruncate failed");
-	 throwFatalException("MMAP : initialization error : ftruncate failed");
-       }
+     addExtent(m_size);
+   }
 
-       m_base = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED , MMAP_fd, 0);
+   void MMAPMemoryManager::addExtent(size_t minSize) {
+     Extent extent;
+     extent.m_size = roundUp(std::max(minSize, m_size), MMAP_PAGE_SIZE);
+     extent.m_fileOffset = m_fileSize;
+     extent.m_used = 0;
 
-       if (m_base == MAP_FAILED) {
-	 VOLT_ERROR("MMAP : initialization error : mmap failed");
-	 throwFatalException("MMAP : initialization error : mmap failed");
+     if(m_persistent == false){
+       // Not backed by a file
+       extent.m_base = static_cast<char*>(mmap(NULL, extent.m_size, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+     }
+     else{
+       // Backed by a file, each extent maps the next stretch of it
+       if(ftruncate(m_fd, static_cast<off_t>(m_fileSize + extent.m_size)) < 0){
+	 VOLT_ERROR("MMAP : initialization error : ftruncate failed");
+	 throwFatalException("MMAP : initialization error : ftruncate failed");
        }
 
-       // Can close file since mmap adds a reference to file implicitly
-       close(MMAP_fd);
+       extent.m_base = static_cast<char*>(mmap(NULL, extent.m_size, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED, m_fd, static_cast<off_t>(m_fileSize)));
      }
 
-     //VOLT_TRACE("Init m_base      : %p ",m_base);
-     //VOLT_TRACE("Init m_allocated : %ld ",m_allocated);
+     if (extent.m_base == MAP_FAILED) {
+       VOLT_ERROR("MMAP : initialization error : mmap failed");
+       throwFatalException("MMAP : initialization error : mmap failed");
+     }
 
-     assert(m_base != NULL);
-     assert(m_allocated == 0);
+     m_fileSize += extent.m_size;
+     m_extents.push_back(extent);
+     VOLT_DEBUG("MMAP : added extent %d of %lu bytes", static_cast<int>(m_extents.size()),
+                static_cast<unsigned long>(extent.m_size));
    }
 
    MMAPMemoryManager::~MMAPMemoryManager() {
-
-     if (pthread_mutex_lock(&m_mutex)) {
-       VOLT_ERROR("Failed to lock mutex in MMAPMemoryManager::~MemoryManager()\n");
-       throwFatalException("Failed to lock mutex.");
-     }
-
-     int ret;
-
-     if (m_base != NULL) {
-       ret = munmap(m_base, m_size);
-
-       if(ret != 0){
-	 VOLT_ERROR("MUNMAP : initialization error.");
-	 throwFatalException("MUNMAP : initialization error.");
+     for (std::vector<Extent>::iterator itr = m_extents.begin(); itr != m_extents.end(); ++itr) {
+       if (munmap(itr->m_base, itr->m_size) != 0) {
+	 VOLT_ERROR("MUNMAP : failed to unmap extent at %p", itr->m_base);
        }
      }
-
-     m_base = NULL;
+     m_extents.clear();
      m_allocated = 0;
 
-     if (pthread_mutex_unlock(&m_mutex)) {
-       VOLT_ERROR("Failed to unlock mutex in MMAPMemoryManager::~MemoryManager()\n");
-       throwFatalException("Failed to unlock mutex.");
+     if (m_fd >= 0) {
+       close(m_fd);
      }
    }
 
+   size_t MMAPMemoryManager::sizeClass(size_t chunkSize) {
+     if (chunkSize == 0) {
+       chunkSize = 1;
+     }
+     return roundUp(chunkSize, chunkSize < MMAP_PAGE_SIZE ? MMAP_SMALL_CLASS : MMAP_PAGE_SIZE);
+   }
+
+   size_t MMAPMemoryManager::mappedBytes() const {
+     return m_fileSize;
+   }
 
    void* MMAPMemoryManager::allocate(size_t chunkSize) {
-     if (pthread_mutex_lock(&m_mutex)) {
-       VOLT_ERROR("Failed to lock mutex in MMAPMemoryManager::allocate()\n");
-       throwFatalException("Failed to lock mutex.");
+     const size_t size = sizeClass(chunkSize);
+
+     /** Reuse a deallocated chunk of the same class first **/
+     std::map<size_t, std::vector<void*> >::iterator freeList = m_freeLists.find(size);
+     if (freeList != m_freeLists.end() && !freeList->second.empty()) {
+       void *memory = freeList->second.back();
+       freeList->second.pop_back();
+       m_allocated += size;
+       return memory;
      }
 
-     void *memory = NULL;
-
-     if (m_base == NULL) {
-       init();
+     /** Otherwise carve it out of the last extent, growing the mapping if it's full **/
+     if (m_extents.back().m_used + size > m_extents.back().m_size) {
+       addExtent(size);
      }
+     Extent &extent = m_extents.back();
+     char *memory = extent.m_base + extent.m_used;
 
      /** Update METADATA map and do the allocation **/
-     m_metadata.push_back(std::make_pair(m_allocated, chunkSize));
+     m_metadata.push_back(std::make_pair(extent.m_fileOffset + extent.m_used, size));
      m_index += 1;
 
-     /** Not an issue since we are mmap'ing **/
-     if(m_allocated + chunkSize > m_size){
-       VOLT_ERROR("No more memory available in MMAP'ed file");
-       throwFatalException("No more memory available in MMAP'ed file.");
-     }
-
-     memory = reinterpret_cast<char*> ((char*) m_base + m_allocated);
+     VOLT_TRACE("Allocated chunk at : %p ",memory);
 
-     VOLT_WARN("Allocated chunk at : %p ",memory);
-
-     m_allocated += chunkSize;
-
-     if (pthread_mutex_unlock(&m_mutex)) {
-       VOLT_ERROR("Failed to unlock mutex in MMAPMemoryManager::allocate()");
-       throwFatalException("Failed to unlock mutex.");
-     }
+     extent.m_used += size;
+     m_allocated += size;
 
      assert(memory != NULL);
      return memory;
    }
 
    void MMAPMemoryManager::deallocate(void* offset, size_t chunkSize) {
-     if (pthread_mutex_lock(&m_mutex)) {
-       printf("Failed to lock mutex in MMAPMemoryManager::deallocate()\n");
-       exit(1);
-     }
-
-     /** Update METADATA map and mark the deallocation **/
-     //m_metadata.push_back(std::make_pair(m_allocated, chunkSize));
-     //m_index += 1;
-
-     if (pthread_mutex_unlock(&m_mutex)) {
-       printf("Failed to unlock mutex in MMAPMemoryManager::deallocate()\n");
-       exit(1);
+     if (offset == NULL) {
+       return;
      }
+     const size_t size = sizeClass(chunkSize);
+     m_freeLists[size].push_back(offset);
+     assert(m_allocated >= size);
+     m_allocated -= size;
    }
 
    void MMAPMemoryManager::showMetadata(){
@@ -208,25 +195,40 @@
      }
    }
 
+   /** Only sync the part of each extent that was ever handed out **/
+   void MMAPMemoryManager::msyncExtents(int flags){
+     for (std::vector<Extent>::iterator itr = m_extents.begin(); itr != m_extents.end(); ++itr) {
+       if (itr->m_used == 0) {
+         continue;
+       }
+       int ret = msync(itr->m_base, itr->m_used, flags);
+       if(ret<0){
+	 VOLT_ERROR("msync failed with error.");
+	 throwFatalException("Failed to msync.");
+       }
+     }
+   }
 
    /** ASYNC m_sync **/
    void MMAPMemoryManager::async(){
-     /** Only sync till m_allocated **/
-     int ret = msync(m_base, m_allocated, MS_ASYNC);
-     if(ret<0){
-       VOLT_ERROR("msync failed with error.");
-       throwFatalException("Failed to msync.");
-     }
+     msyncExtents(MS_ASYNC);
    }
 
    /** SYNC m_sync **/
    void MMAPMemoryManager::sync(){
-     /** Only sync till m_allocated **/
-     int ret = msync(m_base, m_allocated, MS_SYNC);
-     if(ret<0){
-       VOLT_ERROR("msync failed with error.");
-       throwFatalException("Failed to msync.");
+     msyncExtents(MS_SYNC);
+   }
+
+   /**
+    * Start writeback in the background so the synchronous sync() at group
+    * commit has less left to write.
+    */
+   void MMAPMemoryManager::scheduledAsync(int64_t timeInMillis){
+     if (timeInMillis - m_lastAsync < ASYNC_INTERVAL_MS) {
+       return;
      }
+     m_lastAsync = timeInMillis;
+     async();
    }
 
 
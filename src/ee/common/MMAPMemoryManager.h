@@ -33,13 +33,27 @@
 #include <string>
 #include <pthread.h>
 #include <map>
+#include <vector>
 #include <utility>
 #include <algorithm>
+#include <stdint.h>
 
 using namespace std;
 
 namespace voltdb {
   
+    /**
+     * Allocator over memory mapped extents, optionally backed by a file.
+     *
+     * The mapping starts with one extent of the requested size and grows by
+     * further extents (never remapping, so handed out memory stays put).
+     * Allocations are rounded up to a size class and deallocated chunks go
+     * on a free list per size class to be handed out again.
+     *
+     * A manager belongs to a single table, pool or allocator of one
+     * partition and is only used from that partition's thread, so there is
+     * no locking.
+     */
     class MMAPMemoryManager {
     public:
 	MMAPMemoryManager();
@@ -67,26 +81,56 @@ namespace voltdb {
         void sync();
         void async();
 
+        // async() if at least ASYNC_INTERVAL_MS passed since the last
+        // scheduled one. Driven by VoltDBEngine::tick.
+        void scheduledAsync(int64_t timeInMillis);
+
+        static const int64_t ASYNC_INTERVAL_MS = 1000;
+
+        // Bytes mapped over all extents
+        size_t mappedBytes() const;
+
+        // Bytes handed out and not deallocated
+        size_t allocatedBytes() const {
+            return m_allocated;
+        }
+
+        // Size class an allocation of chunkSize is rounded up to
+        static size_t sizeClass(size_t chunkSize);
+
     private:
-        void init();
-        
-        // Base Ptr to allocated memory
-        void *m_base;
+        struct Extent {
+            char *m_base;
+            size_t m_size;
+            // where the extent starts in the file
+            size_t m_fileOffset;
+            // bump pointer, everything past it has never been handed out
+            size_t m_used;
+        };
+
+        // Map a new extent of at least minSize bytes
+        void addExtent(size_t minSize);
+        void msyncExtents(int flags);
+
+        // Size of the first extent and the minimum size of later ones
+        size_t m_size;
+        std::vector<Extent> m_extents;
 
         // Bookkeeping
-        size_t m_size;
         size_t m_allocated;
+        std::map<size_t, std::vector<void*> > m_freeLists;
+        int64_t m_lastAsync;
 
 	// For persistent Map
         std::string m_fileName;
         bool m_persistent;
+        int m_fd;
+        size_t m_fileSize;
         
-        // METADATA :: (Offset, Size)
+        // METADATA :: (Offset, Size) of every chunk carved out of an extent
         vector<pair<size_t,size_t> > m_metadata;
         size_t m_index;
 
-        static pthread_mutex_t m_mutex;
-
     };
 
 }
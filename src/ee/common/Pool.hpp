@@ -236,9 +236,10 @@ namespace voltdb {
                     if(m_enableMMAP == false){
                         delete [] m_oversizeChunks[ii].m_chunkData;
                     }
-                    /**
-                     * MMAP'ed pool will be cleaned up by its own destructor
-                     **/
+                    else{
+                        /** Hand the chunk back so the MMAP'ed pool can reuse it **/
+                        m_pool_manager->deallocate(m_oversizeChunks[ii].m_chunkData, m_oversizeChunks[ii].m_size);
+                    }
                 }
                 m_oversizeChunks.clear();
 
@@ -253,12 +254,12 @@ namespace voltdb {
                  */
                 if (numChunks > m_maxChunkCount) {
                     for (std::size_t ii = m_maxChunkCount; ii < numChunks; ii++) {
-                        if(m_enableMMAP){
+                        if(m_enableMMAP == false){
                             delete []m_chunks[ii].m_chunkData;
                         }
-                        /**
-                         * MMAP'ed pool will be cleaned up by its own destructor
-                         **/
+                        else{
+                            m_pool_manager->deallocate(m_chunks[ii].m_chunkData, m_chunks[ii].m_size);
+                        }
                     }
                     m_chunks.resize(m_maxChunkCount);
                 }
@@ -16,6 +16,7 @@
  */
 
 #include "common/RecoveryProtoMessage.h"
+#include "common/Compression.h"
 #include "common/FatalException.hpp"
 #include "common/types.h"
 #include "common/Pool.hpp"
@@ -29,11 +30,51 @@ RecoveryProtoMsg::RecoveryProtoMsg(ReferenceSerializeInput *in) :
         m_in(in),  m_type(static_cast<RecoveryMsgType>(in->readByte())),
         m_tableId(in->readInt()) {
     assert(m_in);
-    assert(m_type != RECOVERY_MSG_TYPE_SCAN_COMPLETE);
+    // the completion message carries the export stream position instead of a tuple count
+    if (m_type == RECOVERY_MSG_TYPE_COMPLETE) {
+        m_totalTupleCount = 0;
+        m_exportStreamSeqNo = in->readLong();
+        return;
+    }
     int32_t totalTupleCount = in->readInt();
     m_totalTupleCount = *reinterpret_cast<uint32_t*>(&totalTupleCount);
-    if (m_type == RECOVERY_MSG_TYPE_COMPLETE)
-        m_exportStreamSeqNo = in->readLong();
+    if (m_type == RECOVERY_MSG_TYPE_SCAN_TUPLES || m_type == RECOVERY_MSG_TYPE_SCAN_COMPLETE) {
+        decompressTuples();
+    }
+}
+
+/*
+ * If the tuples are compressed, expand them behind a copy of the tuple
+ * count and read the rest of the message from there.
+ */
+void RecoveryProtoMsg::decompressTuples() {
+    if (m_in->numBytesNotYetRead() < 2 * sizeof(int32_t)) {
+        return;
+    }
+    const int32_t tupleCount = m_in->readInt();
+    if (m_in->readInt() != COMPRESSED_MARKER) {
+        m_in->unread(2 * sizeof(int32_t));
+        return;
+    }
+
+    const int32_t rawLength = m_in->readInt();
+    const int32_t compressedLength = m_in->readInt();
+    if (rawLength < 0 || compressedLength < 0 ||
+        m_in->numBytesNotYetRead() < static_cast<size_t>(compressedLength)) {
+        throwFatalException("Malformed compressed recovery message for table %d", m_tableId);
+    }
+
+    const size_t length = sizeof(int32_t) + rawLength;
+    m_tuples.reset(new char[length]);
+    ReferenceSerializeOutput out(m_tuples.get(), length);
+    out.writeInt(tupleCount);
+    const char *compressed = reinterpret_cast<const char*>(m_in->getRawPointer(compressedLength));
+    if (!Compression::decompress(compressed, compressedLength,
+                                 m_tuples.get() + sizeof(int32_t), rawLength)) {
+        throwFatalException("Corrupt compressed recovery message for table %d", m_tableId);
+    }
+    m_tuplesIn.reset(new ReferenceSerializeInput(m_tuples.get(), length));
+    m_in = m_tuplesIn.get();
 }
 
 /*
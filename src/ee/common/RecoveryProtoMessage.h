@@ -20,6 +20,8 @@
 
 #include "common/serializeio.h"
 #include "common/tabletuple.h"
+#include "boost/scoped_array.hpp"
+#include "boost/scoped_ptr.hpp"
 
 namespace voltdb {
 class Pool;
@@ -36,10 +38,20 @@ class Pool;
  * 4 byte tuple count
  * <tuples>
  *
- * The tuple count is omitted for some message types.
+ * The tuple count is omitted for some message types. The tuples of a scan message may be
+ * block compressed (see Compression), in which case they are replaced by
+ * 4 byte COMPRESSED_MARKER
+ * 4 byte uncompressed length
+ * 4 byte compressed length
+ * <compressed tuples>
+ * The marker sits where the first tuple's length would be, which is never negative.
+ * The last message of the scan has type RECOVERY_MSG_TYPE_SCAN_COMPLETE and is
+ * otherwise laid out the same.
  */
 class RecoveryProtoMsg {
 public:
+    static const int32_t COMPRESSED_MARKER = -2;
+    static const size_t COMPRESSED_HEADER_SIZE = 3 * sizeof(int32_t);
 
     /*
      * Prepare a recovery message for reading.
@@ -66,14 +78,27 @@ public:
      */
     uint32_t totalTupleCount();
 
+    /*
+     * The message positioned at the tuple count, with the tuples
+     * already decompressed.
+     */
     ReferenceSerializeInput* stream();
 
 private:
+    void decompressTuples();
+
     /*
      * Input serializer.
      */
     ReferenceSerializeInput *m_in;
 
+    /*
+     * Tuple count and decompressed tuples of a compressed message, and
+     * the input m_in is switched to over them.
+     */
+    boost::scoped_array<char> m_tuples;
+    boost::scoped_ptr<ReferenceSerializeInput> m_tuplesIn;
+
     /*
      * Type of this recovery message
      */
@@ -16,11 +16,15 @@
  */
 
 #include "common/RecoveryProtoMessageBuilder.h"
+#include "common/RecoveryProtoMessage.h"
+#include "common/Compression.h"
 #include "common/FatalException.hpp"
 #include "common/types.h"
 #include "common/Pool.hpp"
 #include "common/TupleSerializer.h"
 
+#include <algorithm>
+
 namespace voltdb {
 /*
  * Construct a recovery message to populate with recovery data
@@ -31,14 +35,24 @@ RecoveryProtoMsgBuilder::RecoveryProtoMsgBuilder(
         uint32_t totalTupleCount,
         ReferenceSerializeOutput *out,
         TupleSerializer *serializer,
-        const TupleSchema *schema) :
-    m_out(out),
+        const TupleSchema *schema,
+        char *stagingBuffer,
+        size_t stagingCapacity) :
+    m_out(out), m_body(out),
     m_tupleCount(0), m_maxSerializedSize(serializer->getMaxSerializedTupleSize(schema)) {
     assert(m_out);
+    m_typePosition = m_out->position();
     m_out->writeByte(static_cast<int8_t>(type));
     m_out->writeInt(tableId);
     m_out->writeInt(*reinterpret_cast<int32_t*>(&totalTupleCount));
     m_tupleCountPosition = m_out->reserveBytes(sizeof(int32_t));
+
+    // leave room to fall back to the uncompressed tuples behind the compressed header
+    if (stagingBuffer != NULL && m_out->remaining() > RecoveryProtoMsg::COMPRESSED_HEADER_SIZE) {
+        const size_t capacity = m_out->remaining() - RecoveryProtoMsg::COMPRESSED_HEADER_SIZE;
+        m_staging.initializeWithPosition(stagingBuffer, std::min(capacity, stagingCapacity), 0);
+        m_body = &m_staging;
+    }
 }
 
 /*
@@ -47,19 +61,45 @@ RecoveryProtoMsgBuilder::RecoveryProtoMsgBuilder(
 void RecoveryProtoMsgBuilder::addTuple(TableTuple tuple) {
     assert(m_out);
     assert(canAddMoreTuples());
-    tuple.serializeTo(*m_out);
+    tuple.serializeTo(*m_body);
     m_tupleCount++;
 }
 
+void RecoveryProtoMsgBuilder::setMsgType(RecoveryMsgType type) {
+    m_out->writeByteAt(m_typePosition, static_cast<int8_t>(type));
+}
+
 /*
  * Write the tuple count and any other information
  */
 void RecoveryProtoMsgBuilder::finalize() {
     m_out->writeIntAt(m_tupleCountPosition, m_tupleCount);
+    if (m_body == m_out) {
+        return;
+    }
+
+    // compress straight into the message behind the space for the header
+    const size_t rawLength = m_staging.position();
+    size_t compressedLength = 0;
+    if (rawLength > RecoveryProtoMsg::COMPRESSED_HEADER_SIZE + 1) {
+        char *compressed = const_cast<char*>(m_out->data()) + m_out->position() +
+            RecoveryProtoMsg::COMPRESSED_HEADER_SIZE;
+        compressedLength = Compression::compress(m_staging.data(), rawLength, compressed,
+                rawLength - RecoveryProtoMsg::COMPRESSED_HEADER_SIZE - 1);
+    }
+
+    if (compressedLength == 0) {
+        m_out->writeBytes(m_staging.data(), rawLength);
+        return;
+    }
+    m_out->writeInt(RecoveryProtoMsg::COMPRESSED_MARKER);
+    m_out->writeInt(static_cast<int32_t>(rawLength));
+    m_out->writeInt(static_cast<int32_t>(compressedLength));
+    m_out->reserveBytes(compressedLength);
 }
 
 bool RecoveryProtoMsgBuilder::canAddMoreTuples() {
-    if (m_out->remaining() >= m_maxSerializedSize) {
+    if (m_body->remaining() >= m_maxSerializedSize) {
         return true;
     }
     return false;
@@ -20,6 +20,7 @@
 
 #include "common/types.h"
 #include "common/tabletuple.h"
+#include "common/serializeio.h"
 
 namespace voltdb {
 class Pool;
@@ -53,7 +54,9 @@ public:
                                     //Not the number in this message. Used to size hash tables.
             ReferenceSerializeOutput *out,
             TupleSerializer *serializer,
-            const TupleSchema *schema);
+            const TupleSchema *schema,
+            char *stagingBuffer = NULL,  //If provided tuples are staged here and compressed
+            size_t stagingCapacity = 0); //into out by finalize()
 
     /*
      * Return true if another max size tuple can fit
@@ -66,7 +69,14 @@ public:
     void addTuple(TableTuple tuple);
 
     /*
-     * Write the tuple count and any other information
+     * Change the message type written at construction, e.g. to mark the last
+     * message of the scan once it is known to be the last.
+     */
+    void setMsgType(RecoveryMsgType type);
+
+    /*
+     * Write the tuple count and any other information. Compresses staged tuples
+     * into the message when that makes it smaller.
      */
     void finalize();
 
@@ -76,6 +86,21 @@ private:
      */
     ReferenceSerializeOutput *m_out;
 
+    /*
+     * Where tuples are serialized to. Either m_out or m_staging.
+     */
+    ReferenceSerializeOutput *m_body;
+
+    /*
+     * Staging buffer for tuples that will be compressed
+     */
+    ReferenceSerializeOutput m_staging;
+
+    /*
+     * Position of the message type byte
+     */
+    size_t m_typePosition;
+
     /*
      * Position to put the count of tuples @ once serialization is complete.
      */
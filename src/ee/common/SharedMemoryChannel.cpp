@@ -0,0 +1,338 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/SharedMemoryChannel.h"
+#include "common/FatalException.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace voltdb {
+
+/*
+ * Control block of one ring. Positions count every byte ever written or
+ * read, so head - tail is the fill level and neither wraps in practice.
+ * The producer and consumer halves sit on separate cache lines.
+ */
+struct SharedMemoryRing {
+    // written by the producer
+    uint64_t head;
+    uint32_t dataSeq;         // bumped after each write, the reader's futex word
+    uint32_t readerWaiting;
+    char pad0[48];
+
+    // written by the consumer
+    uint64_t tail;
+    uint32_t spaceSeq;        // bumped after each read, the writer's futex word
+    uint32_t writerWaiting;
+    char pad1[48];
+};
+
+/*
+ * Start of the mapping. The ring data follows at HEADER_SIZE, client to
+ * engine first.
+ */
+struct SharedMemoryRegion {
+    uint32_t magic;           // stored last by create()
+    uint32_t closed;
+    uint64_t ringCapacity;
+    char pad[48];
+    SharedMemoryRing rings[2];
+};
+
+namespace {
+
+const size_t HEADER_SIZE = 4096;
+const size_t MIN_RING_CAPACITY = 4096;
+const uint32_t MIN_SPINS = 64;
+const uint32_t INITIAL_SPINS = 1 << 12;
+const uint32_t MAX_SPINS = 1 << 16;
+
+// sleeps are bounded so a side notices the other closing without a wakeup
+const long WAIT_TIMEOUT_NS = 100 * 1000 * 1000;
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#endif
+}
+
+inline uint64_t loadAcquire(const uint64_t *value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+#ifdef __linux__
+void futexWait(uint32_t *word, uint32_t expected) {
+    struct timespec timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = WAIT_TIMEOUT_NS;
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+void futexWake(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+#else
+void futexWait(uint32_t *word, uint32_t expected) {
+    ::usleep(50);
+}
+
+void futexWake(uint32_t *word) {
+}
+#endif
+
+/*
+ * Bump a futex word and wake the other side if it went to sleep on it.
+ * Sequentially consistent so that either the sleeper sees the new
+ * position or this sees it waiting.
+ */
+void signal(uint32_t *seq, uint32_t *waiting) {
+    __atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST) != 0) {
+        futexWake(seq);
+    }
+}
+
+}
+
+SharedMemoryChannel* SharedMemoryChannel::create(const std::string &path, size_t ringCapacity) {
+    size_t capacity = MIN_RING_CAPACITY;
+    while (capacity < ringCapacity) {
+        capacity <<= 1;
+    }
+    const size_t mappedSize = HEADER_SIZE + 2 * capacity;
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        throwFatalException("Failed to create shared memory channel %s: %s",
+                            path.c_str(), strerror(errno));
+    }
+    if (::ftruncate(fd, static_cast<off_t>(mappedSize)) != 0) {
+        ::close(fd);
+        throwFatalException("Failed to size shared memory channel %s: %s",
+                            path.c_str(), strerror(errno));
+    }
+    void *base = ::mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        throwFatalException("Failed to map shared memory channel %s: %s",
+                            path.c_str(), strerror(errno));
+    }
+
+    // the file is zero filled, which is an empty ring with nobody waiting
+    SharedMemoryRegion *region = static_cast<SharedMemoryRegion*>(base);
+    region->ringCapacity = capacity;
+    __atomic_store_n(&region->magic, MAGIC, __ATOMIC_RELEASE);
+    return new SharedMemoryChannel(region, mappedSize, true);
+}
+
+SharedMemoryChannel* SharedMemoryChannel::open(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        throwFatalException("Failed to open shared memory channel %s: %s",
+                            path.c_str(), strerror(errno));
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < HEADER_SIZE) {
+        ::close(fd);
+        throwFatalException("Shared memory channel %s is too small", path.c_str());
+    }
+    const size_t mappedSize = static_cast<size_t>(status.st_size);
+    void *base = ::mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        throwFatalException("Failed to map shared memory channel %s: %s",
+                            path.c_str(), strerror(errno));
+    }
+
+    SharedMemoryRegion *region = static_cast<SharedMemoryRegion*>(base);
+    if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != MAGIC ||
+        mappedSize != HEADER_SIZE + 2 * region->ringCapacity) {
+        ::munmap(base, mappedSize);
+        throwFatalException("Shared memory channel %s is not initialized", path.c_str());
+    }
+    return new SharedMemoryChannel(region, mappedSize, false);
+}
+
+SharedMemoryChannel::SharedMemoryChannel(SharedMemoryRegion *region, size_t mappedSize, bool client) :
+    m_region(region), m_mappedSize(mappedSize),
+    m_readSpins(INITIAL_SPINS), m_writeSpins(INITIAL_SPINS)
+{
+    char *data = reinterpret_cast<char*>(region) + HEADER_SIZE;
+    const size_t capacity = static_cast<size_t>(region->ringCapacity);
+    SharedMemoryRing *toEngine = &region->rings[0];
+    SharedMemoryRing *toClient = &region->rings[1];
+    m_in = client ? toClient : toEngine;
+    m_out = client ? toEngine : toClient;
+    m_inData = client ? data + capacity : data;
+    m_outData = client ? data : data + capacity;
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+    close();
+    ::munmap(m_region, m_mappedSize);
+}
+
+size_t SharedMemoryChannel::ringCapacity() const {
+    return static_cast<size_t>(m_region->ringCapacity);
+}
+
+void SharedMemoryChannel::close() {
+    __atomic_store_n(&m_region->closed, 1, __ATOMIC_SEQ_CST);
+    for (int ii = 0; ii < 2; ii++) {
+        __atomic_fetch_add(&m_region->rings[ii].dataSeq, 1, __ATOMIC_SEQ_CST);
+        futexWake(&m_region->rings[ii].dataSeq);
+        __atomic_fetch_add(&m_region->rings[ii].spaceSeq, 1, __ATOMIC_SEQ_CST);
+        futexWake(&m_region->rings[ii].spaceSeq);
+    }
+}
+
+bool SharedMemoryChannel::read(void *data, size_t length) {
+    char *dest = static_cast<char*>(data);
+    const size_t capacity = ringCapacity();
+    while (length > 0) {
+        const uint64_t tail = m_in->tail;
+        const uint64_t available = loadAcquire(&m_in->head) - tail;
+        if (available == 0) {
+            if (!waitForData(m_in)) {
+                return false;
+            }
+            continue;
+        }
+
+        const size_t chunk = available < length ? static_cast<size_t>(available) : length;
+        const size_t offset = static_cast<size_t>(tail & (capacity - 1));
+        const size_t first = chunk < capacity - offset ? chunk : capacity - offset;
+        ::memcpy(dest, m_inData + offset, first);
+        ::memcpy(dest + first, m_inData, chunk - first);
+        __atomic_store_n(&m_in->tail, tail + chunk, __ATOMIC_SEQ_CST);
+        signal(&m_in->spaceSeq, &m_in->writerWaiting);
+
+        dest += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool SharedMemoryChannel::write(const void *data, size_t length) {
+    const char *source = static_cast<const char*>(data);
+    const size_t capacity = ringCapacity();
+    while (length > 0) {
+        if (__atomic_load_n(&m_region->closed, __ATOMIC_ACQUIRE) != 0) {
+            return false;
+        }
+        const uint64_t head = m_out->head;
+        const uint64_t space = capacity - (head - loadAcquire(&m_out->tail));
+        if (space == 0) {
+            if (!waitForSpace(m_out)) {
+                return false;
+            }
+            continue;
+        }
+
+        const size_t chunk = space < length ? static_cast<size_t>(space) : length;
+        const size_t offset = static_cast<size_t>(head & (capacity - 1));
+        const size_t first = chunk < capacity - offset ? chunk : capacity - offset;
+        ::memcpy(m_outData + offset, source, first);
+        ::memcpy(m_outData, source + first, chunk - first);
+        __atomic_store_n(&m_out->head, head + chunk, __ATOMIC_SEQ_CST);
+        signal(&m_out->dataSeq, &m_out->readerWaiting);
+
+        source += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+/*
+ * Spin, then sleep until the ring has data. Returns false if the channel
+ * was closed with nothing left to read. The spin budget doubles when
+ * data shows up while spinning and halves when it didn't.
+ */
+bool SharedMemoryChannel::waitForData(SharedMemoryRing *ring) {
+    for (uint32_t ii = 0; ii < m_readSpins; ii++) {
+        if (loadAcquire(&ring->head) != ring->tail) {
+            m_readSpins = m_readSpins < MAX_SPINS ? m_readSpins * 2 : MAX_SPINS;
+            return true;
+        }
+        cpuRelax();
+    }
+    m_readSpins = m_readSpins > MIN_SPINS ? m_readSpins / 2 : MIN_SPINS;
+
+    while (true) {
+        const uint32_t seq = __atomic_load_n(&ring->dataSeq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&ring->readerWaiting, 1, __ATOMIC_SEQ_CST);
+        const bool ready = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) != ring->tail;
+        // data written before the other side closed is still delivered
+        const bool closed = __atomic_load_n(&m_region->closed, __ATOMIC_SEQ_CST) != 0;
+        if (!ready && !closed) {
+            futexWait(&ring->dataSeq, seq);
+        }
+        __atomic_store_n(&ring->readerWaiting, 0, __ATOMIC_RELAXED);
+        if (ready) {
+            return true;
+        }
+        if (closed) {
+            return loadAcquire(&ring->head) != ring->tail;
+        }
+    }
+}
+
+/*
+ * Counterpart of waitForData() for a full ring.
+ */
+bool SharedMemoryChannel::waitForSpace(SharedMemoryRing *ring) {
+    const uint64_t capacity = m_region->ringCapacity;
+    for (uint32_t ii = 0; ii < m_writeSpins; ii++) {
+        if (ring->head - loadAcquire(&ring->tail) < capacity) {
+            m_writeSpins = m_writeSpins < MAX_SPINS ? m_writeSpins * 2 : MAX_SPINS;
+            return true;
+        }
+        cpuRelax();
+    }
+    m_writeSpins = m_writeSpins > MIN_SPINS ? m_writeSpins / 2 : MIN_SPINS;
+
+    while (true) {
+        const uint32_t seq = __atomic_load_n(&ring->spaceSeq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&ring->writerWaiting, 1, __ATOMIC_SEQ_CST);
+        const bool ready = ring->head - __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) < capacity;
+        const bool closed = __atomic_load_n(&m_region->closed, __ATOMIC_SEQ_CST) != 0;
+        if (!ready && !closed) {
+            futexWait(&ring->spaceSeq, seq);
+        }
+        __atomic_store_n(&ring->writerWaiting, 0, __ATOMIC_RELAXED);
+        if (closed) {
+            return false;
+        }
+        if (ready) {
+            return true;
+        }
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAREDMEMORYCHANNEL_H
+#define SHAREDMEMORYCHANNEL_H
+
+#include <cstddef>
+#include <string>
+#include <stdint.h>
+
+namespace voltdb
+{
+    struct SharedMemoryRing;
+    struct SharedMemoryRegion;
+
+    /// Byte stream between two processes over a pair of single
+    /// producer, single consumer ring buffers in a shared file
+    /// mapping, used by voltdbipc in place of the TCP socket. The
+    /// stream carries exactly what the socket did, so the ipc_command
+    /// framing is unchanged; a read or write only makes a system
+    /// call when it has to sleep or wake the other side.
+    ///
+    /// A blocked side spins for a while, adapting the spin to how
+    /// long it recently had to wait, and then sleeps on a futex
+    /// (polls with short sleeps on platforms without one).
+    ///
+    /// The client creates the region and the engine opens it; each
+    /// side writes the ring the other reads. Not thread safe: one
+    /// reader and one writer per process.
+    class SharedMemoryChannel
+    {
+    public:
+        static const uint32_t MAGIC = 0x564f4c54;
+        static const size_t DEFAULT_RING_CAPACITY = 1024 * 1024;
+
+        /// Create, size and initialize the region at path and map it
+        /// as the client. ringCapacity is rounded up to a power of
+        /// two. Throws a FatalException on failure.
+        static SharedMemoryChannel* create(const std::string &path,
+                                           size_t ringCapacity = DEFAULT_RING_CAPACITY);
+
+        /// Map a region created by the client, as the engine. Throws
+        /// a FatalException on failure.
+        static SharedMemoryChannel* open(const std::string &path);
+
+        /// Closes the channel and unmaps the region
+        ~SharedMemoryChannel();
+
+        /// Block until length bytes have been read. Returns false if
+        /// the other side closed the channel first.
+        bool read(void *data, size_t length);
+
+        /// Block until length bytes have been written. Returns false
+        /// if the other side closed the channel.
+        bool write(const void *data, size_t length);
+
+        /// Tell the other side no more data is coming and wake it
+        void close();
+
+        size_t ringCapacity() const;
+
+    private:
+        SharedMemoryChannel(SharedMemoryRegion *region, size_t mappedSize, bool client);
+
+        bool waitForData(SharedMemoryRing *ring);
+        bool waitForSpace(SharedMemoryRing *ring);
+
+        SharedMemoryRegion *m_region;
+        const size_t m_mappedSize;
+        SharedMemoryRing *m_in;
+        SharedMemoryRing *m_out;
+        char *m_inData;
+        char *m_outData;
+
+        // spin iterations before sleeping, per direction
+        uint32_t m_readSpins;
+        uint32_t m_writeSpins;
+    };
+}
+
+#endif // SHAREDMEMORYCHANNEL_H
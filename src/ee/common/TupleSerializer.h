@@ -37,6 +37,14 @@ public:
      */
     virtual int getMaxSerializedTupleSize(const TupleSchema *schema) = 0;
 
+    /**
+     * True if a COW snapshot may copy raw tuple blocks (see TupleBlockFormat)
+     * instead of calling serializeTo for each tuple
+     */
+    virtual bool blockCopyEnabled() {
+        return false;
+    }
+
     virtual ~TupleSerializer() {}
 };
 }
@@ -314,7 +314,9 @@ enum TableStreamType {
 // ------------------------------------------------------------------
 enum StatisticsSelectorType {
     STATISTICS_SELECTOR_TYPE_TABLE,
-    STATISTICS_SELECTOR_TYPE_INDEX
+    STATISTICS_SELECTOR_TYPE_INDEX,
+    // must match the ordinal of SysProcSelector.PLANFRAGMENTPROFILER
+    STATISTICS_SELECTOR_TYPE_PLANFRAGMENT = 20
 };
 
 // ------------------------------------------------------------------
@@ -326,7 +328,7 @@ enum RecoveryMsgType {
      */
     RECOVERY_MSG_TYPE_SCAN_TUPLES = 0,
     /*
-     * Message indicating that the table scan is complete, future polling
+     * Last message of the table scan, with its final tuples. Future polling
      * will produce delta data
      */
     RECOVERY_MSG_TYPE_SCAN_COMPLETE = 1,
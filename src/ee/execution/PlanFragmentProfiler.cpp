@@ -0,0 +1,141 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <sstream>
+#include "execution/PlanFragmentProfiler.h"
+#include "execution/PlanFragmentStats.h"
+#include "common/executorcontext.hpp"
+#include "executors/abstractexecutor.h"
+#include "indexes/tableindex.h"
+#include "plannodes/abstractplannode.h"
+#include "plannodes/abstractscannode.h"
+#include "stats/StatsAgent.h"
+#include "storage/table.h"
+#include "storage/temptable.h"
+
+using namespace voltdb;
+using namespace std;
+
+static inline uint64_t rdtsc() {
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (((uint64_t)hi << 32) | lo);
+}
+
+PlanFragmentProfiler::PlanFragmentProfiler(StatsAgent &statsAgent)
+    : m_statsAgent(statsAgent), m_executorContext(NULL), m_enabled(false)
+{
+}
+
+PlanFragmentProfiler::~PlanFragmentProfiler()
+{
+    m_statsAgent.unregisterStatsSource(STATISTICS_SELECTOR_TYPE_PLANFRAGMENT);
+    for (StatsMap::iterator i = m_stats.begin(); i != m_stats.end(); i++) {
+        delete i->second;
+    }
+}
+
+void PlanFragmentProfiler::start(AbstractExecutor *executor, Sample &sample) const
+{
+    sample.tuplesIn = 0;
+    AbstractPlanNode *node = executor->getPlanNode();
+    vector<Table*> &inputTables = node->getInputTables();
+    for (int i = 0; i < inputTables.size(); i++) {
+        sample.tuplesIn += inputTables[i]->activeTupleCount();
+    }
+    // scans of a persistent table have no input tables, they read the target
+    if (inputTables.empty()) {
+        AbstractScanPlanNode *scanNode = dynamic_cast<AbstractScanPlanNode*>(node);
+        if (scanNode != NULL && scanNode->getTargetTable() != NULL)
+            sample.tuplesIn = scanNode->getTargetTable()->activeTupleCount();
+    }
+    TableIndex *index = executor->getProbedIndex();
+    sample.indexProbes = (index != NULL) ? index->getLookupCount() : 0;
+
+    // read the clock last so the bookkeeping above is not charged to the executor
+    sample.startCycles = rdtsc();
+}
+
+void PlanFragmentProfiler::stop(int64_t planFragmentId, AbstractExecutor *executor,
+                                const Sample &sample)
+{
+    uint64_t cycles = rdtsc() - sample.startCycles;
+
+    AbstractPlanNode *node = executor->getPlanNode();
+    Table *outputTable = node->getOutputTable();
+    int64_t tuplesOut = (outputTable != NULL) ? outputTable->activeTupleCount() : 0;
+
+    // rows streamed into the result buffer never reach the table
+    TempTable *tempTable = executor->getTempOutputTable();
+    if (tempTable != NULL && tempTable == outputTable)
+        tuplesOut += tempTable->streamedTupleCount();
+    int64_t tempTableBytes = (tempTable != NULL) ?
+        tempTable->occupiedTupleMemory() + tempTable->nonInlinedMemorySize() : 0;
+
+    TableIndex *index = executor->getProbedIndex();
+    int64_t indexProbes = (index != NULL) ? index->getLookupCount() - sample.indexProbes : 0;
+
+    getStats(planFragmentId, node->getPlanNodeType())->addSample(
+        static_cast<int64_t>(cycles), sample.tuplesIn, tuplesOut, tempTableBytes, indexProbes);
+}
+
+void PlanFragmentProfiler::getStatsIds(int64_t planFragmentId,
+                                       std::vector<CatalogId> &statsIds) const
+{
+    for (std::size_t ii = 0; ii < m_statsIds.size(); ii++) {
+        if (m_statsFragmentIds[ii] == planFragmentId) {
+            statsIds.push_back(m_statsIds[ii]);
+        }
+    }
+}
+
+PlanFragmentStats* PlanFragmentProfiler::getStats(int64_t planFragmentId,
+                                                  PlanNodeType planNodeType)
+{
+    pair<int64_t, PlanNodeType> key(planFragmentId, planNodeType);
+    StatsMap::iterator i = m_stats.find(key);
+    if (i != m_stats.end()) {
+        return i->second;
+    }
+
+    PlanFragmentStats *stats = new PlanFragmentStats(planFragmentId, planNodeType);
+    std::ostringstream name;
+    name << "PlanFragment " << planFragmentId << " " << planNodeToString(planNodeType) << " stats";
+    assert(m_executorContext);
+    stats->configure(name.str(),
+                     m_executorContext->m_hostId,
+                     m_executorContext->m_hostname,
+                     m_executorContext->m_siteId,
+                     m_executorContext->m_partitionId,
+                     1);
+
+    // fragment ids are 64-bit, so the StatsAgent key is just a running count
+    CatalogId statsId = static_cast<CatalogId>(m_statsIds.size());
+    m_statsAgent.registerStatsSource(STATISTICS_SELECTOR_TYPE_PLANFRAGMENT, statsId, stats);
+    m_statsIds.push_back(statsId);
+    m_statsFragmentIds.push_back(planFragmentId);
+    m_stats[key] = stats;
+    return stats;
+}
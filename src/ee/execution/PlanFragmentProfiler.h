@@ -0,0 +1,104 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTOREPLANFRAGMENTPROFILER_H
+#define HSTOREPLANFRAGMENTPROFILER_H
+
+#include "common/ids.h"
+#include "common/types.h"
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace voltdb {
+
+class AbstractExecutor;
+class ExecutorContext;
+class PlanFragmentStats;
+class StatsAgent;
+
+/**
+ * Runtime-toggleable profiler for plan fragment execution. While enabled,
+ * VoltDBEngine::executeQuery brackets every executor with start()/stop()
+ * and the measurements are aggregated per (plan fragment, plan node type).
+ * Each aggregate is a PlanFragmentStats registered with the StatsAgent under
+ * STATISTICS_SELECTOR_TYPE_PLANFRAGMENT. When disabled the only cost is the
+ * isEnabled() check per executor.
+ */
+class PlanFragmentProfiler {
+public:
+    /**
+     * Measurements taken right before an executor runs.
+     */
+    struct Sample {
+        uint64_t startCycles;
+        int64_t tuplesIn;
+        int64_t indexProbes;
+    };
+
+    PlanFragmentProfiler(StatsAgent &statsAgent);
+    ~PlanFragmentProfiler();
+
+    /**
+     * Host, site and partition information for the stats rows.
+     */
+    void configure(ExecutorContext *executorContext) {
+        m_executorContext = executorContext;
+    }
+
+    inline bool isEnabled() const { return m_enabled; }
+    inline void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    void start(AbstractExecutor *executor, Sample &sample) const;
+    void stop(int64_t planFragmentId, AbstractExecutor *executor, const Sample &sample);
+
+    /**
+     * Ids under which the profiled fragments are registered with the StatsAgent.
+     */
+    const std::vector<CatalogId>& getStatsIds() const { return m_statsIds; }
+
+    /**
+     * Append the ids of the aggregates of one plan fragment, one per plan
+     * node type it has run. Nothing is appended for a fragment that has not
+     * been profiled.
+     */
+    void getStatsIds(int64_t planFragmentId, std::vector<CatalogId> &statsIds) const;
+
+private:
+    PlanFragmentStats* getStats(int64_t planFragmentId, PlanNodeType planNodeType);
+
+    typedef std::map<std::pair<int64_t, PlanNodeType>, PlanFragmentStats*> StatsMap;
+
+    StatsAgent &m_statsAgent;
+    ExecutorContext *m_executorContext;
+    bool m_enabled;
+    StatsMap m_stats;
+    std::vector<CatalogId> m_statsIds;
+    std::vector<int64_t> m_statsFragmentIds;
+};
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "execution/PlanFragmentStats.h"
+#include "stats/StatsSource.h"
+#include "common/TupleSchema.h"
+#include "common/ids.h"
+#include "common/ValueFactory.hpp"
+#include "common/tabletuple.h"
+
+using namespace voltdb;
+using namespace std;
+
+static const char* const COUNTER_COLUMNS[] = {
+    "INVOCATIONS",
+    "CYCLES",
+    "TUPLES_IN",
+    "TUPLES_OUT",
+    "TEMP_TABLE_BYTES",
+    "INDEX_PROBES"
+};
+static const int TEMP_TABLE_BYTES_COUNTER = 4;
+static const int COUNTER_COLUMN_COUNT =
+    static_cast<int>(sizeof(COUNTER_COLUMNS) / sizeof(COUNTER_COLUMNS[0]));
+
+vector<string> PlanFragmentStats::generatePlanFragmentStatsColumnNames() {
+    vector<string> columnNames = StatsSource::generateBaseStatsColumnNames();
+    columnNames.push_back("PLAN_FRAGMENT_ID");
+    columnNames.push_back("PLAN_NODE_TYPE");
+    for (int i = 0; i < COUNTER_COLUMN_COUNT; i++) {
+        columnNames.push_back(COUNTER_COLUMNS[i]);
+    }
+    return columnNames;
+}
+
+void PlanFragmentStats::populatePlanFragmentStatsSchema(
+        vector<ValueType> &types,
+        vector<int32_t> &columnLengths,
+        vector<bool> &allowNull) {
+    StatsSource::populateBaseSchema(types, columnLengths, allowNull);
+
+    // plan fragment id
+    types.push_back(VALUE_TYPE_BIGINT);
+    columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+    allowNull.push_back(false);
+
+    // plan node type
+    types.push_back(VALUE_TYPE_VARCHAR);
+    columnLengths.push_back(4096);
+    allowNull.push_back(false);
+
+    // counters
+    for (int i = 0; i < COUNTER_COLUMN_COUNT; i++) {
+        types.push_back(VALUE_TYPE_BIGINT);
+        columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        allowNull.push_back(false);
+    }
+}
+
+PlanFragmentStats::PlanFragmentStats(int64_t planFragmentId, PlanNodeType planNodeType)
+    : StatsSource(), m_planFragmentId(planFragmentId),
+      m_invocations(0), m_cycles(0), m_tuplesIn(0), m_tuplesOut(0),
+      m_tempTableBytes(0), m_indexProbes(0),
+      m_lastInvocations(0), m_lastCycles(0), m_lastTuplesIn(0), m_lastTuplesOut(0),
+      m_lastIndexProbes(0), m_intervalTempTableBytes(0)
+{
+    m_planNodeType = ValueFactory::getStringValue(planNodeToString(planNodeType));
+}
+
+vector<string> PlanFragmentStats::generateStatsColumnNames()
+{
+    return PlanFragmentStats::generatePlanFragmentStatsColumnNames();
+}
+
+/**
+ * Update the stats tuple with the latest statistics available to this StatsSource.
+ */
+void PlanFragmentStats::updateStatsTuple(TableTuple *tuple) {
+    tuple->setNValue(StatsSource::m_columnName2Index["PLAN_FRAGMENT_ID"],
+                     ValueFactory::getBigIntValue(m_planFragmentId));
+    tuple->setNValue(StatsSource::m_columnName2Index["PLAN_NODE_TYPE"], m_planNodeType);
+
+    int64_t counters[] = { m_invocations, m_cycles, m_tuplesIn, m_tuplesOut,
+                           m_tempTableBytes, m_indexProbes };
+    if (interval()) {
+        int64_t last[] = { m_lastInvocations, m_lastCycles, m_lastTuplesIn, m_lastTuplesOut,
+                           0, m_lastIndexProbes };
+        m_lastInvocations = m_invocations;
+        m_lastCycles = m_cycles;
+        m_lastTuplesIn = m_tuplesIn;
+        m_lastTuplesOut = m_tuplesOut;
+        m_lastIndexProbes = m_indexProbes;
+        for (int i = 0; i < COUNTER_COLUMN_COUNT; i++) {
+            counters[i] -= last[i];
+        }
+        // a peak isn't a difference, it starts over with each interval
+        counters[TEMP_TABLE_BYTES_COUNTER] = m_intervalTempTableBytes;
+        m_intervalTempTableBytes = 0;
+    }
+
+    for (int i = 0; i < COUNTER_COLUMN_COUNT; i++) {
+        tuple->setNValue(StatsSource::m_columnName2Index[COUNTER_COLUMNS[i]],
+                         ValueFactory::getBigIntValue(counters[i]));
+    }
+}
+
+/**
+ * Same pattern as generateStatsColumnNames except the return value is used as an offset into
+ * the tuple schema instead of appending to end of a list.
+ */
+void PlanFragmentStats::populateSchema(
+        vector<ValueType> &types,
+        vector<int32_t> &columnLengths,
+        vector<bool> &allowNull)
+{
+    PlanFragmentStats::populatePlanFragmentStatsSchema(types, columnLengths, allowNull);
+}
+
+PlanFragmentStats::~PlanFragmentStats() {
+    m_planNodeType.free();
+}
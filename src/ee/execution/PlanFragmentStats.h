@@ -0,0 +1,119 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTOREPLANFRAGMENTSTATS_H
+#define HSTOREPLANFRAGMENTSTATS_H
+
+#include "stats/StatsSource.h"
+#include "common/ids.h"
+#include "common/types.h"
+#include <vector>
+#include <string>
+
+namespace voltdb {
+
+/**
+ * StatsSource extension for the executors of one plan node type within
+ * one plan fragment. Counters are filled in by the PlanFragmentProfiler.
+ */
+class PlanFragmentStats : public voltdb::StatsSource {
+public:
+    /**
+     * Static method to generate the column names for the tables which
+     * contain plan fragment profiling stats.
+     */
+    static std::vector<std::string> generatePlanFragmentStatsColumnNames();
+
+    /**
+     * Static method to generate the remaining schema information for
+     * the tables which contain plan fragment profiling stats.
+     */
+    static void populatePlanFragmentStatsSchema(std::vector<voltdb::ValueType>& types,
+                                                std::vector<int32_t>& columnLengths,
+                                                std::vector<bool>& allowNull);
+
+    PlanFragmentStats(int64_t planFragmentId, voltdb::PlanNodeType planNodeType);
+
+    ~PlanFragmentStats();
+
+    /**
+     * Account one execution of an executor of this plan node type.
+     */
+    inline void addSample(int64_t cycles, int64_t tuplesIn, int64_t tuplesOut,
+                          int64_t tempTableBytes, int64_t indexProbes) {
+        m_invocations++;
+        m_cycles += cycles;
+        m_tuplesIn += tuplesIn;
+        m_tuplesOut += tuplesOut;
+        if (tempTableBytes > m_tempTableBytes)
+            m_tempTableBytes = tempTableBytes;
+        if (tempTableBytes > m_intervalTempTableBytes)
+            m_intervalTempTableBytes = tempTableBytes;
+        m_indexProbes += indexProbes;
+    }
+
+protected:
+
+    /**
+     * Update the stats tuple with the latest statistics available to this StatsSource.
+     */
+    virtual void updateStatsTuple(voltdb::TableTuple *tuple);
+
+    /**
+     * Generates the list of column names that will be in the statTable_.
+     */
+    virtual std::vector<std::string> generateStatsColumnNames();
+
+    /**
+     * Same pattern as generateStatsColumnNames except the return value is used as an offset into the tuple schema instead of appending to
+     * end of a list.
+     */
+    virtual void populateSchema(std::vector<voltdb::ValueType> &types, std::vector<int32_t> &columnLengths, std::vector<bool> &allowNull);
+
+private:
+    int64_t m_planFragmentId;
+    voltdb::NValue m_planNodeType;
+
+    int64_t m_invocations;
+    int64_t m_cycles;
+    int64_t m_tuplesIn;
+    int64_t m_tuplesOut;
+    // largest output temp table of any one execution
+    int64_t m_tempTableBytes;
+    int64_t m_indexProbes;
+
+    // values reported by the last interval request
+    int64_t m_lastInvocations;
+    int64_t m_lastCycles;
+    int64_t m_lastTuplesIn;
+    int64_t m_lastTuplesOut;
+    int64_t m_lastIndexProbes;
+    // peak since the last interval request
+    int64_t m_intervalTempTableBytes;
+};
+
+}
+
+#endif
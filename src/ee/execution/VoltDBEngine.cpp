@@ -92,6 +92,7 @@
 #include "executors/executorutil.h"
 #include "storage/table.h"
 #include "storage/tablefactory.h"
+#include "storage/temptable.h"
 #include "indexes/tableindex.h"
 #include "storage/constraintutil.h"
 #include "storage/persistenttable.h"
@@ -106,7 +107,9 @@
 // ARIES
 #include "logging/Logrecord.h"
 #include "logging/AriesLogProxy.h"
+#include "logging/AriesReplayer.h"
 #include <string>
+#include <set>
 
 #define BUFFER_SIZE         1024*1024*300    // 100 MB buffer for reading in log file
 
@@ -122,10 +125,12 @@ VoltDBEngine::VoltDBEngine(Topend *topend, LogProxy *logProxy) :
         m_currentOutputDepId(-1),
         m_currentInputDepId(-1),
         m_isELEnabled(false),
+        m_profiler(m_statsManager),
         m_stringPool(16777216, 2),
         m_numResultDependencies(0),
         m_templateSingleLongTable(NULL),
         m_topend(topend),
+        m_tupleSerializer(true),
         m_logProxy(logProxy),
         m_logManager(new LogManager(logProxy)),
         m_ARIESEnabled(false) {
@@ -170,6 +175,7 @@ bool VoltDBEngine::initialize(int32_t clusterIndex, int32_t siteId,
     m_executorContext = new ExecutorContext(siteId, m_partitionId,
             m_currentUndoQuantum, getTopend(), m_isELEnabled, 0, /* epoch not yet known */
             hostname, hostId);
+    m_profiler.configure(m_executorContext);
 
     return true;
 }
@@ -253,6 +259,14 @@ Table* VoltDBEngine::getTable(string name) const {
     return NULL;
 }
 
+int32_t VoltDBEngine::getTableId(const std::string &name) const {
+    catalog::Table *catTable = m_database->tables().get(name);
+    if (catTable != NULL) {
+        return catTable->relativeIndex();
+    }
+    return -1;
+}
+
 bool VoltDBEngine::serializeTable(int32_t tableId, SerializeOutput* out) const {
     // Just look in our list of tables
     map<int32_t, Table*>::const_iterator lookup = m_tables.find(tableId);
@@ -274,6 +288,7 @@ int VoltDBEngine::executeQuery(int64_t planfragmentId,
         const NValueArray &params, int64_t txnId, int64_t lastCommittedTxnId,
         bool first, bool last) {
     Table *cleanUpTable = NULL;
+    shareLoadedIndexStages();
     m_currentOutputDepId = outputDependencyId;
     m_currentInputDepId = inputDependencyId;
 
@@ -325,6 +340,12 @@ int VoltDBEngine::executeQuery(int64_t planfragmentId,
     assert(iter != m_executorMap.end());
     boost::shared_ptr<ExecutorVector> execsForFrag = iter->second;
 
+    ResultTableStreamGuard resultStreamGuard(m_resultStream);
+    if (execsForFrag->resultStreamTable != NULL) {
+        m_resultStream.open(&m_resultOutput, execsForFrag->resultStreamTable,
+                m_currentOutputDepId);
+    }
+
     // Read/Write Set Tracking
     ReadWriteTracker *tracker = NULL;
     if (m_executorContext->isTrackingEnabled()) {
@@ -369,7 +390,16 @@ int VoltDBEngine::executeQuery(int64_t planfragmentId,
             try {
                 // Now call the execute method to actually perform whatever action
                 // it is that the node is supposed to do...
-                if (!executor->execute(params, tracker)) {
+                bool success;
+                if (m_profiler.isEnabled()) {
+                    PlanFragmentProfiler::Sample sample;
+                    m_profiler.start(executor, sample);
+                    success = executor->execute(params, tracker);
+                    m_profiler.stop(planfragmentId, executor, sample);
+                } else {
+                    success = executor->execute(params, tracker);
+                }
+                if (!success) {
                     VOLT_DEBUG(
                             "The Executor's execution at position '%d' failed for PlanFragment '%jd'",
                             ctr, (intmax_t)planfragmentId);
@@ -385,6 +415,8 @@ int VoltDBEngine::executeQuery(int64_t planfragmentId,
                         "The Executor's execution at position '%d' failed for PlanFragment '%jd'",
                         ctr, (intmax_t)planfragmentId);
                 VOLT_INFO("SerializableEEException: %s", e.message().c_str());
+                // rewind before the buffer is reset, not after
+                m_resultStream.abandon();
                 if (cleanUpTable != NULL)
                     cleanUpTable->deleteAllTuples(false);
                 resetReusedResultOutputBuffer();
@@ -397,6 +429,8 @@ int VoltDBEngine::executeQuery(int64_t planfragmentId,
             }
         }
     }
+    // a fragment whose send never ran leaves no partial table behind
+    m_resultStream.abandon();
     if (cleanUpTable != NULL)
         cleanUpTable->deleteAllTuples(false);
 
@@ -447,6 +481,7 @@ int VoltDBEngine::executePlanFragment(string fragmentString,
         int32_t outputDependencyId, int32_t inputDependencyId, int64_t txnId,
         int64_t lastCommittedTxnId) {
     int retval = ENGINE_ERRORCODE_ERROR;
+    shareLoadedIndexStages();
 
     m_currentOutputDepId = outputDependencyId;
     m_currentInputDepId = inputDependencyId;
@@ -502,6 +537,12 @@ int VoltDBEngine::executePlanFragment(string fragmentString,
 // -------------------------------------------------
 bool VoltDBEngine::send(Table* dependency) {
     VOLT_DEBUG("Sending Dependency '%d' from C++", m_currentOutputDepId);
+    if (m_resultStream.isOpenFor(dynamic_cast<TempTable*>(dependency))) {
+        // rows are already in the buffer, only the spill and header remain
+        m_resultStream.close();
+        m_numResultDependencies++;
+        return true;
+    }
     m_resultOutput.writeInt(m_currentOutputDepId);
     if (!dependency->serializeTo(m_resultOutput))
         return false;
@@ -723,6 +764,7 @@ bool VoltDBEngine::loadTable(Table *table,
                 txnId,// xid
                 getSiteId(),// which execution site
                 table->name(),// the table affected
+                getTableId(table->name()),
                 NULL,// bulk-load, no primary key
                 -1,// inserting, all columns affected
                 NULL,// insert, don't care about modified cols
@@ -784,9 +826,35 @@ bool VoltDBEngine::loadTable(Table *table,
     } catch (SerializableEEException e) {
         throwFatalException("%s", e.message().c_str());
     }
+
+    // every partition loads the same replicated content, so their indexes
+    // can point at one copy of the static stage once the load is done
+    PersistentTable *persistentTable = dynamic_cast<PersistentTable*>(table);
+    if (persistentTable != NULL && persistentTable->partitionColumn() == -1)
+        m_unsharedTables.insert(persistentTable->name());
     return true;
 }
 
+/*
+ * Share the index stages of the replicated tables loaded since the last
+ * call. Sharing folds the dynamic stage in and digests the static one,
+ * and a merge into a shared stage copies it again, so it is only worth
+ * doing after the last chunk of a load.
+ */
+void VoltDBEngine::shareLoadedIndexStages() {
+    if (m_unsharedTables.empty())
+        return;
+    for (set<string>::iterator it = m_unsharedTables.begin(); it != m_unsharedTables.end(); ++it) {
+        map<string, Table*>::iterator table = m_tablesByName.find(*it);
+        if (table == m_tablesByName.end())
+            continue;
+        PersistentTable *persistentTable = dynamic_cast<PersistentTable*>(table->second);
+        if (persistentTable != NULL)
+            persistentTable->shareIndexStages();
+    }
+    m_unsharedTables.clear();
+}
+
 /*
  * Delete and rebuild id based table collections. Does not affect
  * any currently stored tuples.
@@ -963,11 +1031,65 @@ bool VoltDBEngine::initPlanFragment(const int64_t fragId,
             ctr++) {
         ev->list.push_back(pnf->getExecuteList()[ctr]->getExecutor());
     }
+    ev->resultStreamTable = findResultStreamTable(ev->list);
     m_executorMap[fragId] = ev;
 
     return true;
 }
 
+/*
+ * The rows of a fragment can be serialized straight into the result
+ * buffer when it ends in a single real send whose input is a TempTable
+ * that only the executor right before it fills, by appending, and that
+ * nothing else reads.
+ */
+TempTable* VoltDBEngine::findResultStreamTable(
+        const std::vector<AbstractExecutor*> &list) const {
+    size_t cnt = list.size();
+    if (cnt < 2)
+        return NULL;
+
+    AbstractPlanNode *sendNode = list[cnt - 1]->getPlanNode();
+    if (sendNode->getPlanNodeType() != PLAN_NODE_TYPE_SEND
+            || dynamic_cast<SendPlanNode*>(sendNode)->getFake())
+        return NULL;
+
+    AbstractPlanNode *producer = list[cnt - 2]->getPlanNode();
+    switch (producer->getPlanNodeType()) {
+    case PLAN_NODE_TYPE_SEQSCAN:
+    case PLAN_NODE_TYPE_INDEXSCAN:
+    case PLAN_NODE_TYPE_NESTLOOP:
+    case PLAN_NODE_TYPE_NESTLOOPINDEX:
+    case PLAN_NODE_TYPE_PROJECTION:
+    case PLAN_NODE_TYPE_ORDERBY:
+    case PLAN_NODE_TYPE_LIMIT:
+    case PLAN_NODE_TYPE_DISTINCT:
+    case PLAN_NODE_TYPE_UNION:
+        break;
+    default:
+        // aggregates revisit their output rows, receive and DML
+        // executors fill it by other means
+        return NULL;
+    }
+
+    TempTable *table = dynamic_cast<TempTable*>(producer->getOutputTable());
+    if (table == NULL || sendNode->getInputTables().size() != 1
+            || sendNode->getInputTables()[0] != table)
+        return NULL;
+
+    for (size_t ctr = 0; ctr < cnt - 1; ctr++) {
+        AbstractPlanNode *node = list[ctr]->getPlanNode();
+        if (node->getPlanNodeType() == PLAN_NODE_TYPE_SEND)
+            return NULL;
+        std::vector<Table*> &inputs = node->getInputTables();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (inputs[i] == table)
+                return NULL;
+        }
+    }
+    return table;
+}
+
 bool VoltDBEngine::initPlanNode(const int64_t fragId, AbstractPlanNode* node,
         int* tempTableMemoryInBytes) {
     assert(node);
@@ -1147,10 +1269,28 @@ bool VoltDBEngine::isLocalSite(const NValue& value) {
 /** Perform once per second, non-transactional work. */
 void VoltDBEngine::tick(int64_t timeInMillis, int64_t lastCommittedTxnId) {
     m_executorContext->setupForTick(lastCommittedTxnId, timeInMillis);
+    shareLoadedIndexStages();
     typedef pair<int64_t, Table*> TablePair;
     BOOST_FOREACH (TablePair table, m_exportingTables){
     table.second->flushOldTuples(timeInMillis);
 }
+
+#ifdef STORAGE_MMAP
+    // start writing back the mmap'ed tables in the background between the
+    // synchronous syncs done at group commit
+    if (m_executorContext->isMMAPEnabled()) {
+        for (map<int32_t, Table*>::iterator it = m_tables.begin(); it != m_tables.end(); ++it) {
+            MMAPMemoryManager *dataManager = it->second->getDataManager();
+            if (dataManager != NULL) {
+                dataManager->scheduledAsync(timeInMillis);
+            }
+            Pool *pool = it->second->getPool();
+            if (pool != NULL && pool->getPoolManager() != NULL) {
+                pool->getPoolManager()->scheduledAsync(timeInMillis);
+            }
+        }
+    }
+#endif
 }
 
 /** For now, bring the Export system to a steady state with no buffers with content */
@@ -1276,6 +1416,24 @@ int VoltDBEngine::getStats(int selector, int locators[], int numLocators,
                     now);
             break;
         }
+        // -------------------------------------------------
+        // PLAN FRAGMENT PROFILER STATS
+        // -------------------------------------------------
+        case STATISTICS_SELECTOR_TYPE_PLANFRAGMENT: {
+            // locators are plan fragment ids, none means every profiled fragment
+            if (numLocators == 0) {
+                locatorIds = m_profiler.getStatsIds();
+            }
+            for (int ii = 0; ii < numLocators; ii++) {
+                m_profiler.getStatsIds(static_cast<int64_t>(locators[ii]), locatorIds);
+            }
+            if (!locatorIds.empty()) {
+                resultTable = m_statsManager.getStats(
+                        (StatisticsSelectorType) selector, locatorIds, interval,
+                        now);
+            }
+            break;
+        }
         default:
             char message[256];
             snprintf(message, 256,
@@ -1544,103 +1702,58 @@ void VoltDBEngine::doAriesRecovery(char *logData, size_t length, int64_t replay_
 
     m_isRecovering = true;
 
-    bool noMoreLogRecords = false;
-
     Logger m_ariesLogger = m_logManager->getAriesLogger();
     VOLT_DEBUG("m_logManager : %p AriesLogger : %p",&m_logManager, &m_ariesLogger);
     const Logger *logger = m_logManager->getThreadLogger(LOGGERID_MM_ARIES);
     logger->log(LOGLEVEL_INFO, "Running ARIES recovery, repeating history ...");
 
-    int64_t actualBufLen = length;
-    ReferenceSerializeInput input(logData, actualBufLen);
-
-    char *endOfBuffer = logData + actualBufLen;
-
-    int32_t counter = 0;
-
-    VOLT_DEBUG("actualBufLen : %ld", actualBufLen);
-
-    while (input.getRawPointer(0) < endOfBuffer) {
-        const char* logInitPosition = reinterpret_cast<const char*>(input.getRawPointer(0));
-
-        int32_t recordSize = 0;
-
-        // log header is 4 bytes
-        int64_t breathingSpace = endOfBuffer - (logInitPosition + sizeof(int32_t));
-
-        if (breathingSpace < 0) {
-            // read the full header along with the next chunk
-            // seek in reverse direction
-            break;//XXX:hack when we have a single buffer for the entire file
-            // logfilestream.seekg((logInitPosition - endOfBuffer), ios::cur);
-        } else {
-            // read log record header to determine its size.
-            memcpy(&recordSize, logInitPosition, sizeof(recordSize));
-            recordSize = ntohl(recordSize);
-
-            VOLT_DEBUG("breathingSpace : %ld recordSize : %d", breathingSpace, recordSize);
-            if (recordSize <= 0) {
-                // hit junk, no more log records.
-                noMoreLogRecords = true;
-                break;
-            } else {
-                /* if (logInitPosition + sizeof(int32_t) + recordSize > endOfBuffer) {
-                 //part of this log record is in the
-                 // next buffer chunk
-                 // rewind back to beginning of log record's header
-                 logfilestream.seekg((logInitPosition - endOfBuffer), ios::cur);
-                 break;
-                 }
-                 // else entire log record is in this chunk
-                 */
+    // parse and validate on the replayer's threads, apply here in log
+    // order. Runs of inserts into a table skip index maintenance; the
+    // indexes get the whole run in one batch before anything else touches
+    // that table (see PersistentTable::setDeferIndexInserts)
+    AriesReplayer replayer(this, logData, length, replay_txnid, m_siteId);
+
+    // tables skipping their indexes for the current run of inserts
+    struct DeferredTables : std::set<PersistentTable*> {
+        // build the deferred indexes, throws if one can't be built
+        void flush() {
+            while (!empty()) {
+                PersistentTable *table = *begin();
+                erase(begin());
+                table->setDeferIndexInserts(false);
             }
         }
+        // only has tables left when a record threw; don't throw over
+        // that exception, but still leave no table skipping its indexes
+        ~DeferredTables() {
+            for (iterator i = begin(); i != end(); ++i) {
+                try {
+                    (*i)->setDeferIndexInserts(false);
+                } catch (...) {
+                    VOLT_ERROR("ARIES : could not build the deferred indexes of %s",
+                               (*i)->name().c_str());
+                }
+            }
+        }
+    } deferredTables;
 
-        bool skipLogRecord = false;
-
-        // find the transaction type, need to know if its a bulk load
-        int8_t txnType;
-        memcpy(&txnType, logInitPosition + sizeof(int32_t) + OFFSET_TO_TXNTYPE, sizeof(txnType));
-
-        int64_t numBulkLoadBytes = 0;
+    int32_t counter = 0;
 
-        if (txnType == static_cast<int8_t>(LogRecord::T_BULKLOAD)) {
-            memcpy(&numBulkLoadBytes, logInitPosition + sizeof(int32_t) + recordSize, sizeof(numBulkLoadBytes));
-            numBulkLoadBytes = ntohll(numBulkLoadBytes);
-        }
+    VOLT_DEBUG("actualBufLen : %lu", length);
 
-        // Run only if txnId is greater than the id to replay from
-        int64_t txnId;
-        memcpy(&txnId, logInitPosition + sizeof(int32_t) + OFFSET_TO_TXNID, sizeof(txnId));
-        txnId = ntohll(txnId);
-
-        VOLT_DEBUG("LogRecord :: TXN Type : %d TXN Id : %ld", txnType, txnId);
-
-        // Check the site-id, re-run only if original site-id matches
-        // Correctness follows because all updates from a site are to
-        // a particular partition only.
-        // (much like the page wise recovery in the original Aries recovery)
-        int32_t origSiteId;
-        memcpy(&origSiteId, logInitPosition + sizeof(int32_t) + OFFSET_TO_SITEID, sizeof(origSiteId));
-        origSiteId = ntohl(origSiteId);
-
-        if ((txnId < replay_txnid) || (origSiteId != m_siteId)) {
-            // don't forget to advance the pointer, o/w there's an infinite loop
-            input.readInt();
-            input.getRawPointer(recordSize);
-
-            if (txnType == static_cast<int8_t>(LogRecord::T_BULKLOAD)) {
-                // skip over the load bytes as well
-                input.getRawPointer(sizeof(numBulkLoadBytes) + numBulkLoadBytes);
-            }
+    std::vector<AriesReplayRecord> *batch = &replayer.nextBatch();
+    size_t nextRecord = 0;
 
-            skipLogRecord = true;
+    while (!batch->empty()) {
+        if (nextRecord == batch->size()) {
+            batch = &replayer.nextBatch();
+            nextRecord = 0;
             continue;
         }
 
-        LogRecord logrecord(input);
-
-        PersistentTable* table = dynamic_cast<PersistentTable*>(getTable(logrecord.getTableName()));
+        AriesReplayRecord &replayRecord = (*batch)[nextRecord++];
+        LogRecord &logrecord = *replayRecord.record;
+        PersistentTable* table = replayRecord.table;
 
         if (table == NULL) {
             // Invalid log record hit
@@ -1649,6 +1762,16 @@ void VoltDBEngine::doAriesRecovery(char *logData, size_t length, int64_t replay_
             break;
         }
 
+        if (replayRecord.type == static_cast<int8_t>(LogRecord::T_INSERT)) {
+            if (deferredTables.insert(table).second) {
+                table->setDeferIndexInserts(true);
+            }
+        } else if (deferredTables.erase(table) > 0) {
+            // the record below may look tuples up through the indexes
+            table->setDeferIndexInserts(false);
+        }
+
+        // inserts were already populated by the replayer
         logrecord.populateFields(table->schema(), table->primaryKeyIndex());
 
         if (!logrecord.isValidRecord()) {
@@ -1711,12 +1834,7 @@ void VoltDBEngine::doAriesRecovery(char *logData, size_t length, int64_t replay_
         } else if (logrecord.getType() == LogRecord::T_BULKLOAD) {
             VOLT_DEBUG("Log record recovery : BULKLOAD start");
 
-            numBulkLoadBytes = input.readLong();
-
-            // make sure we create a separate input reader
-            // for the load, otherwise we'll get the number of
-            // bytes wrong in there.
-            ReferenceSerializeInput bulkIn(input.getRawPointer(0), numBulkLoadBytes);
+            ReferenceSerializeInput bulkIn(replayRecord.bulkLoadData, replayRecord.bulkLoadBytes);
 
             // figure if the last committed txnId,
             // should be the replay_txnId?
@@ -1731,9 +1849,6 @@ void VoltDBEngine::doAriesRecovery(char *logData, size_t length, int64_t replay_
             // let the txnId be set to 1 + last committed txnId for now
             loadTable(table, bulkIn, replay_txnid + 1, replay_txnid, false);
 
-            // advance read position to the correct place.
-            input.getRawPointer(numBulkLoadBytes);
-
             VOLT_DEBUG("Log record recovery : BULKLOAD end");
         } else if (logrecord.getType() == LogRecord::T_DELETE) {
             VOLT_DEBUG("Log record recovery : DELETE start");
@@ -1758,18 +1873,19 @@ void VoltDBEngine::doAriesRecovery(char *logData, size_t length, int64_t replay_
         }
     }
 
+    deferredTables.flush();
 
     gettimeofday(&tv2, NULL);
 
-    //long microseconds = (tv2.tv_sec - tv1.tv_sec) * 1000000 + ((int)tv2.tv_usec - (int)tv1.tv_usec);
-    //long milliseconds = microseconds/1000;
-    //VOLT_ERROR("ARIES : ######################### Recovery Latency : completed in %ld ms", milliseconds);
-    //VOLT_ERROR("ARIES : ######################### Recovery Completed : %d log records replayed", counter);
+    int64_t microseconds = (tv2.tv_sec - tv1.tv_sec) * 1000000 + (tv2.tv_usec - tv1.tv_usec);
+    int64_t recordsPerSecond = microseconds > 0 ? counter * 1000000LL / microseconds : counter;
 
     std::ostringstream sstm;
-    sstm << counter;
+    sstm << "ARIES : recovery completed, " << counter << " log records replayed ("
+         << replayer.getSkippedCount() << " skipped) in " << microseconds / 1000
+         << " ms, " << recordsPerSecond << " records/sec.";
 
-    std::string outputString = "ARIES : recovery completed, " + sstm.str() + " log records found, all replayed.";
+    std::string outputString = sstm.str();
     logger->log(LOGLEVEL_INFO, &outputString);
 }
 
@@ -69,6 +69,8 @@
 #include "logging/LogProxy.h"
 #include "logging/StdoutLogProxy.h"
 #include "stats/StatsAgent.h"
+#include "execution/PlanFragmentProfiler.h"
+#include "storage/ResultTableStream.h"
 //#include "storage/persistenttable.h"
 //#include "storage/mmap_persistenttable.h"
 
@@ -105,6 +107,7 @@ class AbstractPlanNode;
 class SerializeInput;
 class SerializeOutput;
 class Table;
+class TempTable;
 class CatalogDelegate;
 class ReferenceSerializeInput;
 class ReferenceSerializeOutput;
@@ -128,6 +131,7 @@ class __attribute__((visibility("default"))) VoltDBEngine {
           m_currentOutputDepId(-1),
           m_currentInputDepId(-1),
           m_isELEnabled(false),
+          m_profiler(m_statsManager),
           m_numResultDependencies(0),
           m_templateSingleLongTable(NULL),
           m_topend(NULL),
@@ -161,6 +165,8 @@ class __attribute__((visibility("default"))) VoltDBEngine {
 
         Table* getTable(int32_t tableId) const;
         Table* getTable(std::string name) const;
+        // Catalog id (relative index) of the named table, -1 if unknown
+        int32_t getTableId(const std::string &name) const;
         // Serializes table_id to out. Returns true if successful.
         bool serializeTable(int32_t tableId, SerializeOutput* out) const;
 
@@ -378,6 +384,15 @@ class __attribute__((visibility("default"))) VoltDBEngine {
                 bool interval,
                 int64_t now);
 
+        /**
+         * Turn per-plan-node profiling of executed plan fragments on or off.
+         * The collected counters are read through getStats() with
+         * STATISTICS_SELECTOR_TYPE_PLANFRAGMENT.
+         */
+        void setProfilingEnabled(bool enabled) {
+            m_profiler.setEnabled(enabled);
+        }
+
         inline Pool* getStringPool() { return &m_stringPool; }
 
         inline LogManager* getLogManager() {
@@ -499,9 +514,11 @@ class __attribute__((visibility("default"))) VoltDBEngine {
         // -------------------------------------------------
         bool initPlanFragment(const int64_t fragId, const std::string planNodeTree);
         bool initPlanNode(const int64_t fragId, AbstractPlanNode* node, int* tempTableMemoryInBytes);
+        TempTable* findResultStreamTable(const std::vector<AbstractExecutor*> &list) const;
         bool initCluster();
         bool initMaterializedViews(bool addAll);
         bool updateCatalogDatabaseReference();
+        void shareLoadedIndexStages();
 
         void printReport();
         
@@ -518,6 +535,9 @@ class __attribute__((visibility("default"))) VoltDBEngine {
         struct ExecutorVector {
             std::vector<AbstractExecutor*> list;
             int tempTableMemoryInBytes;
+            // output table of the executor feeding the final send, when its
+            // rows can be streamed straight into m_resultOutput
+            TempTable *resultStreamTable;
         };
         std::map<int64_t, boost::shared_ptr<ExecutorVector> > m_executorMap;
 
@@ -544,6 +564,11 @@ class __attribute__((visibility("default"))) VoltDBEngine {
         // map catalog table name to table pointers
         std::map<std::string, Table*> m_tablesByName;
 
+        // replicated tables loaded since their index stages were last
+        // shared; a load arrives in many chunks, so the stages are shared
+        // once the next fragment or tick comes in rather than per chunk
+        std::set<std::string> m_unsharedTables;
+
         /*
          * Map of catalog table ids to snapshotting tables.
          * Note that these tableIds are the ids when the snapshot
@@ -576,6 +601,9 @@ class __attribute__((visibility("default"))) VoltDBEngine {
         /** buffer object for result tables. set when the result table is sent out to localsite. */
         ReferenceSerializeOutput m_resultOutput;
 
+        /** streams the final rows of a fragment into m_resultOutput */
+        ResultTableStream m_resultStream;
+
         // ARIES
         /** buffer object for aries log generated by the EE */
         FallbackSerializeOutput m_arieslogOutput;
@@ -630,6 +658,9 @@ class __attribute__((visibility("default"))) VoltDBEngine {
         /** Stats manager for this execution engine **/
         voltdb::StatsAgent m_statsManager;
 
+        /** Plan fragment profiler, registers its sources with m_statsManager **/
+        voltdb::PlanFragmentProfiler m_profiler;
+
         /*
          * Pool for short lived strings that will not live past the return back to Java.
          */
@@ -682,6 +713,14 @@ inline void VoltDBEngine::resetReusedResultOutputBuffer(const size_t headerSize)
 }
 
 void VoltDBEngine::releaseUndoToken(int64_t undoToken){
+#ifdef ARIES
+  // the transaction is acknowledged once this returns, so its log
+  // records must be durable; the flusher batches them into one sync
+  if (isARIESEnabled() && !m_isRecovering) {
+      m_logManager->getThreadLogger(LOGGERID_MM_ARIES)->sync();
+  }
+#endif
+
   if (m_currentUndoQuantum != NULL && m_currentUndoQuantum->isDummy()) {
     return;
   }
@@ -61,6 +61,7 @@ namespace voltdb {
 class VoltDBEngine;
 class ExecutorContext;
 class ReadWriteTracker;
+class TableIndex;
 
 /**
  * AbstractExecutor provides the API for initializing and invoking executors.
@@ -93,6 +94,17 @@ class AbstractExecutor {
      * Returns the plannode that generated this executor.
      */
     inline AbstractPlanNode* getPlanNode() { return abstract_node; }
+
+    /**
+     * Returns the temp table this executor writes its output to, if any.
+     */
+    inline TempTable* getTempOutputTable() const { return tmp_output_table; }
+
+    /**
+     * Returns the index this executor probes, if any. Used by the plan
+     * fragment profiler to count index probes.
+     */
+    virtual TableIndex* getProbedIndex() const { return NULL; }
     
   protected:
     AbstractExecutor(VoltDBEngine *engine, AbstractPlanNode *abstract_node) {
@@ -0,0 +1,325 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "executors/batchpredicate.h"
+#include "common/debuglog.h"
+#include "common/tabletuple.h"
+#include "common/TupleSchema.h"
+#include "common/NValue.hpp"
+#include "expressions/abstractexpression.h"
+#include "expressions/tuplevalueexpression.h"
+#include "expressions/constantvalueexpression.h"
+#include "expressions/parametervalueexpression.h"
+
+using namespace voltdb;
+
+namespace {
+
+inline bool isIntegerType(ValueType type) {
+    switch (type) {
+        case VALUE_TYPE_TINYINT:
+        case VALUE_TYPE_SMALLINT:
+        case VALUE_TYPE_INTEGER:
+        case VALUE_TYPE_BIGINT:
+        case VALUE_TYPE_TIMESTAMP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline bool isComparison(ExpressionType type) {
+    return (type >= EXPRESSION_TYPE_COMPARE_EQUAL &&
+            type <= EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO);
+}
+
+/** Mirror a comparison so that "value op column" becomes "column op' value" */
+inline ExpressionType flipComparison(ExpressionType type) {
+    switch (type) {
+        case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+            return EXPRESSION_TYPE_COMPARE_GREATERTHAN;
+        case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+            return EXPRESSION_TYPE_COMPARE_LESSTHAN;
+        case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+            return EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO;
+        case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+            return EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO;
+        default:
+            return type;
+    }
+}
+
+inline bool isValueExpression(const AbstractExpression *expression) {
+    return (dynamic_cast<const ConstantValueExpression*>(expression) != NULL ||
+            dynamic_cast<const ParameterValueExpressionMarker*>(expression) != NULL);
+}
+
+inline uint64_t countMask(int count) {
+    return (count >= BatchPredicate::BATCH_SIZE ? ~0ULL : ((1ULL << count) - 1));
+}
+
+/**
+ * Turn the equal and greater-than bitmaps of a batch into the
+ * result bitmap for the requested comparison.
+ */
+inline uint64_t combine(ExpressionType op, uint64_t eq, uint64_t gt) {
+    switch (op) {
+        case EXPRESSION_TYPE_COMPARE_EQUAL:
+            return eq;
+        case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+            return ~eq;
+        case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+            return ~(eq | gt);
+        case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+            return ~gt;
+        case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+            return gt;
+        case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+            return eq | gt;
+        default:
+            assert(false);
+            return 0;
+    }
+}
+
+inline void compareNarrow(const int32_t *values, int32_t rhs, uint64_t &eq, uint64_t &gt) {
+#ifdef __SSE2__
+    const __m128i r = _mm_set1_epi32(rhs);
+    for (int i = 0; i < BatchPredicate::BATCH_SIZE; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        eq |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, r)))) << i;
+        gt |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, r)))) << i;
+    }
+#else
+    for (int i = 0; i < BatchPredicate::BATCH_SIZE; i++) {
+        eq |= static_cast<uint64_t>(values[i] == rhs) << i;
+        gt |= static_cast<uint64_t>(values[i] > rhs) << i;
+    }
+#endif
+}
+
+/*
+ * SSE2 has no 64-bit compares (pcmpeqq is SSE4.1, pcmpgtq SSE4.2) and the
+ * release build only targets SSE3, so both are put together from 32-bit
+ * lane compares. movemask_pd reads bit 63 of each half, i.e. the high
+ * lane, so only the high lanes need the combined result:
+ *   eq: both lanes equal
+ *   gt: high lanes greater (signed), or high lanes equal and low lanes
+ *       greater as unsigned (compared signed after flipping the sign bit)
+ */
+inline void compareWide(const int64_t *values, int64_t rhs, uint64_t &eq, uint64_t &gt) {
+#ifdef __SSE2__
+    const __m128i r = _mm_set1_epi64x(rhs);
+    const __m128i sign = _mm_set_epi32(0, INT32_MIN, 0, INT32_MIN);
+    const __m128i rFlipped = _mm_xor_si128(r, sign);
+    for (int i = 0; i < BatchPredicate::BATCH_SIZE; i += 2) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const __m128i laneEq = _mm_cmpeq_epi32(v, r);
+        const __m128i laneGt = _mm_cmpgt_epi32(v, r);
+        const __m128i lowGt = _mm_cmpgt_epi32(_mm_xor_si128(v, sign), rFlipped);
+        // copy each low-lane result into the high lane above it
+        const __m128i both = _mm_and_si128(laneEq, _mm_shuffle_epi32(laneEq, _MM_SHUFFLE(2, 2, 0, 0)));
+        const __m128i greater = _mm_or_si128(laneGt,
+                                             _mm_and_si128(laneEq, _mm_shuffle_epi32(lowGt, _MM_SHUFFLE(2, 2, 0, 0))));
+        eq |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(both))) << i;
+        gt |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(greater))) << i;
+    }
+#else
+    for (int i = 0; i < BatchPredicate::BATCH_SIZE; i++) {
+        eq |= static_cast<uint64_t>(values[i] == rhs) << i;
+        gt |= static_cast<uint64_t>(values[i] > rhs) << i;
+    }
+#endif
+}
+
+}
+
+const int BatchPredicate::BATCH_SIZE;
+
+BatchPredicate* BatchPredicate::build(const AbstractExpression *predicate, const TupleSchema *schema) {
+    if (predicate == NULL) {
+        return NULL;
+    }
+    std::vector<Term> terms;
+    if (!collectTerms(predicate, schema, terms)) {
+        return NULL;
+    }
+    BatchPredicate *retval = new BatchPredicate();
+    retval->m_terms.swap(terms);
+    VOLT_DEBUG("Built batch predicate with %d terms", retval->termCount());
+    return retval;
+}
+
+bool BatchPredicate::collectTerms(const AbstractExpression *expression,
+                                  const TupleSchema *schema,
+                                  std::vector<Term> &terms) {
+    const ExpressionType type = expression->getExpressionType();
+    if (type == EXPRESSION_TYPE_CONJUNCTION_AND) {
+        return (collectTerms(expression->getLeft(), schema, terms) &&
+                collectTerms(expression->getRight(), schema, terms));
+    }
+    if (!isComparison(type)) {
+        return false;
+    }
+
+    const AbstractExpression *left = expression->getLeft();
+    const AbstractExpression *right = expression->getRight();
+    const TupleValueExpressionMarker *column = dynamic_cast<const TupleValueExpressionMarker*>(left);
+    const AbstractExpression *value = right;
+    ExpressionType op = type;
+    if (column == NULL) {
+        column = dynamic_cast<const TupleValueExpressionMarker*>(right);
+        value = left;
+        op = flipComparison(type);
+    }
+    if (column == NULL || !isValueExpression(value)) {
+        return false;
+    }
+
+    const int columnIndex = column->getColumnId();
+    if (columnIndex < 0 || columnIndex >= schema->columnCount() ||
+        !isIntegerType(schema->columnType(columnIndex))) {
+        return false;
+    }
+
+    Term term;
+    term.offset = TUPLE_HEADER_SIZE + schema->columnOffset(columnIndex);
+    term.columnType = schema->columnType(columnIndex);
+    term.op = op;
+    term.valueExpression = value;
+    term.value = 0;
+    term.narrow = false;
+    terms.push_back(term);
+    return true;
+}
+
+bool BatchPredicate::bind() {
+    for (std::vector<Term>::iterator it = m_terms.begin(); it != m_terms.end(); ++it) {
+        const NValue value = it->valueExpression->eval(NULL, NULL);
+        if (!isIntegerType(ValuePeeker::peekValueType(value))) {
+            VOLT_DEBUG("Batch predicate cannot compare against a %s value",
+                       getTypeName(ValuePeeker::peekValueType(value)).c_str());
+            return false;
+        }
+        // NValue::compare() widens both sides to a BIGINT and NULL becomes
+        // INT64_NULL, so that is the domain that we have to match here.
+        it->value = ValuePeeker::peekAsBigInt(value);
+
+        // Columns no wider than an INTEGER can be compared four at a time
+        // as long as the value maps onto the same order in 32 bits.
+        const bool narrowColumn = (it->columnType == VALUE_TYPE_TINYINT ||
+                                   it->columnType == VALUE_TYPE_SMALLINT ||
+                                   it->columnType == VALUE_TYPE_INTEGER);
+        it->narrow = narrowColumn &&
+                     (it->value == INT64_NULL ||
+                      (it->value > INT32_NULL && it->value <= INT32_MAX));
+    }
+    return true;
+}
+
+uint64_t BatchPredicate::activeMask(const char *tuples, uint32_t tupleLength, int count) {
+    assert(count <= BATCH_SIZE);
+    uint64_t mask = 0;
+    for (int i = 0; i < count; i++) {
+        const char flags = *(tuples + (i * tupleLength));
+        mask |= static_cast<uint64_t>((flags & DELETED_MASK) == 0) << i;
+    }
+    return mask;
+}
+
+uint64_t BatchPredicate::evaluate(const char *tuples, uint32_t tupleLength, int count) const {
+    uint64_t selected = activeMask(tuples, tupleLength, count);
+    for (std::vector<Term>::const_iterator it = m_terms.begin();
+         it != m_terms.end() && selected != 0; ++it) {
+        selected &= evaluateTerm(*it, tuples, tupleLength, count);
+    }
+    return selected;
+}
+
+uint64_t BatchPredicate::evaluateTerm(const Term &term, const char *tuples,
+                                      uint32_t tupleLength, int count) const {
+    const char *column = tuples + term.offset;
+    uint64_t eq = 0;
+    uint64_t gt = 0;
+
+    if (term.narrow) {
+        int32_t values[BATCH_SIZE] = { 0 };
+        switch (term.columnType) {
+            case VALUE_TYPE_TINYINT:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    const int8_t v = *reinterpret_cast<const int8_t*>(column);
+                    values[i] = (v == INT8_NULL ? INT32_NULL : v);
+                }
+                break;
+            case VALUE_TYPE_SMALLINT:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    const int16_t v = *reinterpret_cast<const int16_t*>(column);
+                    values[i] = (v == INT16_NULL ? INT32_NULL : v);
+                }
+                break;
+            default:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    values[i] = *reinterpret_cast<const int32_t*>(column);
+                }
+                break;
+        }
+        const int32_t rhs = (term.value == INT64_NULL ? INT32_NULL : static_cast<int32_t>(term.value));
+        compareNarrow(values, rhs, eq, gt);
+    } else {
+        int64_t values[BATCH_SIZE] = { 0 };
+        switch (term.columnType) {
+            case VALUE_TYPE_TINYINT:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    const int8_t v = *reinterpret_cast<const int8_t*>(column);
+                    values[i] = (v == INT8_NULL ? INT64_NULL : v);
+                }
+                break;
+            case VALUE_TYPE_SMALLINT:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    const int16_t v = *reinterpret_cast<const int16_t*>(column);
+                    values[i] = (v == INT16_NULL ? INT64_NULL : v);
+                }
+                break;
+            case VALUE_TYPE_INTEGER:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    const int32_t v = *reinterpret_cast<const int32_t*>(column);
+                    values[i] = (v == INT32_NULL ? INT64_NULL : v);
+                }
+                break;
+            default:
+                for (int i = 0; i < count; i++, column += tupleLength) {
+                    values[i] = *reinterpret_cast<const int64_t*>(column);
+                }
+                break;
+        }
+        compareWide(values, term.value, eq, gt);
+    }
+    return combine(term.op, eq, gt) & countMask(count);
+}
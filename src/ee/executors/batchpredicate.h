@@ -0,0 +1,104 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTOREBATCHPREDICATE_H
+#define HSTOREBATCHPREDICATE_H
+
+#include <vector>
+#include <stdint.h>
+#include "common/types.h"
+
+namespace voltdb {
+
+class AbstractExpression;
+class TupleSchema;
+
+/**
+ * Evaluates a simple conjunctive predicate over a batch of contiguous tuples
+ * in a table block. Every conjunct must compare a fixed-width integer column
+ * against a constant or a parameter. The column values for a batch are
+ * gathered into a dense array (the fixed tuple length makes this a strided
+ * load) and compared with SIMD instructions into a selection bitmap, so the
+ * executor only has to materialize the tuples that survive.
+ *
+ * Predicates that do not have this shape are not handled here and the
+ * executor falls back to AbstractExpression::eval() for every tuple.
+ */
+class BatchPredicate {
+public:
+    /** Number of tuples evaluated per call; one bit per tuple in the result */
+    static const int BATCH_SIZE = 64;
+
+    /**
+     * Returns a new BatchPredicate for the given predicate tree or NULL if the
+     * predicate cannot be evaluated in batches against this schema.
+     */
+    static BatchPredicate* build(const AbstractExpression *predicate, const TupleSchema *schema);
+
+    /**
+     * Pull in the constant and parameter values of every conjunct. This
+     * must be called after the predicate has been substitute()'d. Returns
+     * false if any of the values is not an integer that can be compared in
+     * the batch domain, in which case the caller must use the slow path.
+     */
+    bool bind();
+
+    /**
+     * Evaluate the predicate for count (<= BATCH_SIZE) tuples laid out back
+     * to back starting at tuples. Bit i of the result is set if tuple i is
+     * active and satisfies the predicate.
+     */
+    uint64_t evaluate(const char *tuples, uint32_t tupleLength, int count) const;
+
+    /** Returns a bitmap with bit i set if tuple i is active (not deleted) */
+    static uint64_t activeMask(const char *tuples, uint32_t tupleLength, int count);
+
+    inline int termCount() const { return static_cast<int>(m_terms.size()); }
+
+private:
+    BatchPredicate() {}
+
+    struct Term {
+        uint32_t offset;       // column offset, including the tuple header
+        ValueType columnType;
+        ExpressionType op;     // normalized so that the column is on the left
+        const AbstractExpression *valueExpression;
+        int64_t value;
+        bool narrow;           // compare in the 32-bit domain
+    };
+
+    static bool collectTerms(const AbstractExpression *expression,
+                             const TupleSchema *schema,
+                             std::vector<Term> &terms);
+
+    uint64_t evaluateTerm(const Term &term, const char *tuples,
+                          uint32_t tupleLength, int count) const;
+
+    std::vector<Term> m_terms;
+};
+
+}
+
+#endif
@@ -71,6 +71,7 @@ bool DeleteExecutor::p_init(AbstractPlanNode *abstract_node, const catalog::Data
     assert(node->getTargetTable());
     m_targetTable = dynamic_cast<PersistentTable*>(node->getTargetTable()); //target table should be persistenttable
     assert(m_targetTable);
+    m_targetTableId = m_engine->getTableId(m_targetTable->name());
     m_truncate = node->getTruncate();
     if (m_truncate) {
         assert(node->getInputTables().size() == 0);
@@ -113,6 +114,7 @@ bool DeleteExecutor::p_execute(const NValueArray &params, ReadWriteTracker *trac
                     m_engine->getExecutorContext()->currentTxnId() ,// txn id
                     m_engine->getSiteId(),// which execution site
                     m_targetTable->name(),// the table affected
+                    m_targetTableId,
                     NULL,// primary key irrelevant
                     -1,// irrelevant numCols
                     NULL,// list of modified cols irrelevant
@@ -206,6 +208,7 @@ bool DeleteExecutor::p_execute(const NValueArray &params, ReadWriteTracker *trac
                     m_engine->getExecutorContext()->currentTxnId() ,// txn id
                     m_engine->getSiteId(),// which execution site
                     m_targetTable->name(),// the table affected
+                    m_targetTableId,
                     keyTuple,// primary key
                     -1,// must delete all columns
                     NULL,// no list of modified cols
@@ -69,6 +69,7 @@ class DeleteExecutor : public OperationExecutor {
         DeleteExecutor(VoltDBEngine *engine, AbstractPlanNode* abstract_node) : OperationExecutor(engine, abstract_node) {
             m_inputTable = NULL;
             m_targetTable = NULL;
+            m_targetTableId = -1;
             m_engine = engine;
         }
         ~DeleteExecutor();
@@ -80,6 +81,8 @@ class DeleteExecutor : public OperationExecutor {
         bool m_truncate;
         TempTable* m_inputTable;
         PersistentTable* m_targetTable;
+        /** catalog id of the target table, for the log records */
+        int32_t m_targetTableId;
         TableTuple m_inputTuple;
         TableTuple m_targetTuple;
 
@@ -83,6 +83,8 @@ public:
     }
     ~IndexScanExecutor();
 
+    TableIndex* getProbedIndex() const { return m_index; }
+
 protected:
     bool p_init(AbstractPlanNode*, const catalog::Database* catalog_db, int* tempTableMemoryInBytes);
     bool p_execute(const NValueArray &params, ReadWriteTracker *tracker);
@@ -86,6 +86,7 @@ bool InsertExecutor::p_init(AbstractPlanNode *abstract_node, const catalog::Data
     // Target table can be StreamedTable or PersistentTable and must not be NULL
     m_targetTable = m_node->getTargetTable();
     assert(m_targetTable);
+    m_targetTableId = m_engine->getTableId(m_targetTable->name());
     assert((m_targetTable == dynamic_cast<PersistentTable*>(m_targetTable)) ||
            (m_targetTable == dynamic_cast<StreamedTable*>(m_targetTable)));
 
@@ -160,6 +161,7 @@ bool InsertExecutor::p_execute(const NValueArray &params, ReadWriteTracker *trac
                         m_engine->getExecutorContext()->currentTxnId() ,// txn id
                         m_engine->getSiteId(),// which execution site
                         m_targetTable->name(),// the table affected
+                        m_targetTableId,
                         NULL,// insert, no primary key
                         -1,// inserting, all columns affected
                         NULL,// insert, don't care about modified cols
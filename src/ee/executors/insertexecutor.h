@@ -64,6 +64,7 @@ class InsertExecutor : public OperationExecutor {
         InsertExecutor(VoltDBEngine *engine, AbstractPlanNode* abstract_node) : OperationExecutor(engine, abstract_node) {
             m_inputTable = NULL;
             m_targetTable = NULL;
+            m_targetTableId = -1;
             m_node = NULL;
             m_engine = engine;
             m_partitionColumn = -1;
@@ -79,6 +80,8 @@ class InsertExecutor : public OperationExecutor {
 
         TempTable* m_inputTable;
         Table* m_targetTable;
+        /** catalog id of the target table, for the log records */
+        int32_t m_targetTableId;
 
         TableTuple m_tuple;
         int m_partitionColumn;
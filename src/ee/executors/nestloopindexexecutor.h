@@ -89,6 +89,8 @@ public:
 
     ~NestLoopIndexExecutor();
 
+    TableIndex* getProbedIndex() const { return index; }
+
 protected:
     bool p_init(AbstractPlanNode*, const catalog::Database* catalog_db, int* tempTableMemoryInBytes);
     bool p_execute(const NValueArray &params, ReadWriteTracker *tracker);
@@ -43,8 +43,10 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <iostream>
 #include "seqscanexecutor.h"
+#include "executors/batchpredicate.h"
 #include "common/debuglog.h"
 #include "common/common.h"
 #include "common/tabletuple.h"
@@ -65,6 +67,10 @@
 
 using namespace voltdb;
 
+SeqScanExecutor::~SeqScanExecutor() {
+    delete m_batchPredicate;
+}
+
 bool SeqScanExecutor::p_init(AbstractPlanNode *abstract_node,
                              const catalog::Database* catalog_db,
                              int* tempTableMemoryInBytes) {
@@ -124,6 +130,15 @@ bool SeqScanExecutor::p_init(AbstractPlanNode *abstract_node,
                     tempTableMemoryInBytes));
         }
     }
+
+    // OPTIMIZATION: BATCH PREDICATE
+    // If the predicate is just a bunch of integer column comparisons
+    // AND'ed together, then we can evaluate it over a whole batch of
+    // tuples in a block at once instead of calling eval() on each one.
+#ifndef MEMCHECK
+    delete m_batchPredicate;
+    m_batchPredicate = BatchPredicate::build(node->getPredicate(), target_table->schema());
+#endif
     return true;
 }
 
@@ -197,12 +212,6 @@ bool SeqScanExecutor::p_execute(const NValueArray &params, ReadWriteTracker *tra
     // at the TargetTable. Therefore, there is nothing we more we need
     // to do here
     if (hasEvictedTable || node->getPredicate() != NULL || projection_node != NULL || limit_node != NULL) {
-        // Just walk through the table using our iterator and apply
-        // the predicate to each tuple. For each tuple that satisfies
-        // our expression, we'll insert them into the output table.
-        TableTuple tuple(target_table->schema());
-        TableIterator iterator(target_table);
-        
         AbstractExpression *predicate = node->getPredicate();
         if (predicate) {
             VOLT_DEBUG("SCAN PREDICATE A:\n%s\n", predicate->debug(true).c_str());
@@ -212,6 +221,18 @@ bool SeqScanExecutor::p_execute(const NValueArray &params, ReadWriteTracker *tra
                        predicate->debug(true).c_str());
         }
 
+        // OPTIMIZATION: BATCH PREDICATE
+        // Simple integer predicates are evaluated a block at a time
+        if (canExecuteBatch(hasEvictedTable)) {
+            return p_executeBatch(target_table, output_table, projection_node,
+                                  num_of_columns, limit, tracker);
+        }
+
+        // Just walk through the table using our iterator and apply
+        // the predicate to each tuple. For each tuple that satisfies
+        // our expression, we'll insert them into the output table.
+        TableTuple tuple(target_table->schema());
+        TableIterator iterator(target_table);
         int tuple_ctr = 0;
         while (iterator.next(tuple)) {
             target_table->updateTupleAccessCount();
@@ -233,36 +254,9 @@ bool SeqScanExecutor::p_execute(const NValueArray &params, ReadWriteTracker *tra
             // For each tuple we need to evaluate it against our predicate
             //
             if (predicate == NULL || predicate->eval(&tuple, NULL).isTrue()) {
-                //
-                // Nested Projection
-                // Project (or replace) values from input tuple
-                //
-                if (projection_node != NULL) {
-                    TableTuple &temp_tuple = output_table->tempTuple();
-                    for (int ctr = 0; ctr < num_of_columns; ctr++) {
-                        NValue value =
-                            projection_node->
-                          getOutputColumnExpressions()[ctr]->eval(&tuple, NULL);
-                        temp_tuple.setNValue(ctr, value);
-                    }
-                    if (!output_table->insertTuple(temp_tuple)) {
-                        VOLT_ERROR("Failed to insert tuple from table '%s' into"
-                                   " output table '%s'",
-                                   target_table->name().c_str(),
-                                   output_table->name().c_str());
-                        return false;
-                    }
-                } else {
-                    //
-                    // Insert the tuple into our output table
-                    //
-                    if (!output_table->insertTuple(tuple)) {
-                        VOLT_ERROR("Failed to insert tuple from table '%s' into"
-                                   " output table '%s'",
-                                   target_table->name().c_str(),
-                                   output_table->name().c_str());
-                        return false;
-                    }
+                if (!outputTuple(tuple, target_table, output_table,
+                                 projection_node, num_of_columns)) {
+                    return false;
                 }
                 ++tuple_ctr;
                 
@@ -321,3 +315,106 @@ bool SeqScanExecutor::p_execute(const NValueArray &params, ReadWriteTracker *tra
 
     return true;
 }
+
+bool SeqScanExecutor::outputTuple(TableTuple &tuple, PersistentTable* target_table, Table* output_table,
+                                  ProjectionPlanNode* projection_node, int num_of_columns) {
+    //
+    // Nested Projection
+    // Project (or replace) values from input tuple
+    //
+    if (projection_node != NULL) {
+        TableTuple &temp_tuple = output_table->tempTuple();
+        for (int ctr = 0; ctr < num_of_columns; ctr++) {
+            NValue value =
+                projection_node->
+              getOutputColumnExpressions()[ctr]->eval(&tuple, NULL);
+            temp_tuple.setNValue(ctr, value);
+        }
+        if (!output_table->insertTuple(temp_tuple)) {
+            VOLT_ERROR("Failed to insert tuple from table '%s' into"
+                       " output table '%s'",
+                       target_table->name().c_str(),
+                       output_table->name().c_str());
+            return false;
+        }
+    } else {
+        //
+        // Insert the tuple into our output table
+        //
+        if (!output_table->insertTuple(tuple)) {
+            VOLT_ERROR("Failed to insert tuple from table '%s' into"
+                       " output table '%s'",
+                       target_table->name().c_str(),
+                       output_table->name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SeqScanExecutor::canExecuteBatch(bool hasEvictedTable) {
+    // Evicted tuples are handed to the anti-cache one at a time, and
+    // bind() refuses parameters that did not come in as integers
+    return (m_batchPredicate != NULL && !hasEvictedTable && m_batchPredicate->bind());
+}
+
+bool SeqScanExecutor::p_executeBatch(PersistentTable* target_table, Table* output_table,
+                                     ProjectionPlanNode* projection_node, int num_of_columns,
+                                     int limit, ReadWriteTracker *tracker) {
+    VOLT_DEBUG("Batch scanning table %s with %d predicate terms",
+               target_table->name().c_str(), m_batchPredicate->termCount());
+
+    TableTuple tuple(target_table->schema());
+    const uint32_t tupleLength = target_table->m_tupleLength;
+    const uint32_t tuplesPerBlock = target_table->m_tuplesPerBlock;
+    const uint32_t usedTuples = target_table->m_usedTuples;
+    int tuple_ctr = 0;
+
+    for (uint32_t blockStart = 0; blockStart < usedTuples; blockStart += tuplesPerBlock) {
+        char *block = target_table->dataPtrForTuple(blockStart);
+        const uint32_t blockTuples = std::min(tuplesPerBlock, usedTuples - blockStart);
+
+        for (uint32_t batchStart = 0; batchStart < blockTuples; batchStart += BatchPredicate::BATCH_SIZE) {
+            char *batch = block + (batchStart * tupleLength);
+            const int count = static_cast<int>(std::min(static_cast<uint32_t>(BatchPredicate::BATCH_SIZE),
+                                                        blockTuples - batchStart));
+            uint64_t selected = m_batchPredicate->evaluate(batch, tupleLength, count);
+
+            // Read/Write Set Tracking
+            // Every active tuple in the batch was read, not just the ones
+            // that satisfied the predicate
+            if (tracker != NULL) {
+                uint64_t active = BatchPredicate::activeMask(batch, tupleLength, count);
+                target_table->updateTupleAccessCount(__builtin_popcountll(active));
+                while (active != 0) {
+                    const int i = __builtin_ctzll(active);
+                    active &= active - 1;
+                    tuple.move(batch + (i * tupleLength));
+                    tracker->markTupleRead(target_table, &tuple);
+                }
+            } else {
+                target_table->updateTupleAccessCount(
+                    __builtin_popcountll(BatchPredicate::activeMask(batch, tupleLength, count)));
+            }
+
+            // Materialize the survivors in table order
+            while (selected != 0) {
+                const int i = __builtin_ctzll(selected);
+                selected &= selected - 1;
+                tuple.move(batch + (i * tupleLength));
+                if (!outputTuple(tuple, target_table, output_table,
+                                 projection_node, num_of_columns)) {
+                    return false;
+                }
+                // Check whether we have gone past our limit
+                if (limit >= 0 && ++tuple_ctr >= limit) {
+                    VOLT_DEBUG("Finished Seq scanning (limit reached)");
+                    return true;
+                }
+            }
+        }
+    }
+    VOLT_TRACE("\n%s\n", output_table->debug().c_str());
+    VOLT_DEBUG("Finished Seq scanning");
+    return true;
+}
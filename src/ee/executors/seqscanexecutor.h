@@ -55,19 +55,47 @@ namespace voltdb
 {
     class UndoLog;
     class ReadWriteSet;
+    class BatchPredicate;
+    class PersistentTable;
+    class ProjectionPlanNode;
 
     class SeqScanExecutor : public AbstractExecutor {
     public:
         SeqScanExecutor(VoltDBEngine *engine, AbstractPlanNode* abstract_node)
-            : AbstractExecutor(engine, abstract_node)
+            : AbstractExecutor(engine, abstract_node), m_batchPredicate(NULL)
         {}
+        ~SeqScanExecutor();
     protected:
         bool p_init(AbstractPlanNode* abstract_node,
                     const catalog::Database* catalog_db, int* tempTableMemoryInBytes);
         bool p_execute(const NValueArray& params, ReadWriteTracker *tracker);
         bool needsOutputTableClear();
-        
+
+        /**
+         * Whether this execution can use p_executeBatch. Binds
+         * m_batchPredicate to the parameters substituted into the
+         * predicate, so call it after substitute().
+         */
+        bool canExecuteBatch(bool hasEvictedTable);
+
+        /**
+         * Walk the target table's blocks and evaluate the predicate for
+         * a batch of tuples at a time with m_batchPredicate. Only the
+         * tuples that survive are materialized into the output table.
+         */
+        bool p_executeBatch(PersistentTable* target_table, Table* output_table,
+                            ProjectionPlanNode* projection_node, int num_of_columns,
+                            int limit, ReadWriteTracker *tracker);
+
+        /** Project (if needed) and insert a qualifying tuple into the output table */
+        bool outputTuple(TableTuple &tuple, PersistentTable* target_table, Table* output_table,
+                         ProjectionPlanNode* projection_node, int num_of_columns);
+
         catalog::Table* m_catalogTable;
+
+        // Vectorized version of the scan predicate. NULL if the predicate
+        // is not a simple conjunction over fixed-width integer columns.
+        BatchPredicate* m_batchPredicate;
     };
 }
 
@@ -83,6 +83,7 @@ bool UpdateExecutor::p_init(AbstractPlanNode *abstract_node, const catalog::Data
     m_targetTable = dynamic_cast<PersistentTable*>(node->getTargetTable()); //target table should be persistenttable
     assert(m_targetTable);
     assert(node->getTargetTable());
+    m_targetTableId = m_engine->getTableId(m_targetTable->name());
 
     // Our output is just our input table (regardless if plan is single-sited or not)
     node->setOutputTable(node->getInputTables()[0]);
@@ -264,6 +265,7 @@ bool UpdateExecutor::p_execute(const NValueArray &params, ReadWriteTracker *trac
                         m_engine->getExecutorContext()->currentTxnId() ,// txn id
                         m_engine->getSiteId(),// which execution site
                         m_targetTable->name(),// the table affected
+                        m_targetTableId,
                         keyTuple,// primary key
                         numCols,
                         (numCols > 0) ? &modifiedCols : NULL,
@@ -69,6 +69,7 @@ class UpdateExecutor : public OperationExecutor {
             m_inputTargetMapSize = -1;
             m_inputTable = NULL;
             m_targetTable = NULL;
+            m_targetTableId = -1;
             m_engine = engine;
             m_partitionColumn = -1;
         }
@@ -83,6 +84,8 @@ class UpdateExecutor : public OperationExecutor {
 
         TempTable* m_inputTable;
         PersistentTable* m_targetTable;
+        /** catalog id of the target table, for the log records */
+        int32_t m_targetTableId;
 
         TableTuple m_inputTuple;
         TableTuple m_targetTuple;
@@ -17,6 +17,7 @@
 
 #include <vector>
 #include <string>
+#include <sstream>
 #include "indexes/IndexStats.h"
 #include "stats/StatsSource.h"
 #include "common/TupleSchema.h"
@@ -38,6 +39,22 @@ vector<string> IndexStats::generateIndexStatsColumnNames() {
     columnNames.push_back("IS_UNIQUE");
     columnNames.push_back("ENTRY_COUNT");
     columnNames.push_back("MEMORY_ESTIMATE");
+    columnNames.push_back("DEAD_ENTRY_COUNT");
+    columnNames.push_back("DEAD_ENTRY_RATIO");
+    columnNames.push_back("DYNAMIC_HITS");
+    columnNames.push_back("STATIC_HITS");
+    columnNames.push_back("LOOKUP_MISSES");
+    columnNames.push_back("BLOOM_NEGATIVES");
+    columnNames.push_back("BLOOM_FALSE_POSITIVES");
+    columnNames.push_back("MERGE_COUNT");
+    columnNames.push_back("MERGE_PAUSE_TOTAL");
+    columnNames.push_back("MERGE_PAUSE_MAX");
+    columnNames.push_back("MERGE_PAUSE_HISTOGRAM");
+    columnNames.push_back("DYNAMIC_BYTES");
+    columnNames.push_back("STATIC_BYTES");
+    columnNames.push_back("VALUE_BYTES");
+    columnNames.push_back("FILTER_BYTES");
+    columnNames.push_back("LEAF_FILL_HISTOGRAM");
 
     return columnNames;
 }
@@ -77,6 +94,58 @@ void IndexStats::populateIndexStatsSchema(
     types.push_back(VALUE_TYPE_INTEGER);
     columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_INTEGER));
     allowNull.push_back(false);
+
+    // removed entries still holding a slot
+    types.push_back(VALUE_TYPE_BIGINT);
+    columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+    allowNull.push_back(false);
+
+    // dead entries / (dead + live entries)
+    types.push_back(VALUE_TYPE_DOUBLE);
+    columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_DOUBLE));
+    allowNull.push_back(false);
+
+    // lookups answered by the dynamic stage, the static stage, neither;
+    // Bloom filter negatives and false positives; merges and their total
+    // and longest pause in microseconds
+    for (int i = 0; i < 8; i++) {
+        types.push_back(VALUE_TYPE_BIGINT);
+        columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        allowNull.push_back(false);
+    }
+
+    // merge pause histogram, see histogramString()
+    types.push_back(VALUE_TYPE_VARCHAR);
+    columnLengths.push_back(1024);
+    allowNull.push_back(false);
+
+    // dynamic stage, static nodes, static values and Bloom filter bytes
+    for (int i = 0; i < 4; i++) {
+        types.push_back(VALUE_TYPE_BIGINT);
+        columnLengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        allowNull.push_back(false);
+    }
+
+    // dynamic leaf fill histogram
+    types.push_back(VALUE_TYPE_VARCHAR);
+    columnLengths.push_back(1024);
+    allowNull.push_back(false);
+}
+
+/**
+ * Comma separated bucket counts, trailing empty buckets dropped.
+ */
+static string histogramString(const vector<int64_t> &buckets) {
+    size_t n = buckets.size();
+    while (n > 0 && buckets[n - 1] == 0)
+        n--;
+    ostringstream out;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0)
+            out << ',';
+        out << buckets[i];
+    }
+    return out.str();
 }
 
 Table*
@@ -112,6 +181,8 @@ IndexStats::IndexStats(TableIndex* index)
     : StatsSource(), m_index(index), m_isUnique(0),
       m_lastTupleCount(0), m_lastMemEstimate(0)
 {
+    m_mergePauseHistogram = ValueFactory::getNullStringValue();
+    m_leafFillHistogram = ValueFactory::getNullStringValue();
 }
 
 /**
@@ -177,6 +248,11 @@ void IndexStats::updateStatsTuple(TableTuple *tuple) {
         mem_estimate_kb = -1;
     }
 
+    // dead entries are a gauge, not a counter, so intervals report them as is
+    int64_t dead = static_cast<int64_t>(m_index->getDeadEntryCount());
+    int64_t slots = dead + static_cast<int64_t>(m_index->getSize());
+    double dead_ratio = slots > 0 ? static_cast<double>(dead) / static_cast<double>(slots) : 0.0;
+
     tuple->setNValue(
             StatsSource::m_columnName2Index["IS_UNIQUE"],
             ValueFactory::getTinyIntValue(m_isUnique));
@@ -185,6 +261,63 @@ void IndexStats::updateStatsTuple(TableTuple *tuple) {
     tuple->setNValue(StatsSource::m_columnName2Index["MEMORY_ESTIMATE"],
                      ValueFactory::
                      getIntegerValue(static_cast<int32_t>(mem_estimate_kb)));
+    tuple->setNValue( StatsSource::m_columnName2Index["DEAD_ENTRY_COUNT"],
+            ValueFactory::getBigIntValue(dead));
+    tuple->setNValue( StatsSource::m_columnName2Index["DEAD_ENTRY_RATIO"],
+            ValueFactory::getDoubleValue(dead_ratio));
+
+    // counters and histograms become per-interval deltas like ENTRY_COUNT;
+    // MERGE_PAUSE_MAX and the byte and leaf fill gauges are reported as is
+    TableIndexDetailedStats detail;
+    m_index->getDetailedStats(detail);
+    TableIndexDetailedStats delta = detail;
+    if (interval()) {
+        delta.dynamicHits -= m_lastDetail.dynamicHits;
+        delta.staticHits -= m_lastDetail.staticHits;
+        delta.misses -= m_lastDetail.misses;
+        delta.bloomNegatives -= m_lastDetail.bloomNegatives;
+        delta.bloomFalsePositives -= m_lastDetail.bloomFalsePositives;
+        delta.merges -= m_lastDetail.merges;
+        delta.mergePauseTotal -= m_lastDetail.mergePauseTotal;
+        for (size_t i = 0; i < delta.mergePauses.size() &&
+                 i < m_lastDetail.mergePauses.size(); i++)
+            delta.mergePauses[i] -= m_lastDetail.mergePauses[i];
+        m_lastDetail = detail;
+    }
+
+    m_mergePauseHistogram.free();
+    m_mergePauseHistogram = ValueFactory::getStringValue(histogramString(delta.mergePauses));
+    m_leafFillHistogram.free();
+    m_leafFillHistogram = ValueFactory::getStringValue(histogramString(delta.leafFill));
+
+    tuple->setNValue( StatsSource::m_columnName2Index["DYNAMIC_HITS"],
+            ValueFactory::getBigIntValue(delta.dynamicHits));
+    tuple->setNValue( StatsSource::m_columnName2Index["STATIC_HITS"],
+            ValueFactory::getBigIntValue(delta.staticHits));
+    tuple->setNValue( StatsSource::m_columnName2Index["LOOKUP_MISSES"],
+            ValueFactory::getBigIntValue(delta.misses));
+    tuple->setNValue( StatsSource::m_columnName2Index["BLOOM_NEGATIVES"],
+            ValueFactory::getBigIntValue(delta.bloomNegatives));
+    tuple->setNValue( StatsSource::m_columnName2Index["BLOOM_FALSE_POSITIVES"],
+            ValueFactory::getBigIntValue(delta.bloomFalsePositives));
+    tuple->setNValue( StatsSource::m_columnName2Index["MERGE_COUNT"],
+            ValueFactory::getBigIntValue(delta.merges));
+    tuple->setNValue( StatsSource::m_columnName2Index["MERGE_PAUSE_TOTAL"],
+            ValueFactory::getBigIntValue(delta.mergePauseTotal));
+    tuple->setNValue( StatsSource::m_columnName2Index["MERGE_PAUSE_MAX"],
+            ValueFactory::getBigIntValue(delta.mergePauseMax));
+    tuple->setNValue( StatsSource::m_columnName2Index["MERGE_PAUSE_HISTOGRAM"],
+            m_mergePauseHistogram);
+    tuple->setNValue( StatsSource::m_columnName2Index["DYNAMIC_BYTES"],
+            ValueFactory::getBigIntValue(delta.dynamicBytes));
+    tuple->setNValue( StatsSource::m_columnName2Index["STATIC_BYTES"],
+            ValueFactory::getBigIntValue(delta.staticBytes));
+    tuple->setNValue( StatsSource::m_columnName2Index["VALUE_BYTES"],
+            ValueFactory::getBigIntValue(delta.valueBytes));
+    tuple->setNValue( StatsSource::m_columnName2Index["FILTER_BYTES"],
+            ValueFactory::getBigIntValue(delta.filterBytes));
+    tuple->setNValue( StatsSource::m_columnName2Index["LEAF_FILL_HISTOGRAM"],
+            m_leafFillHistogram);
 }
 
 /**
@@ -203,4 +336,6 @@ IndexStats::~IndexStats() {
     m_indexName.free();
     m_indexType.free();
     m_tableName.free();
+    m_mergePauseHistogram.free();
+    m_leafFillHistogram.free();
 }
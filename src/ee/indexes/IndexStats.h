@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <string>
+#include <stdint.h>
 #include "stats/StatsSource.h"
 #include "common/TupleSchema.h"
 #include "common/ids.h"
@@ -28,6 +29,38 @@ namespace voltdb {
 
 class TableIndex;
 
+/**
+ * Detailed counters an index with a dynamic and a static stage reports
+ * through IndexStats (see TableIndex::getDetailedStats). Lookup, Bloom
+ * filter and merge counts are cumulative; bytes are current. mergePauses[b]
+ * counts merges that took [2^b, 2^(b+1)) microseconds and leafFill[n] the
+ * dynamic leaves holding n keys.
+ */
+struct TableIndexDetailedStats {
+    TableIndexDetailedStats()
+        : dynamicHits(0), staticHits(0), misses(0), bloomNegatives(0),
+          bloomFalsePositives(0), merges(0), mergePauseTotal(0), mergePauseMax(0),
+          dynamicBytes(0), staticBytes(0), valueBytes(0), filterBytes(0),
+          staticHolders(0) {}
+
+    int64_t dynamicHits;
+    int64_t staticHits;
+    int64_t misses;
+    int64_t bloomNegatives;
+    int64_t bloomFalsePositives;
+    int64_t merges;
+    int64_t mergePauseTotal;
+    int64_t mergePauseMax;
+    std::vector<int64_t> mergePauses;
+    int64_t dynamicBytes;
+    int64_t staticBytes;
+    int64_t valueBytes;
+    int64_t filterBytes;
+    // indexes sharing this one's static stage, itself included; 0 if private
+    int64_t staticHolders;
+    std::vector<int64_t> leafFill;
+};
+
 /**
  * StatsSource extension for tables.
  */
@@ -109,6 +142,10 @@ private:
 
     int64_t m_lastTupleCount;
     int64_t m_lastMemEstimate;
+
+    voltdb::TableIndexDetailedStats m_lastDetail;
+    voltdb::NValue m_mergePauseHistogram;
+    voltdb::NValue m_leafFillHistogram;
 };
 
 }
@@ -48,6 +48,9 @@
 
 #include <iostream>
 #include "indexes/tableindex.h"
+#include "indexes/masstreebulkload.h"
+#include "indexes/masstreetupleid.h"
+#include "indexes/masstreestats.h"
 #include "common/tabletuple.h"
 
 #include "masstree/mtIndexAPI.hh"
@@ -84,10 +87,11 @@ public:
       char* m_tmp1_data = get_m_tmp1_data();
       int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, tuple);
 
-      uint64_t addr = (uint64_t)tuple->address();
-      uint64_t *addr_ptr = &addr;
+      char addr[8];
+      if (!m_tupleIds.encode(tuple->address(), addr))
+	return false;
 
-      mt_entries.put_nuv((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr, 8);
+      mt_entries.put_nuv((const char*)m_tmp1_data, m_tmp1_size, addr, m_tupleIds.valueLength());
       ++m_inserts;
       item_count++;
 
@@ -95,6 +99,25 @@ public:
       return true;
     }
 
+    bool addEntries(const std::vector<void*> &tupleAddresses)
+    {
+      TableTuple tuple(m_tupleSchema);
+      MasstreeBulkLoad load(tupleAddresses.size(), m_keySchema->tupleLength());
+      for (size_t i = 0; i < tupleAddresses.size(); i++) {
+	tuple.move(tupleAddresses[i]);
+	m_tmp1.setFromTupleLE(&tuple, column_indices_, m_keySchema);
+	char* m_tmp1_data = get_m_tmp1_data();
+	int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, &tuple);
+	load.add(m_tmp1_data, m_tmp1_size, tuple.address());
+      }
+
+      size_t loaded;
+      bool success = loadMultiMapEntries(mt_entries, m_tupleIds, load, loaded);
+      m_inserts += (int)loaded;
+      item_count += (int)loaded;
+      return success;
+    }
+
     bool deleteEntry(const TableTuple *tuple)
     {
       //std::cout << "MOM -- DELETE " << name_ << "\n";
@@ -102,11 +125,12 @@ public:
       char* m_tmp1_data = get_m_tmp1_data();
       int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, tuple);
 
-      uint64_t addr = (uint64_t)tuple->address();
-      uint64_t *addr_ptr = &addr;
+      char addr[8];
+      if (!m_tupleIds.encode(tuple->address(), addr))
+	return false;
 
       ++m_deletes;
-      bool success = mt_entries.remove_nuv((const char*)m_tmp1_data, m_tmp1_size, (const char*) addr_ptr, 8);
+      bool success = mt_entries.remove_nuv((const char*)m_tmp1_data, m_tmp1_size, addr, m_tupleIds.valueLength());
       if (success)
 	item_count--;
       /*
@@ -130,11 +154,12 @@ public:
       if (m_eq(m_tmp1, m_tmp2))
 	return true;
 
-      uint64_t addr = (uint64_t)newTupleValue->address();
-      uint64_t *addr_ptr = &addr;
+      char addr[8];
+      if (!m_tupleIds.encode(newTupleValue->address(), addr))
+	return false;
 
-      mt_entries.remove_nuv((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr, 8);
-      mt_entries.put_nuv((const char*)m_tmp2_data, m_tmp2_size, (const char*)addr_ptr, 8);
+      mt_entries.remove_nuv((const char*)m_tmp1_data, m_tmp1_size, addr, m_tupleIds.valueLength());
+      mt_entries.put_nuv((const char*)m_tmp2_data, m_tmp2_size, addr, m_tupleIds.valueLength());
       ++m_updates;
       return true;
     }
@@ -146,17 +171,31 @@ public:
       int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, tuple);
       ++m_updates;
 	
-      uint64_t addr = (uint64_t)address;
-      uint64_t *addr_ptr = &addr;
-      uint64_t old_addr = (uint64_t)oldAddress;
-      uint64_t *old_addr_ptr = &old_addr;
+      char addr[8];
+      if (!m_tupleIds.encode(address, addr))
+	return false;
+      char old_addr[8];
+      if (!m_tupleIds.encode(oldAddress, old_addr))
+	return false;
 
-      mt_entries.replace((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr, 8, (const char*)old_addr_ptr, 8);
+      mt_entries.replace((const char*)m_tmp1_data, m_tmp1_size, addr, m_tupleIds.valueLength(), old_addr, m_tupleIds.valueLength());
 
-      //mt_entries.replace_first((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr, 8);
+      //mt_entries.replace_first((const char*)m_tmp1_data, m_tmp1_size, addr, m_tupleIds.valueLength());
       return true;
     }
 
+    void setTupleTables(Table *table, Table *evictedTable) {
+      // the value width can only change while nothing is stored yet
+      if (m_tupleIds.valueLength() == 8 && item_count != 0)
+	return;
+      m_tupleIds.setTables(table, evictedTable);
+      mt_entries.set_value_len(m_tupleIds.valueLength());
+    }
+
+    bool shareStaticStage(const std::string &key) {
+      return m_tupleIds.bound() && mt_entries.share_static(key.c_str());
+    }
+
     bool checkForIndexChange(const TableTuple *lhs, const TableTuple *rhs)
     {
       //std::cout << "MOM -- CHECKFORCHANGE " << name_ << "\n";
@@ -203,7 +242,7 @@ public:
       memcpy(cur_values + dynamic_values_str.len, static_values_str.s, static_values_str.len);
       cur_values_len = dynamic_values_str.len + static_values_str.len;
 
-      char *retvalue = *(reinterpret_cast<char**>(cur_values));
+      char *retvalue = m_tupleIds.decode(cur_values);
       iter_pos = 0;
       m_match.move(retvalue);
       return m_match.address() != NULL;
@@ -236,7 +275,7 @@ public:
       memcpy(cur_values + dynamic_values_str.len, static_values_str.s, static_values_str.len);
       cur_values_len = dynamic_values_str.len + static_values_str.len;
 
-      char *retvalue = *(reinterpret_cast<char**>(cur_values));
+      char *retvalue = m_tupleIds.decode(cur_values);
       iter_pos = 0;
       m_match.move(retvalue);
       return m_match.address() != NULL;
@@ -302,7 +341,7 @@ public:
       Str value;
       bool same_key = false;
       if (m_begin) {
-	iter_pos += 8;
+	iter_pos += m_tupleIds.valueLength();
 	if (iter_pos < cur_values_len)
 	  same_key = true;
 	else if (!mt_entries.get_next_nuv(value))
@@ -316,7 +355,7 @@ public:
 	  cur_values_len = value.len;
 	  iter_pos = 0;
 	}
-	char *retvalue = *(reinterpret_cast<char**>(cur_values + iter_pos));
+	char *retvalue = m_tupleIds.decode(cur_values + iter_pos);
 	retval.move(retvalue);
       }
       else {
@@ -331,11 +370,11 @@ public:
       if (m_match.isNullTuple())
 	return m_match;
       TableTuple retval = m_match;
-      iter_pos += 8;
+      iter_pos += m_tupleIds.valueLength();
       if (iter_pos >= cur_values_len)
         m_match.move(NULL);
       else {
-	char *retvalue = *(reinterpret_cast<char**>(cur_values + iter_pos));
+	char *retvalue = m_tupleIds.decode(cur_values + iter_pos);
         m_match.move(retvalue);
       }
       return retval;
@@ -359,7 +398,7 @@ public:
 	cur_values_len = dynamic_values_str.len + static_values_str.len;
 	iter_pos = 0;
 
-	char *retvalue = *(reinterpret_cast<char**>(cur_values));
+	char *retvalue = m_tupleIds.decode(cur_values);
 	  
 	m_match.move(retvalue);
       }
@@ -374,6 +413,14 @@ public:
     int64_t getMemoryEstimate() const {
       return (int64_t)mt_entries.memory_consumption();
     }
+    size_t getDeadEntryCount() const {
+      return (size_t)mt_entries.get_sdead();
+    }
+
+    bool getDetailedStats(TableIndexDetailedStats &stats) {
+      getMasstreeDetailedStats(mt_entries, stats);
+      return true;
+    }
     /*
     void printTreeStats() {
       std::cout << name_ << "\n";
@@ -395,6 +442,7 @@ protected:
         ints_only = scheme.intsOnly;
 	item_count = 0;
 	mt_entries.setup(m_tmp1.size(), m_keySchema->tupleLength(), true);
+	mt_entries.set_packed_static_values(true);
         m_match = TableTuple(m_tupleSchema);
 	m_memoryEstimate = 1;
 	m_tmp1_str = (char*)malloc(m_keySchema->tupleLength() * 2);
@@ -466,6 +514,8 @@ protected:
     }
 
     MtiType mt_entries;
+    // 32-bit tuple ids once bound to the table, raw addresses before that
+    MasstreeTupleId m_tupleIds;
     KeyType m_tmp1;
     KeyType m_tmp2;
     char* m_tmp1_str;
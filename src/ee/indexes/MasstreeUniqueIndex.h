@@ -55,6 +55,9 @@
 #include "common/debuglog.h"
 #include "common/tabletuple.h"
 #include "indexes/tableindex.h"
+#include "indexes/masstreebulkload.h"
+#include "indexes/masstreetupleid.h"
+#include "indexes/masstreestats.h"
 
 #include "masstree/mtIndexAPI.hh"
 #include "masstree/str.hh"
@@ -88,16 +91,36 @@ public:
       char* m_tmp1_data = get_m_tmp1_data();
       int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, tuple);
 
-      uint64_t addr = (uint64_t)tuple->address();
-      uint64_t *addr_ptr = &addr;
+      char addr[8];
+      if (!m_tupleIds.encode(tuple->address(), addr))
+	return false;
 
-      if (!mt_entries.put_uv((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr, 8))
+      if (!mt_entries.put_uv((const char*)m_tmp1_data, m_tmp1_size, addr, 8))
 	return false;
       ++m_inserts;
       item_count++;
       return true;
     }
 
+    bool addEntries(const std::vector<void*> &tupleAddresses)
+    {
+      TableTuple tuple(m_tupleSchema);
+      MasstreeBulkLoad load(tupleAddresses.size(), m_keySchema->tupleLength());
+      for (size_t i = 0; i < tupleAddresses.size(); i++) {
+	tuple.move(tupleAddresses[i]);
+	m_tmp1.setFromTuple(&tuple, column_indices_, m_keySchema);
+	char* m_tmp1_data = get_m_tmp1_data();
+	int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, &tuple);
+	load.add(m_tmp1_data, m_tmp1_size, tuple.address());
+      }
+
+      size_t loaded;
+      bool success = loadUniqueEntries(mt_entries, m_tupleIds, load, loaded);
+      m_inserts += (int)loaded;
+      item_count += (int)loaded;
+      return success;
+    }
+
     bool deleteEntry(const TableTuple* tuple)
     {
       //std::cout << "MU -- DELETE\n";
@@ -124,11 +147,12 @@ public:
       int m_tmp2_size = m_tmp2.size(m_keySchema, column_indices_, newTupleValue);
       if (m_eq(m_tmp1, m_tmp2))
 	return true;
-      uint64_t addr = (uint64_t)newTupleValue->address();
-      uint64_t *addr_ptr = &addr;
+      char addr[8];
+      if (!m_tupleIds.encode(newTupleValue->address(), addr))
+	return false;
 
       bool remove_success = mt_entries.remove((const char*)m_tmp1_data, m_tmp1_size);
-      bool insert_success = mt_entries.put_uv((const char*)m_tmp2_data, m_tmp2_size, (const char*)addr_ptr, 8);
+      bool insert_success = mt_entries.put_uv((const char*)m_tmp2_data, m_tmp2_size, addr, 8);
       ++m_updates;
       return (remove_success && insert_success);
     }
@@ -139,12 +163,13 @@ public:
       char* m_tmp1_data = get_m_tmp1_data();
       int m_tmp1_size = m_tmp1.size(m_keySchema, column_indices_, tuple);
 
-      uint64_t addr = (uint64_t)address;
-      uint64_t *addr_ptr = &addr;
+      char addr[8];
+      if (!m_tupleIds.encode(address, addr))
+	return false;
 
       //mt_entries.remove((const char*)m_tmp1_data, m_tmp1_size);
-      mt_entries.update_uv((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr);
-      //mt_entries.put((const char*)m_tmp1_data, m_tmp1_size, (const char*)addr_ptr, 8);
+      mt_entries.update_uv((const char*)m_tmp1_data, m_tmp1_size, addr);
+      //mt_entries.put((const char*)m_tmp1_data, m_tmp1_size, addr, 8);
       ++m_updates; 
       return true;
     }
@@ -189,7 +214,7 @@ public:
 	return false;
       }
 
-      char *retvalue = *(reinterpret_cast<char**>(const_cast<char*>(value.s)));
+      char *retvalue = m_tupleIds.decode(value.s);
       m_match.move(retvalue);
       return m_match.address() != NULL;
     }
@@ -213,7 +238,7 @@ public:
 	return false;
       }
 
-      char *retvalue = *(reinterpret_cast<char**>(const_cast<char*>(value.s)));
+      char *retvalue = m_tupleIds.decode(value.s);
       m_match.moveC(retvalue);
       return m_match.address() != NULL;
     }
@@ -230,6 +255,30 @@ public:
     int64_t getMemoryEstimate() const {
       return (int64_t)mt_entries.memory_consumption();
     }
+    size_t getDeadEntryCount() const {
+      return (size_t)mt_entries.get_sdead();
+    }
+
+    bool getDetailedStats(TableIndexDetailedStats &stats) {
+      getMasstreeDetailedStats(mt_entries, stats);
+      return true;
+    }
+
+    void enableStaticSharing() {
+      m_staticSharing = true;
+    }
+
+    // the value is the tuple id only when the static stage may be shared;
+    // the slot width stays 8, but a filled index can't switch encodings
+    void setTupleTables(Table *table, Table *evictedTable) {
+      if (!m_staticSharing || (!m_tupleIds.bound() && item_count != 0))
+	return;
+      m_tupleIds.setTables(table, evictedTable);
+    }
+
+    bool shareStaticStage(const std::string &key) {
+      return m_tupleIds.bound() && mt_entries.share_static(key.c_str());
+    }
     /*
     void printTreeStats() {
       std::cout << name_ << "\n";
@@ -244,12 +293,14 @@ protected:
     MasstreeUniqueIndex(const TableIndexScheme &scheme) :
         TableIndex(scheme),
         m_begin(true),
-	m_eq(m_keySchema)
+	m_eq(m_keySchema),
+	m_tupleIds(8)
     {
       //std::cout << "MasstreeUniqueIndex\t" << scheme.name << ": " << m_tmp1.size() << "\n";
       //std::cout << "BEGIN\t" << scheme.name << "\n";
         ints_only = scheme.intsOnly;
 	item_count = 0;
+	m_staticSharing = false;
         m_match = TableTuple(m_tupleSchema);
 	m_memoryEstimate = 1;
 	mt_entries.setup(m_tmp1.size(), false);
@@ -334,6 +385,10 @@ protected:
 
     bool ints_only;
     int item_count;
+
+    // tuple ids instead of addresses, see enableStaticSharing()
+    MasstreeTupleId m_tupleIds;
+    bool m_staticSharing;
 };
 
 }
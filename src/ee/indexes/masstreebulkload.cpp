@@ -0,0 +1,142 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "masstreebulkload.h"
+
+using namespace voltdb;
+
+// buckets smaller than this are finished with an insertion sort
+static const size_t RADIX_CUTOFF = 32;
+
+MasstreeBulkLoad::MasstreeBulkLoad(size_t expectedEntries, size_t expectedKeyLength)
+{
+    m_keys.reserve(expectedEntries * expectedKeyLength);
+    m_entries.reserve(expectedEntries);
+}
+
+void MasstreeBulkLoad::add(const char *key, int keyLength, const void *address)
+{
+    Entry entry;
+    entry.offset = static_cast<uint32_t>(m_keys.size());
+    entry.length = static_cast<uint32_t>(keyLength);
+    entry.address = address;
+    m_keys.insert(m_keys.end(), key, key + keyLength);
+    m_entries.push_back(entry);
+}
+
+void MasstreeBulkLoad::sort()
+{
+    if (m_entries.size() < 2)
+        return;
+    m_scratch.resize(m_entries.size());
+    radixSort(0, m_entries.size(), 0);
+    std::vector<Entry>().swap(m_scratch);
+}
+
+size_t MasstreeBulkLoad::equalRangeEnd(size_t i) const
+{
+    const Entry &first = m_entries[i];
+    size_t end = i + 1;
+    while (end < m_entries.size()) {
+        const Entry &next = m_entries[end];
+        if (next.length != first.length ||
+            ::memcmp(&m_keys[next.offset], &m_keys[first.offset], first.length) != 0)
+            break;
+        ++end;
+    }
+    return end;
+}
+
+bool MasstreeBulkLoad::less(const Entry &lhs, const Entry &rhs, size_t depth) const
+{
+    uint32_t common = lhs.length < rhs.length ? lhs.length : rhs.length;
+    if (depth < common) {
+        int cmp = ::memcmp(&m_keys[lhs.offset + depth], &m_keys[rhs.offset + depth],
+                           common - depth);
+        if (cmp != 0)
+            return cmp < 0;
+    }
+    return lhs.length < rhs.length;
+}
+
+void MasstreeBulkLoad::insertionSort(size_t begin, size_t end, size_t depth)
+{
+    for (size_t i = begin + 1; i < end; ++i) {
+        Entry entry = m_entries[i];
+        size_t j = i;
+        while (j > begin && less(entry, m_entries[j - 1], depth)) {
+            m_entries[j] = m_entries[j - 1];
+            --j;
+        }
+        m_entries[j] = entry;
+    }
+}
+
+void MasstreeBulkLoad::radixSort(size_t begin, size_t end, size_t depth)
+{
+    while (end - begin > 1) {
+        if (end - begin < RADIX_CUTOFF) {
+            insertionSort(begin, end, depth);
+            return;
+        }
+
+        size_t counts[257];
+        ::memset(counts, 0, sizeof(counts));
+        for (size_t i = begin; i < end; ++i)
+            ++counts[byteAt(m_entries[i], depth)];
+
+        // every key exhausted: the whole range is one run of equal keys
+        if (counts[0] == end - begin)
+            return;
+
+        // a shared byte at this depth needs no scatter pass
+        if (counts[byteAt(m_entries[begin], depth)] == end - begin) {
+            ++depth;
+            continue;
+        }
+
+        size_t starts[257];
+        size_t pos = begin;
+        for (int b = 0; b < 257; ++b) {
+            starts[b] = pos;
+            pos += counts[b];
+        }
+        for (size_t i = begin; i < end; ++i)
+            m_scratch[starts[byteAt(m_entries[i], depth)]++] = m_entries[i];
+        std::copy(m_scratch.begin() + begin, m_scratch.begin() + end,
+                  m_entries.begin() + begin);
+
+        // bucket 0 holds keys that ended at this depth; they are all equal
+        pos = begin + counts[0];
+        for (int b = 1; b < 257; ++b) {
+            if (counts[b] > 1)
+                radixSort(pos, pos + counts[b], depth + 1);
+            pos += counts[b];
+        }
+        return;
+    }
+}
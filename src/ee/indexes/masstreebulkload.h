@@ -0,0 +1,151 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTOREMASSTREEBULKLOAD_H
+#define HSTOREMASSTREEBULKLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace voltdb {
+
+/**
+ * Collects the (packed key, tuple address) pairs of a batch of tuples that
+ * are about to be added to a Masstree index and sorts them by the unsigned
+ * byte order Masstree itself uses. Feeding the keys to the tree in that order
+ * keeps every insert on the rightmost leaf of each layer and lets the caller
+ * fold the whole batch into the static stage with a single merge.
+ */
+class MasstreeBulkLoad {
+public:
+    MasstreeBulkLoad(size_t expectedEntries, size_t expectedKeyLength);
+
+    /**
+     * Copy the key bytes and remember the tuple address they map to.
+     */
+    void add(const char *key, int keyLength, const void *address);
+
+    /**
+     * Sort the entries with an MSD radix sort on the key bytes. Entries
+     * with equal keys end up adjacent, in no particular order.
+     */
+    void sort();
+
+    inline size_t size() const { return m_entries.size(); }
+    inline const char* key(size_t i) const { return &m_keys[m_entries[i].offset]; }
+    inline int keyLength(size_t i) const { return static_cast<int>(m_entries[i].length); }
+    inline const void* address(size_t i) const { return m_entries[i].address; }
+
+    /**
+     * Index one past the last entry sharing the key of entry i. Only
+     * meaningful after sort().
+     */
+    size_t equalRangeEnd(size_t i) const;
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        const void *address;
+    };
+
+    inline int byteAt(const Entry &entry, size_t depth) const {
+        // keys that end before depth sort ahead of every key that continues
+        return depth < entry.length ?
+            static_cast<unsigned char>(m_keys[entry.offset + depth]) + 1 : 0;
+    }
+
+    bool less(const Entry &lhs, const Entry &rhs, size_t depth) const;
+    void radixSort(size_t begin, size_t end, size_t depth);
+    void insertionSort(size_t begin, size_t end, size_t depth);
+
+    std::vector<char> m_keys;
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_scratch;
+};
+
+/**
+ * Sort the collected entries and insert them into a unique Masstree index
+ * with a single merge into the static stage at the end. Tuples whose id
+ * can't be encoded or whose key is already present are skipped. loaded is
+ * set to the number of entries added; returns false if any was skipped.
+ */
+template <typename MtiType, typename TupleIds>
+bool loadUniqueEntries(MtiType &entries, TupleIds &tupleIds, MasstreeBulkLoad &load,
+                       size_t &loaded) {
+    load.sort();
+    loaded = 0;
+    bool success = true;
+    entries.begin_bulk_load();
+    for (size_t i = 0; i < load.size(); i++) {
+        char value[8];
+        if (!tupleIds.encode(load.address(i), value) ||
+            !entries.put_uv(load.key(i), load.keyLength(i), value, 8)) {
+            success = false;
+            continue;
+        }
+        loaded++;
+    }
+    entries.end_bulk_load();
+    return success;
+}
+
+/**
+ * The multimap counterpart of loadUniqueEntries: one insert per distinct
+ * key carrying the values of all of its tuples.
+ */
+template <typename MtiType, typename TupleIds>
+bool loadMultiMapEntries(MtiType &entries, TupleIds &tupleIds, MasstreeBulkLoad &load,
+                         size_t &loaded) {
+    load.sort();
+    loaded = 0;
+    const int valueLength = tupleIds.valueLength();
+    std::vector<char> values;
+    bool success = true;
+    entries.begin_bulk_load();
+    for (size_t i = 0; i < load.size(); ) {
+        size_t end = load.equalRangeEnd(i);
+        values.resize((end - i) * valueLength);
+        size_t count = 0;
+        for (size_t j = i; j < end; j++) {
+            if (tupleIds.encode(load.address(j), &values[count * valueLength]))
+                count++;
+            else
+                success = false;
+        }
+        if (count > 0)
+            entries.put_nuv(load.key(i), load.keyLength(i), &values[0],
+                            static_cast<int>(count * valueLength));
+        loaded += count;
+        i = end;
+    }
+    entries.end_bulk_load();
+    return success;
+}
+
+}
+
+#endif
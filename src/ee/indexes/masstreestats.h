@@ -0,0 +1,62 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTOREMASSTREESTATS_H
+#define HSTOREMASSTREESTATS_H
+
+#include <stdint.h>
+#include "indexes/tableindex.h"
+
+#include "masstree/mtIndexAPI.hh"
+
+namespace voltdb {
+
+/**
+ * Copy an mt_index's counters into the index-neutral form IndexStats reads.
+ */
+template <typename MtiType>
+inline void getMasstreeDetailedStats(MtiType &entries, TableIndexDetailedStats &stats) {
+    mt_index_stats s;
+    entries.get_stats(s);
+    stats.dynamicHits = static_cast<int64_t>(s.dynamic_hits);
+    stats.staticHits = static_cast<int64_t>(s.static_hits);
+    stats.misses = static_cast<int64_t>(s.misses);
+    stats.bloomNegatives = static_cast<int64_t>(s.bloom_negatives);
+    stats.bloomFalsePositives = static_cast<int64_t>(s.bloom_false_positives);
+    stats.merges = static_cast<int64_t>(s.merges);
+    stats.mergePauseTotal = static_cast<int64_t>(s.merge_usec_total);
+    stats.mergePauseMax = static_cast<int64_t>(s.merge_usec_max);
+    stats.mergePauses.assign(s.merge_pause, s.merge_pause + MERGE_PAUSE_BUCKETS);
+    stats.dynamicBytes = s.dynamic_bytes;
+    stats.staticBytes = s.static_bytes;
+    stats.valueBytes = s.value_bytes;
+    stats.filterBytes = s.filter_bytes;
+    stats.staticHolders = static_cast<int64_t>(s.static_holders);
+    stats.leafFill.assign(s.leaf_fill, s.leaf_fill + LEAF_FILL_BUCKETS);
+}
+
+}
+
+#endif
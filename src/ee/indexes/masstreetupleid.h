@@ -0,0 +1,105 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTOREMASSTREETUPLEID_H
+#define HSTOREMASSTREETUPLEID_H
+
+#include <stdint.h>
+#include <string.h>
+#include "storage/table.h"
+
+namespace voltdb {
+
+/**
+ * Translates between tuple addresses and the values a Masstree multimap
+ * index stores for them. Until the index is bound to its table the value is
+ * the raw 64-bit address. Once bound it is a 32-bit tuple id: the tuple's
+ * position across the table's blocks (see Table::getTupleID), with the top
+ * bit set when the tuple is an anti-cache stub living in the EvictedTable.
+ * boundWidth is the stored width of a bound id: 4 for multimaps, 8 (the id
+ * zero-extended) for unique indexes, whose values fill the whole slot.
+ */
+class MasstreeTupleId {
+public:
+    MasstreeTupleId(int boundWidth = 4)
+        : m_table(NULL), m_evictedTable(NULL), m_boundWidth(boundWidth) {}
+
+    inline void setTables(Table *table, Table *evictedTable) {
+        m_table = table;
+        m_evictedTable = evictedTable;
+    }
+
+    /** True once values are tuple ids rather than addresses. */
+    inline bool bound() const { return m_table != NULL; }
+
+    /** Width in bytes of one stored value. */
+    inline int valueLength() const { return m_table ? m_boundWidth : 8; }
+
+    /**
+     * Write the value for address into out (valueLength() bytes). Returns
+     * false, leaving the index to fail the operation, if the tuple belongs
+     * to neither table.
+     */
+    inline bool encode(const void *address, char *out) const {
+        if (m_table == NULL) {
+            uint64_t addr = (uint64_t)address;
+            memcpy(out, &addr, 8);
+            return true;
+        }
+        int id = m_table->getTupleID(static_cast<const char*>(address));
+        uint32_t value = static_cast<uint32_t>(id);
+        if (id < 0 && m_evictedTable != NULL) {
+            id = m_evictedTable->getTupleID(static_cast<const char*>(address));
+            value = static_cast<uint32_t>(id) | EVICTED_BIT;
+        }
+        if (id < 0)
+            return false;
+        uint64_t wide = value;
+        memcpy(out, &wide, m_boundWidth);
+        return true;
+    }
+
+    /** Tuple address for a value previously produced by encode(). */
+    inline char* decode(const char *value) const {
+        if (m_table == NULL)
+            return *(reinterpret_cast<char* const*>(value));
+        uint32_t id;
+        memcpy(&id, value, 4);
+        if (id & EVICTED_BIT)
+            return m_evictedTable->dataPtrForTuple(id & ~EVICTED_BIT);
+        return m_table->dataPtrForTuple(id);
+    }
+
+private:
+    static const uint32_t EVICTED_BIT = 0x80000000u;
+
+    Table *m_table;
+    Table *m_evictedTable;
+    int m_boundWidth;
+};
+
+}
+
+#endif
@@ -83,6 +83,18 @@ TableIndex::~TableIndex()
     voltdb::TupleSchema::freeTupleSchema(m_keySchema);
 }
 
+bool TableIndex::addEntries(const std::vector<void*> &tupleAddresses)
+{
+    bool success = true;
+    TableTuple tuple(m_tupleSchema);
+    for (std::vector<void*>::const_iterator i = tupleAddresses.begin();
+         i != tupleAddresses.end(); ++i) {
+        tuple.move(*i);
+        success &= addEntry(&tuple);
+    }
+    return success;
+}
+
 IndexStats* TableIndex::getIndexStats() {
     return &m_stats;
 }
@@ -60,6 +60,8 @@
 
 namespace voltdb {
 
+class Table;
+
 /**
  * Parameter for constructing TableIndex. TupleSchema, then key schema
  */
@@ -133,6 +135,14 @@ public:
      */
     virtual bool addEntry(const TableTuple *tuple) = 0;
 
+    /**
+     * adds index entries for a batch of tuples given by their addresses,
+     * e.g. a freshly loaded table chunk. The default implementation calls
+     * addEntry() for each tuple; indexes that can build faster from sorted
+     * input override it. Returns false if any single insert failed.
+     */
+    virtual bool addEntries(const std::vector<void*> &tupleAddresses);
+
     /**
      * removes the index entry linked to given value (and tuple
      * pointer, if it's non-unique index).
@@ -148,6 +158,31 @@ public:
                               const TableTuple *newTupleValue) = 0;
     
     virtual bool setEntryToNewAddress(const TableTuple *tuple, const void* address, const void* oldAddress) = 0; 
+
+    /**
+     * tells the index which table its tuples live in (and, with anti-caching,
+     * the EvictedTable holding stubs for evicted tuples). Indexes that store
+     * compact tuple ids instead of addresses resolve them through these.
+     * Called before any entry is added; the default ignores it.
+     */
+    virtual void setTupleTables(Table *table, Table *evictedTable) {}
+
+    /**
+     * marks the index as one whose copies in other partitions hold the
+     * same entries (it belongs to a replicated table), so it should store
+     * values that are the same in every copy. Called before
+     * setTupleTables(); the default ignores it.
+     */
+    virtual void enableStaticSharing() {}
+
+    /**
+     * lets the index share its read-only stage with identical copies in
+     * other partitions of this process, registered under key. Returns true
+     * if the stage is now shared; the default can't share.
+     */
+    virtual bool shareStaticStage(const std::string &key) {
+        return false;
+    }
     
     
     /**
@@ -283,10 +318,27 @@ public:
 
     virtual size_t getSize() const = 0;
 
+    // Number of key lookups served so far.
+    int64_t getLookupCount() const {
+        return m_lookups;
+    }
+
     // Return the amount of memory we think is allocated for this
     // index.
     virtual int64_t getMemoryEstimate() const = 0;
 
+    // Number of removed entries whose slots the index has not
+    // reclaimed yet. Only indexes with a static stage have any.
+    virtual size_t getDeadEntryCount() const {
+        return 0;
+    }
+
+    // Fill in stats and return true if the index keeps detailed
+    // counters. Called when stats are polled; may walk the index.
+    virtual bool getDetailedStats(TableIndexDetailedStats &/*stats*/) {
+        return false;
+    }
+
     //virtual void printTreeStats() = 0;
     
     const std::vector<int>& getColumnIndices() const {
@@ -340,7 +392,7 @@ protected:
     int* column_indices_;
 
     // counters
-    int m_lookups;
+    int64_t m_lookups;
     int m_inserts;
     int m_deletes;
     int m_updates;
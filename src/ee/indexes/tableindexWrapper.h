@@ -53,6 +53,7 @@
 #include "indexes/tableindex.h"
 
 #include <string>
+#include <vector>
 
 namespace voltdb {
 
@@ -70,6 +71,17 @@ public:
       return ti_->addEntry(tuple);
     }
 
+    bool addEntries(const std::vector<void*> &tupleAddresses) {
+      // traced one put per tuple so parse.py replays a batch like single inserts
+      TableTuple tuple(ti_->m_tupleSchema);
+      for (size_t i = 0; i < tupleAddresses.size(); i++) {
+        tuple.move(tupleAddresses[i]);
+        index_file_ << "CMD\taddEntry\n";
+        dumpTuple(&tuple);
+      }
+      return ti_->addEntries(tupleAddresses);
+    }
+
     bool deleteEntry(const TableTuple* tuple) {
       index_file_ << "CMD\tdeleteEntry\n";
       dumpTuple(tuple);
@@ -98,6 +110,22 @@ public:
       return ti_->setEntryToNewAddress(tuple, address, oldAddress);
     }
 
+    void setTupleTables(Table *table, Table *evictedTable) {
+      ti_->setTupleTables(table, evictedTable);
+    }
+
+    void enableStaticSharing() {
+      ti_->enableStaticSharing();
+    }
+
+    bool shareStaticStage(const std::string &key) {
+      return ti_->shareStaticStage(key);
+    }
+
+    bool getDetailedStats(TableIndexDetailedStats &stats) {
+      return ti_->getDetailedStats(stats);
+    }
+
     bool checkForIndexChange(const TableTuple* lhs, const TableTuple* rhs) {
       index_file_ << "CMD\tcheckForIndexChange\n";
       index_file_ << "ARG\tlhs\n";
@@ -174,6 +202,10 @@ public:
       return 0;
     }
 
+    size_t getDeadEntryCount() const {
+      return ti_->getDeadEntryCount();
+    }
+
     std::string getTypeName() const {
       //std::cout << "getTypeName\n";
       //std::cout << ti_->getTypeName() << "\n";
@@ -16,7 +16,16 @@
  */
 #include "AriesLogProxy.h"
 #include "execution/VoltDBEngine.h"
+#include "logging/Logrecord.h"
+#include "common/serializeio.h"
+#include "common/FatalException.hpp"
 #include <string>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using std::ios;
 using std::string;
@@ -41,16 +50,49 @@ void AriesLogProxy::init(VoltDBEngine *engine, string logfileName) {
 	// XXX originally true
 	jniLogging = false;
 
+	logFileFD = -1;
+	ringBuffer = NULL;
+	appendedLSN = durableLSN = syncRequestLSN = 0;
+	allocatedSize = 0;
+	flusherRunning = false;
+	stopping = false;
+	flushFailed = false;
+	pthread_mutex_init(&ringMutex, NULL);
+	pthread_cond_init(&flushCond, NULL);
+	pthread_cond_init(&durableCond, NULL);
+
 	if (!jniLogging) {
-		// append + binary mode
-		logFile = fopen(logfileName.c_str(), "ab+");
-		logFileFD = fileno(logFile);
+		logFileFD = open(logfileName.c_str(), O_RDWR | O_CREAT, 0644);
 
-		if(logFile != NULL){
+		if(logFileFD >= 0){
 			VOLT_DEBUG("AriesLogProxy : opened logfile %s ", logFileName.c_str());
 		}
 		else{
 			VOLT_ERROR("AriesLogProxy : cannot open logfile %s ", logFileName.c_str());
+			return;
+		}
+
+		// append after the last whole record; anything past it is either
+		// zero fill from a previous run or a torn write, and must not be
+		// replayed behind the records we add now
+		struct stat st;
+		if (fstat(logFileFD, &st) == 0) {
+			allocatedSize = st.st_size;
+		}
+		appendedLSN = durableLSN = syncRequestLSN = findLogEnd();
+		if (durableLSN < allocatedSize) {
+			if (ftruncate(logFileFD, durableLSN) == 0) {
+				allocatedSize = durableLSN;
+			} else {
+				VOLT_ERROR("AriesLogProxy : could not trim logfile %s", logFileName.c_str());
+			}
+		}
+
+		ringBuffer = new char[ARIES_LOG_BUFFER_SIZE];
+		if (pthread_create(&flusher, NULL, flusherMain, this) == 0) {
+			flusherRunning = true;
+		} else {
+			VOLT_ERROR("AriesLogProxy : cannot start flusher for %s", logFileName.c_str());
 		}
 	} else {
 		if (engine == NULL) {
@@ -61,8 +103,21 @@ void AriesLogProxy::init(VoltDBEngine *engine, string logfileName) {
 }
 
 AriesLogProxy::~AriesLogProxy() {
-	if(logFile != NULL){
-		int ret = fclose(logFile);
+	if (flusherRunning) {
+		// the flusher drains the ring before it exits
+		pthread_mutex_lock(&ringMutex);
+		stopping = true;
+		pthread_cond_signal(&flushCond);
+		pthread_mutex_unlock(&ringMutex);
+		pthread_join(flusher, NULL);
+	}
+
+	if(logFileFD >= 0){
+		// drop the zero fill so the file ends with the last record
+		if (ftruncate(logFileFD, durableLSN) != 0) {
+			VOLT_ERROR("AriesLogProxy : could not trim logfile %s", logFileName.c_str());
+		}
+		int ret = close(logFileFD);
 
 		if(ret == 0){
 			VOLT_DEBUG("AriesLogProxy : closed logfile %s", logFileName.c_str());
@@ -71,6 +126,11 @@ AriesLogProxy::~AriesLogProxy() {
 			VOLT_ERROR("AriesLogProxy : could not close logfile %s", logFileName.c_str());
 		}
 	}
+
+	delete[] ringBuffer;
+	pthread_cond_destroy(&durableCond);
+	pthread_cond_destroy(&flushCond);
+	pthread_mutex_destroy(&ringMutex);
 }
 
 AriesLogProxy* AriesLogProxy::getAriesLogProxy(VoltDBEngine *engine) {
@@ -158,31 +218,216 @@ void AriesLogProxy::logBinaryOutput(const char *data, size_t size) {
 }
 
 void AriesLogProxy::logLocally(const char *data, size_t size) {
-	size_t s_ret = -1;
-	int ret = -1;
+	if (!flusherRunning) {
+		VOLT_ERROR("logLocally failed : logfile %s is not open", logFileName.c_str());
+		return;
+	}
+
+	pthread_mutex_lock(&ringMutex);
+	while (size > 0) {
+		if (flushFailed) {
+			pthread_mutex_unlock(&ringMutex);
+			throwFatalException("AriesLogProxy : could not write logfile %s", logFileName.c_str());
+		}
+		int64_t space = ARIES_LOG_BUFFER_SIZE - (appendedLSN - durableLSN);
+		if (space == 0) {
+			// ring is full, hand it all to the flusher and wait for room
+			pthread_cond_signal(&flushCond);
+			pthread_cond_wait(&durableCond, &ringMutex);
+			continue;
+		}
+
+		size_t n = std::min(size, static_cast<size_t>(space));
+		size_t offset = static_cast<size_t>(appendedLSN % ARIES_LOG_BUFFER_SIZE);
+		size_t first = std::min(n, ARIES_LOG_BUFFER_SIZE - offset);
+		memcpy(ringBuffer + offset, data, first);
+		memcpy(ringBuffer, data + first, n - first);
+
+		bool wasIdle = (appendedLSN == durableLSN);
+		appendedLSN += static_cast<int64_t>(n);
+		if (wasIdle || appendedLSN - durableLSN >= ARIES_LOG_BUFFER_SIZE / 2) {
+			pthread_cond_signal(&flushCond);
+		}
 
-	s_ret = fwrite (data , sizeof(char), size, logFile);
-	if(s_ret != size){
-		VOLT_ERROR("logLocally failed : badbit set");
+		data += n;
+		size -= n;
 	}
+	pthread_mutex_unlock(&ringMutex);
+}
 
-	ret = fflush(logFile);
-	if(ret == 0){
-	 	VOLT_DEBUG("logLocally : flushed : file pos %ld", ftell(logFile));
+int64_t AriesLogProxy::waitForDurableLSN() {
+	pthread_mutex_lock(&ringMutex);
+	int64_t lsn = appendedLSN;
+	if (durableLSN < lsn) {
+		if (syncRequestLSN < lsn) {
+			syncRequestLSN = lsn;
+		}
+		pthread_cond_signal(&flushCond);
+		while (durableLSN < lsn && !flushFailed) {
+			pthread_cond_wait(&durableCond, &ringMutex);
+		}
 	}
-	else{
-	 	VOLT_ERROR("logLocally : flushed : file pos %ld", ftell(logFile));
+	bool failed = durableLSN < lsn;
+	pthread_mutex_unlock(&ringMutex);
+
+	if (failed) {
+		throwFatalException("AriesLogProxy : could not write logfile %s past %ld",
+				logFileName.c_str(), durableLSN);
 	}
 
-	// SYNC changes
-	ret = fsync(logFileFD);
-	if(ret == 0){
-		VOLT_DEBUG("logLocally : synced file");
+	VOLT_DEBUG("waitForDurableLSN : durable up to %ld", lsn);
+	return lsn;
+}
+
+/**
+ * Walk the record headers to find where the last whole record ends.
+ * Same framing as AriesReplayer::frameBatch: a 4 byte length, the
+ * record, and for bulk loads an 8 byte count followed by the raw bytes.
+ */
+int64_t AriesLogProxy::findLogEnd() {
+	int64_t pos = 0;
+
+	while (pos + static_cast<int64_t>(sizeof(int32_t)) <= allocatedSize) {
+		int32_t recordSize = 0;
+		if (pread(logFileFD, &recordSize, sizeof(recordSize), pos) != sizeof(recordSize)) {
+			break;
+		}
+		recordSize = ntohl(recordSize);
+		if (recordSize <= 0) {
+			break;
+		}
+
+		int64_t end = pos + static_cast<int64_t>(sizeof(int32_t)) + recordSize;
+
+		char header[sizeof(int32_t) + LOGRECORD_PEEK_LENGTH];
+		size_t headerLength = std::min(sizeof(header), sizeof(int32_t) + static_cast<size_t>(recordSize));
+		int8_t txnType = 0;
+		int64_t txnId;
+		int32_t siteId;
+		if (pread(logFileFD, header, headerLength, pos) != static_cast<ssize_t>(headerLength) ||
+				!LogRecord::peekHeader(header, headerLength, txnType, txnId, siteId)) {
+			break;
+		}
+		if (txnType == static_cast<int8_t>(LogRecord::T_BULKLOAD)) {
+			int64_t numBulkLoadBytes = 0;
+			if (pread(logFileFD, &numBulkLoadBytes, sizeof(numBulkLoadBytes), end) != sizeof(numBulkLoadBytes)) {
+				break;
+			}
+			end += static_cast<int64_t>(sizeof(numBulkLoadBytes) + ntohll(numBulkLoadBytes));
+		}
+
+		if (end > allocatedSize) {
+			break;
+		}
+		pos = end;
+	}
+
+	VOLT_DEBUG("AriesLogProxy : logfile %s ends at %ld", logFileName.c_str(), pos);
+	return pos;
+}
+
+/**
+ * Zero-fill the log file up to size and sync it with the inode, so the
+ * appends that follow only need fdatasync.
+ */
+bool AriesLogProxy::extendLogFile(int64_t size) {
+	static const char zeros[64 * 1024] = { 0 };
+
+	int64_t pos = allocatedSize;
+	while (pos < size) {
+		size_t n = static_cast<size_t>(std::min(static_cast<int64_t>(sizeof(zeros)), size - pos));
+		ssize_t ret = pwrite(logFileFD, zeros, n, pos);
+		if (ret <= 0) {
+			VOLT_ERROR("AriesLogProxy : could not extend logfile %s", logFileName.c_str());
+			return false;
+		}
+		pos += ret;
 	}
-	else{
-		VOLT_ERROR("logLocally : could not sync file ");
+
+	if (fsync(logFileFD) != 0) {
+		VOLT_ERROR("AriesLogProxy : could not sync logfile %s", logFileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Write the records between the two LSNs from the ring to the file.
+ * Returns false if any of them could not be written.
+ */
+bool AriesLogProxy::writeToLogFile(int64_t fromLSN, int64_t toLSN) {
+	if (toLSN > allocatedSize) {
+		int64_t size = (toLSN + ARIES_LOG_SEGMENT_SIZE - 1) / ARIES_LOG_SEGMENT_SIZE * ARIES_LOG_SEGMENT_SIZE;
+		if (!extendLogFile(size)) {
+			return false;
+		}
+		allocatedSize = size;
 	}
 
+	while (fromLSN < toLSN) {
+		size_t offset = static_cast<size_t>(fromLSN % ARIES_LOG_BUFFER_SIZE);
+		size_t n = static_cast<size_t>(std::min(toLSN - fromLSN,
+				static_cast<int64_t>(ARIES_LOG_BUFFER_SIZE - offset)));
+		ssize_t ret = pwrite(logFileFD, ringBuffer + offset, n, fromLSN);
+		if (ret <= 0) {
+			VOLT_ERROR("logLocally failed : could not write at file pos %ld", fromLSN);
+			return false;
+		}
+		fromLSN += ret;
+	}
+	return true;
+}
+
+void* AriesLogProxy::flusherMain(void *proxy) {
+	static_cast<AriesLogProxy*>(proxy)->flushLoop();
+	return NULL;
+}
+
+void AriesLogProxy::flushLoop() {
+	pthread_mutex_lock(&ringMutex);
+	while (true) {
+		while (!stopping && appendedLSN == durableLSN) {
+			pthread_cond_wait(&flushCond, &ringMutex);
+		}
+		if (appendedLSN == durableLSN) {
+			break; // stopping, nothing left to write
+		}
+
+		if (!stopping && syncRequestLSN <= durableLSN &&
+				appendedLSN - durableLSN < ARIES_LOG_BUFFER_SIZE / 2) {
+			// nobody is committing yet, let more records join this batch
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += ARIES_LOG_FLUSH_WINDOW_USEC * 1000;
+			if (deadline.tv_nsec >= 1000000000) {
+				deadline.tv_sec += 1;
+				deadline.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&flushCond, &ringMutex, &deadline);
+		}
+
+		int64_t fromLSN = durableLSN;
+		int64_t toLSN = appendedLSN;
+		pthread_mutex_unlock(&ringMutex);
+
+		bool written = writeToLogFile(fromLSN, toLSN);
+		if (written && fdatasync(logFileFD) != 0) {
+			VOLT_ERROR("logLocally : could not sync file ");
+			written = false;
+		}
+
+		pthread_mutex_lock(&ringMutex);
+		if (!written) {
+			// the records may be partly on disk, they are not durable;
+			// wake everyone waiting so they see the failure
+			flushFailed = true;
+			pthread_cond_broadcast(&durableCond);
+			break;
+		}
+		durableLSN = toLSN;
+		pthread_cond_broadcast(&durableCond);
+	}
+	pthread_mutex_unlock(&ringMutex);
 }
 
 void AriesLogProxy::logToEngineBuffer(const char *data, size_t size) {
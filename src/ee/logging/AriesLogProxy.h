@@ -24,6 +24,19 @@
 #include <iostream>
 #include <cstdio>
 #include <fstream>
+#include <stdint.h>
+#include <pthread.h>
+
+// Bytes of log records buffered in memory ahead of the flusher
+#define ARIES_LOG_BUFFER_SIZE (4 * 1024 * 1024)
+
+// The log file is grown in zero-filled segments of this size, so
+// appending never changes the file size and fdatasync skips the inode
+#define ARIES_LOG_SEGMENT_SIZE (16 * 1024 * 1024)
+
+// Longest a buffered record waits for the flusher when no transaction
+// is committing
+#define ARIES_LOG_FLUSH_WINDOW_USEC 2000
 
 namespace voltdb {
 class VoltDBEngine;
@@ -31,6 +44,16 @@ class VoltDBEngine;
 /**
  * A log proxy implementation geared toward Aries. Implements an
  * extra function to log binary output to files.
+ *
+ * Records are appended to an in-memory ring and written out by a
+ * flusher thread, one fdatasync per batch. A log sequence number (LSN)
+ * is the file offset just past a record. The flusher starts a batch
+ * when a transaction commits (waitForDurableLSN), when the ring is
+ * half full, or after ARIES_LOG_FLUSH_WINDOW_USEC.
+ *
+ * If the log file can't be written or synced the flusher stops without
+ * advancing the durable LSN, and the next commit (or a logger waiting
+ * for room in the ring) throws a FatalException.
  */
 class AriesLogProxy : public LogProxy {
 public:
@@ -39,6 +62,13 @@ public:
 	void log(LoggerId loggerId, LogLevel level, const char *statement) const;
 	static AriesLogProxy* getAriesLogProxy(VoltDBEngine* engine);
 	void logBinaryOutput(const char *data, size_t size);
+
+	/**
+	 * Block until every record logged so far is on disk. Called at
+	 * transaction commit; returns the durable LSN. Throws a
+	 * FatalException if the records can't be made durable.
+	 */
+	int64_t waitForDurableLSN();
 	//void setEngine(VoltDBEngine*);
 
 	std::string getLogFileName();
@@ -53,9 +83,29 @@ private:
 	void logLocally(const char *data, size_t size);
 	void logToEngineBuffer(const char *data, size_t size);
 
+	int64_t findLogEnd();
+	bool extendLogFile(int64_t size);
+	bool writeToLogFile(int64_t fromLSN, int64_t toLSN);
+	void flushLoop();
+	static void* flusherMain(void *proxy);
+
 	std::string logFileName;
-	FILE* logFile;
-	int logFileFD; // fd equivalent for fsync
+	int logFileFD;
+
+	// ring of records not yet written, indexed by LSN % ARIES_LOG_BUFFER_SIZE
+	char *ringBuffer;
+	int64_t appendedLSN;
+	int64_t durableLSN;
+	int64_t syncRequestLSN;
+	int64_t allocatedSize;
+
+	pthread_t flusher;
+	bool flusherRunning;
+	bool stopping;
+	bool flushFailed;   // the flusher gave up, nothing past durableLSN will be written
+	pthread_mutex_t ringMutex;
+	pthread_cond_t flushCond;   // flusher waits for records or a commit
+	pthread_cond_t durableCond; // committers and the appender wait for the flusher
 
 	bool jniLogging;
 	VoltDBEngine* engine;
@@ -0,0 +1,179 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "AriesReplayer.h"
+#include "logging/Logrecord.h"
+#include "execution/VoltDBEngine.h"
+#include "storage/persistenttable.h"
+#include "common/serializeio.h"
+#include "common/debuglog.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace voltdb;
+
+AriesReplayer::AriesReplayer(VoltDBEngine *engine, const char *logData, size_t length,
+                             int64_t replayTxnId, int32_t siteId)
+    : m_engine(engine), m_position(logData), m_end(logData + length),
+      m_replayTxnId(replayTxnId), m_siteId(siteId), m_skipped(0),
+      m_current(0), m_runningParsers(0)
+{
+    // get the first batch parsing before the caller asks for it
+    frameBatch(m_batches[1]);
+    startParse(m_batches[1]);
+}
+
+AriesReplayer::~AriesReplayer() {
+    finishParse();
+    freeBatch(m_batches[0]);
+    freeBatch(m_batches[1]);
+}
+
+std::vector<AriesReplayRecord>& AriesReplayer::nextBatch() {
+    finishParse();
+    freeBatch(m_batches[m_current]);
+    m_current ^= 1;
+
+    frameBatch(m_batches[m_current ^ 1]);
+    startParse(m_batches[m_current ^ 1]);
+
+    return m_batches[m_current];
+}
+
+/**
+ * Same framing as the log writer: a 4 byte length, the record (either
+ * format, see LogRecord::peekHeader), and for
+ * bulk loads an 8 byte count followed by the raw bytes. A zero length
+ * (the writer's zero fill) or a record running past the end of the log
+ * (a torn write) ends the log.
+ */
+void AriesReplayer::frameBatch(std::vector<AriesReplayRecord> &batch) {
+    const int32_t headerSize = static_cast<int32_t>(sizeof(int32_t));
+
+    while (batch.size() < ARIES_REPLAY_BATCH_SIZE && m_end - m_position >= headerSize) {
+        int32_t recordSize = 0;
+        memcpy(&recordSize, m_position, sizeof(recordSize));
+        recordSize = ntohl(recordSize);
+
+        AriesReplayRecord replayRecord;
+        int64_t txnId;
+        int32_t origSiteId;
+
+        if (recordSize <= 0 || m_end - m_position - headerSize < recordSize ||
+                !LogRecord::peekHeader(m_position, headerSize + recordSize,
+                                       replayRecord.type, txnId, origSiteId)) {
+            VOLT_DEBUG("ARIES : end of log, record size %d", recordSize);
+            m_position = m_end;
+            break;
+        }
+
+        replayRecord.data = m_position;
+        replayRecord.length = headerSize + recordSize;
+        replayRecord.bulkLoadData = NULL;
+        replayRecord.bulkLoadBytes = 0;
+        replayRecord.record = NULL;
+        replayRecord.table = NULL;
+
+        const char *next = m_position + replayRecord.length;
+        if (replayRecord.type == static_cast<int8_t>(LogRecord::T_BULKLOAD)) {
+            int64_t numBulkLoadBytes = 0;
+            if (m_end - next < static_cast<int64_t>(sizeof(numBulkLoadBytes))) {
+                m_position = m_end;
+                break;
+            }
+            memcpy(&numBulkLoadBytes, next, sizeof(numBulkLoadBytes));
+            numBulkLoadBytes = ntohll(numBulkLoadBytes);
+            next += sizeof(numBulkLoadBytes);
+            if (numBulkLoadBytes < 0 || m_end - next < numBulkLoadBytes) {
+                m_position = m_end;
+                break;
+            }
+            replayRecord.bulkLoadData = next;
+            replayRecord.bulkLoadBytes = numBulkLoadBytes;
+            next += numBulkLoadBytes;
+        }
+
+        m_position = next;
+
+        // all updates from a site go to its partition, so only the records
+        // of this site are replayed here
+        if (txnId < m_replayTxnId || origSiteId != m_siteId) {
+            m_skipped++;
+            continue;
+        }
+        batch.push_back(replayRecord);
+    }
+}
+
+void AriesReplayer::startParse(std::vector<AriesReplayRecord> &batch) {
+    size_t stride = std::min(batch.size(), static_cast<size_t>(ARIES_REPLAY_PARSE_THREADS));
+
+    for (size_t slice = 0; slice < stride; slice++) {
+        ParseTask &task = m_tasks[m_runningParsers];
+        task.replayer = this;
+        task.batch = &batch;
+        task.slice = slice;
+        task.stride = stride;
+        if (pthread_create(&m_parsers[m_runningParsers], NULL, parseMain, &task) == 0) {
+            m_runningParsers++;
+        } else {
+            parseSlice(batch, slice, stride);
+        }
+    }
+}
+
+void AriesReplayer::finishParse() {
+    for (int i = 0; i < m_runningParsers; i++) {
+        pthread_join(m_parsers[i], NULL);
+    }
+    m_runningParsers = 0;
+}
+
+void AriesReplayer::freeBatch(std::vector<AriesReplayRecord> &batch) {
+    for (size_t i = 0; i < batch.size(); i++) {
+        delete batch[i].record;
+    }
+    batch.clear();
+}
+
+void* AriesReplayer::parseMain(void *task) {
+    ParseTask *parseTask = static_cast<ParseTask*>(task);
+    parseTask->replayer->parseSlice(*parseTask->batch, parseTask->slice, parseTask->stride);
+    return NULL;
+}
+
+void AriesReplayer::parseSlice(std::vector<AriesReplayRecord> &batch, size_t slice, size_t stride) {
+    for (size_t i = slice; i < batch.size(); i += stride) {
+        AriesReplayRecord &replayRecord = batch[i];
+
+        ReferenceSerializeInput input(replayRecord.data, replayRecord.length);
+        replayRecord.record = new LogRecord(input);
+
+        int32_t tableId = replayRecord.record->getTableId();
+        replayRecord.table = dynamic_cast<PersistentTable*>(tableId >= 0 ?
+            m_engine->getTable(tableId) :
+            m_engine->getTable(replayRecord.record->getTableName()));
+
+        // updates and deletes find their before image through the primary
+        // key index, which the engine thread may be changing; inserts only
+        // need the schema
+        if (replayRecord.table != NULL &&
+                replayRecord.type == static_cast<int8_t>(LogRecord::T_INSERT)) {
+            replayRecord.record->populateFields(replayRecord.table->schema(),
+                                                replayRecord.table->primaryKeyIndex());
+        }
+    }
+}
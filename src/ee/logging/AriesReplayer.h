@@ -0,0 +1,110 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARIESREPLAYER_H_
+#define ARIESREPLAYER_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <pthread.h>
+
+// Log records framed and parsed together
+#define ARIES_REPLAY_BATCH_SIZE 1024
+
+// Threads parsing the next batch while the engine applies the current one
+#define ARIES_REPLAY_PARSE_THREADS 2
+
+namespace voltdb {
+class LogRecord;
+class PersistentTable;
+class VoltDBEngine;
+
+/**
+ * A log record on its way through replay. Framing fills in the raw
+ * fields; parsing deserializes the record and resolves its table, and
+ * for inserts the after image as well.
+ */
+struct AriesReplayRecord {
+    const char *data;           // starts with the 4 byte length header
+    int32_t length;             // header included
+    int8_t type;                // LogRecord::Logrec_type_t
+    const char *bulkLoadData;   // raw tuples following a bulk load record
+    int64_t bulkLoadBytes;
+
+    LogRecord *record;
+    PersistentTable *table;     // NULL if the table does not exist
+};
+
+/**
+ * Front half of the ARIES replay pipeline. Frames the log into batches
+ * on the calling thread, dropping records of other sites and of
+ * transactions before the replay point, and parses each batch on
+ * ARIES_REPLAY_PARSE_THREADS threads while the caller applies the
+ * previous one. Parsing only reads the log and table schemas, so it is
+ * safe next to the engine thread; applying stays on the engine thread.
+ */
+class AriesReplayer {
+public:
+    AriesReplayer(VoltDBEngine *engine, const char *logData, size_t length,
+                  int64_t replayTxnId, int32_t siteId);
+    ~AriesReplayer();
+
+    /**
+     * The next batch of parsed records in log order, empty at the end of
+     * the log. Deletes the records of the batch returned before.
+     */
+    std::vector<AriesReplayRecord>& nextBatch();
+
+    int64_t getSkippedCount() const {
+        return m_skipped;
+    }
+
+private:
+    void frameBatch(std::vector<AriesReplayRecord> &batch);
+    void startParse(std::vector<AriesReplayRecord> &batch);
+    void finishParse();
+    void freeBatch(std::vector<AriesReplayRecord> &batch);
+    void parseSlice(std::vector<AriesReplayRecord> &batch, size_t slice, size_t stride);
+    static void* parseMain(void *task);
+
+    struct ParseTask {
+        AriesReplayer *replayer;
+        std::vector<AriesReplayRecord> *batch;
+        size_t slice;
+        size_t stride;
+    };
+
+    VoltDBEngine *m_engine;
+    const char *m_position;
+    const char *m_end;
+    int64_t m_replayTxnId;
+    int32_t m_siteId;
+    int64_t m_skipped;
+
+    // m_batches[m_current] is with the caller, the other one is parsing
+    std::vector<AriesReplayRecord> m_batches[2];
+    int m_current;
+
+    ParseTask m_tasks[ARIES_REPLAY_PARSE_THREADS];
+    pthread_t m_parsers[ARIES_REPLAY_PARSE_THREADS];
+    int m_runningParsers;
+};
+
+}
+
+#endif /* ARIESREPLAYER_H_ */
@@ -96,6 +96,24 @@ public:
 		ariesProxy->logBinaryOutput(data, len);
 	}
 
+	/**
+	 * For Aries logging only: block until everything logged so far is
+	 * durable. Returns the durable LSN, or -1 if this is not the Aries logger.
+	 */
+	inline int64_t sync() const {
+		if (m_id != LOGGERID_MM_ARIES) {
+			return -1;
+		}
+
+		AriesLogProxy* ariesProxy = const_cast<AriesLogProxy*>(dynamic_cast<const AriesLogProxy*>(m_logProxy));
+
+		if (ariesProxy == NULL) {
+			return -1;
+		}
+
+		return ariesProxy->waitForDurableLSN();
+	}
+
 private:
     /**
      * Currently active log level containing a cached value of the log level of some logger elsewhere
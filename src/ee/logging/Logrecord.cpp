@@ -52,9 +52,14 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <arpa/inet.h>
 
 #include "common/NValue.hpp"
 #include "common/ValueFactory.hpp"
+#include "common/SerializableEEException.h"
 #include "Logrecord.h"
 
 #define MAX_TUPLE_PKEY_LEN			1024	// the pkey could be bigger, we assume its not
@@ -68,7 +73,7 @@ using namespace voltdb;
 
 LogRecord::LogRecord(double timestamp, Logrec_type_t type, Logrec_category_t category,
 		double prevLsn, int64_t xid, int32_t execSiteId, const std::string& tableName,
-		TableTuple *primaryKey, int32_t numCols, std::vector<int32_t> *colIndices,
+		int32_t tableId, TableTuple *primaryKey, int32_t numCols, std::vector<int32_t> *colIndices,
 		TableTuple* beforeImage, TableTuple *afterImage)
 		: lsn(timestamp),
 		type(type),
@@ -77,6 +82,7 @@ LogRecord::LogRecord(double timestamp, Logrec_type_t type, Logrec_category_t cat
 		xid(xid),
 		execSiteId(execSiteId),
 		tableName(tableName),
+		tableId(tableId),
 		primaryKey(primaryKey),
 		numColumnsModified(numCols),
 		beforeImage(beforeImage),
@@ -102,48 +108,69 @@ LogRecord::LogRecord(double timestamp, Logrec_type_t type, Logrec_category_t cat
 	// same
 	afterImageData = NULL;
 
-	schema = initSchema();
+	// serializeTo writes the compact format straight from the fields
+	schema = NULL;
+	recordData = NULL;
+	recordTuple = NULL;
 
-	// XXX HACKY
-	// This is not arbitrary, rather its based on all the
-	// fields in the log record header
-	size_t recordDataLen = 80;
+	flags = 0;
+	compactBody = NULL;
+	compactBodyLength = 0;
 
-	recordDataLen += tableName.capacity();
+	isValid = true;
+}
 
-	if (primaryKey != NULL) {
-		recordDataLen += sizeof(int32_t) + primaryKey->maxExportSerializationSize();
-	} else {
-		recordDataLen += sizeof(intptr_t);	// just a null pointer's size
-	}
+LogRecord::LogRecord(ReferenceSerializeInput &input) {
+    type = T_INVALIDTYPE;
+    category = T_BAD_CATEGORY;
 
-	if (columnsModified != NULL) {
-		recordDataLen += (sizeof(int32_t) * numColumnsModified);
-	} else {
-		recordDataLen += sizeof(intptr_t);	// just a null pointer's size
-	}
+    beforeImageData = NULL;
+    beforeImage = NULL;
 
-	if (beforeImage != NULL) {
-		recordDataLen += sizeof(int32_t) + beforeImage->maxExportSerializationSize();
-	} else {
-		recordDataLen += sizeof(intptr_t);	// just a null pointer's size
-	}
+    afterImageData = NULL;
+    afterImage = NULL;
 
-	if (afterImage != NULL) {
-		recordDataLen += sizeof(int32_t) +  afterImage->maxExportSerializationSize();
-	} else {
-		recordDataLen += sizeof(intptr_t);	// just a null pointer's size
-	}
+	primaryKey = NULL;
 
-	recordData = new char[static_cast<int32_t>(recordDataLen)];
-	recordTuple = new TableTuple(recordData, schema);
+	numColumnsModified = -1;
+	columnsModified = NULL;
 
-	initRecordTuple();
+    isValid = false;
 
-	isValid = true;
-}
+    tableId = -1;
+    flags = 0;
+    compactBody = NULL;
+    compactBodyLength = 0;
+
+	const char *header = reinterpret_cast<const char*>(input.getRawPointer(0));
+	if (static_cast<uint8_t>(header[sizeof(int32_t)]) == LOGRECORD_COMPACT_MARKER) {
+		schema = NULL;
+		recordData = NULL;
+		recordTuple = NULL;
+
+		int32_t recordSize = input.readInt();
+		ReferenceSerializeInput recordIn(input.getRawPointer(recordSize), recordSize);
+
+		recordIn.readByte(); // marker
+		type = static_cast<Logrec_type_t>(recordIn.readByte());
+		category = T_FORWARD;
+		flags = static_cast<uint8_t>(recordIn.readByte());
+		lsn = prevLsn = 0;
+		xid = static_cast<int64_t>(readVarint(recordIn));
+		execSiteId = static_cast<int32_t>(readVarint(recordIn));
+
+		if (flags & LOGRECORD_HAS_TABLE_NAME) {
+			size_t nameLength = static_cast<size_t>(readVarint(recordIn));
+			tableName = std::string(reinterpret_cast<const char*>(recordIn.getRawPointer(nameLength)), nameLength);
+		} else {
+			tableId = static_cast<int32_t>(readVarint(recordIn));
+		}
+
+		compactBodyLength = recordIn.numBytesNotYetRead();
+		compactBody = reinterpret_cast<const char*>(recordIn.getRawPointer(compactBodyLength));
+		return;
+	}
 
-LogRecord::LogRecord(ReferenceSerializeInput &input) {
 	schema = initSchema();
 
 	recordData = new char[MAX_RECORD_TUPDATA_LEN];
@@ -157,22 +184,6 @@ LogRecord::LogRecord(ReferenceSerializeInput &input) {
     if (!deserializeSuccess) {
     	recordTuple = NULL;
     }
-
-    type = T_INVALIDTYPE;
-    category = T_BAD_CATEGORY;
-
-    beforeImageData = NULL;
-    beforeImage = NULL;
-
-    afterImageData = NULL;
-    afterImage = NULL;
-
-	primaryKey = NULL;
-
-	numColumnsModified = -1;
-	columnsModified = NULL;
-
-    isValid = false;
 }
 
 LogRecord::~LogRecord() {
@@ -197,123 +208,12 @@ LogRecord::~LogRecord() {
 		columnsModified = NULL;
 	}
 
-	assert(recordData != NULL);
 	delete[] recordData;
 	recordData = NULL;
 
-	TupleSchema::freeTupleSchema(schema);
-}
-
-TableTuple* LogRecord::initRecordTuple() {
-	recordTuple->setNValue(0, ValueFactory::getDoubleValue(lsn));
-	recordTuple->setNValue(1, ValueFactory::getTinyIntValue(static_cast<int8_t>(type)));
-	recordTuple->setNValue(2, ValueFactory::getTinyIntValue(static_cast<int8_t>(category)));
-	recordTuple->setNValue(3, ValueFactory::getDoubleValue(prevLsn));
-	recordTuple->setNValue(4, ValueFactory::getBigIntValue(xid));
-	recordTuple->setNValue(5, ValueFactory::getIntegerValue(execSiteId));
-	recordTuple->setNValue(6, ValueFactory::getStringValue(tableName));
-
-	if (primaryKey != NULL) {
-		size_t len = sizeof(int32_t) + primaryKey->maxExportSerializationSize();
-		char *pkeyRawData = new char[len];
-
-		FallbackSerializeOutput output;
-		output.initializeWithPosition(pkeyRawData, len, 0);
-
-		primaryKey->serializeTo(output);
-		recordTuple->setNValue(7,
-				ValueFactory::getBinaryValue(
-				reinterpret_cast<unsigned char*>(const_cast<char*>(output.data())),
-				static_cast<int32_t>(output.position())
-				)
-		);
-
-		// Safe to delete, ValueFactory copies out the data.
-		delete[] pkeyRawData;
-		pkeyRawData = NULL;
-	} else {
-		recordTuple->setNValue(7, ValueFactory::getNullBinaryValue());
-	}
-
-	recordTuple->setNValue(8, ValueFactory::getIntegerValue(numColumnsModified));
-
-	if (numColumnsModified > 0) {
-		char *colData = new char[numColumnsModified * sizeof(int32_t)];
-
-		FallbackSerializeOutput output;
-		output.initializeWithPosition(colData, numColumnsModified * sizeof(int32_t), 0);
-
-		for (int i = 0; i < numColumnsModified; i++) {
-			output.writeInt(columnsModified[i]);
-		}
-
-		recordTuple->setNValue(9,
-				ValueFactory::getBinaryValue(
-				reinterpret_cast<unsigned char*>(const_cast<char*>(output.data())),
-				static_cast<int32_t>(output.position())
-				)
-		);
-
-		delete[] colData;
-		colData = NULL;
-	} else {
-		recordTuple->setNValue(9, ValueFactory::getNullBinaryValue());
+	if (schema != NULL) {
+		TupleSchema::freeTupleSchema(schema);
 	}
-
-	// only present for T_UPDATE and T_DELETE, that too in the absence of a primary index
-	if (beforeImage != NULL) {
-		size_t len = sizeof(int32_t) + beforeImage->maxExportSerializationSize();
-		char *beforeRawData = new char[len];
-
-		FallbackSerializeOutput output;
-		output.initializeWithPosition(beforeRawData, len, 0);
-
-		beforeImage->serializeTo(output);
-		recordTuple->setNValue(10,
-				ValueFactory::getBinaryValue(
-				reinterpret_cast<unsigned char*>(const_cast<char*>(output.data())),
-				static_cast<int32_t>(output.position())
-				)
-		);
-
-		// Safe to delete beforeData because
-		// ValueFactory copies out the data.
-		delete[] beforeRawData;
-		beforeRawData = NULL;
-
-	} else {
-		recordTuple->setNValue(10, ValueFactory::getNullBinaryValue());
-	}
-
-	// only present for T_INSERT, T_UPDATE (not for T_BULKLOAD, T_DELETE, T_TRUNCATE)
-	if (afterImage != NULL) {
-		// This is correct, tupleLength() is not required.
-		// On serialization, the first 4 bytes indicate the length
-		// and then comes the tuple.
-		size_t len = sizeof(int32_t) + afterImage->maxExportSerializationSize();
-		char *afterRawData = new char[len];
-
-		FallbackSerializeOutput output;
-		output.initializeWithPosition(afterRawData, len, 0);
-
-		afterImage->serializeTo(output);
-		recordTuple->setNValue(11,
-				ValueFactory::getBinaryValue(
-				reinterpret_cast<unsigned char*>(const_cast<char*>(output.data())),
-				static_cast<int32_t>(output.position())
-				)
-		);
-
-		delete[] afterRawData;
-		afterRawData = NULL;
-	} else {
-		recordTuple->setNValue(11, ValueFactory::getNullBinaryValue());
-	}
-
-	//debug
-	VOLT_DEBUG("Logrecord : %s", recordTuple->debugNoHeader().c_str());
-
-	return recordTuple;
 }
 
 void LogRecord::populateFields(const TupleSchema *imageSchema, TableIndex *pkeyIndex) {
@@ -321,6 +221,11 @@ void LogRecord::populateFields(const TupleSchema *imageSchema, TableIndex *pkeyI
 		return; // nothing to be done
 	}
 
+	if (compactBody != NULL) {
+		populateCompactFields(imageSchema, pkeyIndex);
+		return;
+	}
+
 	if (recordTuple == NULL) {
 		return; // failed deserialization of logrecord
 	}
@@ -446,8 +351,7 @@ std::string& LogRecord::getTableName() {
 	}
 
 	if (recordTuple == NULL) {
-		tableName = "";
-		return tableName; // nothing is instantiated
+		return tableName; // compact record, or nothing is instantiated
 	}
 
 	tableName = std::string(reinterpret_cast<char *>(ValuePeeker::peekObjectValue(recordTuple->getNValue(6))),
@@ -456,13 +360,244 @@ std::string& LogRecord::getTableName() {
 }
 
 void LogRecord::serializeTo(SerializeOutput &output) {
-	recordTuple->serializeTo(output);
+	size_t lengthPosition = output.reserveBytes(sizeof(int32_t));
+	size_t start = output.position();
+
+	if (primaryKey != NULL) {
+		flags = LOGRECORD_HAS_PRIMARY_KEY;
+	} else if (beforeImage != NULL) {
+		flags = LOGRECORD_HAS_BEFORE_IMAGE;
+	} else {
+		flags = 0;
+	}
+	if (tableId < 0) {
+		flags |= LOGRECORD_HAS_TABLE_NAME;
+	}
+
+	output.writeByte(static_cast<int8_t>(LOGRECORD_COMPACT_MARKER));
+	output.writeByte(static_cast<int8_t>(type));
+	output.writeByte(static_cast<int8_t>(flags));
+	writeVarint(output, static_cast<uint64_t>(xid));
+	writeVarint(output, static_cast<uint64_t>(execSiteId));
+	if (flags & LOGRECORD_HAS_TABLE_NAME) {
+		writeVarint(output, tableName.size());
+		output.writeBytes(tableName.data(), tableName.size());
+	} else {
+		writeVarint(output, static_cast<uint64_t>(tableId));
+	}
+
+	if (type == T_UPDATE || type == T_DELETE) {
+		TableTuple *locator = (primaryKey != NULL) ? primaryKey : beforeImage;
+		if (locator != NULL) {
+			for (int i = 0; i < locator->sizeInValues(); i++) {
+				locator->getNValue(i).serializeTo(output);
+			}
+		}
+	}
+
+	if (type == T_INSERT && afterImage != NULL) {
+		for (int i = 0; i < afterImage->sizeInValues(); i++) {
+			afterImage->getNValue(i).serializeTo(output);
+		}
+	} else if (type == T_UPDATE && afterImage != NULL) {
+		// (table column, after image column) of every changed column. The
+		// update executor's after image holds a tuple address in column 0
+		// and the new values from column 1 on, in columnsModified order;
+		// without that list it is the whole new tuple.
+		std::vector<std::pair<int, int> > changed;
+		if (columnsModified != NULL) {
+			for (int i = 0; i < numColumnsModified; i++) {
+				if (columnsModified[i] >= 0) {
+					changed.push_back(std::make_pair(columnsModified[i], i + 1));
+				}
+			}
+		} else {
+			for (int i = 0; i < afterImage->sizeInValues(); i++) {
+				changed.push_back(std::make_pair(i, i));
+			}
+		}
+		std::sort(changed.begin(), changed.end());
+
+		int columnCount = changed.empty() ? 0 : changed.back().first + 1;
+		writeVarint(output, static_cast<uint64_t>(columnCount));
+
+		std::vector<uint8_t> bitmap((columnCount + 7) / 8, 0);
+		for (size_t i = 0; i < changed.size(); i++) {
+			bitmap[changed[i].first / 8] = static_cast<uint8_t>(bitmap[changed[i].first / 8] | (1 << (changed[i].first % 8)));
+		}
+		if (!bitmap.empty()) {
+			output.writeBytes(&bitmap[0], bitmap.size());
+		}
+
+		for (size_t i = 0; i < changed.size(); i++) {
+			if (i > 0 && changed[i].first == changed[i - 1].first) {
+				continue;
+			}
+			afterImage->getNValue(changed[i].second).serializeTo(output);
+		}
+	}
+
+	output.writeIntAt(lengthPosition, static_cast<int32_t>(output.position() - start));
 }
 
 size_t LogRecord::getEstimatedLength() {
-	// max export size does not include the header size which records
-	// length of tuple.
-	return (sizeof(int32_t) + recordTuple->maxExportSerializationSize());
+	// length header, marker, type, flags and three varints
+	size_t length = sizeof(int32_t) + 3 + 10 + 5 + 5;
+
+	if (tableId < 0) {
+		length += 5 + tableName.size();
+	}
+	if (primaryKey != NULL) {
+		length += primaryKey->maxExportSerializationSize();
+	} else if (beforeImage != NULL) {
+		length += beforeImage->maxExportSerializationSize();
+	}
+	if (afterImage != NULL) {
+		// varint column count and bitmap for updates
+		int columnCount = afterImage->sizeInValues();
+		for (int i = 0; columnsModified != NULL && i < numColumnsModified; i++) {
+			columnCount = std::max(columnCount, columnsModified[i] + 1);
+		}
+		length += 5 + (columnCount + 7) / 8 + afterImage->maxExportSerializationSize();
+	}
+	return length;
+}
+
+bool LogRecord::peekHeader(const char *data, size_t available,
+		int8_t &type, int64_t &txnId, int32_t &siteId) {
+	const size_t headerSize = sizeof(int32_t);
+
+	if (available > headerSize && static_cast<uint8_t>(data[headerSize]) == LOGRECORD_COMPACT_MARKER) {
+		if (available < headerSize + 3) {
+			return false;
+		}
+		type = static_cast<int8_t>(data[headerSize + 1]);
+
+		uint64_t values[2] = { 0, 0 };
+		size_t pos = headerSize + 3;
+		for (int v = 0; v < 2; v++) {
+			int shift = 0;
+			while (true) {
+				if (pos >= available || shift > 63) {
+					return false;
+				}
+				uint8_t byte = static_cast<uint8_t>(data[pos++]);
+				values[v] |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) {
+					break;
+				}
+				shift += 7;
+			}
+		}
+		txnId = static_cast<int64_t>(values[0]);
+		siteId = static_cast<int32_t>(values[1]);
+		return true;
+	}
+
+	if (available < headerSize + OFFSET_TO_SITEID + sizeof(int32_t)) {
+		return false;
+	}
+	memcpy(&type, data + headerSize + OFFSET_TO_TXNTYPE, sizeof(type));
+	memcpy(&txnId, data + headerSize + OFFSET_TO_TXNID, sizeof(txnId));
+	txnId = ntohll(txnId);
+	memcpy(&siteId, data + headerSize + OFFSET_TO_SITEID, sizeof(siteId));
+	siteId = ntohl(siteId);
+	return true;
+}
+
+void LogRecord::populateCompactFields(const TupleSchema *imageSchema, TableIndex *pkeyIndex) {
+	ReferenceSerializeInput input(compactBody, compactBodyLength);
+	size_t imageLength = imageSchema->tupleLength() + TUPLE_HEADER_SIZE;
+
+	if (type == T_UPDATE || type == T_DELETE) {
+		if ((flags & LOGRECORD_HAS_PRIMARY_KEY) && pkeyIndex != NULL) {
+			const TupleSchema *keySchema = pkeyIndex->getKeySchema();
+			char *pkeyData = new char[keySchema->tupleLength() + TUPLE_HEADER_SIZE]();
+			TableTuple key(pkeyData, keySchema);
+			for (int i = 0; i < keySchema->columnCount(); i++) {
+				readColumn(input, key, i);
+			}
+
+			pkeyIndex->moveToKey(&key);
+			TableTuple found = pkeyIndex->nextValueAtKey();
+			delete[] pkeyData;
+
+			// the record was logged against a row replay should have restored
+			if (found.isNullTuple()) {
+				char message[256];
+				snprintf(message, 256, "LogRecord names a primary key that is not"
+						" in index %s", pkeyIndex->getName().c_str());
+				throw SerializableEEException(VOLT_EE_EXCEPTION_TYPE_EEEXCEPTION, message);
+			}
+			beforeImage = new TableTuple(found);
+		} else if (flags & LOGRECORD_HAS_BEFORE_IMAGE) {
+			beforeImageData = new char[imageLength]();
+			beforeImage = new TableTuple(beforeImageData, imageSchema);
+			for (int i = 0; i < imageSchema->columnCount(); i++) {
+				readColumn(input, *beforeImage, i);
+			}
+		} else {
+			return; // cannot locate the tuple
+		}
+	}
+
+	if (type == T_INSERT) {
+		afterImageData = new char[imageLength]();
+		afterImage = new TableTuple(afterImageData, imageSchema);
+		for (int i = 0; i < imageSchema->columnCount(); i++) {
+			readColumn(input, *afterImage, i);
+		}
+	} else if (type == T_UPDATE) {
+		afterImageData = new char[imageLength]();
+		afterImage = new TableTuple(afterImageData, imageSchema);
+		afterImage->copy(*beforeImage);
+
+		int columnCount = static_cast<int>(readVarint(input));
+		const uint8_t *bitmap = reinterpret_cast<const uint8_t*>(input.getRawPointer((columnCount + 7) / 8));
+		for (int i = 0; i < columnCount && i < imageSchema->columnCount(); i++) {
+			if (bitmap[i / 8] & (1 << (i % 8))) {
+				readColumn(input, *afterImage, i);
+			}
+		}
+	}
+
+	isValid = true;
+}
+
+void LogRecord::writeVarint(SerializeOutput &output, uint64_t value) {
+	while (value >= 0x80) {
+		output.writeByte(static_cast<int8_t>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	output.writeByte(static_cast<int8_t>(value));
+}
+
+uint64_t LogRecord::readVarint(SerializeInput &input) {
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t byte = static_cast<uint8_t>(input.readByte());
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			break;
+		}
+	}
+	return value;
+}
+
+/**
+ * Read one value written by NValue::serializeTo into column of tuple.
+ * Uninlined strings are allocated on the heap, like the images of the
+ * original format.
+ */
+void LogRecord::readColumn(SerializeInput &input, TableTuple &tuple, int column) {
+	const TupleSchema *tupleSchema = tuple.getSchema();
+	const ValueType columnType = tupleSchema->columnType(column);
+	const bool isInlined = tupleSchema->columnIsInlined(column);
+
+	char storage[UNINLINEABLE_OBJECT_LENGTH + 16];
+	NValue::deserializeFrom(input, columnType, storage, isInlined,
+			tupleSchema->columnLength(column), NULL);
+	tuple.setNValue(column, NValue::deserializeFromTupleStorage(storage, columnType, isInlined));
 }
 
 TupleSchema* LogRecord::initSchema() {
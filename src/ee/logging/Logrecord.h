@@ -57,10 +57,25 @@
 
 #include "indexes/tableindex.h"
 
+// Header offsets of the original record format, a serialized TableTuple
 #define OFFSET_TO_TXNTYPE		8
 #define OFFSET_TO_TXNID			8 + 1 + 1 + 8
 #define OFFSET_TO_SITEID		8 + 1 + 1 + 8 + 8
 
+// Compact records start with this byte after the length header. In the
+// original format that byte is the top of the LSN timestamp, a positive
+// double, so it is never 0xFF.
+#define LOGRECORD_COMPACT_MARKER	0xFF
+
+// Compact record flags
+#define LOGRECORD_HAS_PRIMARY_KEY	0x01	// update/delete located by packed primary key
+#define LOGRECORD_HAS_BEFORE_IMAGE	0x02	// update/delete located by full before image
+#define LOGRECORD_HAS_TABLE_NAME	0x04	// table given by name rather than catalog id
+
+// Bytes after the length header that hold the type, txn id and site id
+// of either format (see LogRecord::peekHeader)
+#define LOGRECORD_PEEK_LENGTH		40
+
 namespace voltdb {
 
 class LogRecord {
@@ -82,16 +97,38 @@ public:
 
 	LogRecord(double timestamp, Logrec_type_t type, Logrec_category_t category,
 			double prevLsn, int64_t xid, int32_t execSiteId, const std::string& tableName,
-			TableTuple *primaryKey, int32_t numCols, std::vector<int32_t> *colIndices,
+			int32_t tableId, TableTuple *primaryKey, int32_t numCols, std::vector<int32_t> *colIndices,
 			TableTuple* beforeImage, TableTuple *afterImage);
 
-	LogRecord(ReferenceSerializeInput &input); 		// parsing back written out records
+	LogRecord(ReferenceSerializeInput &input); 		// parsing back written out records, either format
 
 	~LogRecord();
 
+	/**
+	 * Writes the compact format: length header, marker, type, flags, varint
+	 * txn id, site id and table id, then by type
+	 *   INSERT   all column values
+	 *   UPDATE   packed primary key (or full before image), varint column
+	 *            count, changed-column bitmap, new values of those columns
+	 *   DELETE   packed primary key (or full before image)
+	 * Values use NValue::serializeTo. The LSN timestamps are not written.
+	 */
 	void serializeTo(SerializeOutput &output);
 	size_t getEstimatedLength();
 
+	/**
+	 * Type, txn id and site id of the record at data, which starts with the
+	 * length header, reading at most available bytes. Returns false if they
+	 * do not hold a whole header.
+	 */
+	static bool peekHeader(const char *data, size_t available,
+			int8_t &type, int64_t &txnId, int32_t &siteId);
+
+	// catalog id of the table, -1 if the record names it instead
+	inline int32_t getTableId() {
+		return tableId;
+	}
+
 	TupleSchema* getRecordSchema();
 
 	inline bool isValidRecord() {
@@ -156,7 +193,11 @@ public:
 private:
 	LogRecord();	// do not allow empty constructor
 	TupleSchema* initSchema();
-	TableTuple* initRecordTuple();
+	void populateCompactFields(const TupleSchema *imageSchema, TableIndex *pkeyIndex);
+
+	static void writeVarint(SerializeOutput &output, uint64_t value);
+	static uint64_t readVarint(SerializeInput &input);
+	static void readColumn(SerializeInput &input, TableTuple &tuple, int column);
 
 	bool isValid;
 
@@ -171,6 +212,7 @@ private:
 	int32_t execSiteId;			// id of the execution site
 
 	std::string tableName;		// what table are we updating?
+	int32_t tableId;			// its catalog id, -1 if unknown
 
 	TableTuple *primaryKey;			// what's the primary key
 
@@ -185,10 +227,17 @@ private:
 	char *afterImageData;
 	TableTuple *afterImage;
 
+	// original format only
 	TupleSchema *schema; // log record's schema
 	char *recordData;		// data for the tuple representing the record
 
 	TableTuple *recordTuple;	 // the actual tuple representing the record
+
+	// compact format only: flags and the type-specific part of the record,
+	// which points into the log being replayed
+	uint8_t flags;
+	const char *compactBody;
+	size_t compactBodyLength;
 };
 
 }
@@ -19,10 +19,11 @@
 #include "storage/tablefactory.h"
 #include "storage/CopyOnWriteIterator.h"
 #include "storage/tableiterator.h"
+#include "storage/TupleBlockFormat.h"
 #include "common/FatalException.hpp"
+#include "common/Checksum.h"
 #include <algorithm>
 #include <cassert>
-#include <boost/crc.hpp>
 #include "common/tabletuple.h"
 
 /**
@@ -62,7 +63,8 @@ CopyOnWriteContext::CopyOnWriteContext(Table *table, TupleSerializer *serializer
              m_iterator(new CopyOnWriteIterator(table)),
              m_maxTupleLength(serializer->getMaxSerializedTupleSize(table->schema())),
              m_tuple(table->schema()), m_finishedTableScan(false), m_partitionId(partitionId),
-             m_tuplesSerialized(0) {
+             m_tuplesSerialized(0),
+             m_blockCopy(serializer->blockCopyEnabled() && TupleBlockFormat::supports(table->schema())) {
     for (int ii = 0; ii < table->m_data.size(); ii++) {
 #ifdef MEMCHECK
         BlockPair p;
@@ -89,11 +91,15 @@ CopyOnWriteContext::CopyOnWriteContext(Table *table, TupleSerializer *serializer
 }
 
 bool CopyOnWriteContext::serializeMore(ReferenceSerializeOutput *out) {
-    boost::crc_32_type crc;
-    boost::crc_32_type partitionIdCRC;
+    /*
+     * The tuple data is checksummed with CRC32C (hardware accelerated where
+     * available); the snapshot file header records the checksum type. The
+     * partition id keeps plain CRC32 so the chunk header can be validated
+     * the same way for every file version.
+     */
+    ChecksumAccumulator crc(CHECKSUM_TYPE_CRC32C);
     out->writeInt(m_partitionId);
-    partitionIdCRC.process_bytes(out->data() + out->position() - 4, 4);
-    out->writeInt(partitionIdCRC.checksum());
+    out->writeInt(Checksum::crc32(0, out->data() + out->position() - 4, 4));
     const std::size_t crcPosition = out->reserveBytes(4);//For CRC
     int rowsSerialized = 0;
 
@@ -107,6 +113,14 @@ bool CopyOnWriteContext::serializeMore(ReferenceSerializeOutput *out) {
 //        return false;
     }
 
+    if (m_blockCopy) {
+        const bool hasMore = serializeTupleBlocks(out, rowsSerialized);
+        out->writeInt(rowsSerialized);
+        crc.process_block(out->data() + crcPosition + 4, out->data() + out->position());
+        out->writeIntAt(crcPosition, crc.checksum());
+        return hasMore;
+    }
+
     //while (out->remaining() >= (m_maxTupleLength + sizeof(int32_t))) {
     while (out->remaining() >= (m_maxTupleLength + TUPLE_HEADER_SIZE)) {
         const bool hadMore = m_iterator->next(tuple);
@@ -146,6 +160,81 @@ bool CopyOnWriteContext::serializeMore(ReferenceSerializeOutput *out) {
     return true;
 }
 
+bool CopyOnWriteContext::serializeTupleBlocks(ReferenceSerializeOutput *out, int &rowsSerialized) {
+    const int tupleLength = static_cast<int>(m_table->m_tupleLength);
+    TupleBlockFormat::writeHeader(m_table->schema(), tupleLength, *out);
+    const std::size_t runCountPosition = out->reserveBytes(4);
+    int32_t runs = 0;
+
+    /*
+     * Readers that can't take the blocks as is re-encode them as rows in a
+     * buffer the size of a regular chunk, so never copy more slots than
+     * there would be room for as serialized tuples. The 4 bytes held back
+     * are for the trailing row count.
+     */
+    int64_t rowBudget = static_cast<int64_t>(out->remaining() - 4) / m_maxTupleLength;
+    bool hasMore = true;
+    while (hasMore) {
+        // run slot count plus trailing row count
+        const int64_t available = static_cast<int64_t>(out->remaining()) - 8;
+        int32_t maxSlots = static_cast<int32_t>(std::min(rowBudget,
+                (available * 8 - 7) / (8 * static_cast<int64_t>(tupleLength) + 1)));
+        if (maxSlots <= 0) {
+            break;
+        }
+        m_runBitmap.assign(TupleBlockFormat::bitmapLength(maxSlots), 0);
+
+        int32_t slots = 0;
+        char *first = NULL;
+        if (!m_finishedTableScan) {
+            slots = static_cast<CopyOnWriteIterator*>(m_iterator.get())->nextRun(maxSlots, first, &m_runBitmap[0]);
+            if (slots == 0) {
+                m_finishedTableScan = true;
+                m_iterator.reset(new TableIterator(m_backedUpTuples.get()));
+                continue;
+            }
+            out->writeInt(slots);
+            out->writeBytes(&m_runBitmap[0], TupleBlockFormat::bitmapLength(slots));
+            out->writeBytes(first, static_cast<std::size_t>(slots) * tupleLength);
+        } else {
+            /*
+             * Backed up tuples are scattered across the temp table blocks,
+             * gather them into a fully live run.
+             */
+            TableTuple tuple(m_table->schema());
+            m_runTuples.clear();
+            while (slots < maxSlots && m_iterator->next(tuple)) {
+                m_runTuples.push_back(tuple.address());
+                m_runBitmap[slots >> 3] = static_cast<uint8_t>(m_runBitmap[slots >> 3] | (1 << (slots & 7)));
+                slots++;
+            }
+            if (slots == 0) {
+                hasMore = false;
+                break;
+            }
+            hasMore = slots == maxSlots;
+            out->writeInt(slots);
+            out->writeBytes(&m_runBitmap[0], TupleBlockFormat::bitmapLength(slots));
+            for (int32_t ii = 0; ii < slots; ii++) {
+                out->writeBytes(m_runTuples[ii], tupleLength);
+            }
+        }
+
+        int32_t live = 0;
+        for (int32_t ii = 0; ii < slots; ii++) {
+            if (m_runBitmap[ii >> 3] & (1 << (ii & 7))) {
+                live++;
+            }
+        }
+        rowsSerialized += live;
+        m_tuplesSerialized += live;
+        rowBudget -= slots;
+        runs++;
+    }
+    out->writeIntAt(runCountPosition, runs);
+    return hasMore;
+}
+
 void CopyOnWriteContext::markTupleDirty(TableTuple tuple, bool newTuple) {
     /**
      * If this an update or a delete of a tuple that is already dirty then no further action is
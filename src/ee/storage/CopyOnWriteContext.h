@@ -68,6 +68,12 @@ public:
     virtual ~CopyOnWriteContext();
 
 private:
+    /**
+     * Block copy body for serializeMore. Copies runs of raw tuple storage until
+     * the output is full. Returns true if there are more tuples to serialize.
+     */
+    bool serializeTupleBlocks(ReferenceSerializeOutput *out, int &rowsSerialized);
+
     /**
      * Table being copied
      */
@@ -112,6 +118,21 @@ private:
     const int32_t m_partitionId;
 
     int32_t m_tuplesSerialized;
+
+    /**
+     * Serialize raw tuple blocks (see TupleBlockFormat) instead of rows
+     */
+    const bool m_blockCopy;
+
+    /**
+     * Live tuple bitmap of the run being copied
+     */
+    std::vector<uint8_t> m_runBitmap;
+
+    /**
+     * Backed up tuples gathered into the run being copied
+     */
+    std::vector<char*> m_runTuples;
 };
 
 }
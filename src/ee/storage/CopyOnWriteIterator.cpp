@@ -59,6 +59,39 @@ bool CopyOnWriteIterator::next(TableTuple &out) {
     return false;
 }
 
+int32_t CopyOnWriteIterator::nextRun(int32_t maxSlots, char *&first, uint8_t *liveBitmap) {
+    int32_t slots = 0;
+    TableTuple tuple(m_table->schema());
+    while (m_foundTuples < m_activeTupleCount && slots < maxSlots) {
+        char *location = m_location + m_tupleLength;
+        const long int delta = location - m_blocks[m_blockIndex];
+        if (m_didFirstIteration && delta >= m_blockLength) {
+            // a run is contiguous storage, so it ends with the block
+            if (slots > 0) {
+                break;
+            }
+            location = m_blocks[++m_blockIndex];
+        }
+        m_didFirstIteration = true;
+        m_location = location;
+        assert(m_location < m_blocks[m_blockIndex] + m_blockLength);
+        if (slots == 0) {
+            first = m_location;
+        }
+        tuple.move(m_location);
+        if (tuple.isActive() && !tuple.isDirty()) {
+            ++m_foundTuples;
+            liveBitmap[slots >> 3] = static_cast<uint8_t>(liveBitmap[slots >> 3] | (1 << (slots & 7)));
+        }
+        tuple.setDirtyFalse();
+        slots++;
+    }
+    if (slots == 0) {
+        cleanBlocksAfterLastFound();
+    }
+    return slots;
+}
+
 void CopyOnWriteIterator::cleanBlocksAfterLastFound() {
     m_location = m_location + m_tupleLength;
     while (true) {
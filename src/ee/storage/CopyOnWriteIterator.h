@@ -59,6 +59,15 @@ public:
 
     bool next(TableTuple &out);
 
+    /**
+     * Block copy counterpart of next(). Scans up to maxSlots consecutive tuple slots
+     * of the current block, applying the same active/dirty rules as next(), and
+     * returns the number of slots covered (0 once the scan is complete). first is set
+     * to the storage of the first slot and bit i of liveBitmap (which the caller
+     * zeroes) is set for each slot next() would have returned.
+     */
+    int32_t nextRun(int32_t maxSlots, char *&first, uint8_t *liveBitmap);
+
     virtual ~CopyOnWriteIterator() {}
 private:
     /**
@@ -17,41 +17,100 @@
 
 #include <storage/PersistentTableUndoUpdateAction.h>
 #include <cassert>
+#include <cstring>
 
 namespace voltdb {
 
+void PersistentTableUndoUpdateAction::recordChanges(const TableTuple &oldTuple, Pool *pool) {
+    const TupleSchema *schema = m_tuple.getSchema();
+    const int columnCount = schema->columnCount();
+    const size_t bitmapSize = ((columnCount + 63) / 64) * sizeof(uint64_t);
+    m_changedColumns = reinterpret_cast<uint64_t*>(pool->allocate(bitmapSize));
+    ::memset(m_changedColumns, 0, bitmapSize);
+
+    for (int ii = 0; ii < columnCount; ii++) {
+        const uint32_t size = columnStorageSize(schema, ii);
+        if (::memcmp(oldTuple.getDataPtr(ii), m_tuple.getDataPtr(ii), size) != 0) {
+            m_changedColumns[ii >> 6] |= static_cast<uint64_t>(1) << (ii & 63);
+            m_oldValuesSize += size;
+            if (!schema->columnIsInlined(ii)) {
+                m_changedObjectCount++;
+            }
+        }
+    }
+
+    const size_t valuesSize = m_oldValuesSize + m_changedObjectCount * sizeof(char*);
+    if (valuesSize > 0) {
+        m_values = reinterpret_cast<char*>(pool->allocate(valuesSize));
+        char *oldValue = m_values;
+        const char **newObject = reinterpret_cast<const char**>(m_values + m_oldValuesSize);
+        for (int ii = 0; ii < columnCount; ii++) {
+            if (!isChanged(ii)) {
+                continue;
+            }
+            const uint32_t size = columnStorageSize(schema, ii);
+            ::memcpy(oldValue, oldTuple.getDataPtr(ii), size);
+            oldValue += size;
+            if (!schema->columnIsInlined(ii)) {
+                *newObject++ = *reinterpret_cast<char* const*>(m_tuple.getDataPtr(ii));
+            }
+        }
+    }
+
+#ifdef MEMCHECK_NOFREELIST
+    void *tupleData = pool->allocate(m_tuple.tupleLength());
+    ::memcpy(tupleData, m_tuple.address(), m_tuple.tupleLength());
+    m_newTuple = TableTuple(reinterpret_cast<char*>(tupleData), schema);
+#endif
+}
+
+void PersistentTableUndoUpdateAction::revertColumns(TableTuple &target) const {
+    if (m_oldValuesSize == 0) {
+        return;
+    }
+    const TupleSchema *schema = target.getSchema();
+    const int columnCount = schema->columnCount();
+    const char *oldValue = m_values;
+    for (int ii = 0; ii < columnCount; ii++) {
+        if (isChanged(ii)) {
+            const uint32_t size = columnStorageSize(schema, ii);
+            ::memcpy(target.getDataPtr(ii), oldValue, size);
+            oldValue += size;
+        }
+    }
+}
+
 /*
  * Undo whatever this undo action was created to undo. In this case
- * the string allocations of the new tuple must be freed and the tuple
- * must be overwritten with the old one.
+ * the string allocations of the new tuple must be freed and the
+ * changed columns must be reverted to their old values.
  */
 void PersistentTableUndoUpdateAction::undo() {
-    //Get the address of the tuple in the table and then update it
-    //with the old tuple.  If the indexes haven't been updates then it
-    //has to be looked up
-    TableTuple tupleInTable;
-    if (m_revertIndexes) {
+    // The tuple is reverted where it was updated. Undo runs in reverse
+    // order and the free list is LIFO, so a delete of this tuple later in
+    // the same quantum has already been undone into the same slot.
+    TableTuple tupleInTable = m_tuple;
+#ifdef MEMCHECK_NOFREELIST
+    if (m_revertIndexes || m_table->primaryKeyIndex() == NULL) {
         tupleInTable = m_table->lookupTuple(m_newTuple);
     } else {
-        //TableScan will find the already updated tuple since the copy
-        //is done immediately
-        if (m_table->primaryKeyIndex() == NULL) {
-            tupleInTable = m_table->lookupTuple(m_newTuple);
-        } else {
-            //IndexScan will find it under the old tuple entry since the
-            //index was never updated
-            tupleInTable = m_table->lookupTuple(m_oldTuple);
-        }
+        //IndexScan will find it under the old tuple entry since the
+        //index was never updated
+        TableTuple oldTuple = m_table->tempTuple();
+        oldTuple.copy(m_newTuple);
+        revertColumns(oldTuple);
+        tupleInTable = m_table->lookupTuple(oldTuple);
     }
-    m_table->updateTupleForUndo(m_oldTuple, tupleInTable, m_revertIndexes, m_wrapperOffset);
+#endif
+    assert(tupleInTable.isActive());
+    m_table->updateTupleForUndo(*this, tupleInTable, m_revertIndexes, m_wrapperOffset);
 
     /*
      * Free the strings from the new tuple that updated in the old tuple.
      */
-    for (std::vector<const char*>::iterator i = newUninlineableColumns.begin();
-         i != newUninlineableColumns.end(); i++)
-    {
-        delete (*i);
+    char * const *newObjects = reinterpret_cast<char* const*>(m_values + m_oldValuesSize);
+    for (uint16_t ii = 0; ii < m_changedObjectCount; ii++) {
+        delete [] newObjects[ii];
     }
 }
 
@@ -61,13 +120,23 @@ void PersistentTableUndoUpdateAction::undo() {
  * old tuple must be released.
  */
 void PersistentTableUndoUpdateAction::release() {
+    if (m_changedObjectCount == 0) {
+        return;
+    }
+
     /*
      * Free the strings from the old tuple that were updated.
      */
-    for (std::vector<const char*>::iterator i = oldUninlineableColumns.begin();
-         i != oldUninlineableColumns.end(); i++)
-    {
-        delete [] (*i);
+    const TupleSchema *schema = m_tuple.getSchema();
+    const int columnCount = schema->columnCount();
+    const char *oldValue = m_values;
+    for (int ii = 0; ii < columnCount; ii++) {
+        if (isChanged(ii)) {
+            if (!schema->columnIsInlined(ii)) {
+                delete [] *reinterpret_cast<char* const*>(oldValue);
+            }
+            oldValue += columnStorageSize(schema, ii);
+        }
     }
 }
 
@@ -27,70 +27,51 @@
 
 namespace voltdb {
 
+/*
+ * Undo record for an in-place tuple update. Instead of keeping copies of
+ * the whole tuple before and after the update, only the columns that were
+ * changed are recorded: a bitmap of their indexes and their old inlined
+ * bytes. For uninlined objects those bytes are the pointer to the old
+ * object, which this action owns until it is released. The pointers to
+ * the objects that replaced them are kept too so undo can free them.
+ */
 class PersistentTableUndoUpdateAction: public voltdb::UndoAction {
 public:
 
+    /*
+     * target is the tuple in the table storage that is about to be
+     * updated. The changes are recorded with recordChanges() once the
+     * update has been applied.
+     */
     inline PersistentTableUndoUpdateAction(
-            voltdb::TableTuple &oldTuple,
-            voltdb::PersistentTable *table,
-            voltdb::Pool *pool)
-        : m_oldTuple(oldTuple), m_table(table), m_revertIndexes(false), m_wrapperOffset(0)
+            voltdb::TableTuple &target,
+            voltdb::PersistentTable *table)
+        : m_tuple(target), m_table(table), m_changedColumns(NULL), m_values(NULL),
+          m_changedObjectCount(0), m_oldValuesSize(0),
+          m_revertIndexes(false), m_wrapperOffset(0)
     {
-        /*
-         * Copy the old tuple and the new tuple. The new tuple will be
-         * necessary for undo since we need to look it up in the table
-         * to update it.
-         */
-        void *tupleData = pool->allocate(m_oldTuple.tupleLength());
-        m_oldTuple.move(tupleData);
-        ::memcpy(tupleData, oldTuple.address(), m_oldTuple.tupleLength());
     }
 
-    inline TableTuple& getOldTuple() {
-        return m_oldTuple;
-    }
+    /*
+     * Compare the updated tuple with the copy of its previous version
+     * and record the columns that differ, allocating from the undo
+     * quantum's pool.
+     */
+    void recordChanges(const voltdb::TableTuple &oldTuple, voltdb::Pool *pool);
+
+    /*
+     * Overwrite the recorded columns of target with their old values.
+     */
+    void revertColumns(voltdb::TableTuple &target) const;
 
     inline void setELMark(size_t mark) {
         m_wrapperOffset = mark;
     }
 
-    inline void setNewTuple(TableTuple &newTuple, voltdb::Pool *pool) {
-        m_newTuple = newTuple;
-        void *tupleData = pool->allocate(m_newTuple.tupleLength());
-        m_newTuple.move(tupleData);
-        ::memcpy(tupleData, newTuple.address(), m_newTuple.tupleLength());
-
-        const voltdb::TupleSchema *schema = m_oldTuple.getSchema();
-        const uint16_t uninlineableObjectColumnCount = schema->getUninlinedObjectColumnCount();
-
-        /*
-         * Record which unlineableObjectColumns were updated so the
-         * strings can be freed when this UndoAction is released or
-         * undone.
-         */
-        if (uninlineableObjectColumnCount > 0) {
-            for (uint16_t ii = 0; ii < uninlineableObjectColumnCount; ii++) {
-                const uint16_t uninlineableObjectColumn = schema->getUninlinedObjectColumnInfoIndex(ii);
-                const char *mPtr = *reinterpret_cast<char* const*>
-                  (m_oldTuple.getDataPtr(uninlineableObjectColumn));
-                const char *oPtr = *reinterpret_cast<char* const*>
-                  (m_newTuple.getDataPtr(uninlineableObjectColumn));
-                /*
-                 * Only need to record the ones that are different and
-                 * thus separate allocations.
-                 */
-                if (mPtr != oPtr) {
-                    oldUninlineableColumns.push_back(mPtr);
-                    newUninlineableColumns.push_back(oPtr);
-                }
-            }
-        }
-    }
-
     /*
      * Undo whatever this undo action was created to undo. In this
      * case the string allocations of the new tuple must be freed and
-     * the tuple must be overwritten with the old one.
+     * the changed columns must be reverted to their old values.
      */
     void undo();
 
@@ -112,11 +93,34 @@ public:
     virtual ~PersistentTableUndoUpdateAction();
 
 private:
-    voltdb::TableTuple m_oldTuple;
+    inline bool isChanged(int column) const {
+        return (m_changedColumns[column >> 6] >> (column & 63)) & 1;
+    }
+
+    /*
+     * Bytes the column occupies in the tuple, including the length
+     * prefix of inlined strings.
+     */
+    static inline uint32_t columnStorageSize(const voltdb::TupleSchema *schema, int column) {
+        const uint32_t end = (column + 1 < schema->columnCount()) ?
+            schema->columnOffset(column + 1) : schema->tupleLength();
+        return end - schema->columnOffset(column);
+    }
+
+    voltdb::TableTuple m_tuple;
+#ifdef MEMCHECK_NOFREELIST
+    // Tuple storage is not recycled in this build, so a tuple restored by
+    // an undone delete lives at a new address and has to be looked up by
+    // value.
     voltdb::TableTuple m_newTuple;
+#endif
     voltdb::PersistentTable *m_table;
-    std::vector<const char*> oldUninlineableColumns;
-    std::vector<const char*> newUninlineableColumns;
+    uint64_t *m_changedColumns;
+    // old inlined bytes of the changed columns, followed by the pointers
+    // to the new objects of the changed uninlined columns
+    char *m_values;
+    uint16_t m_changedObjectCount;
+    uint32_t m_oldValuesSize;
     bool m_revertIndexes;
     size_t m_wrapperOffset;
 };
@@ -27,7 +27,8 @@ RecoveryContext::RecoveryContext(PersistentTable *table, int32_t tableId) :
         m_table(table),
         m_iterator(table, true),
         m_tableId(tableId),
-        m_recoveryPhase(RECOVERY_MSG_TYPE_SCAN_TUPLES) {
+        m_recoveryPhase(RECOVERY_MSG_TYPE_SCAN_TUPLES),
+        m_stagingCapacity(0) {
 
 }
 
@@ -56,17 +57,28 @@ bool RecoveryContext::nextMessage(ReferenceSerializeOutput *out) {
     DefaultTupleSerializer serializer;
     //Use allocated tuple count to size stuff at the other end
     uint32_t allocatedTupleCount = static_cast<uint32_t>(m_table->allocatedTupleCount());
+    if (m_stagingCapacity < out->remaining()) {
+        m_stagingCapacity = out->remaining();
+        m_stagingBuffer.reset(new char[m_stagingCapacity]);
+    }
     RecoveryProtoMsgBuilder message(
             m_recoveryPhase,
             m_tableId,
             allocatedTupleCount,
             out,
             &m_serializer,
-            m_table->schema());
+            m_table->schema(),
+            m_stagingBuffer.get(),
+            m_stagingCapacity);
     TableTuple tuple(m_table->schema());
     while (message.canAddMoreTuples() && m_iterator.next(tuple)) {
         message.addTuple(tuple);
     }
+    // tell the recovering partition it has every scanned tuple now, the
+    // completion message below is consumed by Java and never reaches it
+    if (!m_iterator.hasNext()) {
+        message.setMsgType(RECOVERY_MSG_TYPE_SCAN_COMPLETE);
+    }
     message.finalize();
     return true;
 }
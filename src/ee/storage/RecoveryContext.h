@@ -19,6 +19,7 @@
 
 #include "storage/tableiterator.h"
 #include "common/DefaultTupleSerializer.h"
+#include "boost/scoped_array.hpp"
 
 /*
  * A log of changes to tuple data that has already been sent to a recovering
@@ -73,6 +74,14 @@ private:
     RecoveryMsgType m_recoveryPhase;
 
     DefaultTupleSerializer m_serializer;
+
+    /*
+     * Tuples of the next message are serialized here and then compressed into
+     * the output buffer. Sized to the largest output buffer seen and reused
+     * for every message, so the host can ship one buffer while the next is filled.
+     */
+    boost::scoped_array<char> m_stagingBuffer;
+    size_t m_stagingCapacity;
 };
 }
 #endif /* RECOVERYCONTEXT_H_ */
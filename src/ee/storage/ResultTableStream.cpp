@@ -0,0 +1,95 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "storage/ResultTableStream.h"
+#include "storage/temptable.h"
+#include "storage/tableiterator.h"
+
+using namespace voltdb;
+
+// Below this much free space the header alone could overflow the buffer;
+// leave such fragments to the regular send() path.
+static const size_t MIN_STREAM_CAPACITY = 64 * 1024;
+
+ResultTableStream::ResultTableStream() :
+    m_out(NULL), m_table(NULL), m_startPosition(0), m_lengthPosition(0),
+    m_countPosition(0), m_rowCount(0), m_spilled(false)
+{
+}
+
+bool ResultTableStream::open(ReferenceSerializeOutput *out, TempTable *table,
+                             int32_t dependencyId) {
+    assert(m_table == NULL);
+    assert(table->activeTupleCount() == 0);
+    if (out->remaining() < MIN_STREAM_CAPACITY) {
+        return false;
+    }
+
+    m_out = out;
+    m_table = table;
+    m_rowCount = 0;
+    m_spilled = false;
+
+    // same layout as VoltDBEngine::send() followed by Table::serializeTo()
+    m_startPosition = m_out->position();
+    m_out->writeInt(dependencyId);
+    m_lengthPosition = m_out->reserveBytes(sizeof(int32_t));
+    m_table->serializeColumnHeaderTo(*m_out);
+    m_countPosition = m_out->reserveBytes(sizeof(int32_t));
+
+    m_table->setResultStream(this);
+    return true;
+}
+
+void ResultTableStream::close() {
+    assert(m_table != NULL);
+    m_table->setResultStream(NULL);
+
+    if (m_spilled) {
+        TableIterator iter(m_table);
+        TableTuple tuple(m_table->schema());
+        while (iter.next(tuple)) {
+            tuple.serializeTo(*m_out);
+            ++m_rowCount;
+        }
+    }
+
+    m_out->writeIntAt(m_countPosition, m_rowCount);
+    m_out->writeIntAt(m_lengthPosition,
+            static_cast<int32_t>(m_out->position() - m_lengthPosition - sizeof(int32_t)));
+    m_table = NULL;
+    m_out = NULL;
+}
+
+void ResultTableStream::abandon() {
+    if (m_table == NULL) {
+        return;
+    }
+    m_table->setResultStream(NULL);
+    m_out->initializeWithPosition(const_cast<char*>(m_out->data()),
+            m_out->position() + m_out->remaining(), m_startPosition);
+    m_table = NULL;
+    m_out = NULL;
+}
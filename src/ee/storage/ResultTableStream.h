@@ -0,0 +1,124 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HSTORERESULTTABLESTREAM_H
+#define HSTORERESULTTABLESTREAM_H
+
+#include "common/tabletuple.h"
+#include "common/serializeio.h"
+
+namespace voltdb {
+
+class TempTable;
+
+/**
+ * Serializes the rows of a fragment's final TempTable straight into the
+ * engine's result buffer while the producing executor runs, instead of
+ * materializing them in the table and serializing them again in
+ * VoltDBEngine::send(). The dependency id, table header and a row count
+ * placeholder are written on open(); close() patches the count and
+ * length.
+ *
+ * If a row does not fit in the remaining buffer the stream stops taking
+ * rows and the table stores them as usual ("spills"). close() then
+ * serializes the spilled rows after the streamed ones, so row order is
+ * preserved and overflow is reported exactly as before.
+ */
+class ResultTableStream {
+  public:
+    ResultTableStream();
+
+    /**
+     * Attach to table and start a serialized table for dependencyId in
+     * out. Returns false, leaving out untouched, if the buffer is too
+     * small to be worth streaming into.
+     */
+    bool open(ReferenceSerializeOutput *out, TempTable *table, int32_t dependencyId);
+
+    /** True if rows of table are currently being streamed. */
+    bool isOpenFor(const TempTable *table) const {
+        return m_table != NULL && m_table == table;
+    }
+
+    /** Rows written to the buffer so far, not counting spilled ones. */
+    int32_t streamedCount() const { return m_rowCount; }
+
+    /**
+     * Serialize one row into the result buffer. Returns false if the
+     * row was not written and must be stored in the table instead.
+     */
+    inline bool append(TableTuple &tuple);
+
+    /** Serialize any spilled rows, finish the table and detach. */
+    void close();
+
+    /** Detach and rewind the result buffer to where open() started. */
+    void abandon();
+
+  private:
+    ReferenceSerializeOutput *m_out;
+    TempTable *m_table;
+    size_t m_startPosition;
+    size_t m_lengthPosition;
+    size_t m_countPosition;
+    int32_t m_rowCount;
+    bool m_spilled;
+};
+
+/**
+ * Abandons the stream when it goes out of scope unless it was closed
+ * first, so no way out of a fragment, thrown or returned, leaves a table
+ * appending to the result buffer.
+ */
+class ResultTableStreamGuard {
+  public:
+    explicit ResultTableStreamGuard(ResultTableStream &stream) : m_stream(stream) {}
+    ~ResultTableStreamGuard() { m_stream.abandon(); }
+
+  private:
+    ResultTableStream &m_stream;
+};
+
+inline bool ResultTableStream::append(TableTuple &tuple) {
+    if (m_spilled) {
+        return false;
+    }
+    // a serialized column is at most 3 bytes wider than its inlined
+    // storage (string length prefixes), plus the uninlined object data
+    // and the row length prefix
+    const size_t bound = tuple.tupleLength() +
+        3 * tuple.sizeInValues() + tuple.getNonInlinedMemorySize() + sizeof(int32_t);
+    if (m_out->remaining() < bound) {
+        m_spilled = true;
+        return false;
+    }
+    tuple.serializeTo(*m_out);
+    ++m_rowCount;
+    return true;
+}
+
+}
+
+#endif
@@ -88,6 +88,13 @@ namespace voltdb
             return m_offset - m_releaseOffset;
         }
 
+        /**
+         * Size of the buffer
+         */
+        size_t capacity() const {
+            return m_capacity;
+        }
+
     private:
         char* mutableDataPtr() {
             return m_data + m_offset;
@@ -121,6 +128,13 @@ namespace voltdb
             }
         }
 
+        // Empty the block for reuse at a new universal stream offset
+        void reset(size_t uso) {
+            m_offset = 0;
+            m_releaseOffset = 0;
+            m_uso = uso;
+        }
+
         char *m_data;
         const size_t m_capacity;
         size_t m_offset;         // position for next write.
@@ -0,0 +1,135 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "storage/TupleBlockFormat.h"
+#include "common/serializeio.h"
+#include "common/TupleSchema.h"
+#include "common/tabletuple.h"
+#include "common/SerializableEEException.h"
+#include <cassert>
+
+namespace voltdb {
+
+static void throwMalformed(const char *what) {
+    std::string message("Malformed block copy table data: ");
+    message += what;
+    throw SerializableEEException(VOLT_EE_EXCEPTION_TYPE_EEEXCEPTION, message);
+}
+
+bool TupleBlockFormat::supports(const TupleSchema *schema) {
+    return schema->getUninlinedObjectColumnCount() == 0;
+}
+
+void TupleBlockFormat::writeHeader(const TupleSchema *schema, int tupleLength, SerializeOutput &out) {
+    assert(supports(schema));
+    out.writeInt(MARKER);
+    out.writeInt(tupleLength);
+    out.writeShort(static_cast<int16_t>(schema->columnCount()));
+    for (int ii = 0; ii < schema->columnCount(); ii++) {
+        out.writeByte(static_cast<int8_t>(schema->columnType(ii)));
+        out.writeInt(static_cast<int32_t>(schema->columnLength(ii)));
+    }
+}
+
+TupleBlockReader::TupleBlockReader(SerializeInput &in) :
+    m_in(in), m_tupleLength(0), m_runsLeft(0), m_runSlots(0), m_slot(0),
+    m_bitmap(NULL), m_tuples(NULL)
+{
+    if (m_in.readInt() != TupleBlockFormat::MARKER) {
+        throwMalformed("missing marker");
+    }
+    m_tupleLength = m_in.readInt();
+    const int16_t columnCount = m_in.readShort();
+    if (m_tupleLength <= TUPLE_HEADER_SIZE || columnCount <= 0) {
+        throwMalformed("bad schema header");
+    }
+    for (int ii = 0; ii < columnCount; ii++) {
+        m_types.push_back(static_cast<ValueType>(m_in.readByte()));
+        m_lengths.push_back(m_in.readInt());
+    }
+    m_runsLeft = m_in.readInt();
+    if (m_runsLeft < 0) {
+        throwMalformed("negative run count");
+    }
+}
+
+bool TupleBlockReader::matches(const TupleSchema *schema, int tupleLength) const {
+    if (tupleLength != m_tupleLength || schema->columnCount() != m_types.size()) {
+        return false;
+    }
+    for (int ii = 0; ii < schema->columnCount(); ii++) {
+        if (schema->columnType(ii) != m_types[ii] ||
+            static_cast<int32_t>(schema->columnLength(ii)) != m_lengths[ii]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* TupleBlockReader::next() {
+    while (true) {
+        while (m_slot < m_runSlots) {
+            const int32_t slot = m_slot++;
+            if (m_bitmap[slot >> 3] & (1 << (slot & 7))) {
+                return m_tuples + static_cast<std::size_t>(slot) * m_tupleLength;
+            }
+        }
+        if (m_runsLeft == 0) {
+            return NULL;
+        }
+        m_runsLeft--;
+        m_runSlots = m_in.readInt();
+        if (m_runSlots < 0) {
+            throwMalformed("negative slot count");
+        }
+        const std::size_t bitmapLength = TupleBlockFormat::bitmapLength(m_runSlots);
+        const std::size_t tuplesLength = static_cast<std::size_t>(m_runSlots) * m_tupleLength;
+        if (m_in.numBytesNotYetRead() < bitmapLength + tuplesLength) {
+            throwMalformed("truncated run");
+        }
+        m_bitmap = reinterpret_cast<const uint8_t*>(m_in.getRawPointer(bitmapLength));
+        m_tuples = reinterpret_cast<const char*>(m_in.getRawPointer(tuplesLength));
+        m_slot = 0;
+    }
+}
+
+int32_t TupleBlockReader::expandTo(SerializeOutput &out) {
+    std::vector<bool> allowNull(m_types.size(), true);
+    TupleSchema *schema = TupleSchema::createTupleSchema(m_types, m_lengths, allowNull, true);
+    if (!TupleBlockFormat::supports(schema) ||
+        static_cast<int32_t>(schema->tupleLength()) + TUPLE_HEADER_SIZE != m_tupleLength) {
+        TupleSchema::freeTupleSchema(schema);
+        throwMalformed("tuple length does not match the schema");
+    }
+    int32_t rows = 0;
+    try {
+        TableTuple tuple(schema);
+        const char *storage;
+        while ((storage = next()) != NULL) {
+            tuple.move(const_cast<char*>(storage));
+            tuple.serializeTo(out);
+            rows++;
+        }
+    } catch (...) {
+        TupleSchema::freeTupleSchema(schema);
+        throw;
+    }
+    TupleSchema::freeTupleSchema(schema);
+    return rows;
+}
+
+}
@@ -0,0 +1,107 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2011 VoltDB Inc.
+ *
+ * VoltDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * VoltDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with VoltDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TUPLEBLOCKFORMAT_H_
+#define TUPLEBLOCKFORMAT_H_
+
+#include <vector>
+#include <stdint.h>
+#include "common/types.h"
+
+namespace voltdb {
+class TupleSchema;
+class SerializeInput;
+class SerializeOutput;
+
+/**
+ * Block copy variant of the serialized table body, used by COW snapshots of
+ * tables whose tuples are entirely inlined. Instead of rows in the wire
+ * format the body holds raw tuple storage copied straight out of the table
+ * blocks:
+ *
+ * [int32 MARKER][int32 tuple length][int16 column count]
+ * column count * ([int8 type][int32 column length])
+ * [int32 run count]
+ * run count * ([int32 slots][(slots + 7) / 8 byte live bitmap][slots * tuple length])
+ *
+ * Bit i of a run's bitmap (LSB first) is set if slot i holds a tuple that is
+ * part of the snapshot. The row count that precedes the body is the number
+ * of live tuples, so the surrounding VoltTable stays well formed. MARKER sits
+ * where the first row's length would be, which is never negative.
+ */
+class TupleBlockFormat {
+public:
+    static const int32_t MARKER = -1;
+
+    /**
+     * True if tuples with this schema can be copied as raw storage.
+     */
+    static bool supports(const TupleSchema *schema);
+
+    /**
+     * Write the marker and schema header. tupleLength includes the tuple header.
+     */
+    static void writeHeader(const TupleSchema *schema, int tupleLength, SerializeOutput &out);
+
+    static std::size_t bitmapLength(int32_t slots) {
+        return static_cast<std::size_t>((slots + 7) / 8);
+    }
+};
+
+/**
+ * Reads the live tuples back out of a block copy body.
+ */
+class TupleBlockReader {
+public:
+    /**
+     * Reads the marker and schema header. Throws a SerializableEEException
+     * if the header is malformed.
+     */
+    TupleBlockReader(SerializeInput &in);
+
+    /**
+     * True if the blocks were written for a table with the same tuple layout.
+     */
+    bool matches(const TupleSchema *schema, int tupleLength) const;
+
+    /**
+     * Storage (including the tuple header) of the next live tuple, or NULL
+     * after the last one.
+     */
+    const char* next();
+
+    /**
+     * Re-encode the remaining live tuples as rows in the regular wire format.
+     * Returns the number of rows written.
+     */
+    int32_t expandTo(SerializeOutput &out);
+
+private:
+    SerializeInput &m_in;
+    int32_t m_tupleLength;
+    std::vector<ValueType> m_types;
+    std::vector<int32_t> m_lengths;
+    int32_t m_runsLeft;
+    int32_t m_runSlots;
+    int32_t m_slot;
+    const uint8_t *m_bitmap;
+    const char *m_tuples;
+};
+
+}
+
+#endif /* TUPLEBLOCKFORMAT_H_ */
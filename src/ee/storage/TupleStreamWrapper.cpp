@@ -174,11 +174,50 @@ void TupleStreamWrapper::rollbackTo(size_t mark)
 }
 
 /*
- * Correctly release and delete a managed buffer that won't
- * be handed off
+ * Correctly release a managed buffer that won't be handed off. A
+ * few are kept for reuse so a busy stream doesn't allocate and page
+ * in a fresh buffer every time one fills up.
  */
 void TupleStreamWrapper::discardBlock(StreamBlock *sb) {
-    delete sb;
+    if (sb->capacity() == m_defaultCapacity && m_freeBlocks.size() < EL_FREE_BLOCKS) {
+        m_freeBlocks.push_back(sb);
+    }
+    else {
+        delete sb;
+    }
+}
+
+/*
+ * Take a block from the free list or allocate a new one, starting at
+ * the current uso.
+ */
+StreamBlock* TupleStreamWrapper::allocateBlock()
+{
+    if (!m_freeBlocks.empty()) {
+        StreamBlock *sb = m_freeBlocks.back();
+        m_freeBlocks.pop_back();
+        sb->reset(m_uso);
+        return sb;
+    }
+
+    char *buffer = new char[m_defaultCapacity];
+    if (!buffer) {
+        throwFatalException("Failed to claim managed buffer for Export.");
+    }
+    return new StreamBlock(buffer, m_defaultCapacity, m_uso);
+}
+
+/*
+ * Top up the free list outside of the insert path, touching every
+ * page of the new buffers so appends don't take the page faults.
+ */
+void TupleStreamWrapper::fillFreeBlocks()
+{
+    while (m_freeBlocks.size() < EL_FREE_BLOCKS) {
+        char *buffer = new char[m_defaultCapacity];
+        ::memset(buffer, 0, m_defaultCapacity);
+        m_freeBlocks.push_back(new StreamBlock(buffer, m_defaultCapacity, 0));
+    }
 }
 
 /*
@@ -205,12 +244,7 @@ void TupleStreamWrapper::extendBufferChain(size_t minLength)
         }
     }
 
-    char *buffer = new char[m_defaultCapacity];
-    if (!buffer) {
-        throwFatalException("Failed to claim managed buffer for Export.");
-    }
-
-    m_currBlock = new StreamBlock(buffer, m_defaultCapacity, m_uso);
+    m_currBlock = allocateBlock();
 }
 
 /*
@@ -232,6 +266,11 @@ TupleStreamWrapper::periodicFlush(int64_t timeInMillis,
 
         extendBufferChain(0);
         commit(lastCommittedTxnId, currentTxnId);
+
+        // streams that never see data don't hold on to spare buffers
+        if (m_uso != 0) {
+            fillFreeBlocks();
+        }
     }
 }
 
@@ -31,6 +31,8 @@ namespace voltdb {
 
 class Topend;
 const int EL_BUFFER_SIZE = /* 1024; */ 2 * 1024 * 1024;
+// released blocks a stream keeps around for reuse
+const size_t EL_FREE_BLOCKS = 2;
 
 class TupleStreamWrapper {
 public:
@@ -103,6 +105,8 @@ public:
     size_t computeOffsets(TableTuple &tuple,size_t *rowHeaderSz);
     void extendBufferChain(size_t minLength);
     void discardBlock(StreamBlock *sb);
+    StreamBlock* allocateBlock();
+    void fillFreeBlocks();
 
     /** Send committed data to the top end */
     void commit(int64_t lastCommittedTxnId, int64_t txnId);
@@ -133,7 +137,7 @@ public:
     /** Blocks not yet polled by the top-end */
     std::deque<StreamBlock*> m_pendingBlocks;
 
-    /** Free list of blocks */
+    /** Free list of blocks, all of m_defaultCapacity and already paged in */
     std::deque<StreamBlock*> m_freeBlocks;
 
     /** transaction id of the current (possibly uncommitted) transaction */
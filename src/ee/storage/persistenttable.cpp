@@ -99,7 +99,7 @@ TableTuple keyTuple;
 PersistentTable::PersistentTable(ExecutorContext *ctx, bool exportEnabled) :
     Table(TABLE_BLOCKSIZE,ctx->isMMAPEnabled()), m_executorContext(ctx), m_uniqueIndexes(NULL), m_uniqueIndexCount(0), m_allowNulls(NULL),
     m_indexes(NULL), m_indexCount(0), m_pkeyIndex(NULL), m_wrapper(NULL),
-    m_tsSeqNo(0), stats_(this), m_exportEnabled(exportEnabled),
+    m_tsSeqNo(0), m_updateOldTuple(), stats_(this), m_exportEnabled(exportEnabled),
     m_COWContext(NULL)
 {
 
@@ -114,6 +114,8 @@ PersistentTable::PersistentTable(ExecutorContext *ctx, bool exportEnabled) :
     m_batchEvicted = false;
 #endif
 
+    m_deferIndexInserts = false;
+
     if (exportEnabled) {
         m_wrapper = new TupleStreamWrapper(m_executorContext->m_partitionId,
                 m_executorContext->m_siteId,
@@ -126,7 +128,7 @@ PersistentTable::PersistentTable(ExecutorContext *ctx, bool exportEnabled) :
 PersistentTable::PersistentTable(ExecutorContext *ctx, const std::string name, bool exportEnabled) :
     Table(TABLE_BLOCKSIZE,ctx->isMMAPEnabled()), m_executorContext(ctx), m_uniqueIndexes(NULL), m_uniqueIndexCount(0), m_allowNulls(NULL),
     m_indexes(NULL), m_indexCount(0), m_pkeyIndex(NULL), m_wrapper(NULL),
-    m_tsSeqNo(0), stats_(this), m_exportEnabled(exportEnabled),
+    m_tsSeqNo(0), m_updateOldTuple(), stats_(this), m_exportEnabled(exportEnabled),
     m_COWContext(NULL)
 {
 
@@ -141,6 +143,8 @@ PersistentTable::PersistentTable(ExecutorContext *ctx, const std::string name, b
     m_batchEvicted = false;
 #endif
 
+    m_deferIndexInserts = false;
+
     if (exportEnabled) {
         m_wrapper = new TupleStreamWrapper(m_executorContext->m_partitionId,
                 m_executorContext->m_siteId,
@@ -191,6 +195,7 @@ PersistentTable::~PersistentTable() {
     }
 
     delete m_wrapper;
+    delete[] m_updateOldTuple.m_data;
 }
 
 // ------------------------------------------------------------------
@@ -202,6 +207,10 @@ PersistentTable::~PersistentTable() {
 void PersistentTable::setEvictedTable(voltdb::Table *evictedTable) {
     VOLT_INFO("Initialized EvictedTable for table '%s'", this->name().c_str());
     m_evictedTable = evictedTable;
+    // evicted tuples' index entries point into the EvictedTable
+    for (int i = 0; i < m_indexCount; ++i) {
+        m_indexes[i]->setTupleTables(this, evictedTable);
+    }
 }
 
 voltdb::Table* PersistentTable::getEvictedTable() {
@@ -494,7 +503,9 @@ bool PersistentTable::insertTuple(TableTuple &source) {
     }
     m_tmpTarget1.isDirty();
 
-    if (!tryInsertOnAllIndexes(&m_tmpTarget1)) {
+    if (m_deferIndexInserts) {
+        m_deferredIndexTuples.push_back(m_tmpTarget1.address());
+    } else if (!tryInsertOnAllIndexes(&m_tmpTarget1)) {
         // Careful to delete allocated objects
         m_tmpTarget1.freeObjectColumns();
         deleteTupleStorage(m_tmpTarget1);
@@ -620,7 +631,15 @@ bool PersistentTable::updateTuple(TableTuple &source, TableTuple &target, bool u
     assert(pool);
     voltdb::PersistentTableUndoUpdateAction *ptuua =
         new (pool->allocate(sizeof(voltdb::PersistentTableUndoUpdateAction)))
-        voltdb::PersistentTableUndoUpdateAction(target, this, pool);
+        voltdb::PersistentTableUndoUpdateAction(target, this);
+
+    /*
+     * Keep the pre-update version around for the indexes, Export, the
+     * views and the undo action's diff. Only the diff is kept past the
+     * end of this call.
+     */
+    TableTuple &oldTuple = m_updateOldTuple;
+    ::memcpy(oldTuple.address(), target.address(), m_schema->tupleLength() + TUPLE_HEADER_SIZE);
 
     if (m_COWContext.get() != NULL) {
         m_COWContext->markTupleDirty(target, false);
@@ -643,7 +662,7 @@ bool PersistentTable::updateTuple(TableTuple &source, TableTuple &target, bool u
     /** TODO : Not Using MMAP pool **/
     target.copyForPersistentUpdate(source, NULL);
 
-    ptuua->setNewTuple(target, pool);
+    ptuua->recordChanges(oldTuple, pool);
 
     if (!undoQuantum->isDummy()) {
         //DummyUndoQuantum calls destructor upon register.
@@ -653,8 +672,8 @@ bool PersistentTable::updateTuple(TableTuple &source, TableTuple &target, bool u
     // the planner should determine if this update can affect indexes.
     // if so, update the indexes here
     if (updatesIndexes) {
-        if (!tryUpdateOnAllIndexes(ptuua->getOldTuple(), target)) {
-            throw ConstraintFailureException(this, ptuua->getOldTuple(),
+        if (!tryUpdateOnAllIndexes(oldTuple, target)) {
+            throw ConstraintFailureException(this, oldTuple,
                     target,
                     voltdb::CONSTRAINT_TYPE_UNIQUE);
         }
@@ -662,20 +681,20 @@ bool PersistentTable::updateTuple(TableTuple &source, TableTuple &target, bool u
         //If the CFE is thrown the Undo action should not attempt to revert the
         //indexes.
         ptuua->needToRevertIndexes();
-        updateFromAllIndexes(ptuua->getOldTuple(), target);
+        updateFromAllIndexes(oldTuple, target);
     }
 
     // if EL is enabled, append the tuple to the buffer
     if (m_exportEnabled) {
         // only need the earliest mark
-        elMark = appendToELBuffer(ptuua->getOldTuple(), m_tsSeqNo, TupleStreamWrapper::DELETE);
+        elMark = appendToELBuffer(oldTuple, m_tsSeqNo, TupleStreamWrapper::DELETE);
         appendToELBuffer(target, m_tsSeqNo++, TupleStreamWrapper::INSERT);
         ptuua->setELMark(elMark);
     }
 
     // handle any materialized views
     for (int i = 0; i < m_views.size(); i++) {
-        m_views[i]->processTupleUpdate(ptuua->getOldTuple(), target);
+        m_views[i]->processTupleUpdate(oldTuple, target);
     }
 
     /**
@@ -683,7 +702,7 @@ bool PersistentTable::updateTuple(TableTuple &source, TableTuple &target, bool u
      * some columns
      */
     FAIL_IF(!checkNulls(target)) {
-        throw ConstraintFailureException(this, ptuua->getOldTuple(),
+        throw ConstraintFailureException(this, oldTuple,
                 target,
                 voltdb::CONSTRAINT_TYPE_NOT_NULL);
     }
@@ -715,12 +734,11 @@ bool PersistentTable::updateTuple(TableTuple &source, TableTuple &target, bool u
  * changed). The backup is necessary because the indexes expect the
  * data ptr that will be used as the value in the index.
  */
-void PersistentTable::updateTupleForUndo(TableTuple &source, TableTuple &target,
-        bool revertIndexes, size_t wrapperOffset) {
+void PersistentTable::updateTupleForUndo(const PersistentTableUndoUpdateAction &undoAction,
+        TableTuple &target, bool revertIndexes, size_t wrapperOffset) {
     if (m_schema->getUninlinedObjectColumnCount() != 0)
     {
         m_nonInlinedMemorySize -= target.getNonInlinedMemorySize();
-        m_nonInlinedMemorySize += source.getNonInlinedMemorySize();
     }
 
     //Need to back up the updated version of the tuple to provide to
@@ -733,15 +751,14 @@ void PersistentTable::updateTupleForUndo(TableTuple &source, TableTuple &target,
     TableTuple targetBackup = tempTuple();
     targetBackup.copy(target);
 
-    bool dirty = target.isDirty();
-    // this is the actual in-place revert to the old version
-    target.copy(source);
-    if (dirty) {
-        target.setDirtyTrue();
-    } else {
-        target.setDirtyFalse();
+    // this is the actual in-place revert to the old version. Only the
+    // changed columns are rewritten, so the header flags are untouched.
+    undoAction.revertColumns(target);
+
+    if (m_schema->getUninlinedObjectColumnCount() != 0)
+    {
+        m_nonInlinedMemorySize += target.getNonInlinedMemorySize();
     }
-    target.isDirty();
 
     //If the indexes were never updated there is no need to revert them.
     if (revertIndexes) {
@@ -951,6 +968,22 @@ bool PersistentTable::tryInsertOnAllIndexes(TableTuple *tuple) {
     return true;
 }
 
+void PersistentTable::setDeferIndexInserts(bool defer) {
+    if (!defer && !m_deferredIndexTuples.empty()) {
+        VOLT_DEBUG("Adding %d deferred tuples to the indexes of %s",
+                   (int) m_deferredIndexTuples.size(), name().c_str());
+        for (int i = m_indexCount - 1; i >= 0; --i) {
+            if (!m_indexes[i]->addEntries(m_deferredIndexTuples)) {
+                throwFatalException("Failed to add deferred inserts to index %s.%s [%s]",
+                                    name().c_str(), m_indexes[i]->getName().c_str(),
+                                    m_indexes[i]->getTypeName().c_str());
+            }
+        }
+        m_deferredIndexTuples.clear();
+    }
+    m_deferIndexInserts = defer;
+}
+
 bool PersistentTable::tryUpdateOnAllIndexes(TableTuple &targetTuple, const TableTuple &sourceTuple) {
     for (int i = m_uniqueIndexCount - 1; i >= 0;--i) {
         if (m_uniqueIndexes[i]->checkForIndexChange(&targetTuple, &sourceTuple) == false)
@@ -1053,6 +1086,10 @@ void PersistentTable::onSetColumns() {
     for (int i = m_columnCount - 1; i >= 0; --i) {
         m_allowNulls[i] = m_schema->columnAllowNull(i);
     }
+
+    delete[] m_updateOldTuple.m_data;
+    char *oldTupleMemory = new char[m_schema->tupleLength() + TUPLE_HEADER_SIZE];
+    m_updateOldTuple = TableTuple(oldTupleMemory, m_schema);
 }
 
 /*
@@ -1092,14 +1129,36 @@ void PersistentTable::processLoadedTuple(bool allowExport, TableTuple &tuple) {
  */
 void PersistentTable::populateIndexes(int tupleCount) 
 {
-    // populate indexes. walk the contiguous memory in the inner loop.
-    for (int i = m_indexCount - 1; i >= 0;--i) {
-        TableIndex *index = m_indexes[i];
+    if (m_indexCount == 0 || tupleCount == 0)
+        return;
+
+    if (m_deferIndexInserts) {
         for (int j = 0; j < tupleCount; ++j) {
-            m_tmpTarget1.move(dataPtrForTuple((int) m_usedTuples + j));
-            index->addEntry(&m_tmpTarget1);
+            m_deferredIndexTuples.push_back(dataPtrForTuple((int) m_usedTuples + j));
         }
+        return;
+    }
+
+    // collect the loaded tuples once and hand each index the whole batch so
+    // it can sort the keys and build its structure in one pass
+    std::vector<void*> tupleAddresses(tupleCount);
+    for (int j = 0; j < tupleCount; ++j) {
+        tupleAddresses[j] = dataPtrForTuple((int) m_usedTuples + j);
+    }
+    for (int i = m_indexCount - 1; i >= 0;--i) {
+        m_indexes[i]->addEntries(tupleAddresses);
+    }
+}
+
+int PersistentTable::shareIndexStages() {
+    int shared = 0;
+    for (int i = 0; i < m_indexCount; ++i) {
+        if (m_indexes[i]->shareStaticStage(name() + "." + m_indexes[i]->getName()))
+            shared++;
     }
+    VOLT_DEBUG("Shared %d of %d index stages for table '%s'",
+               shared, m_indexCount, name().c_str());
+    return shared;
 }
 
 size_t PersistentTable::appendToELBuffer(TableTuple &tuple, int64_t seqNo,
@@ -1222,14 +1281,20 @@ void PersistentTable::nextRecoveryMessage(ReferenceSerializeOutput *out) {
  */
 void PersistentTable::processRecoveryMessage(RecoveryProtoMsg* message, Pool *pool, bool allowExport) {
     switch (message->msgType()) {
-        case voltdb::RECOVERY_MSG_TYPE_SCAN_TUPLES: {
+        case voltdb::RECOVERY_MSG_TYPE_SCAN_TUPLES:
+        case voltdb::RECOVERY_MSG_TYPE_SCAN_COMPLETE: {
                                                         if (activeTupleCount() == 0) {
                                                             uint32_t tupleCount = message->totalTupleCount();
                                                             for (int i = 0; i < m_indexCount; i++) {
                                                                 m_indexes[i]->ensureCapacity(tupleCount);
                                                             }
                                                         }
+                                                        // index the whole table in one batch once it has all arrived
+                                                        setDeferIndexInserts(true);
                                                         loadTuplesFromNoHeader( allowExport, *message->stream(), pool);
+                                                        if (message->msgType() == voltdb::RECOVERY_MSG_TYPE_SCAN_COMPLETE) {
+                                                            setDeferIndexInserts(false);
+                                                        }
                                                         break;
                                                     }
         default:
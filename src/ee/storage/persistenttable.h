@@ -84,6 +84,7 @@ class ReferenceSerializeOutput;
 class ExecutorContext;
 class MaterializedViewMetadata;
 class RecoveryProtoMsg;
+class PersistentTableUndoUpdateAction;
     
 #ifdef ANTICACHE
 class EvictedTable;
@@ -158,11 +159,12 @@ class PersistentTable : public Table {
                      bool updatesIndexes);
 
     /*
-     * Identical to regular updateTuple except no memory management
-     * for unlined columns is performed because that will be handled
-     * by the UndoAction.
+     * Revert the columns recorded by the undo action in targetTuple.
+     * No memory management for unlined columns is performed because
+     * that will be handled by the UndoAction.
      */
-    void updateTupleForUndo(TableTuple &sourceTuple, TableTuple &targetTuple,
+    void updateTupleForUndo(const PersistentTableUndoUpdateAction &undoAction,
+                            TableTuple &targetTuple,
                             bool revertIndexes, size_t elMark);
 
     /*
@@ -188,6 +190,25 @@ class PersistentTable : public Table {
     virtual TableIndex *primaryKeyIndex() { return m_pkeyIndex; }
     virtual const TableIndex *primaryKeyIndex() const { return m_pkeyIndex; }
 
+    /**
+     * Let each index share its read-only stage with the same index of this
+     * table in the other partitions of this process (see
+     * TableIndex::shareStaticStage). Only meaningful for replicated tables,
+     * whose copies are loaded with identical content. Returns the number of
+     * indexes now sharing.
+     */
+    int shareIndexStages();
+
+    /**
+     * While on, insertTuple() leaves the indexes alone and remembers the
+     * new tuples; turning it off adds them to every index in one
+     * addEntries() batch. Used by ARIES replay for runs of inserts and
+     * by recovery between the first scan message and the completion
+     * message, so nothing that looks tuples up through an index may run
+     * in between. Bulk loads are deferred the same way.
+     */
+    void setDeferIndexInserts(bool defer);
+
     // ------------------------------------------------------------------
     // UTILITY
     // ------------------------------------------------------------------
@@ -227,7 +248,9 @@ class PersistentTable : public Table {
     void nextRecoveryMessage(ReferenceSerializeOutput *out);
 
     /**
-     * Process the updates from a recovery message
+     * Process the updates from a recovery message. Index maintenance for
+     * scanned tuples is deferred until the last scan message, typed
+     * RECOVERY_MSG_TYPE_SCAN_COMPLETE, has been loaded.
      */
     void processRecoveryMessage(RecoveryProtoMsg* message, Pool *pool, bool allowExport);
 
@@ -372,6 +395,13 @@ protected:
     // temporary for tuplestream stuff
     TupleStreamWrapper *m_wrapper;
     int64_t m_tsSeqNo;
+
+    // scratch copy of a tuple's previous version during updateTuple
+    TableTuple m_updateOldTuple;
+
+    // see setDeferIndexInserts()
+    bool m_deferIndexInserts;
+    std::vector<void*> m_deferredIndexTuples;
     
     // ANTI-CACHE VARIABLES
     #ifdef ANTICACHE
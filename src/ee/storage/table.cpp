@@ -56,6 +56,7 @@
 #include "indexes/tableindex.h"
 #include "storage/tableiterator.h"
 #include "storage/persistenttable.h"
+#include "storage/TupleBlockFormat.h"
 
 using std::string;
 
@@ -72,6 +73,7 @@ Table::Table(int tableAllocationTargetSize) :
     m_tuplesPerBlock(0),
     m_tupleLength(0),
     m_nonInlinedMemorySize(0),
+    m_lastIdBlock(0),
     m_columnHeaderData(NULL),
     m_columnHeaderSize(-1),
     m_columnNames(NULL),
@@ -111,6 +113,7 @@ Table::Table(int tableAllocationTargetSize, bool enableMMAP) :
     m_tuplesPerBlock(0),
     m_tupleLength(0),
     m_nonInlinedMemorySize(0),
+    m_lastIdBlock(0),
     m_columnHeaderData(NULL),
     m_columnHeaderSize(-1),
     m_columnNames(NULL),
@@ -534,6 +537,16 @@ void Table::loadTuplesFromNoHeader(bool allowExport,
     int tupleCount = serialize_io.readInt();
     assert(tupleCount >= 0);
 
+    // a row's length prefix is never negative, so this can only be a block copy body
+    if (tupleCount > 0 && serialize_io.numBytesNotYetRead() >= sizeof(int32_t)) {
+        const int32_t firstRowLength = serialize_io.readInt();
+        serialize_io.unread(sizeof(int32_t));
+        if (firstRowLength == TupleBlockFormat::MARKER) {
+            loadTupleBlocksFrom(allowExport, tupleCount, serialize_io);
+            return;
+        }
+    }
+
     // allocate required data blocks first to make them alligned well
     while (tupleCount + m_usedTuples > m_allocatedTuples) {
         allocateNextBlock();
@@ -557,6 +570,44 @@ void Table::loadTuplesFromNoHeader(bool allowExport,
     
 }
 
+void Table::loadTupleBlocksFrom(bool allowExport, int tupleCount,
+                                SerializeInput &serialize_io) {
+    TupleBlockReader reader(serialize_io);
+    if (!reader.matches(m_schema, static_cast<int>(m_tupleLength))) {
+        throw SerializableEEException(VOLT_EE_EXCEPTION_TYPE_EEEXCEPTION,
+                                      "Tuple block layout does not match table " + name());
+    }
+
+    while (tupleCount + m_usedTuples > m_allocatedTuples) {
+        allocateNextBlock();
+    }
+
+    int loaded = 0;
+    const char *source;
+    while ((source = reader.next()) != NULL) {
+        if (loaded == tupleCount) {
+            throw SerializableEEException(VOLT_EE_EXCEPTION_TYPE_EEEXCEPTION,
+                                          "More tuple blocks than rows for table " + name());
+        }
+        // the source header carries flags from the snapshotted table
+        char *target = dataPtrForTuple((int) m_usedTuples + loaded);
+        ::memset(target, 0, TUPLE_HEADER_SIZE);
+        ::memcpy(target + TUPLE_HEADER_SIZE, source + TUPLE_HEADER_SIZE, m_tupleLength - TUPLE_HEADER_SIZE);
+        m_tmpTarget1.move(target);
+        processLoadedTuple( allowExport, m_tmpTarget1);
+        loaded++;
+    }
+    if (loaded != tupleCount) {
+        throw SerializableEEException(VOLT_EE_EXCEPTION_TYPE_EEEXCEPTION,
+                                      "Fewer tuple blocks than rows for table " + name());
+    }
+
+    populateIndexes(tupleCount);
+
+    m_tupleCount += tupleCount;
+    m_usedTuples += tupleCount;
+}
+
 void Table::loadTuplesFrom(bool allowExport,
                             SerializeInput &serialize_io,
                             Pool *stringPool) {
@@ -46,6 +46,8 @@
 #ifndef HSTORETABLE_H
 #define HSTORETABLE_H
 
+#include <algorithm>
+#include <climits>
 #include <string>
 #include <vector>
 #ifdef MEMCHECK_NOFREELIST
@@ -75,6 +77,7 @@ class TableStats;
 class StatsSource;
 class StreamBlock;
 class Topend;
+class MasstreeTupleId;
 
 const size_t COLUMN_DESCRIPTOR_SIZE = 1 + 4 + 4; // type, name offset, name length
 
@@ -113,6 +116,8 @@ class Table {
     friend class TableStats;
     friend class StatsSource;
     friend class EvictionIterator; 
+    friend class SeqScanExecutor;
+    friend class MasstreeTupleId;
 
   private:
     // no default constructor, no copy
@@ -208,6 +213,10 @@ public:
     inline void updateTupleAccessCount() {
         m_tupleAccesses++;
     }
+
+    inline void updateTupleAccessCount(int count) {
+        m_tupleAccesses += count;
+    }
     
     #ifdef ANTICACHE
     inline int32_t getTuplesEvicted() const { return (m_tuplesEvicted); }
@@ -274,6 +283,13 @@ public:
                                 SerializeInput &serialize_in,
                                 Pool *stringPool = NULL);
 
+    /**
+     * Loads the live tuples of a block copy body (see TupleBlockFormat)
+     * by copying their storage. Called by loadTuplesFromNoHeader.
+     */
+    void loadTupleBlocksFrom(bool allowExport, int tupleCount,
+                             SerializeInput &serialize_in);
+
     /**
      * Loads only tuple data, not schema, from the serialized table.
      * Used for initial data loading and receiving dependencies.
@@ -390,6 +406,13 @@ protected:
     
     // pointers to chunks of data
     std::vector<char*> m_data;
+    // (block start, position in m_data) sorted by address, so getTupleID
+    // can binary search instead of walking every block. Rebuilt lazily by
+    // indexBlocks() once m_data has changed.
+    std::vector<std::pair<char*, int> > m_sortedBlocks;
+    // position in m_data of the block getTupleID last found a tuple in;
+    // lookups come in runs from one block, so it is tried first
+    std::size_t m_lastIdBlock;
 
     char *m_columnHeaderData;
     int32_t m_columnHeaderSize;
@@ -460,6 +483,8 @@ protected:
     MMAPMemoryManager* m_data_manager;
     
   private:
+    void indexBlocks();
+
     int32_t m_refcount;
 
     bool m_enableMMAP;
@@ -529,42 +554,48 @@ inline void Table::allocateNextBlock() {
     
 inline int Table::getTupleID(const char* tuple_address)
 {    
-    char* addr; 
-    int tuple_id = 0; 
-    
     int tuple_size = m_schema->tupleLength() + TUPLE_HEADER_SIZE; 
-    long offset;
-    
-    for(int i = 0; i < m_data.size(); i++)  // iterate through blocks
-    {
-        addr = m_data[i]; 
-        
-        // tuple cannot be in this block, so increment id and skip to the next block
-        if((tuple_address < addr) || (tuple_address > (addr + (tuple_size*m_tuplesPerBlock)))
-           )
-        {
-            tuple_id += m_tuplesPerBlock; 
-            continue; 
+
+    if (m_lastIdBlock < m_data.size()) {
+        long offset = (long)tuple_address - (long)m_data[m_lastIdBlock];
+        if (offset >= 0 && offset < (long)tuple_size * m_tuplesPerBlock && offset % tuple_size == 0)
+            return (int)m_lastIdBlock * (int)m_tuplesPerBlock + (int)(offset / tuple_size);
+    }
+
+    if (m_sortedBlocks.size() != m_data.size())
+        indexBlocks();
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        // the last block starting at or below the tuple is the only candidate
+        std::vector<std::pair<char*, int> >::const_iterator it =
+            std::upper_bound(m_sortedBlocks.begin(), m_sortedBlocks.end(),
+                             std::make_pair(const_cast<char*>(tuple_address), INT_MAX));
+        if (it == m_sortedBlocks.begin())
+            return -1; // no matching tuple was found
+        --it;
+
+        // a block was swapped out at the same m_data size; refresh and retry
+        if (m_data[it->second] != it->first) {
+            indexBlocks();
+            continue;
         }
 
-        offset = ((long)tuple_address - (long)addr) / tuple_size;
-        if (addr + offset * tuple_size == tuple_address)
-            return tuple_id + (int)offset;
-        
-        /*for(int j = 0; j < m_tuplesPerBlock; j++)  // iterate through tuples in a block
-        {
-            if(addr == tuple_address)
-            {
-                return tuple_id; 
-            }
-            
-            addr += tuple_size; // advance pointer to next tuple
-            tuple_id++; 
-        }*/
-        
+        long offset = (long)tuple_address - (long)it->first;
+        if (offset >= (long)tuple_size * m_tuplesPerBlock || offset % tuple_size != 0)
+            return -1;
+        m_lastIdBlock = it->second;
+        return it->second * (int)m_tuplesPerBlock + (int)(offset / tuple_size);
     }
-    
-    return -1; // no matching tuple was found
+    return -1;
+}
+
+inline void Table::indexBlocks()
+{
+    m_sortedBlocks.clear();
+    m_sortedBlocks.reserve(m_data.size());
+    for (int i = 0; i < m_data.size(); i++)
+        m_sortedBlocks.push_back(std::make_pair(m_data[i], i));
+    std::sort(m_sortedBlocks.begin(), m_sortedBlocks.end());
 }
 
 #ifdef MEMCHECK_NOFREELIST
@@ -132,6 +132,9 @@ Table* TableFactory::getPersistentTable(
 
         for (int i = 0; i < indexes.size(); ++i) {
             pTable->m_indexes[i] = TableIndexFactory::getInstance(indexes[i]);
+            if (partitionColumn == -1)
+                pTable->m_indexes[i]->enableStaticSharing();
+            pTable->m_indexes[i]->setTupleTables(pTable, NULL);
         }
         initConstraints(pTable);
     }
@@ -184,6 +187,11 @@ Table* TableFactory::getPersistentTable(
         for (int i = 0; i < indexes.size(); ++i) {
             pTable->m_indexes[i + 1] = TableIndexFactory::getInstance(indexes[i]);
         }
+        for (int i = 0; i < pTable->m_indexCount; ++i) {
+            if (partitionColumn == -1)
+                pTable->m_indexes[i]->enableStaticSharing();
+            pTable->m_indexes[i]->setTupleTables(pTable, NULL);
+        }
         initConstraints(pTable);
     }
 
@@ -48,6 +48,7 @@
 
 #include "table.h"
 #include "common/tabletuple.h"
+#include "storage/ResultTableStream.h"
 
 namespace voltdb {
 
@@ -97,6 +98,17 @@ class TempTable : public Table {
         void insertTupleNonVirtual(TableTuple &source);
         void updateTupleNonVirtual(TableTuple &source, TableTuple &target);
 
+        /**
+         * While a stream is set, inserted tuples are serialized into the
+         * result buffer instead of being stored, until the stream spills.
+         */
+        void setResultStream(ResultTableStream *stream) { m_resultStream = stream; }
+
+        /** Tuples inserted so far that went to the stream instead of the table. */
+        int64_t streamedTupleCount() const {
+            return m_resultStream != NULL ? m_resultStream->streamedCount() : 0;
+        }
+
         // ------------------------------------------------------------------
         // INDEXES
         // ------------------------------------------------------------------
@@ -117,6 +129,9 @@ class TempTable : public Table {
         size_t allocatedBlockCount() const {
             return m_data.size();
         }
+
+    private:
+        ResultTableStream *m_resultStream;
 };
 
 inline void TempTable::insertTupleNonVirtualWithDeepCopy(TableTuple &source, Pool *pool) {
@@ -137,6 +152,9 @@ inline void TempTable::insertTupleNonVirtualWithDeepCopy(TableTuple &source, Poo
 }
 
 inline void TempTable::insertTupleNonVirtual(TableTuple &source) {
+    if (m_resultStream != NULL && m_resultStream->append(source)) {
+        return;
+    }
     //
     // First get the next free tuple
     // This will either give us one from the free slot list, or
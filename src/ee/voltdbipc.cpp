@@ -30,6 +30,7 @@
 #include "common/FatalException.hpp"
 #include "common/SegvException.hpp"
 #include "common/RecoveryProtoMessage.h"
+#include "common/SharedMemoryChannel.h"
 #include "common/TheHashinator.h"
 #include "execution/IPCTopend.h"
 #include "execution/VoltDBEngine.h"
@@ -206,7 +207,7 @@ using namespace voltdb;
 // file static help function to do a blocking write.
 // exit on a -1.. otherwise return when all bytes
 // written.
-static void writeOrDie(int fd, unsigned char *data, ssize_t sz) {
+static void writeSocketOrDie(int fd, unsigned char *data, ssize_t sz) {
     ssize_t written = 0;
     ssize_t last = 0;
     if (sz == 0) {
@@ -232,7 +233,17 @@ static VoltDBIPC *currentVolt = NULL;
 // defined in voltdbjni.cpp
 extern void deserializeParameterSetCommon(int, voltdb::ReferenceSerializeInput&, voltdb::GenericValueArray<voltdb::NValue>&, Pool *stringPool);
 
-VoltDBIPC::VoltDBIPC(int fd) : m_fd(fd) {
+VoltDBIPC::VoltDBIPC(int fd) : m_fd(fd), m_channel(NULL) {
+    currentVolt = this;
+    m_engine = NULL;
+    m_counter = 0;
+    m_reusedResultBuffer = NULL;
+    m_terminate = false;
+
+    setupSigHandler();
+}
+
+VoltDBIPC::VoltDBIPC(SharedMemoryChannel *channel) : m_fd(-1), m_channel(channel) {
     currentVolt = this;
     m_engine = NULL;
     m_counter = 0;
@@ -246,6 +257,36 @@ VoltDBIPC::~VoltDBIPC() {
     delete m_engine;
     delete [] m_reusedResultBuffer;
     delete [] m_exceptionBuffer;
+    delete m_channel;
+}
+
+/*
+ * Blocking read of exactly sz bytes from Java over whichever transport
+ * was selected at startup.
+ */
+bool VoltDBIPC::readFully(void *data, size_t sz) {
+    if (m_channel != NULL) {
+        return m_channel->read(data, sz);
+    }
+    size_t bytesread = 0;
+    while (bytesread < sz) {
+        ssize_t b = read(m_fd, static_cast<char*>(data) + bytesread, sz - bytesread);
+        if (b <= 0) {
+            return false;
+        }
+        bytesread += b;
+    }
+    return true;
+}
+
+void VoltDBIPC::writeOrDie(unsigned char *data, ssize_t sz) {
+    if (m_channel == NULL) {
+        writeSocketOrDie(m_fd, data, sz);
+    } else if (!m_channel->write(data, sz)) {
+        printf("\n\nIPC write to closed shared memory channel. Exiting\n\n");
+        fflush(stdout);
+        exit(-1);
+    }
 }
 
 bool VoltDBIPC::execute(struct ipc_command *cmd) {
@@ -339,9 +380,9 @@ bool VoltDBIPC::execute(struct ipc_command *cmd) {
             char msg[5];
             msg[0] = result;
             *reinterpret_cast<int32_t*>(&msg[1]) = 0;//exception length 0
-            writeOrDie(m_fd, (unsigned char*)msg, sizeof(int8_t) + sizeof(int32_t));
+            writeOrDie((unsigned char*)msg, sizeof(int8_t) + sizeof(int32_t));
         } else {
-            writeOrDie(m_fd, (unsigned char*)&result, sizeof(int8_t));
+            writeOrDie((unsigned char*)&result, sizeof(int8_t));
         }
     }
     return m_terminate;
@@ -445,10 +486,7 @@ int8_t VoltDBIPC::toggleProfiler(struct ipc_command *cmd) {
     }__attribute__((packed));
     struct toggle * cs = (struct toggle*) cmd;
 
-    printf("toggleProfiler: toggle=%d\n", ntohl(cs->toggle));
-
-    // actually, the engine doesn't implement this now.
-    // m_engine->ProfilerStart();
+    m_engine->setProfilingEnabled(ntohl(cs->toggle) != 0);
     return kErrorCode_Success;
 }
 
@@ -578,7 +616,7 @@ void VoltDBIPC::executeQueryPlanFragmentsAndGetResults(struct ipc_command *cmd)
         const int32_t size = m_engine->getResultsSize();
         char *resultBuffer = m_engine->getReusedResultBuffer();
         resultBuffer[0] = kErrorCode_Success;
-        writeOrDie(m_fd, (unsigned char*)resultBuffer, size);
+        writeOrDie((unsigned char*)resultBuffer, size);
     } else {
         sendException(kErrorCode_Error);
     }
@@ -634,14 +672,14 @@ void VoltDBIPC::executePlanFragmentAndGetResults(struct ipc_command *cmd) {
         const int32_t size = m_engine->getResultsSize();
         char *resultBuffer = m_engine->getReusedResultBuffer();
         resultBuffer[0] = kErrorCode_Success;
-        writeOrDie(m_fd, (unsigned char*)resultBuffer, size);
+        writeOrDie((unsigned char*)resultBuffer, size);
     } else {
         sendException(kErrorCode_Error);
     }
 }
 
 void VoltDBIPC::sendException(int8_t errorCode) {
-    writeOrDie(m_fd, (unsigned char*)&errorCode, sizeof(int8_t));
+    writeOrDie((unsigned char*)&errorCode, sizeof(int8_t));
 
     const void* exceptionData =
       m_engine->getExceptionOutputSerializer()->data();
@@ -651,7 +689,7 @@ void VoltDBIPC::sendException(int8_t errorCode) {
     fflush(stdout);
 
     const std::size_t expectedSize = exceptionLength + sizeof(int32_t);
-    writeOrDie(m_fd, (unsigned char*)exceptionData, expectedSize);
+    writeOrDie((unsigned char*)exceptionData, expectedSize);
 }
 
 void VoltDBIPC::executeCustomPlanFragmentAndGetResults(struct ipc_command *cmd) {
@@ -682,11 +720,11 @@ void VoltDBIPC::executeCustomPlanFragmentAndGetResults(struct ipc_command *cmd)
     // write the results array back across the wire
     const int8_t successResult = kErrorCode_Success;
     if (errors == 0) {
-        writeOrDie(m_fd, (unsigned char*)&successResult, sizeof(int8_t));
+        writeOrDie((unsigned char*)&successResult, sizeof(int8_t));
         const int32_t size = m_engine->getResultsSize();
 
         // write the dependency tables back across the wire
-        writeOrDie(m_fd, (unsigned char*)(m_engine->getReusedResultBuffer()), size);
+        writeOrDie((unsigned char*)(m_engine->getReusedResultBuffer()), size);
     } else {
         sendException(kErrorCode_Error);
     }
@@ -754,14 +792,12 @@ char *VoltDBIPC::retrieveDependency(int32_t dependencyId, size_t *dependencySz)
     // tell java to send the dependency over the socket
     message[0] = static_cast<int8_t>(kErrorCode_RetrieveDependency);
     *reinterpret_cast<int32_t*>(&message[1]) = htonl(dependencyId);
-    writeOrDie(m_fd, (unsigned char*)message, sizeof(int8_t) + sizeof(int32_t));
+    writeOrDie((unsigned char*)message, sizeof(int8_t) + sizeof(int32_t));
 
     // read java's response code
     int8_t responseCode;
-    ssize_t bytes = read(m_fd, &responseCode, sizeof(int8_t));
-    if (bytes != sizeof(int8_t)) {
-        printf("Error - blocking read failed. %jd read %jd attempted",
-                (intmax_t)bytes, (intmax_t)sizeof(int8_t));
+    if (!readFully(&responseCode, sizeof(int8_t))) {
+        printf("Error - blocking read of dependency response code failed");
         fflush(stdout);
         assert(false);
         exit(-1);
@@ -780,34 +816,19 @@ char *VoltDBIPC::retrieveDependency(int32_t dependencyId, size_t *dependencySz)
 
     // start reading the dependency. its length is first
     int32_t dependencyLength;
-    bytes = read(m_fd, &dependencyLength, sizeof(int32_t));
-    if (bytes != sizeof(int32_t)) {
-        printf("Error - blocking read failed. %jd read %jd attempted",
-                (intmax_t)bytes, (intmax_t)sizeof(int32_t));
+    if (!readFully(&dependencyLength, sizeof(int32_t))) {
+        printf("Error - blocking read of dependency length failed");
         fflush(stdout);
         assert(false);
         exit(-1);
     }
 
-    bytes = 0;
     dependencyLength = ntohl(dependencyLength);
     *dependencySz = (size_t)dependencyLength;
     char *dependencyData = new char[dependencyLength];
-    while (bytes != dependencyLength) {
-        ssize_t oldBytes = bytes;
-        bytes += read(m_fd, dependencyData + bytes, dependencyLength - bytes);
-        if (oldBytes == bytes) {
-            break;
-        }
-        if (oldBytes > bytes) {
-            bytes++;
-            break;
-        }
-    }
-
-    if (bytes != dependencyLength) {
-        printf("Error - blocking read failed. %jd read %jd attempted",
-                (intmax_t)bytes, (intmax_t)dependencyLength);
+    if (!readFully(dependencyData, dependencyLength)) {
+        printf("Error - blocking read of %jd byte dependency failed",
+                (intmax_t)dependencyLength);
         fflush(stdout);
         assert(false);
         exit(-1);
@@ -871,7 +892,7 @@ void VoltDBIPC::crashVoltDB(voltdb::FatalException e) {
         position += traceLength;
     }
 
-    writeOrDie(m_fd,  (unsigned char*)m_reusedResultBuffer, 5 + messageLength);
+    writeOrDie((unsigned char*)m_reusedResultBuffer, 5 + messageLength);
     exit(-1);
 }
 
@@ -905,12 +926,12 @@ void VoltDBIPC::getStats(struct ipc_command *cmd) {
         // write the results array back across the wire
         const int8_t successResult = kErrorCode_Success;
         if (result == 1) {
-            writeOrDie(m_fd, (unsigned char*)&successResult, sizeof(int8_t));
+            writeOrDie((unsigned char*)&successResult, sizeof(int8_t));
 
             // write the dependency tables back across the wire
             // the result set includes the total serialization size
             const int32_t size = m_engine->getResultsSize();
-            writeOrDie(m_fd, (unsigned char*)(m_engine->getReusedResultBuffer()), size);
+            writeOrDie((unsigned char*)(m_engine->getReusedResultBuffer()), size);
         } else {
             sendException(kErrorCode_Error);
         }
@@ -948,7 +969,7 @@ void VoltDBIPC::tableStreamSerializeMore(struct ipc_command *cmd) {
         char msg[3];
         msg[0] = kErrorCode_Error;
         *reinterpret_cast<int16_t*>(&msg[1]) = 0;//exception length 0
-        writeOrDie(m_fd, (unsigned char*)msg, sizeof(int8_t) + sizeof(int16_t));
+        writeOrDie((unsigned char*)msg, sizeof(int8_t) + sizeof(int16_t));
     }
 
     try {
@@ -965,7 +986,7 @@ void VoltDBIPC::tableStreamSerializeMore(struct ipc_command *cmd) {
             serialized = 0;
         }
         const ssize_t toWrite = serialized + 5;
-        writeOrDie(m_fd, (unsigned char*)m_reusedResultBuffer, toWrite);
+        writeOrDie((unsigned char*)m_reusedResultBuffer, toWrite);
     } catch (FatalException e) {
         crashVoltDB(e);
     }
@@ -987,7 +1008,7 @@ void VoltDBIPC::tableHashCode( struct ipc_command *cmd) {
     char response[9];
     response[0] = kErrorCode_Success;
     *reinterpret_cast<int64_t*>(&response[1]) = htonll(tableHashCode);
-    writeOrDie(m_fd, (unsigned char*)response, 9);
+    writeOrDie((unsigned char*)response, 9);
 }
 
 void VoltDBIPC::exportAction(struct ipc_command *cmd) {
@@ -1005,10 +1026,10 @@ void VoltDBIPC::exportAction(struct ipc_command *cmd) {
 
     // write offset across bigendian.
     result = htonll(result);
-    writeOrDie(m_fd, (unsigned char*)&result, sizeof(result));
+    writeOrDie((unsigned char*)&result, sizeof(result));
 
     // write the poll data. It is at least 4 bytes of length prefix.
-    writeOrDie(m_fd, (unsigned char*)(m_engine->getReusedResultBuffer()), buflength);
+    writeOrDie((unsigned char*)(m_engine->getReusedResultBuffer()), buflength);
 }
 
 void VoltDBIPC::hashinate(struct ipc_command* cmd)
@@ -1037,7 +1058,7 @@ void VoltDBIPC::hashinate(struct ipc_command* cmd)
     char response[5];
     response[0] = kErrorCode_Success;
     *reinterpret_cast<int32_t*>(&response[1]) = htonl(retval);
-    writeOrDie(m_fd, (unsigned char*)response, 5);
+    writeOrDie((unsigned char*)response, 5);
 }
 
 void VoltDBIPC::signalHandler(int signum, siginfo_t *info, void *context) {
@@ -1066,22 +1087,13 @@ void VoltDBIPC::setupSigHandler(void) const {
 #endif
 }
 
-int main(int argc, char **argv) {
-    const int pid = getpid();
-    printf("==%d==\n", pid);
-    fflush(stdout);
-    int sock = -1;
+/*
+ * Listen on an ephemeral port, print it for Java and accept its connection.
+ */
+static int acceptJavaConnection(int *sock) {
     int fd = -1;
-    /* max message size that can be read from java */
-    int max_ipc_message_size = (1024 * 1024 * 2);
-
     int port = 0;
 
-    if (argc == 2) {
-        printf("Binding to a specific socket is no longer supported\n");
-        exit(-1);
-    }
-
     struct sockaddr_in address;
     address.sin_family = AF_INET;
     address.sin_port = htons(port);
@@ -1091,18 +1103,18 @@ int main(int argc, char **argv) {
     // read args which presumably configure VoltDBIPC
 
     // and set up an accept socket.
-    if ((sock = socket(AF_INET,SOCK_STREAM, 0)) < 0) {
+    if ((*sock = socket(AF_INET,SOCK_STREAM, 0)) < 0) {
         printf("Failed to create socket.\n");
         exit(-2);
     }
 
-    if ((bind(sock, (struct sockaddr*) (&address), sizeof(struct sockaddr_in))) != 0) {
+    if ((bind(*sock, (struct sockaddr*) (&address), sizeof(struct sockaddr_in))) != 0) {
         printf("Failed to bind socket.\n");
         exit(-3);
     }
 
     socklen_t address_len = sizeof(struct sockaddr_in);
-    if (getsockname( sock, reinterpret_cast<sockaddr*>(&address), &address_len)) {
+    if (getsockname( *sock, reinterpret_cast<sockaddr*>(&address), &address_len)) {
         printf("Failed to find socket address\n");
         exit(-4);
     }
@@ -1111,7 +1123,7 @@ int main(int argc, char **argv) {
     printf("==%d==\n", port);
     fflush(stdout);
 
-    if ((listen(sock, 1)) != 0) {
+    if ((listen(*sock, 1)) != 0) {
         printf("Failed to listen on socket.\n");
         exit(-5);
     }
@@ -1120,7 +1132,7 @@ int main(int argc, char **argv) {
 
     struct sockaddr_in client_addr;
     socklen_t addr_size = sizeof(struct sockaddr_in);
-    fd = accept(sock, (struct sockaddr*) (&client_addr), &addr_size);
+    fd = accept(*sock, (struct sockaddr*) (&client_addr), &addr_size);
     if (fd < 0) {
         printf("Failed to accept socket.\n");
         exit(-6);
@@ -1132,29 +1144,50 @@ int main(int argc, char **argv) {
       printf("Couldn't setsockopt(TCP_NODELAY)\n");
       exit( EXIT_FAILURE );
     }
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    const int pid = getpid();
+    printf("==%d==\n", pid);
+    fflush(stdout);
+    int sock = -1;
+    int fd = -1;
+    /* max message size that can be read from java */
+    int max_ipc_message_size = (1024 * 1024 * 2);
+
+    // instantiate voltdbipc to interface to EE.
+    VoltDBIPC *voltipc = NULL;
+    if (argc == 3 && strcmp(argv[1], "--shm") == 0) {
+        // the client created the channel before starting us
+        try {
+            voltipc = new VoltDBIPC(SharedMemoryChannel::open(argv[2]));
+        } catch (FatalException &e) {
+            printf("%s\n", e.m_reason.c_str());
+            exit(-7);
+        }
+        printf("listening\n");
+        fflush(stdout);
+    } else {
+        if (argc == 2) {
+            printf("Binding to a specific socket is no longer supported\n");
+            exit(-1);
+        }
+        fd = acceptJavaConnection(&sock);
+        voltipc = new VoltDBIPC(fd);
+    }
 
     // requests larger than this will cause havoc.
     // cry havoc and let loose the dogs of war
     char* data = (char*) malloc(max_ipc_message_size);
     memset(data, 0, max_ipc_message_size);
 
-    // instantiate voltdbipc to interface to EE.
-    VoltDBIPC *voltipc = new VoltDBIPC(fd);
     int more = 1;
     while (more) {
-        size_t bytesread = 0;
-
         // read the header
-        while (bytesread < 4) {
-            std::size_t b = read(fd, data + bytesread, 4 - bytesread);
-            if (b == 0) {
-                printf("client eof\n");
-                goto done;
-            } else if (b == -1) {
-                printf("client error\n");
-                goto done;
-            }
-            bytesread += b;
+        if (!voltipc->readFully(data, 4)) {
+            printf("client eof\n");
+            goto done;
         }
 
         // read the message body in to the same data buffer
@@ -1169,17 +1202,11 @@ int main(int argc, char **argv) {
             data = newdata;
         }
 
-        while (bytesread < msg_size) {
-            std::size_t b = read(fd, data + bytesread, msg_size - bytesread);
-            if (b == 0) {
-                printf("client eof\n");
-                goto done;
-            } else if (b == -1) {
-                printf("client error\n");
-                goto done;
-            }
-            bytesread += b;
+        if (msg_size > 4 && !voltipc->readFully(data + 4, msg_size - 4)) {
+            printf("client eof\n");
+            goto done;
         }
+        size_t bytesread = msg_size < 4 ? 4 : msg_size;
 
         // dispatch the request
         struct ipc_command *cmd = (struct ipc_command*) data;
@@ -26,6 +26,10 @@
 #include "execution/VoltDBEngine.h"
 #include "common/FatalException.hpp"
 
+namespace voltdb {
+class SharedMemoryChannel;
+}
+
 class VoltDBIPC {
 public:
 
@@ -46,8 +50,20 @@ public:
 
     VoltDBIPC(int fd);
 
+    /**
+     * Talk to Java over a shared memory channel instead of a socket.
+     * Takes ownership of the channel.
+     */
+    VoltDBIPC(voltdb::SharedMemoryChannel *channel);
+
     ~VoltDBIPC();
 
+    /**
+     * Blocking read of sz bytes from Java. Returns false if the
+     * connection was closed or failed.
+     */
+    bool readFully(void *data, size_t sz);
+
     /**
      * Retrieve a dependency from Java via the IPC connection.
      * This method returns null if there are no more dependency tables. Otherwise
@@ -121,6 +137,12 @@ private:
 
     void sendException( int8_t errorCode);
 
+    /**
+     * Blocking write of sz bytes to Java. Exits the process if the
+     * connection is gone.
+     */
+    void writeOrDie(unsigned char *data, ssize_t sz);
+
     int8_t activateTableStream(struct ipc_command *cmd);
     void  tableStreamSerializeMore(struct ipc_command *cmd);
     void  exportAction(struct ipc_command *cmd);
@@ -130,6 +152,7 @@ private:
     void setupSigHandler(void) const;
 
     int m_fd;
+    voltdb::SharedMemoryChannel *m_channel;
     char *m_reusedResultBuffer;
     char *m_exceptionBuffer;
     bool m_terminate;
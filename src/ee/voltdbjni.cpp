@@ -104,11 +104,12 @@
 #include "common/FatalException.hpp"
 #include "common/SegvException.hpp"
 #include "common/RecoveryProtoMessage.h"
+#include "storage/TupleBlockFormat.h"
 #include "execution/VoltDBEngine.h"
 #include "execution/JNITopend.h"
 #include "json_spirit/json_spirit.h"
 #include "boost/pool/pool.hpp"
-#include "boost/crc.hpp"
+#include "common/Checksum.h"
 #include "logging/JNILogProxy.h"
 
 #include "logging/LogDefs.h"
@@ -812,9 +813,54 @@ SHAREDLIB_JNIEXPORT jint JNICALL Java_org_voltdb_utils_DBBPool_getBufferCRC32
         return -1;
     }
     assert(address);
-    boost::crc_32_type crc;
-    crc.process_bytes(address + offset, length);
-    return static_cast<jint>(crc.checksum());
+    return static_cast<jint>(Checksum::crc32(0, address + offset, length));
+}
+
+/*
+ * Class:     org_voltdb_utils_DBBPool
+ * Method:    getBufferCRC32C
+ * Signature: (Ljava/nio/ByteBuffer;II)I
+ */
+SHAREDLIB_JNIEXPORT jint JNICALL Java_org_voltdb_utils_DBBPool_getBufferCRC32C
+  (JNIEnv *env, jclass clazz, jobject buffer, jint offset, jint length) {
+    char *address = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        return -1;
+    }
+    assert(address);
+    return static_cast<jint>(Checksum::crc32c(0, address + offset, length));
+}
+
+/*
+ * Class:     org_voltdb_utils_DBBPool
+ * Method:    expandTupleBlocks
+ * Signature: (Ljava/nio/ByteBuffer;IILjava/nio/ByteBuffer;II)I
+ *
+ * Re-encode a block copy table body (see TupleBlockFormat) as serialized
+ * rows. Returns the number of bytes written or -1 if the blocks are malformed
+ * or the rows don't fit.
+ */
+SHAREDLIB_JNIEXPORT jint JNICALL Java_org_voltdb_utils_DBBPool_expandTupleBlocks
+  (JNIEnv *env, jclass clazz, jobject source, jint sourceOffset, jint sourceLength,
+   jobject destination, jint destinationOffset, jint destinationLength) {
+    char *sourceAddress = reinterpret_cast<char*>(env->GetDirectBufferAddress(source));
+    char *destinationAddress = reinterpret_cast<char*>(env->GetDirectBufferAddress(destination));
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        return -1;
+    }
+    assert(sourceAddress);
+    assert(destinationAddress);
+    try {
+        ReferenceSerializeInput in(sourceAddress + sourceOffset, sourceLength);
+        ReferenceSerializeOutput out(destinationAddress + destinationOffset, destinationLength);
+        TupleBlockReader reader(in);
+        reader.expandTo(out);
+        return static_cast<jint>(out.position());
+    } catch (SerializableEEException &e) {
+        return -1;
+    }
 }
 
 /*
@@ -940,14 +986,7 @@ SHAREDLIB_JNIEXPORT jint JNICALL Java_org_voltdb_jni_ExecutionEngine_nativeToggl
     VoltDBEngine *engine = castToEngine(engine_ptr);
     updateJNILogProxy(engine); //JNIEnv pointer can change between calls, must be updated
     if (engine) {
-//        if (toggle) {
-//            ProfilerStart("/tmp/gprof.prof");
-//            ProfilerDisable();
-//        }
-//        else {
-//            ProfilerStop();
-//            ProfilerFlush();
-//        }
+        engine->setProfilingEnabled(toggle != 0);
         return org_voltdb_jni_ExecutionEngine_ERRORCODE_SUCCESS;
 
     }
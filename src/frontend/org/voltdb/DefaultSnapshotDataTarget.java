@@ -38,6 +38,7 @@ import java.util.zip.CRC32;
 import org.apache.log4j.Logger;
 import org.voltdb.client.ConnectionUtil;
 import org.voltdb.messaging.FastSerializer;
+import org.voltdb.sysprocs.saverestore.TableSaveFile;
 import org.voltdb.utils.DBBPool;
 import org.voltdb.utils.DBBPool.BBContainer;
 
@@ -164,6 +165,7 @@ public class DefaultSnapshotDataTarget implements SnapshotDataTarget {
             fs.writeArray(partitionIds);
             fs.writeInt(numPartitions);
         }
+        fs.writeByte(TableSaveFile.CHECKSUM_TYPE_CRC32C);
         final BBContainer container = fs.getBBContainer();
         container.b.position(4);
         container.b.putInt(container.b.remaining() - 4);
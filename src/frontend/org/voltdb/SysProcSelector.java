@@ -37,4 +37,5 @@ public enum SysProcSelector {
     ANTICACHE,      // anti-cache manager information
     ANTICACHEEVICTIONS, // anti-cache eviction history
     ANTICACHEACCESS, // anti-cache evicted access history
+    PLANFRAGMENTPROFILER, // EE per-plan-node fragment profiler information
 }
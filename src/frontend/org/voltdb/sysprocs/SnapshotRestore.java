@@ -842,6 +842,18 @@ public class SnapshotRestore extends VoltSystemProcedure {
         }
 
         try {
+            /*
+             * Without a schema change the chunks can go to the EE as they
+             * are, including ones holding block copied tuples.
+             */
+            final Table new_catalog_table = getCatalogTable(tableName);
+            final ByteBuffer tableHeader = savefile.getTableHeader().duplicate();
+            tableHeader.position(0);
+            final ByteBuffer emptyTable = ByteBuffer.allocate(tableHeader.remaining() + 4);
+            emptyTable.put(tableHeader).putInt(0).flip();
+            final boolean needsConversion = SavedTableConverter.needsConversion(
+                    PrivateVoltTableFactory.createVoltTableFromBuffer(emptyTable, true), new_catalog_table);
+            savefile.setKeepTupleBlocks(!needsConversion);
 
             while (savefile.hasMoreChunks()) {
                 VoltTable table = null;
@@ -849,9 +861,15 @@ public class SnapshotRestore extends VoltSystemProcedure {
                 if (c == null) {
                     continue; // Should be equivalent to break
                 }
-                VoltTable old_table = PrivateVoltTableFactory.createVoltTableFromBuffer(c.b, true);
-                Table new_catalog_table = getCatalogTable(tableName);
-                table = SavedTableConverter.convertTable(old_table, new_catalog_table);
+                if (needsConversion) {
+                    VoltTable old_table = PrivateVoltTableFactory.createVoltTableFromBuffer(c.b, true);
+                    table = SavedTableConverter.convertTable(old_table, new_catalog_table);
+                } else {
+                    ByteBuffer copy = ByteBuffer.allocate(c.b.remaining());
+                    copy.put(c.b);
+                    copy.flip();
+                    table = PrivateVoltTableFactory.createVoltTableFromBuffer(copy, true);
+                }
                 c.discard();
                 try {
                     LOG.trace("LoadTable " + tableName);
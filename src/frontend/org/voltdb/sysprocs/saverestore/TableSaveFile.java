@@ -76,6 +76,20 @@ public class TableSaveFile {
      */
     private static final int DEFAULT_CHUNKSIZE = org.voltdb.SnapshotSiteProcessor.m_snapshotBufferLength + (1024 * 256);
 
+    /**
+     * Checksum used for chunk data, stored as the last byte of the save
+     * restore header. Files written before the field existed have no
+     * byte there and use CRC32. Must match ChecksumType in the EE.
+     */
+    public static final byte CHECKSUM_TYPE_CRC32 = 0;
+    public static final byte CHECKSUM_TYPE_CRC32C = 1;
+
+    /**
+     * Value in place of the first row length when a chunk holds raw tuple
+     * blocks instead of rows. Must match TupleBlockFormat::MARKER in the EE.
+     */
+    public static final int TUPLE_BLOCK_MARKER = -1;
+
     public TableSaveFile(FileChannel dataIn, int readAheadChunks, int relevantPartitionIds[]) throws IOException {
         this(dataIn, readAheadChunks, relevantPartitionIds, false);
     }
@@ -226,6 +240,14 @@ public class TableSaveFile {
                     m_corruptedPartitions.add(0);
                 }
             }
+            if (saveRestoreHeader.hasRemaining()) {
+                m_checksumType = fd.readByte();
+                if (m_checksumType != CHECKSUM_TYPE_CRC32 && m_checksumType != CHECKSUM_TYPE_CRC32C) {
+                    throw new IOException("Corrupted save file has unknown checksum type " + m_checksumType);
+                }
+            } else {
+                m_checksumType = CHECKSUM_TYPE_CRC32;
+            }
 
             //System.err.println("Tablename :" + m_tableName);
             //System.err.println("Replicated :" + m_isReplicated);
@@ -291,6 +313,10 @@ public class TableSaveFile {
         return m_createTime;
     }
 
+    public byte getChecksumType() {
+        return m_checksumType;
+    }
+
     public FileChannel getFileChannel() {
         return m_saveFile;
     }
@@ -328,6 +354,17 @@ public class TableSaveFile {
         return m_tableHeader;
     }
 
+    /**
+     * By default chunks holding raw tuple blocks are re-encoded as rows so
+     * every chunk is an ordinary VoltTable. Callers that hand the chunks
+     * straight to the EE without looking at the rows can keep the blocks.
+     * Must be called before the first call to getNextChunk.
+     */
+    public synchronized void setKeepTupleBlocks(boolean keepTupleBlocks) {
+        assert(m_chunkReader == null);
+        m_keepTupleBlocks = keepTupleBlocks;
+    }
+
     // Will get the next chunk of the table that is just over the chunk size
     public synchronized BBContainer getNextChunk() throws IOException {
         if (m_chunkReaderException != null) {
@@ -418,6 +455,7 @@ public class TableSaveFile {
     private final int m_partitionIds[];
     private final int m_totalPartitions;
     private final long m_createTime;
+    private final byte m_checksumType;
     private boolean m_hasMoreChunks = true;
     private static ConcurrentLinkedQueue<Container> m_buffers = new ConcurrentLinkedQueue<Container>();
     private final ArrayDeque<Container> m_availableChunks = new ArrayDeque<Container>();
@@ -441,6 +479,8 @@ public class TableSaveFile {
      */
     private final Semaphore m_chunkReads;
 
+    private volatile boolean m_keepTupleBlocks = false;
+
     private ChunkReader m_chunkReader = null;
     private Thread m_chunkReaderThread = null;
     private IOException m_chunkReaderException = null;
@@ -532,13 +572,7 @@ public class TableSaveFile {
                      * overwrite the partition id that is not part of the
                      * serialization format
                      */
-                    Container c = m_buffers.poll();
-                    if (c == null) {
-                        final BBContainer originContainer = DBBPool.allocateDirect(DEFAULT_CHUNKSIZE);
-                        final ByteBuffer b = originContainer.b;
-                        final long pointer = org.voltdb.utils.DBBPool.getBufferAddress(b);
-                        c = new Container(b, pointer, originContainer);
-                    }
+                    Container c = getContainer();
 
                     /*
                      * If the length value is wrong or not all data made it to
@@ -591,7 +625,9 @@ public class TableSaveFile {
                      * Validate the rest of the chunk. This can fail if the data
                      * is corrupted or the length value was corrupted.
                      */
-                    final int calculatedCRC = DBBPool.getBufferCRC32(c.b, c.b.position(), c.b.remaining());
+                    final int calculatedCRC = m_checksumType == CHECKSUM_TYPE_CRC32C ?
+                            DBBPool.getBufferCRC32C(c.b, c.b.position(), c.b.remaining()) :
+                            DBBPool.getBufferCRC32(c.b, c.b.position(), c.b.remaining());
                     if (calculatedCRC != nextChunkCRC) {
                         m_corruptedPartitions.add(nextChunkPartitionId);
                         if (m_continueOnCorruptedChunk) {
@@ -638,6 +674,16 @@ public class TableSaveFile {
                             }
                         }
                     }
+
+                    /*
+                     * Chunks of tables without uninlined columns hold raw tuple
+                     * storage rather than rows when written by the EE's block
+                     * copy path.
+                     */
+                    if (!m_keepTupleBlocks && rowCount > 0 &&
+                            c.b.getInt(checksumStartPosition) == TUPLE_BLOCK_MARKER) {
+                        c = expandTupleBlocks(c, checksumStartPosition);
+                    }
                     ++chunksRead;
 
                     synchronized (TableSaveFile.this) {
@@ -680,6 +726,47 @@ public class TableSaveFile {
             }
         }
 
+        private Container getContainer() {
+            Container c = m_buffers.poll();
+            if (c == null) {
+                final BBContainer originContainer = DBBPool.allocateDirect(DEFAULT_CHUNKSIZE);
+                final ByteBuffer b = originContainer.b;
+                final long pointer = org.voltdb.utils.DBBPool.getBufferAddress(b);
+                c = new Container(b, pointer, originContainer);
+            }
+            return c;
+        }
+
+        /**
+         * Re-encode the tuple blocks in a chunk as rows in a new chunk
+         * with the same table header and row count. Discards the block chunk.
+         */
+        private Container expandTupleBlocks(Container blocks, int bodyStart) throws IOException {
+            final Container rows = getContainer();
+            boolean success = false;
+            try {
+                rows.b.clear();
+                m_tableHeader.position(0);
+                rows.b.put(m_tableHeader);
+                rows.b.putInt(blocks.b.getInt(bodyStart - 4));
+                final int written = DBBPool.expandTupleBlocks(
+                        blocks.b, bodyStart, blocks.b.limit() - bodyStart,
+                        rows.b, rows.b.position(), rows.b.remaining());
+                if (written < 0) {
+                    throw new IOException("Unable to expand tuple blocks in saved table chunk");
+                }
+                rows.b.limit(rows.b.position() + written);
+                rows.b.position(0);
+                success = true;
+            } finally {
+                blocks.discard();
+                if (!success) {
+                    rows.discard();
+                }
+            }
+            return rows;
+        }
+
         @Override
         public void run() {
             try {
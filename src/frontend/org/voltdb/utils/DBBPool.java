@@ -485,6 +485,30 @@ public final class DBBPool {
      */
     public static native int getBufferCRC32( ByteBuffer b, int offset, int length);
 
+    /**
+     * Retrieve the CRC32C value of a DirectByteBuffer. Uses the SSE4.2
+     * crc32 instruction when the CPU supports it.
+     * @param b Buffer you want to retrieve the CRC32C of
+     * @param offset Offset into buffer to start calculations
+     * @param length Length of the buffer to calculate
+     * @return CRC32C of the buffer as an int.
+     */
+    public static native int getBufferCRC32C( ByteBuffer b, int offset, int length);
+
+    /**
+     * Re-encode a block copied snapshot chunk body (raw tuple storage, see
+     * TupleBlockFormat in the EE) as serialized VoltTable rows.
+     * @param src Direct buffer holding the block copy body
+     * @param srcOffset Offset of the body in src
+     * @param srcLength Length of the body
+     * @param dst Direct buffer to write the rows to
+     * @param dstOffset Offset in dst to start writing at
+     * @param dstLength Space available in dst
+     * @return Number of bytes written or -1 if the body is malformed or doesn't fit
+     */
+    public static native int expandTupleBlocks( ByteBuffer src, int srcOffset, int srcLength,
+                                                ByteBuffer dst, int dstOffset, int dstLength);
+
     /**
      * Static factory method to wrap a ByteBuffer in a BBContainer that is not
      * associated with any pool
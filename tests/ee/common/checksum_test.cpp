@@ -0,0 +1,88 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2010 VoltDB Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "harness.h"
+#include "common/Checksum.h"
+#include <boost/crc.hpp>
+#include <cstdlib>
+#include <vector>
+
+using namespace voltdb;
+
+typedef boost::crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true> BoostCRC32C;
+
+class ChecksumTest : public Test {
+public:
+    ChecksumTest() : m_data(4096) {
+        srand(42);
+        for (size_t ii = 0; ii < m_data.size(); ii++) {
+            m_data[ii] = static_cast<char>(rand());
+        }
+    }
+protected:
+    std::vector<char> m_data;
+};
+
+TEST_F(ChecksumTest, KnownValues) {
+    EXPECT_EQ(0xCBF43926, Checksum::crc32(0, "123456789", 9));
+    EXPECT_EQ(0xE3069283, Checksum::crc32c(0, "123456789", 9));
+    EXPECT_EQ(0, Checksum::crc32(0, "", 0));
+    EXPECT_EQ(0, Checksum::crc32c(0, "", 0));
+}
+
+/*
+ * Every length and alignment around the 8 byte stride must match the
+ * byte-at-a-time boost implementations the old code used.
+ */
+TEST_F(ChecksumTest, MatchesBoost) {
+    for (int offset = 0; offset < 8; offset++) {
+        for (int length = 0; length < 200; length++) {
+            boost::crc_32_type crc;
+            crc.process_bytes(&m_data[offset], length);
+            EXPECT_EQ(crc.checksum(), Checksum::crc32(0, &m_data[offset], length));
+
+            BoostCRC32C crcc;
+            crcc.process_bytes(&m_data[offset], length);
+            EXPECT_EQ(crcc.checksum(), Checksum::crc32c(0, &m_data[offset], length));
+        }
+    }
+    BoostCRC32C crcc;
+    crcc.process_bytes(&m_data[0], m_data.size());
+    EXPECT_EQ(crcc.checksum(), Checksum::crc32c(0, &m_data[0], m_data.size()));
+}
+
+TEST_F(ChecksumTest, Accumulator) {
+    for (int type = CHECKSUM_TYPE_CRC32; type <= CHECKSUM_TYPE_CRC32C; type++) {
+        ChecksumAccumulator crc(static_cast<ChecksumType>(type));
+        crc.process_bytes(&m_data[0], 13);
+        crc.process_block(&m_data[13], &m_data[1000]);
+        crc.process_bytes(&m_data[1000], m_data.size() - 1000);
+        EXPECT_EQ(Checksum::compute(static_cast<ChecksumType>(type), 0, &m_data[0], m_data.size()),
+                  crc.checksum());
+    }
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,132 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2010 VoltDB Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "harness.h"
+#include "common/Compression.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace voltdb;
+
+class CompressionTest : public Test {
+public:
+    CompressionTest() : m_compressed(1 << 20), m_expanded(1 << 20) {
+        srand(42);
+    }
+
+    /*
+     * Compress into a roomy buffer and check the block expands back to
+     * the input. Returns the compressed length.
+     */
+    size_t roundTrip(const std::vector<char> &data) {
+        const char *bytes = data.empty() ? "" : &data[0];
+        const size_t length = Compression::compress(bytes, data.size(),
+                                                    &m_compressed[0], m_compressed.size());
+        EXPECT_TRUE(length > 0);
+        EXPECT_TRUE(Compression::decompress(&m_compressed[0], length,
+                                            &m_expanded[0], data.size()));
+        EXPECT_EQ(0, ::memcmp(bytes, &m_expanded[0], data.size()));
+        return length;
+    }
+
+protected:
+    std::vector<char> m_compressed;
+    std::vector<char> m_expanded;
+};
+
+TEST_F(CompressionTest, Empty) {
+    std::vector<char> data;
+    EXPECT_EQ(1, roundTrip(data));
+}
+
+TEST_F(CompressionTest, ShortInputs) {
+    for (int length = 1; length < 40; length++) {
+        std::vector<char> data(length);
+        for (int ii = 0; ii < length; ii++) {
+            data[ii] = static_cast<char>(ii % 3);
+        }
+        roundTrip(data);
+    }
+}
+
+/*
+ * A single repeated byte is encoded as overlapping back references
+ * with long length continuations.
+ */
+TEST_F(CompressionTest, Run) {
+    std::vector<char> data(100000, 'x');
+    EXPECT_TRUE(roundTrip(data) < 1000);
+}
+
+/*
+ * Rows that differ only in a few bytes, the shape of serialized tuples.
+ */
+TEST_F(CompressionTest, Rows) {
+    std::vector<char> data;
+    for (int row = 0; row < 10000; row++) {
+        char tuple[32];
+        ::memset(tuple, 0, sizeof(tuple));
+        tuple[3] = 28;
+        ::memcpy(tuple + 4, &row, sizeof(row));
+        tuple[12] = static_cast<char>(rand() % 4);
+        data.insert(data.end(), tuple, tuple + sizeof(tuple));
+    }
+    EXPECT_TRUE(roundTrip(data) < data.size() / 3);
+}
+
+/*
+ * Random bytes don't compress, and a capacity below the input length
+ * reports that rather than overrunning.
+ */
+TEST_F(CompressionTest, Incompressible) {
+    std::vector<char> data(70000);
+    for (size_t ii = 0; ii < data.size(); ii++) {
+        data[ii] = static_cast<char>(rand());
+    }
+    EXPECT_EQ(0, Compression::compress(&data[0], data.size(), &m_compressed[0], data.size() - 1));
+    roundTrip(data);
+}
+
+TEST_F(CompressionTest, Malformed) {
+    std::vector<char> data(5000);
+    for (size_t ii = 0; ii < data.size(); ii++) {
+        data[ii] = static_cast<char>(ii % 17);
+    }
+    const size_t length = roundTrip(data);
+
+    // truncated, wrong expected length
+    EXPECT_FALSE(Compression::decompress(&m_compressed[0], length - 1, &m_expanded[0], data.size()));
+    EXPECT_FALSE(Compression::decompress(&m_compressed[0], length, &m_expanded[0], data.size() - 1));
+    EXPECT_FALSE(Compression::decompress(&m_compressed[0], length, &m_expanded[0], data.size() + 1));
+    EXPECT_FALSE(Compression::decompress(&m_compressed[0], 0, &m_expanded[0], 0));
+
+    // back reference before the start of the output
+    const char bad[] = { 0x10, 'a', 0x02, 0x00 };
+    EXPECT_FALSE(Compression::decompress(bad, sizeof(bad), &m_expanded[0], 8));
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
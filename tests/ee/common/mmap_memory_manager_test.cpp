@@ -0,0 +1,116 @@
+/* Copyright (C) 2013 by H-Store Project
+ * Brown University
+ * Carnegie Mellon University
+ * Massachusetts Institute of Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/MMAPMemoryManager.h"
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace voltdb;
+
+static const size_t EXTENT_SIZE = 1024 * 1024;
+
+class MMAPMemoryManagerTest : public Test {
+public:
+    MMAPMemoryManagerTest() {
+        char dir[] = "/tmp/mmapmanagerXXXXXX";
+        m_fileName = std::string(mkdtemp(dir)) + "/table_Data";
+    }
+
+    ~MMAPMemoryManagerTest() {
+        const std::string file = m_fileName + ".nvm";
+        unlink(file.c_str());
+        rmdir(m_fileName.substr(0, m_fileName.rfind('/')).c_str());
+    }
+
+protected:
+    std::string m_fileName;
+};
+
+/*
+ * Filling the first extent used to throw. The mapping has to grow and
+ * everything handed out before has to stay where it was.
+ */
+TEST_F(MMAPMemoryManagerTest, GrowsInExtents) {
+    MMAPMemoryManager manager(EXTENT_SIZE, m_fileName, true);
+    std::vector<char*> chunks;
+    for (int ii = 0; ii < 20; ii++) {
+        char *chunk = static_cast<char*>(manager.allocate(256 * 1024));
+        ::memset(chunk, ii, 256 * 1024);
+        chunks.push_back(chunk);
+    }
+    EXPECT_TRUE(manager.mappedBytes() >= 20 * 256 * 1024);
+    EXPECT_EQ(20 * 256 * 1024, manager.allocatedBytes());
+    for (int ii = 0; ii < 20; ii++) {
+        EXPECT_EQ(ii, chunks[ii][0]);
+        EXPECT_EQ(ii, chunks[ii][256 * 1024 - 1]);
+    }
+
+    // larger than an extent gets an extent of its own
+    char *big = static_cast<char*>(manager.allocate(3 * EXTENT_SIZE));
+    ::memset(big, 1, 3 * EXTENT_SIZE);
+    manager.sync();
+
+    struct stat st;
+    const std::string file = m_fileName + ".nvm";
+    ASSERT_EQ(0, stat(file.c_str(), &st));
+    EXPECT_EQ(manager.mappedBytes(), static_cast<size_t>(st.st_size));
+}
+
+TEST_F(MMAPMemoryManagerTest, ReusesDeallocatedChunks) {
+    MMAPMemoryManager manager(EXTENT_SIZE, "", false);
+    void *first = manager.allocate(100);
+    void *second = manager.allocate(100);
+    EXPECT_NE(first, second);
+    const size_t mapped = manager.mappedBytes();
+
+    manager.deallocate(first, 100);
+    // same size class
+    EXPECT_EQ(first, manager.allocate(90));
+    // different size class
+    EXPECT_NE(second, manager.allocate(1000));
+
+    for (int ii = 0; ii < 1000; ii++) {
+        void *chunk = manager.allocate(64 * 1024);
+        manager.deallocate(chunk, 64 * 1024);
+    }
+    EXPECT_EQ(mapped, manager.mappedBytes());
+}
+
+TEST_F(MMAPMemoryManagerTest, SizeClasses) {
+    EXPECT_EQ(64, MMAPMemoryManager::sizeClass(1));
+    EXPECT_EQ(64, MMAPMemoryManager::sizeClass(64));
+    EXPECT_EQ(128, MMAPMemoryManager::sizeClass(65));
+    EXPECT_EQ(4096, MMAPMemoryManager::sizeClass(4096));
+    EXPECT_EQ(8192, MMAPMemoryManager::sizeClass(4097));
+    EXPECT_EQ(2097152, MMAPMemoryManager::sizeClass(2097152));
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,188 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2010 VoltDB Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "harness.h"
+#include "common/SharedMemoryChannel.h"
+#include "common/FatalException.hpp"
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace voltdb;
+
+/*
+ * Stand-in for the engine side of voltdbipc: reads framed commands (int32
+ * length including the 8 byte header, int32 command) and answers each with
+ * a one byte status followed by the command body reversed. Exits with 0
+ * when the client closes the channel between commands.
+ */
+static int runEngine(const std::string &path) {
+    SharedMemoryChannel *channel = SharedMemoryChannel::open(path);
+    std::vector<char> data;
+    while (true) {
+        int32_t header[2];
+        if (!channel->read(header, sizeof(header))) {
+            delete channel;
+            return 0;
+        }
+        const int32_t msgSize = ntohl(header[0]);
+        if (msgSize < static_cast<int32_t>(sizeof(header))) {
+            return 1;
+        }
+        data.resize(msgSize - sizeof(header) + 1);
+        if (!channel->read(&data[1], msgSize - sizeof(header))) {
+            return 2;
+        }
+        for (size_t ii = 1, jj = data.size() - 1; ii < jj; ii++, jj--) {
+            std::swap(data[ii], data[jj]);
+        }
+        data[0] = static_cast<char>(ntohl(header[1]));
+        if (!channel->write(&data[0], data.size())) {
+            return 3;
+        }
+    }
+}
+
+class SharedMemoryChannelTest : public Test {
+public:
+    SharedMemoryChannelTest() : m_engine(-1) {
+        char path[] = "/tmp/shared_memory_channel_testXXXXXX";
+        const int fd = ::mkstemp(path);
+        ::close(fd);
+        m_path = path;
+        srand(7);
+    }
+
+    ~SharedMemoryChannelTest() {
+        ::unlink(m_path.c_str());
+    }
+
+    void startEngine() {
+        m_engine = ::fork();
+        if (m_engine == 0) {
+            ::_exit(runEngine(m_path));
+        }
+    }
+
+    int engineExitStatus() {
+        int status = -1;
+        ::waitpid(m_engine, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    /*
+     * Send one command and check the reply.
+     */
+    bool roundTrip(SharedMemoryChannel *channel, int32_t command, const std::vector<char> &body) {
+        int32_t header[2];
+        header[0] = htonl(static_cast<int32_t>(sizeof(header) + body.size()));
+        header[1] = htonl(command);
+        if (!channel->write(header, sizeof(header)) ||
+            (!body.empty() && !channel->write(&body[0], body.size()))) {
+            return false;
+        }
+        std::vector<char> reply(body.size() + 1);
+        if (!channel->read(&reply[0], reply.size())) {
+            return false;
+        }
+        if (reply[0] != static_cast<char>(command)) {
+            return false;
+        }
+        for (size_t ii = 0; ii < body.size(); ii++) {
+            if (reply[reply.size() - 1 - ii] != body[ii]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    std::string m_path;
+    pid_t m_engine;
+};
+
+/*
+ * Replay a stream of mostly small commands with a few larger than the
+ * rings, which have to be streamed through in pieces.
+ */
+TEST_F(SharedMemoryChannelTest, ReplayCommands) {
+    SharedMemoryChannel *client = SharedMemoryChannel::create(m_path, 4096);
+    EXPECT_EQ(4096, client->ringCapacity());
+    startEngine();
+
+    for (int ii = 0; ii < 2000; ii++) {
+        const size_t length = ii % 100 == 0 ? 20000 + rand() % 10000 : rand() % 300;
+        std::vector<char> body(length);
+        for (size_t jj = 0; jj < length; jj++) {
+            body[jj] = static_cast<char>(rand());
+        }
+        ASSERT_TRUE(roundTrip(client, ii % 20, body));
+    }
+
+    client->close();
+    EXPECT_EQ(0, engineExitStatus());
+    delete client;
+}
+
+/*
+ * A write to a channel the other side closed fails instead of blocking
+ * once the ring is full, and data written before closing is still read.
+ */
+TEST_F(SharedMemoryChannelTest, Close) {
+    SharedMemoryChannel *client = SharedMemoryChannel::create(m_path, 4096);
+    SharedMemoryChannel *engine = SharedMemoryChannel::open(m_path);
+
+    int32_t value = 42;
+    ASSERT_TRUE(engine->write(&value, sizeof(value)));
+    engine->close();
+
+    value = 0;
+    EXPECT_TRUE(client->read(&value, sizeof(value)));
+    EXPECT_EQ(42, value);
+    EXPECT_FALSE(client->read(&value, sizeof(value)));
+
+    std::vector<char> big(10000);
+    EXPECT_FALSE(client->write(&big[0], big.size()));
+
+    delete engine;
+    delete client;
+}
+
+TEST_F(SharedMemoryChannelTest, OpenUninitialized) {
+    bool threw = false;
+    try {
+        SharedMemoryChannel::open(m_path);
+    } catch (FatalException &e) {
+        threw = true;
+    }
+    EXPECT_TRUE(threw);
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,190 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/TupleSchema.h"
+#include "common/types.h"
+#include "common/NValue.hpp"
+#include "common/ValueFactory.hpp"
+#include "common/ValuePeeker.hpp"
+#include "common/tabletuple.h"
+#include "execution/PlanFragmentProfiler.h"
+#include "execution/PlanFragmentStats.h"
+#include "execution/VoltDBEngine.h"
+#include "executors/seqscanexecutor.h"
+#include "plannodes/seqscannode.h"
+#include "stats/StatsAgent.h"
+#include "storage/persistenttable.h"
+#include "storage/tablefactory.h"
+#include "storage/tableiterator.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace voltdb;
+
+static const int NUM_TUPLES = 250;
+static const int64_t FRAGMENT_ID = 42;
+static const string columnNames[1] = { "ID" };
+
+class PlanFragmentProfilerTest : public Test {
+public:
+    PlanFragmentProfilerTest() {
+        m_engine = new VoltDBEngine();
+        m_engine->initialize(1, 1, 0, 0, "");
+        m_engine->setUndoToken(INT64_MIN + 1);
+
+        vector<ValueType> types(1, VALUE_TYPE_BIGINT);
+        vector<int32_t> lengths(1, NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(1, false);
+        TupleSchema *schema = TupleSchema::createTupleSchema(types, lengths, allowNull, true);
+        m_table = dynamic_cast<PersistentTable*>(
+            TableFactory::getPersistentTable(0, m_engine->getExecutorContext(), "SCANNED",
+                                             schema, columnNames, 0, false, false));
+        TableTuple &tuple = m_table->tempTuple();
+        for (int64_t id = 0; id < NUM_TUPLES; id++) {
+            tuple.setNValue(0, ValueFactory::getBigIntValue(id));
+            m_table->insertTuple(tuple);
+        }
+    }
+
+    ~PlanFragmentProfilerTest() {
+        delete m_table;
+        delete m_engine;
+    }
+
+    static int column(const string &name) {
+        vector<string> names = PlanFragmentStats::generatePlanFragmentStatsColumnNames();
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    static int64_t counter(StatsSource &stats, bool interval, const string &name) {
+        return ValuePeeker::peekAsBigInt(stats.getStatsTuple(interval, 0)->getNValue(column(name)));
+    }
+
+    VoltDBEngine *m_engine;
+    PersistentTable *m_table;
+};
+
+/*
+ * A sequential scan has no input tables; what it reads is the table it
+ * scans.
+ */
+TEST_F(PlanFragmentProfilerTest, ScanTuplesIn) {
+    SeqScanPlanNode *node = new SeqScanPlanNode(1);
+    node->setTargetTable(m_table);
+    node->setExecutor(new SeqScanExecutor(m_engine, node));
+
+    StatsAgent statsAgent;
+    PlanFragmentProfiler profiler(statsAgent);
+    profiler.configure(m_engine->getExecutorContext());
+    PlanFragmentProfiler::Sample sample;
+    profiler.start(node->getExecutor(), sample);
+    ASSERT_EQ(NUM_TUPLES, sample.tuplesIn);
+    profiler.stop(FRAGMENT_ID, node->getExecutor(), sample);
+    profiler.start(node->getExecutor(), sample);
+    profiler.stop(FRAGMENT_ID, node->getExecutor(), sample);
+
+    ASSERT_EQ(1, static_cast<int>(profiler.getStatsIds().size()));
+    Table *stats = statsAgent.getStats(STATISTICS_SELECTOR_TYPE_PLANFRAGMENT,
+                                       profiler.getStatsIds(), false, 0);
+    ASSERT_EQ(1, stats->activeTupleCount());
+    TableTuple row(stats->schema());
+    TableIterator iterator = stats->tableIterator();
+    ASSERT_TRUE(iterator.next(row));
+    ASSERT_EQ(FRAGMENT_ID, ValuePeeker::peekAsBigInt(row.getNValue(column("PLAN_FRAGMENT_ID"))));
+    ASSERT_EQ(2, ValuePeeker::peekAsBigInt(row.getNValue(column("INVOCATIONS"))));
+    ASSERT_EQ(2 * NUM_TUPLES, ValuePeeker::peekAsBigInt(row.getNValue(column("TUPLES_IN"))));
+
+    delete node;
+}
+
+/*
+ * Stats requests name the fragments they want.
+ */
+TEST_F(PlanFragmentProfilerTest, StatsIdsByFragment) {
+    SeqScanPlanNode *node = new SeqScanPlanNode(1);
+    node->setTargetTable(m_table);
+    node->setExecutor(new SeqScanExecutor(m_engine, node));
+
+    StatsAgent statsAgent;
+    PlanFragmentProfiler profiler(statsAgent);
+    profiler.configure(m_engine->getExecutorContext());
+    PlanFragmentProfiler::Sample sample;
+    profiler.start(node->getExecutor(), sample);
+    profiler.stop(FRAGMENT_ID, node->getExecutor(), sample);
+    profiler.start(node->getExecutor(), sample);
+    profiler.stop(FRAGMENT_ID + 1, node->getExecutor(), sample);
+    ASSERT_EQ(2, static_cast<int>(profiler.getStatsIds().size()));
+
+    std::vector<CatalogId> statsIds;
+    profiler.getStatsIds(FRAGMENT_ID + 1, statsIds);
+    ASSERT_EQ(1, static_cast<int>(statsIds.size()));
+    profiler.getStatsIds(FRAGMENT_ID + 2, statsIds);
+    ASSERT_EQ(1, static_cast<int>(statsIds.size()));
+
+    Table *stats = statsAgent.getStats(STATISTICS_SELECTOR_TYPE_PLANFRAGMENT,
+                                       statsIds, false, 0);
+    ASSERT_EQ(1, stats->activeTupleCount());
+    TableTuple row(stats->schema());
+    TableIterator iterator = stats->tableIterator();
+    ASSERT_TRUE(iterator.next(row));
+    ASSERT_EQ(FRAGMENT_ID + 1, ValuePeeker::peekAsBigInt(row.getNValue(column("PLAN_FRAGMENT_ID"))));
+
+    delete node;
+}
+
+/*
+ * TEMP_TABLE_BYTES is the largest temp table of one execution, over all
+ * executions or, for interval requests, those since the last one. The
+ * other counters add up.
+ */
+TEST_F(PlanFragmentProfilerTest, TempTableBytesPeak) {
+    PlanFragmentStats stats(FRAGMENT_ID, PLAN_NODE_TYPE_SEQSCAN);
+    stats.configure("stats", 0, "host", 0, 0, 0);
+    stats.addSample(10, 5, 5, 1000, 0);
+    stats.addSample(10, 5, 5, 4000, 0);
+    stats.addSample(10, 5, 5, 2000, 0);
+    ASSERT_EQ(4000, counter(stats, false, "TEMP_TABLE_BYTES"));
+    ASSERT_EQ(15, counter(stats, false, "TUPLES_IN"));
+
+    ASSERT_EQ(4000, counter(stats, true, "TEMP_TABLE_BYTES"));
+    stats.addSample(10, 5, 5, 3000, 0);
+    stats.addSample(10, 5, 5, 500, 0);
+    ASSERT_EQ(3000, counter(stats, true, "TEMP_TABLE_BYTES"));
+    ASSERT_EQ(0, counter(stats, true, "TEMP_TABLE_BYTES"));
+    ASSERT_EQ(0, counter(stats, true, "TUPLES_IN"));
+    ASSERT_EQ(4000, counter(stats, false, "TEMP_TABLE_BYTES"));
+    ASSERT_EQ(25, counter(stats, false, "TUPLES_IN"));
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
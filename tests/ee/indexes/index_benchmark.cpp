@@ -0,0 +1,726 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Standalone micro-benchmark for the unique TableIndex implementations.
+ *
+ * Drives the STX B-tree, the boost hash table, a plain (never merged)
+ * Masstree and the hybrid mt_index wrappers directly, without a catalog,
+ * engine or table, through YCSB-style point/scan mixes, TPC-C order keys
+ * and a delete-heavy FIFO queue. Results go to stdout as a JSON array,
+ * one object per (index, workload) pair.
+ *
+ *   indexbench [--index=btree,hash,masstree,hybrid,hybrid-point]
+ *              [--key=ints|generic] [--workload=ycsb-a,...,tpcc,queue]
+ *              [--records=N] [--ops=N] [--theta=F] [--seed=N]
+ *
+ * Build with "python build.py release indexbench" (prod/indexbench).
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#include "common/tabletuple.h"
+#include "common/TupleSchema.h"
+#include "common/ValueFactory.hpp"
+#include "indexes/indexkey.h"
+#include "indexes/tableindex.h"
+#include "indexes/BinaryTreeUniqueIndex.h"
+#include "indexes/HashTableUniqueIndex.h"
+#include "indexes/MasstreeUniqueIndex.h"
+#include "indexes/MasstreeOrderedUniqueIndex.h"
+
+using namespace std;
+using namespace voltdb;
+
+namespace {
+
+inline uint64_t nowNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/** xorshift64*: cheap enough not to show up in the latencies. */
+class Random {
+public:
+    Random(uint64_t seed) : m_state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+    uint64_t next() {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 2685821657736338717ULL;
+    }
+    double nextDouble() {
+        return static_cast<double>(next() >> 11) / 9007199254740992.0;
+    }
+    uint64_t nextBelow(uint64_t n) {
+        return n == 0 ? 0 : next() % n;
+    }
+
+private:
+    uint64_t m_state;
+};
+
+/**
+ * YCSB's zipfian generator (Gray et al., "Quickly generating billion-record
+ * synthetic databases"). Returns ranks in [0, n), rank 0 the hottest.
+ */
+class ZipfianGenerator {
+public:
+    ZipfianGenerator(uint64_t n, double theta) : m_n(n ? n : 1), m_theta(theta) {
+        m_zetan = zeta(m_n);
+        double zeta2 = zeta(2);
+        m_alpha = 1.0 / (1.0 - theta);
+        m_eta = (1.0 - pow(2.0 / static_cast<double>(m_n), 1.0 - theta)) / (1.0 - zeta2 / m_zetan);
+        m_half = 1.0 + pow(0.5, theta);
+    }
+
+    uint64_t next(Random &random) const {
+        double u = random.nextDouble();
+        double uz = u * m_zetan;
+        if (uz < 1.0)
+            return 0;
+        if (uz < m_half)
+            return 1;
+        uint64_t rank = static_cast<uint64_t>(static_cast<double>(m_n) *
+                                              pow(m_eta * u - m_eta + 1.0, m_alpha));
+        return rank < m_n ? rank : m_n - 1;
+    }
+
+private:
+    double zeta(uint64_t n) const {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; i++)
+            sum += 1.0 / pow(static_cast<double>(i), m_theta);
+        return sum;
+    }
+
+    uint64_t m_n;
+    double m_theta;
+    double m_zetan;
+    double m_alpha;
+    double m_eta;
+    double m_half;
+};
+
+/** FNV-1a over the rank, so hot keys are spread over the key space. */
+inline uint64_t scramble(uint64_t rank) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; i++) {
+        hash ^= (rank >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Log-linear latency histogram: 16 buckets per power of two, so any
+ * reported percentile is within 1/16 of the true value.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() : m_buckets(BUCKETS, 0), m_count(0), m_max(0) {}
+
+    void record(uint64_t nanos) {
+        m_buckets[bucketOf(nanos)]++;
+        m_count++;
+        if (nanos > m_max)
+            m_max = nanos;
+    }
+
+    uint64_t count() const { return m_count; }
+
+    uint64_t percentile(double fraction) const {
+        if (m_count == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(ceil(fraction * static_cast<double>(m_count)));
+        if (rank == 0)
+            rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += m_buckets[b];
+            if (seen >= rank)
+                return min(upperBound(b), m_max);
+        }
+        return m_max;
+    }
+
+    void writeJson(FILE *out, bool withBuckets) const {
+        fprintf(out, "{\"count\": %llu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu",
+                ull(m_count), ull(percentile(0.5)), ull(percentile(0.99)),
+                ull(percentile(0.999)), ull(m_max));
+        if (withBuckets) {
+            // [upper bound in ns, count] for every non-empty bucket
+            fprintf(out, ", \"histogram\": [");
+            const char *sep = "";
+            for (int b = 0; b < BUCKETS; b++) {
+                if (m_buckets[b] == 0)
+                    continue;
+                fprintf(out, "%s[%llu, %llu]", sep, ull(upperBound(b)), ull(m_buckets[b]));
+                sep = ", ";
+            }
+            fprintf(out, "]");
+        }
+        fprintf(out, "}");
+    }
+
+private:
+    static const int SUB_BITS = 4;
+    static const int SUB = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    static unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+
+    static int bucketOf(uint64_t v) {
+        if (v < static_cast<uint64_t>(SUB))
+            return static_cast<int>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB + static_cast<int>((v >> shift) & (SUB - 1));
+    }
+
+    static uint64_t upperBound(int bucket) {
+        if (bucket < SUB)
+            return static_cast<uint64_t>(bucket);
+        int shift = bucket / SUB - 1;
+        uint64_t sub = static_cast<uint64_t>(bucket % SUB);
+        return ((SUB + sub + 1) << shift) - 1;
+    }
+
+    vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_max;
+};
+
+//
+// Indexes under test
+//
+
+// The index constructors are reserved for TableIndexFactory; these open
+// them up without going through its compile-time selection.
+template <typename Index>
+class OpenIndex : public Index {
+public:
+    OpenIndex(const TableIndexScheme &scheme) : Index(scheme) {}
+};
+
+template <typename Index>
+class OpenMasstreeIndex : public Index {
+public:
+    OpenMasstreeIndex(const TableIndexScheme &scheme, bool merging) : Index(scheme) {
+        // a bulk load that never ends skips every merge check, which
+        // leaves a plain dynamic Masstree with no static stage
+        if (!merging)
+            this->mt_entries.begin_bulk_load();
+    }
+    uint64_t mergeCount() const { return this->mt_entries.get_merge_count(); }
+};
+
+class Candidate {
+public:
+    Candidate(TableIndex *index, bool ordered) : m_index(index), m_ordered(ordered) {}
+    virtual ~Candidate() { delete m_index; }
+
+    TableIndex *index() const { return m_index; }
+    bool ordered() const { return m_ordered; }
+    virtual uint64_t mergeCount() const { return 0; }
+
+private:
+    TableIndex *m_index;
+    bool m_ordered;
+};
+
+template <typename Index>
+class MasstreeCandidate : public Candidate {
+public:
+    MasstreeCandidate(OpenMasstreeIndex<Index> *index, bool ordered)
+        : Candidate(index, ordered), m_masstree(index) {}
+    uint64_t mergeCount() const { return m_masstree->mergeCount(); }
+
+private:
+    OpenMasstreeIndex<Index> *m_masstree;
+};
+
+template <typename Key, typename Comparator, typename Equality, typename Hasher>
+Candidate *makeCandidate(const string &kind, const TableIndexScheme &scheme) {
+    if (kind == "btree")
+        return new Candidate(new OpenIndex<BinaryTreeUniqueIndex<Key, Comparator, Equality> >(scheme), true);
+    if (kind == "hash")
+        return new Candidate(new OpenIndex<HashTableUniqueIndex<Key, Hasher, Equality> >(scheme), false);
+    if (kind == "masstree" || kind == "hybrid") {
+        typedef MasstreeOrderedUniqueIndex<Key, Comparator, Equality> Index;
+        return new MasstreeCandidate<Index>(new OpenMasstreeIndex<Index>(scheme, kind == "hybrid"), true);
+    }
+    if (kind == "hybrid-point") {
+        typedef MasstreeUniqueIndex<Key, Comparator, Equality> Index;
+        return new MasstreeCandidate<Index>(new OpenMasstreeIndex<Index>(scheme, true), false);
+    }
+    return NULL;
+}
+
+//
+// Workloads
+//
+
+struct Workload {
+    const char *name;
+    // (W_ID INTEGER, D_ID TINYINT, O_ID INTEGER) order keys instead of one BIGINT
+    bool district;
+    // reads favour the most recent inserts instead of scrambled zipfian keys
+    bool latest;
+    double read, update, insert, scan, remove;
+    int maxScan;
+};
+
+const Workload WORKLOADS[] = {
+    { "ycsb-a", false, false, 0.50, 0.50, 0.00, 0.00, 0.00, 0 },
+    { "ycsb-b", false, false, 0.95, 0.05, 0.00, 0.00, 0.00, 0 },
+    { "ycsb-c", false, false, 1.00, 0.00, 0.00, 0.00, 0.00, 0 },
+    { "ycsb-d", false, true,  0.95, 0.00, 0.05, 0.00, 0.00, 0 },
+    { "ycsb-e", false, false, 0.00, 0.00, 0.05, 0.95, 0.00, 100 },
+    // ORDER-STATUS reads, NEW-ORDER inserts, STOCK-LEVEL scans of the last
+    // 20 orders and DELIVERY deletes of each district's oldest order
+    { "tpcc",   true,  true,  0.40, 0.00, 0.45, 0.05, 0.10, 20 },
+    // append at the tail, delete at the head
+    { "queue",  false, false, 0.00, 0.00, 0.50, 0.00, 0.50, 0 },
+};
+const int WORKLOAD_COUNT = static_cast<int>(sizeof(WORKLOADS) / sizeof(WORKLOADS[0]));
+
+enum OpType { OP_READ, OP_UPDATE, OP_INSERT, OP_SCAN, OP_REMOVE, OP_COUNT };
+const char *OP_NAMES[OP_COUNT] = { "read", "update", "insert", "scan", "remove" };
+
+const int DISTRICTS_PER_WAREHOUSE = 10;
+const int ORDERS_PER_DISTRICT = 3000;
+
+/**
+ * The live keys of one key range, [head, tail), and the tuple slot of each.
+ * YCSB and the queue use a single range; TPC-C keeps one per district.
+ */
+struct KeyRange {
+    KeyRange() : head(0), tail(0) {}
+    uint64_t live() const { return tail - head; }
+
+    uint64_t head;
+    uint64_t tail;
+    deque<uint32_t> slots;
+};
+
+struct Options {
+    Options() : key("ints"), records(1000000), ops(1000000), theta(0.99), seed(1) {}
+
+    vector<string> indexes;
+    vector<string> workloads;
+    string key;
+    uint64_t records;
+    uint64_t ops;
+    double theta;
+    uint64_t seed;
+};
+
+class Benchmark {
+public:
+    Benchmark(const Options &options, const Workload &workload, const string &kind)
+        : m_options(options), m_workload(workload), m_kind(kind), m_random(options.seed),
+          m_zipf(max<uint64_t>(options.records, 1), options.theta), m_candidate(NULL),
+          m_schema(NULL), m_keyBuffer(NULL), m_usedSlots(0), m_misses(0)
+    {
+        vector<ValueType> types;
+        vector<int32_t> lengths;
+        if (workload.district) {
+            types.push_back(VALUE_TYPE_INTEGER);
+            types.push_back(VALUE_TYPE_TINYINT);
+            types.push_back(VALUE_TYPE_INTEGER);
+        } else {
+            types.push_back(VALUE_TYPE_BIGINT);
+        }
+        m_keyColumns = static_cast<int>(types.size());
+        types.push_back(VALUE_TYPE_BIGINT); // payload
+        for (size_t i = 0; i < types.size(); i++)
+            lengths.push_back(NValue::getTupleStorageSize(types[i]));
+        vector<bool> allowNull(types.size(), false);
+        m_schema = TupleSchema::createTupleSchema(types, lengths, allowNull, true);
+
+        vector<int32_t> keyIndices;
+        vector<ValueType> keyTypes;
+        vector<int32_t> keyLengths;
+        for (int i = 0; i < m_keyColumns; i++) {
+            keyIndices.push_back(i);
+            keyTypes.push_back(types[i]);
+            keyLengths.push_back(lengths[i]);
+        }
+        TableIndexScheme scheme(kind, BALANCED_TREE_INDEX, keyIndices, keyTypes, true,
+                                options.key == "ints", m_schema);
+        scheme.keySchema = TupleSchema::createTupleSchema(keyTypes, keyLengths,
+                                                          vector<bool>(keyTypes.size(), true), true);
+        if (options.key == "ints") {
+            if (workload.district)
+                m_candidate = makeCandidate<IntsKey<2>, IntsComparator<2>, IntsEqualityChecker<2>,
+                                            IntsHasher<2> >(kind, scheme);
+            else
+                m_candidate = makeCandidate<IntsKey<1>, IntsComparator<1>, IntsEqualityChecker<1>,
+                                            IntsHasher<1> >(kind, scheme);
+        } else {
+            if (workload.district)
+                m_candidate = makeCandidate<GenericKey<16>, GenericComparator<16>,
+                                            GenericEqualityChecker<16>, GenericHasher<16> >(kind, scheme);
+            else
+                m_candidate = makeCandidate<GenericKey<8>, GenericComparator<8>,
+                                            GenericEqualityChecker<8>, GenericHasher<8> >(kind, scheme);
+        }
+        if (m_candidate == NULL) {
+            TupleSchema::freeTupleSchema(scheme.keySchema);
+            return;
+        }
+        const TupleSchema *keySchema = m_candidate->index()->getKeySchema();
+        m_keyBuffer = new char[keySchema->tupleLength()];
+        memset(m_keyBuffer, 0, keySchema->tupleLength());
+        m_searchKey = TableTuple(keySchema);
+        m_searchKey.moveNoHeader(m_keyBuffer);
+
+        // every preloaded record plus every possible insert gets its own slot
+        m_tupleLength = m_schema->tupleLength() + TUPLE_HEADER_SIZE;
+        m_storage.assign((options.records + options.ops) * m_tupleLength, 0);
+        m_tuple = TableTuple(m_schema);
+
+        uint64_t districts = 1;
+        if (workload.district) {
+            uint64_t warehouses = max<uint64_t>(1, options.records / (DISTRICTS_PER_WAREHOUSE * ORDERS_PER_DISTRICT));
+            districts = warehouses * DISTRICTS_PER_WAREHOUSE;
+        }
+        m_ranges.resize(districts);
+    }
+
+    ~Benchmark() {
+        delete m_candidate;
+        delete[] m_keyBuffer;
+        TupleSchema::freeTupleSchema(m_schema);
+    }
+
+    bool valid() const { return m_candidate != NULL; }
+
+    void run(FILE *out) {
+        TableIndex *index = m_candidate->index();
+        fprintf(out, "{\"index\": \"%s\", \"type\": \"%s\", \"key\": \"%s\", \"workload\": \"%s\", "
+                "\"records\": %llu, \"operations\": %llu",
+                m_kind.c_str(), index->getTypeName().c_str(), m_options.key.c_str(), m_workload.name,
+                ull(m_options.records), ull(m_options.ops));
+        if ((m_workload.scan > 0) && !m_candidate->ordered()) {
+            fprintf(out, ", \"skipped\": \"unordered index cannot scan\"}");
+            return;
+        }
+
+        // load
+        uint64_t start = nowNanos();
+        for (uint64_t i = 0; i < m_options.records; i++) {
+            KeyRange &range = m_ranges[i % m_ranges.size()];
+            timed(m_load, &Benchmark::insert, range);
+        }
+        double loadSeconds = seconds(nowNanos() - start);
+        fprintf(out, ", \"load\": {\"seconds\": %.3f, \"ops_per_sec\": %.0f, \"latency_ns\": ",
+                loadSeconds, rate(m_options.records, loadSeconds));
+        m_load.writeJson(out, false);
+        fprintf(out, "}");
+
+        // run
+        start = nowNanos();
+        for (uint64_t i = 0; i < m_options.ops; i++) {
+            double p = m_random.nextDouble();
+            KeyRange &range = m_ranges[m_random.nextBelow(m_ranges.size())];
+            if ((p -= m_workload.read) < 0)
+                timed(m_ops[OP_READ], &Benchmark::read, range);
+            else if ((p -= m_workload.update) < 0)
+                timed(m_ops[OP_UPDATE], &Benchmark::update, range);
+            else if ((p -= m_workload.insert) < 0)
+                timed(m_ops[OP_INSERT], &Benchmark::insert, range);
+            else if ((p -= m_workload.scan) < 0)
+                timed(m_ops[OP_SCAN], &Benchmark::scan, range);
+            else
+                timed(m_ops[OP_REMOVE], &Benchmark::remove, range);
+        }
+        double runSeconds = seconds(nowNanos() - start);
+
+        fprintf(out, ", \"run\": {\"seconds\": %.3f, \"ops_per_sec\": %.0f, \"latency_ns\": ",
+                runSeconds, rate(m_options.ops, runSeconds));
+        m_all.writeJson(out, false);
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (m_ops[op].count() == 0)
+                continue;
+            fprintf(out, ", \"%s\": ", OP_NAMES[op]);
+            m_ops[op].writeJson(out, false);
+        }
+        fprintf(out, "}");
+
+        size_t entries = index->getSize();
+        int64_t memory = index->getMemoryEstimate();
+        fprintf(out, ", \"misses\": %llu, \"entries\": %llu, \"memory_bytes\": %lld, \"bytes_per_key\": %.1f",
+                ull(m_misses), ull(entries), static_cast<long long>(memory),
+                entries ? static_cast<double>(memory) / static_cast<double>(entries) : 0.0);
+        fprintf(out, ", \"merges\": {\"count\": %llu, \"pause_ns\": ", ull(m_candidate->mergeCount()));
+        m_mergePauses.writeJson(out, true);
+        fprintf(out, "}}");
+    }
+
+private:
+    typedef void (Benchmark::*Operation)(KeyRange &range);
+
+    static unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+    static double seconds(uint64_t nanos) { return static_cast<double>(nanos) / 1e9; }
+    static double rate(uint64_t count, double secs) {
+        return secs > 0 ? static_cast<double>(count) / secs : 0.0;
+    }
+
+    /** Time one operation; ones that ran a merge also land in m_mergePauses. */
+    void timed(LatencyHistogram &histogram, Operation operation, KeyRange &range) {
+        uint64_t merges = m_candidate->mergeCount();
+        uint64_t start = nowNanos();
+        (this->*operation)(range);
+        uint64_t elapsed = nowNanos() - start;
+        histogram.record(elapsed);
+        if (&histogram != &m_load)
+            m_all.record(elapsed);
+        if (m_candidate->mergeCount() != merges)
+            m_mergePauses.record(elapsed);
+    }
+
+    uint64_t rangeId(const KeyRange &range) const {
+        return static_cast<uint64_t>(&range - &m_ranges[0]);
+    }
+
+    /** Write the key columns for order number o of range into tuple. */
+    void setKey(TableTuple &tuple, const KeyRange &range, uint64_t o) {
+        if (m_workload.district) {
+            uint64_t district = rangeId(range);
+            tuple.setNValue(0, ValueFactory::getIntegerValue(
+                static_cast<int32_t>(district / DISTRICTS_PER_WAREHOUSE + 1)));
+            tuple.setNValue(1, ValueFactory::getTinyIntValue(
+                static_cast<int8_t>(district % DISTRICTS_PER_WAREHOUSE + 1)));
+            tuple.setNValue(2, ValueFactory::getIntegerValue(static_cast<int32_t>(o)));
+        } else {
+            tuple.setNValue(0, ValueFactory::getBigIntValue(static_cast<int64_t>(o)));
+        }
+    }
+
+    /** A live key of range, or the range's tail if it is empty. */
+    uint64_t pickKey(const KeyRange &range) {
+        uint64_t live = range.live();
+        if (live == 0)
+            return range.tail;
+        uint64_t rank = m_zipf.next(m_random);
+        if (m_workload.latest)
+            return range.tail - 1 - rank % live;
+        return range.head + scramble(rank) % live;
+    }
+
+    void *slotAddress(uint32_t slot) {
+        return &m_storage[static_cast<size_t>(slot) * m_tupleLength];
+    }
+
+    void read(KeyRange &range) {
+        setKey(m_searchKey, range, pickKey(range));
+        TableIndex *index = m_candidate->index();
+        if (!index->moveToKey(&m_searchKey) || index->nextValueAtKey().isNullTuple())
+            m_misses++;
+    }
+
+    void update(KeyRange &range) {
+        // YCSB updates rewrite a field, so the key and index stay as they are
+        setKey(m_searchKey, range, pickKey(range));
+        TableIndex *index = m_candidate->index();
+        TableTuple tuple = index->moveToKey(&m_searchKey) ? index->nextValueAtKey() : TableTuple();
+        if (tuple.isNullTuple()) {
+            m_misses++;
+            return;
+        }
+        tuple.setNValue(m_keyColumns, ValueFactory::getBigIntValue(static_cast<int64_t>(m_random.next() >> 1)));
+    }
+
+    void insert(KeyRange &range) {
+        uint32_t slot;
+        if (m_freeSlots.empty()) {
+            slot = static_cast<uint32_t>(m_usedSlots++);
+        } else {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        m_tuple.move(slotAddress(slot));
+        setKey(m_tuple, range, range.tail);
+        m_tuple.setNValue(m_keyColumns, ValueFactory::getBigIntValue(static_cast<int64_t>(slot)));
+        if (!m_candidate->index()->addEntry(&m_tuple)) {
+            m_misses++;
+            m_freeSlots.push_back(slot);
+            return;
+        }
+        range.tail++;
+        range.slots.push_back(slot);
+    }
+
+    void scan(KeyRange &range) {
+        // YCSB-E starts anywhere; TPC-C reads back the district's last orders
+        uint64_t maxScan = static_cast<uint64_t>(m_workload.maxScan);
+        uint64_t from = m_workload.district ?
+            (range.live() > maxScan ? range.tail - maxScan : range.head) : pickKey(range);
+        int length = m_workload.district ? m_workload.maxScan :
+            static_cast<int>(m_random.nextBelow(maxScan)) + 1;
+        setKey(m_searchKey, range, from);
+        TableIndex *index = m_candidate->index();
+        index->moveToKeyOrGreater(&m_searchKey);
+        for (int i = 0; i < length; i++) {
+            if (index->nextValue().isNullTuple())
+                break;
+        }
+    }
+
+    void remove(KeyRange &range) {
+        if (range.live() == 0)
+            return;
+        uint32_t slot = range.slots.front();
+        m_tuple.move(slotAddress(slot));
+        if (!m_candidate->index()->deleteEntry(&m_tuple))
+            m_misses++;
+        range.slots.pop_front();
+        range.head++;
+        m_freeSlots.push_back(slot);
+    }
+
+    const Options &m_options;
+    const Workload &m_workload;
+    string m_kind;
+    Random m_random;
+    ZipfianGenerator m_zipf;
+    Candidate *m_candidate;
+
+    TupleSchema *m_schema;
+    int m_keyColumns;
+    char *m_keyBuffer;
+    TableTuple m_searchKey;
+    TableTuple m_tuple;
+    size_t m_tupleLength;
+    vector<char> m_storage;
+    size_t m_usedSlots;
+    vector<uint32_t> m_freeSlots;
+    vector<KeyRange> m_ranges;
+
+    LatencyHistogram m_load;
+    LatencyHistogram m_all;
+    LatencyHistogram m_ops[OP_COUNT];
+    LatencyHistogram m_mergePauses;
+    uint64_t m_misses;
+};
+
+vector<string> splitList(const string &list) {
+    vector<string> items;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == string::npos)
+            end = list.size();
+        if (end > start)
+            items.push_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
+
+bool parseOption(const char *arg, const char *name, string &value) {
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+        return false;
+    value = arg + length + 1;
+    return true;
+}
+
+int usage(const char *program) {
+    fprintf(stderr, "usage: %s [--index=btree,hash,masstree,hybrid,hybrid-point] [--key=ints|generic]\n"
+            "          [--workload=ycsb-a,ycsb-b,ycsb-c,ycsb-d,ycsb-e,tpcc,queue]\n"
+            "          [--records=N] [--ops=N] [--theta=F] [--seed=N]\n", program);
+    return 1;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    options.indexes = splitList("btree,hash,masstree,hybrid,hybrid-point");
+    for (int i = 0; i < WORKLOAD_COUNT; i++)
+        options.workloads.push_back(WORKLOADS[i].name);
+
+    for (int i = 1; i < argc; i++) {
+        string value;
+        if (parseOption(argv[i], "--index", value))
+            options.indexes = splitList(value);
+        else if (parseOption(argv[i], "--workload", value))
+            options.workloads = splitList(value);
+        else if (parseOption(argv[i], "--key", value) && (value == "ints" || value == "generic"))
+            options.key = value;
+        else if (parseOption(argv[i], "--records", value))
+            options.records = strtoull(value.c_str(), NULL, 10);
+        else if (parseOption(argv[i], "--ops", value))
+            options.ops = strtoull(value.c_str(), NULL, 10);
+        else if (parseOption(argv[i], "--theta", value))
+            options.theta = strtod(value.c_str(), NULL);
+        else if (parseOption(argv[i], "--seed", value))
+            options.seed = strtoull(value.c_str(), NULL, 10);
+        else
+            return usage(argv[0]);
+    }
+    if (options.records + options.ops > UINT32_MAX || options.theta <= 0 || options.theta >= 1)
+        return usage(argv[0]);
+
+    printf("[\n");
+    const char *sep = "";
+    for (size_t w = 0; w < options.workloads.size(); w++) {
+        const Workload *workload = NULL;
+        for (int i = 0; i < WORKLOAD_COUNT; i++) {
+            if (options.workloads[w] == WORKLOADS[i].name)
+                workload = &WORKLOADS[i];
+        }
+        if (workload == NULL) {
+            fprintf(stderr, "unknown workload '%s'\n", options.workloads[w].c_str());
+            return usage(argv[0]);
+        }
+        for (size_t x = 0; x < options.indexes.size(); x++) {
+            Benchmark benchmark(options, *workload, options.indexes[x]);
+            if (!benchmark.valid()) {
+                fprintf(stderr, "unknown index '%s'\n", options.indexes[x].c_str());
+                return usage(argv[0]);
+            }
+            fprintf(stderr, "%s / %s\n", workload->name, options.indexes[x].c_str());
+            printf("%s", sep);
+            benchmark.run(stdout);
+            sep = ",\n";
+            fflush(stdout);
+        }
+    }
+    printf("\n]\n");
+    return 0;
+}
@@ -0,0 +1,310 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/executorcontext.hpp"
+#include "common/TupleSchema.h"
+#include "common/types.h"
+#include "common/NValue.hpp"
+#include "common/ValueFactory.hpp"
+#include "common/ValuePeeker.hpp"
+#include "common/tabletuple.h"
+#include "common/DummyUndoQuantum.hpp"
+#include "indexes/indexkey.h"
+#include "indexes/masstreebulkload.h"
+#include "indexes/tableindex.h"
+#include "indexes/tableindexfactory.h"
+#include "indexes/MasstreeMultiMapIndex.h"
+#include "indexes/MasstreeOrderedMultiMapIndex.h"
+#include "storage/persistenttable.h"
+#include "storage/tablefactory.h"
+#include "storage/tableiterator.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+using namespace std;
+using namespace voltdb;
+
+class IndexBulkLoadTest : public Test {
+public:
+    IndexBulkLoadTest() {
+        srand(0);
+    }
+};
+
+static bool byteLess(const string &lhs, const string &rhs) {
+    size_t common = min(lhs.size(), rhs.size());
+    int cmp = memcmp(lhs.data(), rhs.data(), common);
+    if (cmp != 0)
+        return cmp < 0;
+    return lhs.size() < rhs.size();
+}
+
+/**
+ * Keys come out in the unsigned byte order Masstree uses, with shorter
+ * prefixes first and duplicates adjacent.
+ */
+TEST_F(IndexBulkLoadTest, SortOrder) {
+    const int numKeys = 5000;
+    vector<string> keys;
+    for (int i = 0; i < numKeys; i++) {
+        int len = rand() % 12;
+        string key;
+        for (int j = 0; j < len; j++) {
+            // a small alphabet with high bytes forces deep buckets and duplicates
+            key.push_back(static_cast<char>(j < 2 ? 0xF0 + rand() % 3 : rand() % 4));
+        }
+        keys.push_back(key);
+    }
+
+    MasstreeBulkLoad load(keys.size(), 12);
+    for (int i = 0; i < numKeys; i++) {
+        load.add(keys[i].data(), static_cast<int>(keys[i].size()), &keys[i]);
+    }
+    load.sort();
+    ASSERT_EQ(numKeys, static_cast<int>(load.size()));
+
+    vector<string> expected(keys);
+    sort(expected.begin(), expected.end(), byteLess);
+    for (int i = 0; i < numKeys; i++) {
+        string actual(load.key(i), load.keyLength(i));
+        ASSERT_TRUE(actual == expected[i]);
+        // the address still belongs to the key it was added with
+        ASSERT_TRUE(*static_cast<const string*>(load.address(i)) == actual);
+    }
+}
+
+TEST_F(IndexBulkLoadTest, EqualRanges) {
+    const int64_t values[] = { 7, 3, 7, 1, 3, 7 };
+    MasstreeBulkLoad load(6, sizeof(int64_t));
+    for (int i = 0; i < 6; i++) {
+        load.add(reinterpret_cast<const char*>(&values[i]), sizeof(int64_t), &values[i]);
+    }
+    load.sort();
+
+    size_t groups = 0;
+    for (size_t i = 0; i < load.size(); i = load.equalRangeEnd(i)) {
+        groups++;
+    }
+    ASSERT_EQ(3, static_cast<int>(groups));
+    ASSERT_EQ(1, static_cast<int>(load.equalRangeEnd(0)));
+    ASSERT_EQ(3, static_cast<int>(load.equalRangeEnd(1)));
+    ASSERT_EQ(6, static_cast<int>(load.equalRangeEnd(3)));
+}
+
+// index types only the factory may construct
+template <typename Index>
+class TestIndex : public Index {
+public:
+    TestIndex(const TableIndexScheme &scheme) : Index(scheme) {}
+};
+
+static const int NUM_TUPLES = 1000;
+static const int NUM_GROUPS = 10;
+static const string columnNames[2] = { "ID", "GRP" };
+
+/**
+ * A table whose index inserts are deferred, so the indexes are filled by
+ * addEntries() in one batch the way recovery loads them.
+ */
+class IndexAddEntriesTest : public Test {
+public:
+    IndexAddEntriesTest() {
+        m_undo = new DummyUndoQuantum();
+        m_context = new ExecutorContext(0, 0, m_undo, NULL, false, 0, "", 0);
+
+        vector<ValueType> types(2, VALUE_TYPE_BIGINT);
+        vector<int32_t> lengths(2, NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(2, false);
+        m_schema = TupleSchema::createTupleSchema(types, lengths, allowNull, true);
+
+        vector<int32_t> pkeyColumns(1, 0);
+        vector<ValueType> keyTypes(1, VALUE_TYPE_BIGINT);
+        TableIndexScheme pkey("LOAD_PK", BALANCED_TREE_INDEX, pkeyColumns,
+                              keyTypes, true, true, m_schema);
+        vector<int32_t> groupColumns(1, 1);
+        vector<TableIndexScheme> indexes;
+        indexes.push_back(TableIndexScheme("LOAD_GRP", BALANCED_TREE_INDEX, groupColumns,
+                                           keyTypes, false, true, m_schema));
+        m_table = dynamic_cast<PersistentTable*>(
+            TableFactory::getPersistentTable(0, m_context, "LOAD", m_schema, columnNames,
+                                             pkey, indexes, -1, false, false));
+    }
+
+    ~IndexAddEntriesTest() {
+        delete m_table;
+        delete m_context;
+        delete m_undo;
+    }
+
+    // inserts the ids in random order with the index inserts held back
+    void load() {
+        vector<int64_t> ids;
+        for (int64_t id = 0; id < NUM_TUPLES; id++)
+            ids.push_back(id);
+        random_shuffle(ids.begin(), ids.end());
+
+        m_table->setDeferIndexInserts(true);
+        TableTuple &tuple = m_table->tempTuple();
+        for (int i = 0; i < NUM_TUPLES; i++) {
+            tuple.setNValue(0, ValueFactory::getBigIntValue(ids[i]));
+            tuple.setNValue(1, ValueFactory::getBigIntValue(ids[i] % NUM_GROUPS));
+            m_table->insertTuple(tuple);
+        }
+        m_table->setDeferIndexInserts(false);
+    }
+
+    // ID of the tuple the primary key finds for id, -1 if there is none
+    int64_t lookup(int64_t id) {
+        TableTuple search(m_table->schema());
+        char data[64];
+        search.move(data);
+        search.setNValue(0, ValueFactory::getBigIntValue(id));
+        search.setNValue(1, ValueFactory::getBigIntValue(0));
+        TableIndex *index = m_table->primaryKeyIndex();
+        if (!index->moveToTuple(&search))
+            return -1;
+        TableTuple found = index->nextValueAtKey();
+        if (found.isNullTuple())
+            return -1;
+        return ValuePeeker::peekAsBigInt(found.getNValue(0));
+    }
+
+    // tuples index has under group, -1 if one is in the wrong group
+    int groupCount(TableIndex *index, int64_t group) {
+        TableTuple search(m_table->schema());
+        char data[64];
+        search.move(data);
+        search.setNValue(0, ValueFactory::getBigIntValue(0));
+        search.setNValue(1, ValueFactory::getBigIntValue(group));
+        if (!index->moveToTuple(&search))
+            return 0;
+        int count = 0;
+        TableTuple found;
+        while (!(found = index->nextValueAtKey()).isNullTuple()) {
+            if (ValuePeeker::peekAsBigInt(found.getNValue(0)) % NUM_GROUPS != group)
+                return -1;
+            count++;
+        }
+        return count;
+    }
+
+    bool holdsAll() {
+        if (m_table->primaryKeyIndex()->getSize() != NUM_TUPLES)
+            return false;
+        for (int64_t id = 0; id < NUM_TUPLES; id++) {
+            if (lookup(id) != id)
+                return false;
+        }
+        if (lookup(NUM_TUPLES) != -1)
+            return false;
+        for (int64_t group = 0; group < NUM_GROUPS; group++) {
+            if (groupCount(m_table->index("LOAD_GRP"), group) != NUM_TUPLES / NUM_GROUPS)
+                return false;
+        }
+        return true;
+    }
+
+    // an index on GRP the way the factory would set it up for the table
+    TableIndexScheme groupScheme() {
+        vector<int32_t> groupColumns(1, 1);
+        vector<ValueType> keyTypes(1, VALUE_TYPE_BIGINT);
+        TableIndexScheme scheme("LOAD_MT_GRP", BALANCED_TREE_INDEX, groupColumns,
+                                keyTypes, false, true, m_schema);
+        vector<int32_t> lengths(1, NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(1, true);
+        scheme.keySchema = TupleSchema::createTupleSchema(keyTypes, lengths, allowNull, true);
+        return scheme;
+    }
+
+    bool loadsGroups(TableIndex *index) {
+        index->setTupleTables(m_table, NULL);
+        vector<void*> addresses;
+        TableTuple tuple(m_table->schema());
+        TableIterator iterator = m_table->tableIterator();
+        while (iterator.next(tuple))
+            addresses.push_back(tuple.address());
+        if (!index->addEntries(addresses) || index->getSize() != NUM_TUPLES)
+            return false;
+        for (int64_t group = 0; group < NUM_GROUPS; group++) {
+            if (groupCount(index, group) != NUM_TUPLES / NUM_GROUPS)
+                return false;
+        }
+        return true;
+    }
+
+    DummyUndoQuantum *m_undo;
+    ExecutorContext *m_context;
+    // owned by m_table
+    TupleSchema *m_schema;
+    PersistentTable *m_table;
+};
+
+/**
+ * Both the unique and the non-unique index find every tuple of the batch
+ * under its own key.
+ */
+TEST_F(IndexAddEntriesTest, DeferredInserts) {
+    load();
+    ASSERT_EQ(NUM_TUPLES, m_table->activeTupleCount());
+    ASSERT_TRUE(holdsAll());
+}
+
+/**
+ * The Masstree multimaps store each run of equal keys as one entry and
+ * still find every tuple in it.
+ */
+TEST_F(IndexAddEntriesTest, MultiMapIndexes) {
+    load();
+    TestIndex<MasstreeOrderedMultiMapIndex<IntsKey<1>, IntsComparator<1>,
+                                           IntsEqualityChecker<1> > > ordered(groupScheme());
+    ASSERT_TRUE(loadsGroups(&ordered));
+    TestIndex<MasstreeMultiMapIndex<IntsKey<1>, IntsComparator<1>,
+                                    IntsEqualityChecker<1> > > hashed(groupScheme());
+    ASSERT_TRUE(loadsGroups(&hashed));
+}
+
+/**
+ * A batch of keys the unique index already holds is turned away without
+ * touching what is there.
+ */
+TEST_F(IndexAddEntriesTest, DuplicateKeys) {
+    load();
+    vector<void*> addresses;
+    TableTuple tuple(m_table->schema());
+    TableIterator iterator = m_table->tableIterator();
+    while (addresses.size() < 10 && iterator.next(tuple))
+        addresses.push_back(tuple.address());
+
+    ASSERT_FALSE(m_table->primaryKeyIndex()->addEntries(addresses));
+    ASSERT_TRUE(holdsAll());
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,261 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/executorcontext.hpp"
+#include "common/TupleSchema.h"
+#include "common/types.h"
+#include "common/NValue.hpp"
+#include "common/ValueFactory.hpp"
+#include "common/ValuePeeker.hpp"
+#include "common/tabletuple.h"
+#include "common/DummyUndoQuantum.hpp"
+#include "indexes/tableindex.h"
+#include "indexes/IndexStats.h"
+#include "storage/persistenttable.h"
+#include "storage/tablefactory.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace voltdb;
+
+static const int NUM_TUPLES = 1000;
+static const string columnNames[2] = { "ID", "VALUE" };
+
+/**
+ * Copies of one replicated table, as the partitions of a host would load
+ * them, sharing the static stage of their primary key index.
+ */
+class IndexShareTest : public Test {
+public:
+    IndexShareTest() {
+        m_undo = new DummyUndoQuantum();
+        m_context = new ExecutorContext(0, 0, m_undo, NULL, false, 0, "", 0);
+    }
+
+    ~IndexShareTest() {
+        for (size_t i = 0; i < m_tables.size(); i++)
+            delete m_tables[i];
+        delete m_context;
+        delete m_undo;
+    }
+
+    static TupleSchema *createSchema() {
+        vector<ValueType> types(2, VALUE_TYPE_BIGINT);
+        vector<int32_t> lengths(2, NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(2, false);
+        return TupleSchema::createTupleSchema(types, lengths, allowNull, true);
+    }
+
+    // a replicated table holding NUM_TUPLES ids from firstId, VALUE = id * salt
+    PersistentTable *createTable(int64_t salt, int64_t firstId = 0) {
+        TupleSchema *schema = createSchema();
+        vector<int32_t> columnIndices(1, 0);
+        vector<ValueType> columnTypes(1, VALUE_TYPE_BIGINT);
+        TableIndexScheme pkey("REPL_PK", BALANCED_TREE_INDEX, columnIndices,
+                              columnTypes, true, true, schema);
+        PersistentTable *table = dynamic_cast<PersistentTable*>(
+            TableFactory::getPersistentTable(0, m_context, "REPL", schema,
+                                             columnNames, pkey, -1, false, false));
+        m_tables.push_back(table);
+
+        TableTuple tuple(schema);
+        char data[64];
+        tuple.move(data);
+        for (int64_t id = firstId; id < firstId + NUM_TUPLES; id++) {
+            tuple.setNValue(0, ValueFactory::getBigIntValue(id));
+            tuple.setNValue(1, ValueFactory::getBigIntValue(id * salt));
+            table->insertTuple(tuple);
+        }
+        return table;
+    }
+
+    void dropTable(PersistentTable *table) {
+        for (size_t i = 0; i < m_tables.size(); i++) {
+            if (m_tables[i] == table) {
+                m_tables.erase(m_tables.begin() + i);
+                break;
+            }
+        }
+        delete table;
+    }
+
+    static int64_t holders(PersistentTable *table) {
+        TableIndexDetailedStats stats;
+        table->primaryKeyIndex()->getDetailedStats(stats);
+        return stats.staticHolders;
+    }
+
+    // VALUE of the tuple the index finds for id, -1 if there is none
+    static int64_t lookup(PersistentTable *table, int64_t id) {
+        TableTuple search(table->schema());
+        char data[64];
+        search.move(data);
+        search.setNValue(0, ValueFactory::getBigIntValue(id));
+        search.setNValue(1, ValueFactory::getBigIntValue(0));
+        TableIndex *index = table->primaryKeyIndex();
+        if (!index->moveToTuple(&search))
+            return -1;
+        TableTuple found = index->nextValueAtKey();
+        if (found.isNullTuple())
+            return -1;
+        return ValuePeeker::peekAsBigInt(found.getNValue(1));
+    }
+
+    // every id but missing maps to its own tuple
+    static bool holdsAll(PersistentTable *table, int64_t salt, int64_t missing = -1) {
+        for (int64_t id = 0; id < NUM_TUPLES; id++) {
+            int64_t expected = id == missing ? -1 : id * salt;
+            if (lookup(table, id) != expected)
+                return false;
+        }
+        return true;
+    }
+
+    static void deleteId(PersistentTable *table, int64_t id) {
+        TableTuple search(table->schema());
+        char data[64];
+        search.move(data);
+        search.setNValue(0, ValueFactory::getBigIntValue(id));
+        search.setNValue(1, ValueFactory::getBigIntValue(0));
+        TableIndex *index = table->primaryKeyIndex();
+        index->moveToTuple(&search);
+        TableTuple target = index->nextValueAtKey();
+        table->deleteTuple(target, true);
+    }
+
+    DummyUndoQuantum *m_undo;
+    ExecutorContext *m_context;
+    vector<PersistentTable*> m_tables;
+};
+
+/**
+ * Copies with the same content attach to one stage; the first one to
+ * change a static entry takes a private copy and leaves the others
+ * attached.
+ */
+TEST_F(IndexShareTest, ShareAndUnshare) {
+    PersistentTable *a = createTable(3);
+    PersistentTable *b = createTable(3);
+    PersistentTable *c = createTable(3);
+    ASSERT_EQ(0, holders(a));
+
+    ASSERT_EQ(1, a->shareIndexStages());
+    ASSERT_EQ(1, holders(a));
+    ASSERT_EQ(1, b->shareIndexStages());
+    ASSERT_EQ(1, c->shareIndexStages());
+    ASSERT_EQ(3, holders(a));
+    ASSERT_EQ(3, holders(b));
+    ASSERT_EQ(3, holders(c));
+
+    // sharing again is a no-op
+    ASSERT_EQ(1, b->shareIndexStages());
+    ASSERT_EQ(3, holders(b));
+
+    ASSERT_TRUE(holdsAll(a, 3));
+    ASSERT_TRUE(holdsAll(b, 3));
+    ASSERT_TRUE(holdsAll(c, 3));
+
+    deleteId(a, 17);
+    ASSERT_EQ(0, holders(a));
+    ASSERT_EQ(2, holders(b));
+    ASSERT_EQ(2, holders(c));
+    ASSERT_TRUE(holdsAll(a, 3, 17));
+    ASSERT_TRUE(holdsAll(b, 3));
+    ASSERT_TRUE(holdsAll(c, 3));
+}
+
+/**
+ * Copies whose index content differs keep stages of their own. Columns
+ * outside the key don't count, the values are only tuple ids.
+ */
+TEST_F(IndexShareTest, DifferentContent) {
+    PersistentTable *a = createTable(3);
+    PersistentTable *b = createTable(5);
+    PersistentTable *c = createTable(3, 1);
+    ASSERT_EQ(1, a->shareIndexStages());
+    ASSERT_EQ(1, b->shareIndexStages());
+    ASSERT_EQ(1, c->shareIndexStages());
+    ASSERT_EQ(2, holders(a));
+    ASSERT_EQ(2, holders(b));
+    ASSERT_EQ(1, holders(c));
+    ASSERT_TRUE(holdsAll(a, 3));
+    ASSERT_TRUE(holdsAll(b, 5));
+    ASSERT_EQ(-1, lookup(c, 0));
+    ASSERT_EQ(3 * NUM_TUPLES, lookup(c, NUM_TUPLES));
+}
+
+/**
+ * The nodes live as long as somebody holds them. The last holder takes
+ * them over on its first change, and once every holder is gone the stage
+ * is no longer registered for new copies to find.
+ */
+TEST_F(IndexShareTest, LastHolder) {
+    PersistentTable *a = createTable(3);
+    PersistentTable *b = createTable(3);
+    a->shareIndexStages();
+    b->shareIndexStages();
+    ASSERT_EQ(2, holders(a));
+
+    dropTable(b);
+    ASSERT_EQ(1, holders(a));
+    ASSERT_TRUE(holdsAll(a, 3));
+
+    deleteId(a, 0);
+    ASSERT_EQ(0, holders(a));
+    ASSERT_TRUE(holdsAll(a, 3, 0));
+    dropTable(a);
+
+    PersistentTable *c = createTable(3);
+    PersistentTable *d = createTable(3);
+    c->shareIndexStages();
+    d->shareIndexStages();
+    ASSERT_EQ(2, holders(c));
+    ASSERT_EQ(2, holders(d));
+    dropTable(c);
+    ASSERT_EQ(1, holders(d));
+    ASSERT_TRUE(holdsAll(d, 3));
+}
+
+/**
+ * A tuple that belongs to neither table bound to the index can't be
+ * given an id, so the index turns it away instead of failing.
+ */
+TEST_F(IndexShareTest, ForeignTuple) {
+    PersistentTable *a = createTable(3);
+    TableTuple foreign(a->schema());
+    char data[64];
+    foreign.move(data);
+    foreign.setNValue(0, ValueFactory::getBigIntValue(NUM_TUPLES));
+    foreign.setNValue(1, ValueFactory::getBigIntValue(0));
+    ASSERT_FALSE(a->primaryKeyIndex()->addEntry(&foreign));
+    ASSERT_EQ(-1, lookup(a, NUM_TUPLES));
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,930 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+// after the standard headers, Masstree defines its own static_assert
+#include "masstree/config.h"
+#include "masstree/mtIndexAPI.hh"
+#include "masstree/str.hh"
+
+using namespace std;
+
+typedef mt_index<Masstree::default_table> MtIndex;
+
+/**
+ * Deterministic across runs and independent of rand(), which
+ * mt_index::setup() reseeds.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : m_state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    uint32_t next(uint32_t bound) {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return static_cast<uint32_t>((m_state * 0x2545F4914F6CDD1DULL) >> 33) % bound;
+    }
+
+private:
+    uint64_t m_state;
+};
+
+// key number as 8 big-endian bytes, so byte order is numeric order
+static string intKey(uint32_t n) {
+    char key[8];
+    uint64_t v = n;
+    for (int i = 7; i >= 0; i--) {
+        key[i] = static_cast<char>(v & 0xFF);
+        v >>= 8;
+    }
+    return string(key, 8);
+}
+
+typedef map<string, multiset<uint32_t> > MultiOracle;
+
+static size_t valueCount(const MultiOracle &oracle) {
+    size_t count = 0;
+    for (MultiOracle::const_iterator it = oracle.begin(); it != oracle.end(); ++it)
+        count += it->second.size();
+    return count;
+}
+
+/**
+ * An index set up the way MasstreeMultiMapIndex does it once bound to a
+ * table: 4-byte tuple ids, packed in the static stage.
+ */
+static void setupMultiMap(MtIndex &index, int keySize) {
+    index.setup(keySize, true);
+    index.set_value_len(4);
+    index.set_packed_static_values(true);
+}
+
+static bool multiMapGet(MtIndex &index, const string &key, multiset<uint32_t> &values) {
+    values.clear();
+    Str dynamicValue, staticValue;
+    if (!index.get_nuv(key.data(), static_cast<int>(key.size()), dynamicValue, staticValue))
+        return false;
+    for (int i = 0; i + 4 <= dynamicValue.len; i += 4) {
+        uint32_t value;
+        memcpy(&value, dynamicValue.s + i, 4);
+        values.insert(value);
+    }
+    for (int i = 0; i + 4 <= staticValue.len; i += 4) {
+        uint32_t value;
+        memcpy(&value, staticValue.s + i, 4);
+        values.insert(value);
+    }
+    return true;
+}
+
+// every key the oracle has, and only those, with the same values
+static bool multiMapMatches(MtIndex &index, const MultiOracle &oracle, uint32_t keySpace) {
+    multiset<uint32_t> values;
+    for (uint32_t n = 0; n < keySpace; n++) {
+        string key = intKey(n);
+        MultiOracle::const_iterator it = oracle.find(key);
+        bool found = multiMapGet(index, key, values);
+        if (it == oracle.end()) {
+            if (found)
+                return false;
+        } else if (!found || values != it->second) {
+            return false;
+        }
+    }
+    return static_cast<size_t>(index.get_ic() + index.get_sic()) == valueCount(oracle);
+}
+
+// a value the oracle holds for key, or a random one
+static uint32_t pickValue(Random &random, const MultiOracle &oracle, const string &key) {
+    MultiOracle::const_iterator it = oracle.find(key);
+    if (it == oracle.end() || it->second.empty() || random.next(10) == 0)
+        return random.next(1000);
+    multiset<uint32_t>::const_iterator v = it->second.begin();
+    advance(v, random.next(static_cast<uint32_t>(it->second.size())));
+    return *v;
+}
+
+/**
+ * Random puts, removes and replaces against std::map, with merges into
+ * the packed static stage happening along the way. Checks every key
+ * after each round.
+ */
+static bool multiMapRandomOps(uint64_t seed) {
+    const uint32_t keySpace = 2000;
+    Random random(seed);
+    MtIndex index;
+    setupMultiMap(index, 8);
+    MultiOracle oracle;
+
+    for (int round = 0; round < 10; round++) {
+        for (int op = 0; op < 10000; op++) {
+            string key = intKey(random.next(keySpace));
+            uint32_t choice = random.next(100);
+            if (choice < 55) {
+                uint32_t value = random.next(1000);
+                index.put_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4);
+                oracle[key].insert(value);
+            } else if (choice < 80) {
+                uint32_t value = pickValue(random, oracle, key);
+                bool expected = false;
+                MultiOracle::iterator it = oracle.find(key);
+                if (it != oracle.end() && it->second.count(value) > 0) {
+                    it->second.erase(it->second.find(value));
+                    if (it->second.empty())
+                        oracle.erase(it);
+                    expected = true;
+                }
+                if (index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4) != expected)
+                    return false;
+            } else if (choice < 95) {
+                uint32_t oldValue = pickValue(random, oracle, key);
+                uint32_t newValue = random.next(1000);
+                bool expected = false;
+                MultiOracle::iterator it = oracle.find(key);
+                if (it != oracle.end() && it->second.count(oldValue) > 0) {
+                    it->second.erase(it->second.find(oldValue));
+                    it->second.insert(newValue);
+                    expected = true;
+                }
+                if (index.replace(key.data(), 8, reinterpret_cast<const char*>(&newValue), 4,
+                                  reinterpret_cast<const char*>(&oldValue), 4) != expected)
+                    return false;
+            } else {
+                multiset<uint32_t> values;
+                bool found = multiMapGet(index, key, values);
+                MultiOracle::const_iterator it = oracle.find(key);
+                if (found != (it != oracle.end()) || (found && values != it->second))
+                    return false;
+            }
+        }
+        if (!multiMapMatches(index, oracle, keySpace))
+            return false;
+    }
+    if (index.get_merge_count() == 0)
+        return false;
+    // whatever is left in the dynamic stage packs just the same
+    index.merge();
+    return index.get_ic() == 0 && multiMapMatches(index, oracle, keySpace);
+}
+
+// mostly close together, sometimes far apart, so deltas take 1 to 5 bytes
+static uint32_t spreadValue(Random &random) {
+    switch (random.next(4)) {
+    case 0:
+        return random.next(0xffffffffU);
+    case 1:
+        return random.next(1U << 20);
+    default:
+        return random.next(5000);
+    }
+}
+
+/**
+ * One key holding thousands of values in the packed static stage, with
+ * single values inserted, removed and replaced in the encoded list one
+ * at a time: at the front, at the back, among duplicates and ones that
+ * are not there. Ends by removing every value, which removes the key.
+ */
+static bool multiMapManyValues(uint64_t seed) {
+    Random random(seed);
+    MtIndex index;
+    setupMultiMap(index, 8);
+    MultiOracle oracle;
+    const string key = intKey(7);
+    multiset<uint32_t> &values = oracle[key];
+
+    for (int i = 0; i < 3000; i++) {
+        uint32_t value = spreadValue(random);
+        index.put_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4);
+        values.insert(value);
+    }
+    for (uint32_t n = 0; n < 20; n++) {
+        uint32_t value = n;
+        string other = intKey(n * 3);
+        index.put_nuv(other.data(), 8, reinterpret_cast<const char*>(&value), 4);
+        oracle[other].insert(value);
+    }
+    index.merge();
+    if (index.get_ic() != 0 || !multiMapMatches(index, oracle, 64))
+        return false;
+
+    multiset<uint32_t> found;
+    for (int op = 0; op < 3000; op++) {
+        uint32_t choice = random.next(10);
+        uint32_t value;
+        if (choice < 3) {
+            value = spreadValue(random);
+            index.put_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4);
+            values.insert(value);
+        } else if (choice < 7) {
+            if (choice == 3)
+                value = *values.begin();
+            else if (choice == 4)
+                value = *values.rbegin();
+            else
+                value = pickValue(random, oracle, key);
+            bool expected = values.count(value) > 0;
+            if (expected)
+                values.erase(values.find(value));
+            if (index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4) != expected)
+                return false;
+        } else {
+            uint32_t oldValue = pickValue(random, oracle, key);
+            value = random.next(2) == 0 ? oldValue + 1 : spreadValue(random);
+            bool expected = values.count(oldValue) > 0;
+            if (expected) {
+                values.erase(values.find(oldValue));
+                values.insert(value);
+            }
+            if (index.replace(key.data(), 8, reinterpret_cast<const char*>(&value), 4,
+                              reinterpret_cast<const char*>(&oldValue), 4) != expected)
+                return false;
+        }
+        if (op % 100 == 0 && (!multiMapGet(index, key, found) || found != values))
+            return false;
+    }
+    // every change went into the static row
+    if (index.get_ic() != 0 || !multiMapMatches(index, oracle, 64))
+        return false;
+
+    while (!values.empty()) {
+        uint32_t value = pickValue(random, oracle, key);
+        if (values.count(value) == 0)
+            continue;
+        values.erase(values.find(value));
+        if (!index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4))
+            return false;
+    }
+    oracle.erase(key);
+    return !multiMapGet(index, key, found) && multiMapMatches(index, oracle, 64);
+}
+
+typedef map<string, uint64_t> UniqueOracle;
+
+/**
+ * A 32-byte key in three 8-byte layers plus a tail: keys share their
+ * first slice in groups, and the suffixes within a group share all but
+ * their last bytes, like composite varchar keys do.
+ */
+static string layeredKey(uint32_t n) {
+    string key(24, 'a');
+    key[7] = static_cast<char>('a' + n % 4);
+    key[15] = static_cast<char>('a' + (n / 4) % 8);
+    key[23] = static_cast<char>('a' + (n / 32) % 2);
+    return key + intKey(n);
+}
+
+static bool uniqueGet(MtIndex &index, const string &key, uint64_t &value) {
+    Str found;
+    if (!index.get(key.data(), static_cast<int>(key.size()), found))
+        return false;
+    if (found.len != 8)
+        return false;
+    memcpy(&value, found.s, 8);
+    return true;
+}
+
+static bool uniqueMatches(MtIndex &index, const UniqueOracle &oracle, uint32_t keySpace) {
+    for (uint32_t n = 0; n < keySpace; n++) {
+        string key = layeredKey(n);
+        UniqueOracle::const_iterator it = oracle.find(key);
+        uint64_t value;
+        bool found = uniqueGet(index, key, value);
+        if (found != (it != oracle.end()) || (found && value != it->second))
+            return false;
+    }
+    return static_cast<size_t>(index.get_ic() + index.get_sic()) == oracle.size();
+}
+
+/**
+ * Random inserts, removes and in-place updates on layered string keys,
+ * the way MasstreeOrderedUniqueIndex drives a GenericKey index. Merges
+ * rewrite the static nodes, front-coded suffixes and all, while keys of
+ * other layers are still queued, which is where add_item_to_node used to
+ * point a queued task at the wrong parent.
+ */
+static bool uniqueRandomOps(uint64_t seed) {
+    const uint32_t keySpace = 3000;
+    const int keySize = 32;
+    Random random(seed);
+    MtIndex index;
+    index.setup(keySize, keySize, false);
+    UniqueOracle oracle;
+
+    for (int round = 0; round < 10; round++) {
+        for (int op = 0; op < 10000; op++) {
+            string key = layeredKey(random.next(keySpace));
+            uint64_t value = random.next(1000000);
+            uint32_t choice = random.next(100);
+            if (choice < 50) {
+                bool expected = oracle.insert(make_pair(key, value)).second;
+                if (index.put_uv(key.data(), keySize, reinterpret_cast<const char*>(&value), 8) != expected)
+                    return false;
+            } else if (choice < 80) {
+                bool expected = oracle.erase(key) > 0;
+                if (index.remove(key.data(), keySize) != expected)
+                    return false;
+            } else if (choice < 90) {
+                UniqueOracle::iterator it = oracle.find(key);
+                if (it == oracle.end())
+                    continue;
+                it->second = value;
+                if (!index.update_uv(key.data(), keySize, reinterpret_cast<const char*>(&value)))
+                    return false;
+            } else {
+                UniqueOracle::const_iterator it = oracle.find(key);
+                uint64_t found;
+                bool exists = uniqueGet(index, key, found);
+                if (exists != (it != oracle.end()) || (exists && found != it->second))
+                    return false;
+            }
+        }
+        if (!uniqueMatches(index, oracle, keySpace))
+            return false;
+    }
+    if (index.get_merge_count() == 0)
+        return false;
+    index.merge();
+    return index.get_ic() == 0 && uniqueMatches(index, oracle, keySpace);
+}
+
+/**
+ * Removes every other key out of a fully merged static stage, then
+ * compacts it. Every node is past the dead-slot ratio, so no tombstone
+ * is left, and the keys that stayed are still found with their values.
+ */
+static bool uniqueCompact() {
+    const uint32_t keySpace = 5000;
+    MtIndex index;
+    index.setup(32, 32, false);
+    UniqueOracle oracle;
+    for (uint32_t n = 0; n < keySpace; n++) {
+        string key = layeredKey(n);
+        uint64_t value = n * 7;
+        index.put_uv(key.data(), 32, reinterpret_cast<const char*>(&value), 8);
+        oracle[key] = value;
+    }
+    index.merge();
+    for (uint32_t n = 0; n < keySpace; n += 2) {
+        string key = layeredKey(n);
+        if (!index.remove(key.data(), 32))
+            return false;
+        oracle.erase(key);
+    }
+    if (index.get_sdead() != static_cast<int>(keySpace / 2) || !uniqueMatches(index, oracle, keySpace))
+        return false;
+    index.compact_static();
+    return index.get_sdead() == 0 && uniqueMatches(index, oracle, keySpace);
+}
+
+static bool multiMapCompact() {
+    const uint32_t keySpace = 5000;
+    MtIndex index;
+    setupMultiMap(index, 8);
+    MultiOracle oracle;
+    for (uint32_t n = 0; n < keySpace; n++) {
+        string key = intKey(n);
+        for (uint32_t value = 0; value <= n % 3; value++) {
+            index.put_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4);
+            oracle[key].insert(value);
+        }
+    }
+    index.merge();
+    for (uint32_t n = 0; n < keySpace; n += 2) {
+        string key = intKey(n);
+        for (uint32_t value = 0; value <= n % 3; value++) {
+            if (!index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&value), 4))
+                return false;
+        }
+        oracle.erase(key);
+    }
+    if (index.get_sdead() != static_cast<int>(keySpace / 2) || !multiMapMatches(index, oracle, keySpace))
+        return false;
+    index.compact_static();
+    return index.get_sdead() == 0 && multiMapMatches(index, oracle, keySpace);
+}
+
+// appends up to limit more values of the scan in progress
+static void readNext(MtIndex &index, size_t limit, vector<uint64_t> &values) {
+    Str found;
+    for (size_t i = 0; i < limit && index.get_next(found); i++) {
+        uint64_t value;
+        memcpy(&value, found.s, 8);
+        values.push_back(value);
+    }
+}
+
+/**
+ * Positions a range scan at the first key >= start (> start unless
+ * orEqual) and reads up to limit values, the way
+ * MasstreeOrderedUniqueIndex drives moveToKeyOrGreater and nextValue.
+ */
+static void scanFrom(MtIndex &index, const string &start, bool orEqual, size_t limit,
+                     vector<uint64_t> &values) {
+    values.clear();
+    if (orEqual)
+        index.get_upper_bound_or_equal(start.data(), static_cast<int>(start.size()));
+    else
+        index.get_upper_bound(start.data(), static_cast<int>(start.size()));
+    readNext(index, limit, values);
+}
+
+// what scanFrom should return
+static vector<uint64_t> oracleFrom(const UniqueOracle &oracle, const string &start, bool orEqual,
+                                   size_t limit) {
+    vector<uint64_t> values;
+    UniqueOracle::const_iterator it = orEqual ? oracle.lower_bound(start) : oracle.upper_bound(start);
+    for (; it != oracle.end() && values.size() < limit; ++it)
+        values.push_back(it->second);
+    return values;
+}
+
+/**
+ * An index with keys in both stages and tombstones in the static one:
+ * two thirds of the keys merged, a ninth of those removed again, and a
+ * few hundred in the dynamic stage, too few to set off another merge.
+ * isStatic tells for each key which stage it is in.
+ */
+static void twoStageIndex(MtIndex &index, UniqueOracle &oracle, map<string, bool> &isStatic,
+                          uint32_t keySpace, Random &random) {
+    index.setup(32, 32, false);
+    for (uint32_t n = 0; n < keySpace; n++) {
+        if (n % 3 == 0)
+            continue;
+        string key = layeredKey(n);
+        uint64_t value = n;
+        index.put_uv(key.data(), 32, reinterpret_cast<const char*>(&value), 8);
+        oracle[key] = value;
+        isStatic[key] = true;
+    }
+    index.merge();
+    for (uint32_t n = 1; n < keySpace; n += 9) {
+        string key = layeredKey(n);
+        index.remove(key.data(), 32);
+        oracle.erase(key);
+        isStatic.erase(key);
+    }
+    for (uint32_t n = 0; n < keySpace; n += 3) {
+        if (random.next(10) != 0)
+            continue;
+        string key = layeredKey(n);
+        uint64_t value = n;
+        index.put_uv(key.data(), 32, reinterpret_cast<const char*>(&value), 8);
+        oracle[key] = value;
+        isStatic[key] = false;
+    }
+}
+
+// first key after key in the given stage, "" if there is none
+static string stageNext(const map<string, bool> &isStatic, const string &key, bool inStatic) {
+    for (map<string, bool>::const_iterator it = isStatic.upper_bound(key); it != isStatic.end(); ++it) {
+        if (it->second == inStatic)
+            return it->first;
+    }
+    return string();
+}
+
+/**
+ * Range scans over both stages, from random start keys, with and
+ * without the start key, compared with std::map. Ranges run to the last
+ * key, start past it and start on it.
+ */
+static bool uniqueRangeScans(uint64_t seed) {
+    const uint32_t keySpace = 6000;
+    Random random(seed);
+    MtIndex index;
+    UniqueOracle oracle;
+    map<string, bool> isStatic;
+    twoStageIndex(index, oracle, isStatic, keySpace, random);
+    if (index.get_ic() == 0)
+        return false;
+
+    vector<uint64_t> values;
+    for (int scan = 0; scan < 300; scan++) {
+        string start = layeredKey(random.next(keySpace + 10));
+        bool orEqual = random.next(2) == 0;
+        // some ranges run to the end
+        size_t limit = random.next(4) == 0 ? keySpace : 1 + random.next(80);
+        scanFrom(index, start, orEqual, limit, values);
+        if (values != oracleFrom(oracle, start, orEqual, limit))
+            return false;
+        // a scan that ended stays ended
+        if (values.size() < limit) {
+            readNext(index, 1, values);
+            if (values != oracleFrom(oracle, start, orEqual, limit))
+                return false;
+        }
+    }
+
+    // the whole index from the first key
+    values.clear();
+    if (!index.get_first())
+        return false;
+    readNext(index, keySpace, values);
+    if (values != oracleFrom(oracle, string(), true, keySpace))
+        return false;
+
+    // empty ranges: past the last key, and after it
+    string last = oracle.rbegin()->first;
+    string past = last + "z";
+    scanFrom(index, past, true, keySpace, values);
+    if (!values.empty())
+        return false;
+    scanFrom(index, last, false, keySpace, values);
+    if (!values.empty())
+        return false;
+    scanFrom(index, last, true, keySpace, values);
+    return values.size() == 1 && values[0] == oracle.rbegin()->second;
+}
+
+/**
+ * A scan left parked between calls while keys are inserted and removed
+ * ahead of it, in both stages, picks up the current content. The next
+ * key of each stage is looked up ahead of time, so changes are only made
+ * beyond both of those, except for removing the dynamic one, which the
+ * cursor has to step over.
+ */
+static bool uniqueScanResume(uint64_t seed) {
+    const uint32_t keySpace = 6000;
+    Random random(seed);
+    MtIndex index;
+    UniqueOracle oracle;
+    map<string, bool> isStatic;
+    twoStageIndex(index, oracle, isStatic, keySpace, random);
+    uint64_t merges = index.get_merge_count();
+
+    for (int scan = 0; scan < 50; scan++) {
+        string start = layeredKey(random.next(keySpace));
+        size_t first = 1 + random.next(40);
+        if (scan % 2 == 0) {
+            // stop right before a dynamic key, so the dynamic stage is the
+            // one to return next and removing its key is felt
+            string dynamicKey = stageNext(isStatic, start, false);
+            UniqueOracle::const_iterator at = oracle.find(dynamicKey);
+            if (at != oracle.begin() && at != oracle.end()) {
+                start = (--at)->first;
+                first = 1;
+            }
+        }
+        vector<uint64_t> values;
+        scanFrom(index, start, true, first, values);
+        vector<uint64_t> expected = oracleFrom(oracle, start, true, first);
+        if (values != expected)
+            return false;
+        if (values.size() < first)
+            continue;
+
+        // last key the scan returned
+        UniqueOracle::const_iterator it = oracle.lower_bound(start);
+        advance(it, first - 1);
+        string last = it->first;
+        string dynamicNext = stageNext(isStatic, last, false);
+        string staticNext = stageNext(isStatic, last, true);
+        string bound = max(dynamicNext, staticNext);
+
+        if (!dynamicNext.empty() && random.next(2) == 0) {
+            if (!index.remove(dynamicNext.data(), 32))
+                return false;
+            oracle.erase(dynamicNext);
+            isStatic.erase(dynamicNext);
+        }
+        for (int change = 0; change < 4; change++) {
+            uint32_t n = random.next(keySpace + 100);
+            string key = layeredKey(n);
+            if (bound.empty() || key <= bound)
+                continue;
+            if (oracle.count(key) > 0) {
+                if (!index.remove(key.data(), 32))
+                    return false;
+                oracle.erase(key);
+                isStatic.erase(key);
+            } else {
+                uint64_t value = n;
+                if (!index.put_uv(key.data(), 32, reinterpret_cast<const char*>(&value), 8))
+                    return false;
+                oracle[key] = value;
+                isStatic[key] = false;
+            }
+        }
+
+        readNext(index, keySpace, values);
+        vector<uint64_t> rest = oracleFrom(oracle, last, false, keySpace);
+        expected.insert(expected.end(), rest.begin(), rest.end());
+        if (values != expected)
+            return false;
+    }
+    // the changes stayed below the merge threshold
+    return index.get_merge_count() == merges;
+}
+
+/**
+ * A scan started after a merge emptied the dynamic stage, or on a
+ * fresh index, must not pick up where an earlier scan left off.
+ */
+static bool scanAfterMerge() {
+    MtIndex index;
+    index.setup(32, 32, false);
+    UniqueOracle oracle;
+    vector<uint64_t> values;
+    if (index.get_first() || index.get_upper_bound_or_equal(layeredKey(0).data(), 32))
+        return false;
+    readNext(index, 10, values);
+    if (!values.empty())
+        return false;
+
+    for (uint32_t n = 0; n < 50; n++) {
+        string key = layeredKey(n);
+        uint64_t value = n;
+        index.put_uv(key.data(), 32, reinterpret_cast<const char*>(&value), 8);
+        oracle[key] = value;
+    }
+    // parks the dynamic cursor mid-range
+    scanFrom(index, layeredKey(0), true, 5, values);
+    if (values != oracleFrom(oracle, layeredKey(0), true, 5))
+        return false;
+    index.merge();
+    string start = oracle.rbegin()->first;
+    scanFrom(index, start, true, 100, values);
+    if (values != oracleFrom(oracle, start, true, 100))
+        return false;
+
+    // and the other way round, an index that never merged
+    MtIndex dynamicOnly;
+    dynamicOnly.setup(32, 32, false);
+    for (uint32_t n = 0; n < 50; n++) {
+        string key = layeredKey(n);
+        uint64_t value = n;
+        dynamicOnly.put_uv(key.data(), 32, reinterpret_cast<const char*>(&value), 8);
+    }
+    scanFrom(dynamicOnly, start, true, 100, values);
+    return values == oracleFrom(oracle, start, true, 100);
+}
+
+/**
+ * Unique indexes keep the 8-byte tuple address inline in the dynamic
+ * leaf. Values use all eight bytes, like pointers do, and go through
+ * insert, upsert, update and remove before a merge copies them into the
+ * static stage, where they are read back by lookup and by range scan
+ * and then updated and removed again. 8-byte keys merge through
+ * buildStatic_quick, longer ones through buildStatic.
+ */
+static bool inlineUniqueValues(int keySize) {
+    const uint32_t keyCount = 90;
+    MtIndex index;
+    index.setup(keySize, keySize, false);
+    UniqueOracle oracle;
+    vector<string> keys;
+    for (uint32_t n = 0; n < keyCount; n++)
+        keys.push_back(keySize == 8 ? intKey(n) : layeredKey(n));
+
+    for (uint32_t n = 0; n < keyCount; n++) {
+        uint64_t value = 0x00007f0000000000ULL + n * 64;
+        if (!index.put_uv(keys[n].data(), keySize, reinterpret_cast<const char*>(&value), 8))
+            return false;
+        oracle[keys[n]] = value;
+    }
+    // a duplicate is refused and leaves the first value
+    uint64_t other = 1;
+    if (index.put_uv(keys[0].data(), keySize, reinterpret_cast<const char*>(&other), 8))
+        return false;
+    // an upsert over an inline value replaces it without counting the key twice
+    for (uint32_t n = 0; n < keyCount; n += 3) {
+        uint64_t value = ~static_cast<uint64_t>(n);
+        index.put(keys[n].data(), keySize, reinterpret_cast<const char*>(&value), 8);
+        oracle[keys[n]] = value;
+    }
+    for (uint32_t n = 1; n < keyCount; n += 3) {
+        uint64_t value = 0xfedcba9876543210ULL ^ n;
+        if (!index.update_uv(keys[n].data(), keySize, reinterpret_cast<const char*>(&value)))
+            return false;
+        oracle[keys[n]] = value;
+    }
+    for (uint32_t n = 2; n < keyCount; n += 9) {
+        if (!index.remove(keys[n].data(), keySize))
+            return false;
+        oracle.erase(keys[n]);
+    }
+    if (index.get_merge_count() != 0 || static_cast<size_t>(index.get_ic()) != oracle.size())
+        return false;
+
+    vector<uint64_t> values;
+    for (int stage = 0; stage < 2; stage++) {
+        for (UniqueOracle::const_iterator it = oracle.begin(); it != oracle.end(); ++it) {
+            uint64_t value;
+            if (!uniqueGet(index, it->first, value) || value != it->second)
+                return false;
+        }
+        values.clear();
+        if (!index.get_first())
+            return false;
+        readNext(index, keyCount, values);
+        if (values != oracleFrom(oracle, string(), true, keyCount))
+            return false;
+        if (stage == 0) {
+            index.merge();
+            if (index.get_ic() != 0 || static_cast<size_t>(index.get_sic()) != oracle.size())
+                return false;
+        }
+    }
+
+    // and changed again in the static stage
+    for (uint32_t n = 0; n < keyCount; n += 4) {
+        UniqueOracle::iterator it = oracle.find(keys[n]);
+        if (it == oracle.end())
+            continue;
+        it->second = 0x0000123400000000ULL + n;
+        if (!index.update_uv(keys[n].data(), keySize, reinterpret_cast<const char*>(&it->second)))
+            return false;
+    }
+    for (uint32_t n = 5; n < keyCount; n += 7) {
+        if (index.remove(keys[n].data(), keySize) != (oracle.erase(keys[n]) > 0))
+            return false;
+    }
+    for (uint32_t n = 0; n < keyCount; n++) {
+        UniqueOracle::const_iterator it = oracle.find(keys[n]);
+        uint64_t value;
+        bool found = uniqueGet(index, keys[n], value);
+        if (found != (it != oracle.end()) || (found && value != it->second))
+            return false;
+    }
+    return static_cast<size_t>(index.get_ic() + index.get_sic()) == oracle.size();
+}
+
+class MasstreeTest : public Test {
+public:
+    MasstreeTest() {}
+};
+
+TEST_F(MasstreeTest, MultiMapRandomOps) {
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        ASSERT_TRUE(multiMapRandomOps(seed));
+    }
+}
+
+TEST_F(MasstreeTest, MultiMapManyValues) {
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        ASSERT_TRUE(multiMapManyValues(seed));
+    }
+}
+
+TEST_F(MasstreeTest, UniqueRandomOps) {
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        ASSERT_TRUE(uniqueRandomOps(seed));
+    }
+}
+
+TEST_F(MasstreeTest, InlineUniqueValues) {
+    ASSERT_TRUE(inlineUniqueValues(8));
+    ASSERT_TRUE(inlineUniqueValues(32));
+}
+
+TEST_F(MasstreeTest, RangeScans) {
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        ASSERT_TRUE(uniqueRangeScans(seed));
+    }
+}
+
+TEST_F(MasstreeTest, ScanResume) {
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        ASSERT_TRUE(uniqueScanResume(seed));
+    }
+}
+
+TEST_F(MasstreeTest, ScanAfterMerge) {
+    ASSERT_TRUE(scanAfterMerge());
+}
+
+TEST_F(MasstreeTest, CompactStatic) {
+    ASSERT_TRUE(uniqueCompact());
+    ASSERT_TRUE(multiMapCompact());
+}
+
+/**
+ * Taking the last value of a static key removes the key, and counts
+ * that value once, not twice.
+ */
+TEST_F(MasstreeTest, RemoveLastStaticValue) {
+    MtIndex index;
+    setupMultiMap(index, 8);
+    string key = intKey(1);
+    string other = intKey(2);
+    uint32_t values[2] = { 10, 20 };
+    index.put_nuv(key.data(), 8, reinterpret_cast<const char*>(&values[0]), 4);
+    index.put_nuv(key.data(), 8, reinterpret_cast<const char*>(&values[1]), 4);
+    index.put_nuv(other.data(), 8, reinterpret_cast<const char*>(&values[0]), 4);
+    index.merge();
+    ASSERT_EQ(0, index.get_ic());
+    ASSERT_EQ(3, index.get_sic());
+
+    ASSERT_TRUE(index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&values[0]), 4));
+    ASSERT_EQ(2, index.get_sic());
+    ASSERT_EQ(0, index.get_sdead());
+    ASSERT_TRUE(index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&values[1]), 4));
+    ASSERT_EQ(1, index.get_sic());
+    ASSERT_EQ(1, index.get_sdead());
+    ASSERT_FALSE(index.remove_nuv(key.data(), 8, reinterpret_cast<const char*>(&values[1]), 4));
+    ASSERT_EQ(1, index.get_sic());
+
+    multiset<uint32_t> found;
+    ASSERT_FALSE(multiMapGet(index, key, found));
+    ASSERT_TRUE(multiMapGet(index, other, found));
+    ASSERT_EQ(1, static_cast<int>(found.size()));
+    ASSERT_EQ(values[0], *found.begin());
+}
+
+/**
+ * Every point lookup counts as a dynamic hit, a static hit or a miss,
+ * and every lookup that goes past the dynamic stage as either a Bloom
+ * filter negative or a false positive.
+ */
+TEST_F(MasstreeTest, StageCounters) {
+    MtIndex index;
+    index.setup(8, false);
+    for (uint32_t n = 0; n < 1000; n++) {
+        string key = intKey(n);
+        uint64_t value = n;
+        index.put_uv(key.data(), 8, reinterpret_cast<const char*>(&value), 8);
+    }
+    index.merge();
+    for (uint32_t n = 1000; n < 1050; n++) {
+        string key = intKey(n);
+        uint64_t value = n;
+        index.put_uv(key.data(), 8, reinterpret_cast<const char*>(&value), 8);
+    }
+    ASSERT_EQ(50, index.get_ic());
+    ASSERT_EQ(1000, index.get_sic());
+
+    mt_index_stats before;
+    index.get_stats(before);
+    ASSERT_TRUE(before.merges > 0);
+    ASSERT_EQ(index.get_merge_count(), before.merges);
+    uint64_t pauses = 0;
+    for (int b = 0; b < MERGE_PAUSE_BUCKETS; b++)
+        pauses += before.merge_pause[b];
+    ASSERT_EQ(before.merges, pauses);
+    ASSERT_TRUE(before.merge_usec_max <= before.merge_usec_total);
+    ASSERT_TRUE(before.static_bytes > 0);
+    ASSERT_TRUE(before.dynamic_bytes > 0);
+    ASSERT_TRUE(before.filter_bytes > 0);
+    ASSERT_EQ(0, before.value_bytes);
+    uint64_t leaves = 0;
+    for (int b = 0; b < LEAF_FILL_BUCKETS; b++)
+        leaves += before.leaf_fill[b];
+    ASSERT_TRUE(leaves > 0);
+
+    Str value;
+    for (uint32_t n = 0; n < 3000; n++) {
+        string key = intKey(n);
+        ASSERT_EQ(n < 1050, index.get(key.data(), 8, value));
+    }
+
+    mt_index_stats after;
+    index.get_stats(after);
+    ASSERT_EQ(50, after.dynamic_hits - before.dynamic_hits);
+    ASSERT_EQ(1000, after.static_hits - before.static_hits);
+    ASSERT_EQ(1950, after.misses - before.misses);
+    ASSERT_EQ(2950, (after.bloom_negatives - before.bloom_negatives)
+              + (after.bloom_false_positives - before.bloom_false_positives));
+    ASSERT_EQ(before.merges, after.merges);
+
+    for (uint32_t n = 0; n < 100; n++) {
+        string key = intKey(n);
+        ASSERT_TRUE(index.remove(key.data(), 8));
+    }
+    index.get_stats(after);
+    ASSERT_EQ(100, after.static_dead);
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,239 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2010 VoltDB Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/FatalException.hpp"
+#include "common/TupleSchema.h"
+#include "common/tabletuple.h"
+#include "common/serializeio.h"
+#include "common/ValueFactory.hpp"
+#include "execution/VoltDBEngine.h"
+#include "logging/AriesLogProxy.h"
+#include "logging/Logrecord.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <stdint.h>
+
+using namespace std;
+using namespace voltdb;
+
+static const char *LOG_FILE = "aries_log_proxy_test.log";
+
+class AriesLogProxyTest : public Test {
+public:
+    AriesLogProxyTest() {
+        vector<ValueType> types(2, VALUE_TYPE_BIGINT);
+        vector<int32_t> sizes(2, NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(2, false);
+        m_schema = TupleSchema::createTupleSchema(types, sizes, allowNull, true);
+        m_tupleData = new char[m_schema->tupleLength() + TUPLE_HEADER_SIZE];
+        m_tuple = TableTuple(m_tupleData, m_schema);
+
+        m_engine.setARIESEnabled(true);
+        m_engine.setARIESFile(LOG_FILE);
+        ::unlink(LOG_FILE);
+    }
+
+    ~AriesLogProxyTest() {
+        ::unlink(LOG_FILE);
+        delete[] m_tupleData;
+        TupleSchema::freeTupleSchema(m_schema);
+    }
+
+    AriesLogProxy* openLog() {
+        return AriesLogProxy::getAriesLogProxy(&m_engine);
+    }
+
+    // append an insert record for txnId, returns its length
+    size_t logInsert(AriesLogProxy *proxy, int64_t txnId) {
+        m_tuple.setNValue(0, ValueFactory::getBigIntValue(txnId));
+        m_tuple.setNValue(1, ValueFactory::getBigIntValue(txnId * 7));
+        LogRecord record(0, LogRecord::T_INSERT, LogRecord::T_FORWARD, 0, txnId, 0,
+                         "T", 1, NULL, 0, NULL, NULL, &m_tuple);
+        m_out.reset();
+        record.serializeTo(m_out);
+        proxy->logBinaryOutput(m_out.data(), m_out.size());
+        return m_out.size();
+    }
+
+    static int64_t fileSize() {
+        struct stat st;
+        if (::stat(LOG_FILE, &st) != 0) {
+            return -1;
+        }
+        return st.st_size;
+    }
+
+    // txn ids of the whole records in the log file, in order
+    static vector<int64_t> readTxnIds() {
+        vector<int64_t> txnIds;
+        int64_t size = fileSize();
+        if (size <= 0) {
+            return txnIds;
+        }
+        vector<char> data(static_cast<size_t>(size));
+        FILE *file = ::fopen(LOG_FILE, "rb");
+        size_t read = ::fread(&data[0], 1, data.size(), file);
+        ::fclose(file);
+
+        size_t pos = 0;
+        while (pos < read) {
+            int8_t type;
+            int64_t txnId;
+            int32_t siteId;
+            if (!LogRecord::peekHeader(&data[pos], read - pos, type, txnId, siteId)) {
+                break;
+            }
+            int32_t recordSize;
+            ::memcpy(&recordSize, &data[pos], sizeof(recordSize));
+            pos += sizeof(recordSize) + ntohl(recordSize);
+            if (pos > read) {
+                break;
+            }
+            txnIds.push_back(txnId);
+        }
+        return txnIds;
+    }
+
+    VoltDBEngine m_engine;
+    TupleSchema *m_schema;
+    char *m_tupleData;
+    TableTuple m_tuple;
+    CopySerializeOutput m_out;
+};
+
+/*
+ * Log more than a ring's worth of records with a commit now and then.
+ * Every commit must come back with everything logged so far durable,
+ * and the file must hold exactly the records, in order.
+ */
+TEST_F(AriesLogProxyTest, GroupCommit) {
+    AriesLogProxy *proxy = openLog();
+    ASSERT_TRUE(proxy != NULL);
+
+    const int64_t records = 300000;
+    int64_t logged = 0;
+    for (int64_t txnId = 0; txnId < records; txnId++) {
+        logged += static_cast<int64_t>(logInsert(proxy, txnId));
+        if (txnId % 1000 == 999) {
+            ASSERT_EQ(logged, proxy->waitForDurableLSN());
+        }
+    }
+    ASSERT_TRUE(logged > ARIES_LOG_BUFFER_SIZE);
+    ASSERT_EQ(logged, proxy->waitForDurableLSN());
+
+    // a commit with nothing new to flush doesn't wait
+    ASSERT_EQ(logged, proxy->waitForDurableLSN());
+
+    // records logged after the last commit are flushed on close
+    logged += static_cast<int64_t>(logInsert(proxy, records));
+    delete proxy;
+    ASSERT_EQ(logged, fileSize());
+
+    vector<int64_t> txnIds = readTxnIds();
+    ASSERT_EQ(records + 1, static_cast<int64_t>(txnIds.size()));
+    for (int64_t txnId = 0; txnId <= records; txnId++) {
+        ASSERT_EQ(txnId, txnIds[static_cast<size_t>(txnId)]);
+    }
+}
+
+/*
+ * A crash can leave a record half written, or zero fill past the last
+ * record. Reopening trims the file to the last whole record and new
+ * records go right after it.
+ */
+TEST_F(AriesLogProxyTest, TornTail) {
+    AriesLogProxy *proxy = openLog();
+    int64_t lastRecordStart = 0;
+    for (int64_t txnId = 0; txnId < 10; txnId++) {
+        lastRecordStart = proxy->waitForDurableLSN();
+        logInsert(proxy, txnId);
+    }
+    delete proxy;
+    int64_t end = fileSize();
+    ASSERT_TRUE(end > lastRecordStart);
+
+    // cut the last record in half
+    ASSERT_EQ(0, ::truncate(LOG_FILE, lastRecordStart + (end - lastRecordStart) / 2));
+    proxy = openLog();
+    ASSERT_EQ(lastRecordStart, fileSize());
+    ASSERT_EQ(lastRecordStart, proxy->waitForDurableLSN());
+    logInsert(proxy, 100);
+    int64_t reopenedEnd = proxy->waitForDurableLSN();
+    delete proxy;
+
+    // zero fill after the records, as a segment extension leaves it
+    ASSERT_EQ(0, ::truncate(LOG_FILE, reopenedEnd + 4096));
+    proxy = openLog();
+    ASSERT_EQ(reopenedEnd, fileSize());
+    logInsert(proxy, 101);
+    delete proxy;
+
+    vector<int64_t> txnIds = readTxnIds();
+    ASSERT_EQ(11, static_cast<int>(txnIds.size()));
+    for (int64_t txnId = 0; txnId < 9; txnId++) {
+        ASSERT_EQ(txnId, txnIds[static_cast<size_t>(txnId)]);
+    }
+    ASSERT_EQ(100, txnIds[9]);
+    ASSERT_EQ(101, txnIds[10]);
+}
+
+/*
+ * When the log can't be written the commit fails rather than
+ * reporting records durable that never reached the disk.
+ */
+TEST_F(AriesLogProxyTest, WriteFailure) {
+    m_engine.setARIESFile("/dev/full");
+    AriesLogProxy *proxy = openLog();
+    ASSERT_TRUE(proxy != NULL);
+
+    logInsert(proxy, 0);
+    bool threw = false;
+    try {
+        proxy->waitForDurableLSN();
+    } catch (FatalException &e) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+
+    // the flusher has stopped, so further records are refused as well
+    threw = false;
+    try {
+        logInsert(proxy, 1);
+    } catch (FatalException &e) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    delete proxy;
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,240 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2010 VoltDB Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/tabletuple.h"
+#include "common/serializeio.h"
+#include "common/ValueFactory.hpp"
+#include "common/ValuePeeker.hpp"
+#include "execution/VoltDBEngine.h"
+#include "logging/AriesReplayer.h"
+#include "logging/Logrecord.h"
+#include "storage/persistenttable.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace voltdb;
+
+static const int32_t SITE_ID = 0;
+static const int32_t OTHER_SITE_ID = 1;
+
+class AriesReplayerTest : public Test {
+public:
+    AriesReplayerTest() {
+        string catalogString = "add / clusters cluster"
+            "\nadd /clusters[cluster] databases database"
+            "\nadd /clusters[cluster]/databases[database] programs program"
+            "\nadd /clusters[cluster]/databases[database] tables STOCK"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK] type 0"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK] isreplicated false"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK] partitioncolumn 0"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK] estimatedtuplecount 0"
+            "\nadd /clusters[cluster]/databases[database]/tables[STOCK] columns S_I_ID"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_I_ID] index 0"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_I_ID] type 5"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_I_ID] size 0"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_I_ID] nullable false"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_I_ID] name \"S_I_ID\""
+            "\nadd /clusters[cluster]/databases[database]/tables[STOCK] columns S_QUANTITY"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_QUANTITY] index 1"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_QUANTITY] type 5"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_QUANTITY] size 0"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_QUANTITY] nullable false"
+            "\nset /clusters[cluster]/databases[database]/tables[STOCK]/columns[S_QUANTITY] name \"S_QUANTITY\"";
+
+        m_engine = new VoltDBEngine();
+        m_engine->initialize(0, SITE_ID, 0, 0, "");
+        m_engine->loadCatalog(catalogString);
+        m_tableId = m_engine->getTableId("STOCK");
+        m_table = dynamic_cast<PersistentTable*>(m_engine->getTable(m_tableId));
+
+        m_tupleData = new char[m_table->schema()->tupleLength() + TUPLE_HEADER_SIZE];
+        m_tuple = TableTuple(m_tupleData, m_table->schema());
+    }
+
+    ~AriesReplayerTest() {
+        delete[] m_tupleData;
+        delete m_engine;
+    }
+
+    void logRecord(LogRecord::Logrec_type_t type, int64_t txnId, int32_t siteId,
+                   const string &tableName, int32_t tableId) {
+        m_tuple.setNValue(0, ValueFactory::getIntegerValue(static_cast<int32_t>(txnId)));
+        m_tuple.setNValue(1, ValueFactory::getIntegerValue(static_cast<int32_t>(txnId * 3)));
+        TableTuple *beforeImage = type == LogRecord::T_INSERT ? NULL : &m_tuple;
+        TableTuple *afterImage = type == LogRecord::T_DELETE ? NULL : &m_tuple;
+        vector<int32_t> columns(1, 1);
+        LogRecord record(0, type, LogRecord::T_FORWARD, 0, txnId, siteId, tableName, tableId,
+                         NULL, type == LogRecord::T_UPDATE ? 1 : 0,
+                         type == LogRecord::T_UPDATE ? &columns : NULL,
+                         beforeImage, afterImage);
+        record.serializeTo(m_log);
+    }
+
+    void logInsert(int64_t txnId, int32_t siteId = SITE_ID) {
+        logRecord(LogRecord::T_INSERT, txnId, siteId, m_table->name(), m_tableId);
+    }
+
+    // checks the parsed insert of txnId and frees its after image
+    void checkInsert(AriesReplayRecord &replayRecord, int64_t txnId) {
+        ASSERT_EQ(static_cast<int8_t>(LogRecord::T_INSERT), replayRecord.type);
+        ASSERT_TRUE(replayRecord.record != NULL);
+        ASSERT_TRUE(replayRecord.table == m_table);
+
+        TableTuple *afterImage = replayRecord.record->getTupleAfterImage();
+        ASSERT_TRUE(afterImage != NULL);
+        ASSERT_EQ(txnId, ValuePeeker::peekAsBigInt(afterImage->getNValue(0)));
+        ASSERT_EQ(txnId * 3, ValuePeeker::peekAsBigInt(afterImage->getNValue(1)));
+        replayRecord.record->dellocateAfterImageData();
+        delete afterImage;
+    }
+
+    VoltDBEngine *m_engine;
+    int32_t m_tableId;
+    PersistentTable *m_table;
+    char *m_tupleData;
+    TableTuple m_tuple;
+    CopySerializeOutput m_log;
+};
+
+/*
+ * A log of several batches comes back in log order, in batches of at
+ * most ARIES_REPLAY_BATCH_SIZE, with every insert parsed by one of the
+ * parser threads. Records of other sites and from before the replay
+ * point are counted as skipped.
+ */
+TEST_F(AriesReplayerTest, Batches) {
+    const int64_t replayTxnId = 100;
+    const int64_t lastTxnId = replayTxnId + ARIES_REPLAY_BATCH_SIZE * 5 / 2;
+    int64_t skipped = 0;
+    for (int64_t txnId = 0; txnId <= lastTxnId; txnId++) {
+        logInsert(txnId);
+        if (txnId % 10 == 0) {
+            logInsert(txnId, OTHER_SITE_ID);
+            skipped++;
+        }
+    }
+    skipped += replayTxnId;
+
+    AriesReplayer replayer(m_engine, m_log.data(), m_log.size(), replayTxnId, SITE_ID);
+    int64_t txnId = replayTxnId;
+    int batches = 0;
+    while (true) {
+        vector<AriesReplayRecord> &batch = replayer.nextBatch();
+        if (batch.empty()) {
+            break;
+        }
+        batches++;
+        ASSERT_TRUE(batch.size() <= ARIES_REPLAY_BATCH_SIZE);
+        for (size_t i = 0; i < batch.size(); i++) {
+            checkInsert(batch[i], txnId++);
+        }
+    }
+    ASSERT_EQ(lastTxnId + 1, txnId);
+    ASSERT_EQ(3, batches);
+    ASSERT_EQ(skipped, replayer.getSkippedCount());
+
+    // the end of the log stays the end
+    ASSERT_TRUE(replayer.nextBatch().empty());
+}
+
+/*
+ * The parser threads split a batch by stride; with fewer records than
+ * threads each record still gets parsed, and records that aren't
+ * inserts are left for the engine thread to populate.
+ */
+TEST_F(AriesReplayerTest, SmallBatch) {
+    for (int records = 1; records <= ARIES_REPLAY_PARSE_THREADS + 1; records++) {
+        m_log.reset();
+        for (int64_t txnId = 0; txnId < records; txnId++) {
+            logInsert(txnId);
+        }
+        logRecord(LogRecord::T_DELETE, records, SITE_ID, m_table->name(), m_tableId);
+
+        AriesReplayer replayer(m_engine, m_log.data(), m_log.size(), 0, SITE_ID);
+        vector<AriesReplayRecord> &batch = replayer.nextBatch();
+        ASSERT_EQ(records + 1, static_cast<int>(batch.size()));
+        for (int64_t txnId = 0; txnId < records; txnId++) {
+            checkInsert(batch[static_cast<size_t>(txnId)], txnId);
+        }
+        AriesReplayRecord &deleteRecord = batch[static_cast<size_t>(records)];
+        ASSERT_EQ(static_cast<int8_t>(LogRecord::T_DELETE), deleteRecord.type);
+        ASSERT_TRUE(deleteRecord.record != NULL);
+        ASSERT_TRUE(deleteRecord.table == m_table);
+        ASSERT_TRUE(deleteRecord.record->getTupleBeforeImage() == NULL);
+        ASSERT_TRUE(replayer.nextBatch().empty());
+    }
+}
+
+/*
+ * Tables are found by catalog id or, for records that name them, by
+ * name; a table that doesn't exist comes back NULL.
+ */
+TEST_F(AriesReplayerTest, Tables) {
+    logRecord(LogRecord::T_INSERT, 0, SITE_ID, m_table->name(), -1);
+    logRecord(LogRecord::T_INSERT, 1, SITE_ID, "NO_SUCH_TABLE", -1);
+    logRecord(LogRecord::T_INSERT, 2, SITE_ID, m_table->name(), m_tableId + 100);
+
+    AriesReplayer replayer(m_engine, m_log.data(), m_log.size(), 0, SITE_ID);
+    vector<AriesReplayRecord> &batch = replayer.nextBatch();
+    ASSERT_EQ(3, static_cast<int>(batch.size()));
+    checkInsert(batch[0], 0);
+    ASSERT_TRUE(batch[1].table == NULL);
+    ASSERT_TRUE(batch[2].table == NULL);
+}
+
+/*
+ * A torn record or the writer's zero fill ends the log.
+ */
+TEST_F(AriesReplayerTest, TornTail) {
+    for (int64_t txnId = 0; txnId < 10; txnId++) {
+        logInsert(txnId);
+    }
+    size_t wholeRecords = m_log.size();
+    logInsert(10);
+
+    AriesReplayer torn(m_engine, m_log.data(), m_log.size() - 3, 0, SITE_ID);
+    vector<AriesReplayRecord> &batch = torn.nextBatch();
+    ASSERT_EQ(10, static_cast<int>(batch.size()));
+    for (int64_t txnId = 0; txnId < 10; txnId++) {
+        checkInsert(batch[static_cast<size_t>(txnId)], txnId);
+    }
+    ASSERT_TRUE(torn.nextBatch().empty());
+
+    vector<char> zeroFilled(m_log.data(), m_log.data() + wholeRecords);
+    zeroFilled.resize(wholeRecords + 4096, 0);
+    AriesReplayer filled(m_engine, &zeroFilled[0], zeroFilled.size(), 0, SITE_ID);
+    vector<AriesReplayRecord> &filledBatch = filled.nextBatch();
+    ASSERT_EQ(10, static_cast<int>(filledBatch.size()));
+    for (int64_t txnId = 0; txnId < 10; txnId++) {
+        checkInsert(filledBatch[static_cast<size_t>(txnId)], txnId);
+    }
+    ASSERT_TRUE(filled.nextBatch().empty());
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -0,0 +1,368 @@
+/* This file is part of VoltDB.
+ * Copyright (C) 2008-2010 VoltDB Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/TupleSchema.h"
+#include "common/tabletuple.h"
+#include "common/serializeio.h"
+#include "common/SerializableEEException.h"
+#include "common/ValueFactory.hpp"
+#include "execution/VoltDBEngine.h"
+#include "indexes/tableindex.h"
+#include "logging/Logrecord.h"
+#include "storage/persistenttable.h"
+#include "storage/tablefactory.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <arpa/inet.h>
+#include <stdint.h>
+
+using namespace std;
+using namespace voltdb;
+
+static const int32_t TABLE_ID = 7;
+static const int32_t SITE_ID = 3;
+
+/**
+ * Log records of a table (ID INTEGER primary key, NAME VARCHAR(16)
+ * inlined, NOTE VARCHAR(300) uninlined, QTY BIGINT) written with
+ * serializeTo and read back the way replay reads them.
+ */
+class LogRecordTest : public Test {
+public:
+    LogRecordTest() {
+        m_engine = new VoltDBEngine();
+        m_engine->initialize(1, 1, 0, 0, "");
+
+        vector<ValueType> types;
+        vector<int32_t> sizes;
+        types.push_back(VALUE_TYPE_INTEGER);
+        sizes.push_back(NValue::getTupleStorageSize(VALUE_TYPE_INTEGER));
+        types.push_back(VALUE_TYPE_VARCHAR);
+        sizes.push_back(16);
+        types.push_back(VALUE_TYPE_VARCHAR);
+        sizes.push_back(300);
+        types.push_back(VALUE_TYPE_BIGINT);
+        sizes.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(4, true);
+        allowNull[0] = false;
+        TupleSchema *schema = TupleSchema::createTupleSchema(types, sizes, allowNull, true);
+
+        vector<ValueType> keyTypes(1, VALUE_TYPE_INTEGER);
+        vector<int32_t> keySizes(1, NValue::getTupleStorageSize(VALUE_TYPE_INTEGER));
+        vector<bool> keyAllowNull(1, false);
+        vector<int32_t> keyColumns(1, 0);
+        TableIndexScheme pkeyScheme("pkey", BALANCED_TREE_INDEX, keyColumns, keyTypes,
+                                    true, false, schema);
+        m_keySchema = TupleSchema::createTupleSchema(keyTypes, keySizes, keyAllowNull, true);
+        pkeyScheme.keySchema = m_keySchema;
+
+        string columnNames[] = { "ID", "NAME", "NOTE", "QTY" };
+        vector<TableIndexScheme> indexes;
+        m_table = dynamic_cast<PersistentTable*>(TableFactory::getPersistentTable(
+                0, m_engine->getExecutorContext(), "Foo", schema, columnNames,
+                pkeyScheme, indexes, 0, false, false));
+
+        m_data[0] = new char[schema->tupleLength() + TUPLE_HEADER_SIZE]();
+        m_data[1] = new char[schema->tupleLength() + TUPLE_HEADER_SIZE]();
+        m_before = TableTuple(m_data[0], schema);
+        m_after = TableTuple(m_data[1], schema);
+    }
+
+    ~LogRecordTest() {
+        m_before.freeObjectColumns();
+        m_after.freeObjectColumns();
+        delete[] m_data[0];
+        delete[] m_data[1];
+        delete m_table;
+        delete m_engine;
+        TupleSchema::freeTupleSchema(m_keySchema);
+    }
+
+    static void setRow(TableTuple &tuple, int32_t id, const char *name, const char *note, int64_t qty) {
+        tuple.freeObjectColumns();
+        tuple.setNValue(0, ValueFactory::getIntegerValue(id));
+        tuple.setNValueAllocateForObjectCopies(1, name == NULL ? ValueFactory::getNullStringValue() :
+                                               ValueFactory::getStringValue(name), NULL);
+        tuple.setNValueAllocateForObjectCopies(2, note == NULL ? ValueFactory::getNullStringValue() :
+                                               ValueFactory::getStringValue(note), NULL);
+        tuple.setNValue(3, ValueFactory::getBigIntValue(qty));
+    }
+
+    void serialize(LogRecord &record) {
+        m_out.reset();
+        record.serializeTo(m_out);
+    }
+
+    // parse what serialize wrote, checking the header fields on the way
+    LogRecord* parse(LogRecord::Logrec_type_t type, int64_t txnId) {
+        int8_t peekedType;
+        int64_t peekedTxnId;
+        int32_t peekedSiteId;
+        if (!LogRecord::peekHeader(m_out.data(), m_out.size(), peekedType, peekedTxnId, peekedSiteId) ||
+                peekedType != static_cast<int8_t>(type) || peekedTxnId != txnId ||
+                peekedSiteId != SITE_ID) {
+            return NULL;
+        }
+
+        ReferenceSerializeInput input(m_out.data(), m_out.size());
+        LogRecord *record = new LogRecord(input);
+        if (record->getType() != type) {
+            delete record;
+            return NULL;
+        }
+        record->populateFields(m_table->schema(), m_table->primaryKeyIndex());
+        return record;
+    }
+
+    static bool equalRows(const TableTuple &expected, const TableTuple &actual) {
+        for (int i = 0; i < expected.sizeInValues(); i++) {
+            NValue expectedValue = expected.getNValue(i);
+            NValue actualValue = actual.getNValue(i);
+            if (expectedValue.isNull() || actualValue.isNull()) {
+                if (expectedValue.isNull() != actualValue.isNull()) {
+                    return false;
+                }
+            } else if (expectedValue.compare(actualValue) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // releases the images replay would have released, ownsBefore if the
+    // before image came with the record rather than from the table
+    static void freeImages(LogRecord *record, bool ownsBefore) {
+        TableTuple *afterImage = record->getTupleAfterImage();
+        if (afterImage != NULL) {
+            afterImage->freeObjectColumns();
+            delete afterImage;
+        }
+        record->dellocateAfterImageData();
+
+        TableTuple *beforeImage = record->getTupleBeforeImage();
+        if (beforeImage != NULL) {
+            if (ownsBefore) {
+                beforeImage->freeObjectColumns();
+            }
+            delete beforeImage;
+        }
+        record->dellocateBeforeImageData();
+        delete record;
+    }
+
+    VoltDBEngine *m_engine;
+    PersistentTable *m_table;
+    TupleSchema *m_keySchema;
+    char *m_data[2];
+    TableTuple m_before;
+    TableTuple m_after;
+    CopySerializeOutput m_out;
+};
+
+TEST_F(LogRecordTest, Insert) {
+    setRow(m_after, 42, "short name", string(250, 'n').c_str(), -5);
+    LogRecord record(0, LogRecord::T_INSERT, LogRecord::T_FORWARD, 0, 1000, SITE_ID,
+                     m_table->name(), TABLE_ID, NULL, -1, NULL, NULL, &m_after);
+    serialize(record);
+    ASSERT_TRUE(m_out.size() <= record.getEstimatedLength());
+
+    LogRecord *parsed = parse(LogRecord::T_INSERT, 1000);
+    ASSERT_TRUE(parsed != NULL);
+    ASSERT_EQ(TABLE_ID, parsed->getTableId());
+    ASSERT_TRUE(parsed->isValidRecord());
+    ASSERT_TRUE(parsed->getTupleBeforeImage() == NULL);
+    ASSERT_TRUE(parsed->getTupleAfterImage() != NULL);
+    ASSERT_TRUE(equalRows(m_after, *parsed->getTupleAfterImage()));
+    freeImages(parsed, true);
+
+    // null strings, a table given by name and a txn id taking several
+    // varint bytes
+    const int64_t bigTxnId = (static_cast<int64_t>(1) << 50) + 3;
+    setRow(m_after, -1, NULL, NULL, INT64_MAX);
+    LogRecord named(0, LogRecord::T_INSERT, LogRecord::T_FORWARD, 0, bigTxnId, SITE_ID,
+                    m_table->name(), -1, NULL, -1, NULL, NULL, &m_after);
+    serialize(named);
+    ASSERT_TRUE(m_out.size() <= named.getEstimatedLength());
+
+    parsed = parse(LogRecord::T_INSERT, bigTxnId);
+    ASSERT_TRUE(parsed != NULL);
+    ASSERT_EQ(-1, parsed->getTableId());
+    ASSERT_TRUE(parsed->getTableName() == m_table->name());
+    ASSERT_TRUE(equalRows(m_after, *parsed->getTupleAfterImage()));
+    freeImages(parsed, true);
+}
+
+/*
+ * Without a primary key an update carries the whole before image; the
+ * after image is either the whole new row or, as the update executor
+ * passes it, a tuple address followed by the changed columns.
+ */
+TEST_F(LogRecordTest, UpdateWithBeforeImage) {
+    setRow(m_before, 1, "before", "old note", 10);
+    setRow(m_after, 1, NULL, "new note", 11);
+    LogRecord record(0, LogRecord::T_UPDATE, LogRecord::T_FORWARD, 0, 2000, SITE_ID,
+                     m_table->name(), TABLE_ID, NULL, -1, NULL, &m_before, &m_after);
+    serialize(record);
+    ASSERT_TRUE(m_out.size() <= record.getEstimatedLength());
+
+    LogRecord *parsed = parse(LogRecord::T_UPDATE, 2000);
+    ASSERT_TRUE(parsed != NULL);
+    ASSERT_TRUE(parsed->getTupleBeforeImage() != NULL);
+    ASSERT_TRUE(equalRows(m_before, *parsed->getTupleBeforeImage()));
+    ASSERT_TRUE(equalRows(m_after, *parsed->getTupleAfterImage()));
+    freeImages(parsed, true);
+
+    vector<ValueType> changedTypes;
+    vector<int32_t> changedSizes;
+    changedTypes.push_back(VALUE_TYPE_BIGINT);
+    changedSizes.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+    changedTypes.push_back(VALUE_TYPE_BIGINT);
+    changedSizes.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+    changedTypes.push_back(VALUE_TYPE_VARCHAR);
+    changedSizes.push_back(300);
+    vector<bool> changedAllowNull(3, true);
+    TupleSchema *changedSchema = TupleSchema::createTupleSchema(changedTypes, changedSizes,
+                                                                changedAllowNull, true);
+    char *changedData = new char[changedSchema->tupleLength() + TUPLE_HEADER_SIZE]();
+    TableTuple changed(changedData, changedSchema);
+    changed.setNValue(0, ValueFactory::getBigIntValue(0));
+    changed.setNValue(1, ValueFactory::getBigIntValue(99));
+    changed.setNValueAllocateForObjectCopies(2, ValueFactory::getStringValue(string(280, 'x')), NULL);
+
+    // listed out of column order, as a SET clause may list them
+    vector<int32_t> columns;
+    columns.push_back(3);
+    columns.push_back(2);
+    LogRecord partial(0, LogRecord::T_UPDATE, LogRecord::T_FORWARD, 0, 2001, SITE_ID,
+                      m_table->name(), TABLE_ID, NULL, 2, &columns, &m_before, &changed);
+    serialize(partial);
+    ASSERT_TRUE(m_out.size() <= partial.getEstimatedLength());
+
+    parsed = parse(LogRecord::T_UPDATE, 2001);
+    ASSERT_TRUE(parsed != NULL);
+    setRow(m_after, 1, "before", string(280, 'x').c_str(), 99);
+    ASSERT_TRUE(equalRows(m_before, *parsed->getTupleBeforeImage()));
+    ASSERT_TRUE(equalRows(m_after, *parsed->getTupleAfterImage()));
+    freeImages(parsed, true);
+
+    changed.freeObjectColumns();
+    delete[] changedData;
+    TupleSchema::freeTupleSchema(changedSchema);
+}
+
+/*
+ * With a primary key, updates and deletes only carry the key and replay
+ * finds the before image through the primary key index.
+ */
+TEST_F(LogRecordTest, PrimaryKey) {
+    for (int32_t id = 0; id < 10; id++) {
+        setRow(m_before, id, "row", string(100, static_cast<char>('a' + id)).c_str(), id * 10);
+        m_table->insertTuple(m_before);
+    }
+
+    const TupleSchema *keySchema = m_table->primaryKeyIndex()->getKeySchema();
+    char *keyData = new char[keySchema->tupleLength() + TUPLE_HEADER_SIZE]();
+    TableTuple key(keyData, keySchema);
+    key.setNValue(0, ValueFactory::getIntegerValue(6));
+
+    setRow(m_before, 6, "row", string(100, 'g').c_str(), 60);
+    LogRecord deleteRecord(0, LogRecord::T_DELETE, LogRecord::T_FORWARD, 0, 3000, SITE_ID,
+                           m_table->name(), TABLE_ID, &key, -1, NULL, NULL, NULL);
+    serialize(deleteRecord);
+    ASSERT_TRUE(m_out.size() <= deleteRecord.getEstimatedLength());
+
+    LogRecord *parsed = parse(LogRecord::T_DELETE, 3000);
+    ASSERT_TRUE(parsed != NULL);
+    ASSERT_TRUE(parsed->getTupleBeforeImage() != NULL);
+    ASSERT_TRUE(parsed->getTupleAfterImage() == NULL);
+    ASSERT_TRUE(equalRows(m_before, *parsed->getTupleBeforeImage()));
+    freeImages(parsed, false);
+
+    key.setNValue(0, ValueFactory::getIntegerValue(2));
+    setRow(m_before, 2, "row", string(100, 'c').c_str(), 20);
+    setRow(m_after, 2, "renamed", string(100, 'c').c_str(), 21);
+    LogRecord updateRecord(0, LogRecord::T_UPDATE, LogRecord::T_FORWARD, 0, 3001, SITE_ID,
+                           m_table->name(), TABLE_ID, &key, -1, NULL, NULL, &m_after);
+    serialize(updateRecord);
+
+    parsed = parse(LogRecord::T_UPDATE, 3001);
+    ASSERT_TRUE(parsed != NULL);
+    ASSERT_TRUE(equalRows(m_before, *parsed->getTupleBeforeImage()));
+    ASSERT_TRUE(equalRows(m_after, *parsed->getTupleAfterImage()));
+    freeImages(parsed, false);
+
+    // a key that isn't in the table can't be replayed
+    key.setNValue(0, ValueFactory::getIntegerValue(42));
+    LogRecord missingRecord(0, LogRecord::T_UPDATE, LogRecord::T_FORWARD, 0, 3002, SITE_ID,
+                            m_table->name(), TABLE_ID, &key, -1, NULL, NULL, &m_after);
+    serialize(missingRecord);
+    ReferenceSerializeInput input(m_out.data(), m_out.size());
+    LogRecord missing(input);
+    bool thrown = false;
+    try {
+        missing.populateFields(m_table->schema(), m_table->primaryKeyIndex());
+    } catch (SerializableEEException &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    ASSERT_TRUE(missing.getTupleBeforeImage() == NULL);
+
+    delete[] keyData;
+}
+
+/*
+ * The header of a record cut short can't be peeked; replay and the log
+ * writer both stop at such a record.
+ */
+TEST_F(LogRecordTest, Truncated) {
+    const int64_t txnId = (static_cast<int64_t>(1) << 40) + 1;
+    setRow(m_after, 5, "name", "note", 50);
+    LogRecord record(0, LogRecord::T_INSERT, LogRecord::T_FORWARD, 0, txnId, SITE_ID,
+                     m_table->name(), TABLE_ID, NULL, -1, NULL, NULL, &m_after);
+    serialize(record);
+
+    // length header, marker, type, flags, then the two varints
+    size_t headerEnd = sizeof(int32_t) + 3 + 6 + 1;
+    int8_t type;
+    int64_t peekedTxnId;
+    int32_t siteId;
+    for (size_t available = 0; available < headerEnd; available++) {
+        ASSERT_FALSE(LogRecord::peekHeader(m_out.data(), available, type, peekedTxnId, siteId));
+    }
+    ASSERT_TRUE(LogRecord::peekHeader(m_out.data(), headerEnd, type, peekedTxnId, siteId));
+    ASSERT_EQ(static_cast<int8_t>(LogRecord::T_INSERT), type);
+    ASSERT_EQ(txnId, peekedTxnId);
+    ASSERT_EQ(SITE_ID, siteId);
+
+    // the length header covers exactly the record
+    int32_t recordSize;
+    ::memcpy(&recordSize, m_out.data(), sizeof(recordSize));
+    ASSERT_EQ(m_out.size(), sizeof(recordSize) + ntohl(recordSize));
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
@@ -34,7 +34,9 @@
 #include "indexes/tableindex.h"
 #include "storage/tableiterator.h"
 #include "storage/CopyOnWriteIterator.h"
+#include "storage/TupleBlockFormat.h"
 #include "common/DefaultTupleSerializer.h"
+#include "common/RecoveryProtoMessage.h"
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -358,6 +360,185 @@ TEST_F(CopyOnWriteTest, BigTest) {
     }
 }
 
+TEST_F(CopyOnWriteTest, BigTestBlockCopy) {
+    initTable(true);
+    addRandomUniqueTuples( m_table, 699048);
+    DefaultTupleSerializer serializer(true);
+    for (int qq = 0; qq < 10; qq++) {
+        std::set<int64_t> originalTuples;
+        voltdb::TableIterator iterator(m_table);
+        TableTuple tuple(m_table->schema());
+        while (iterator.next(tuple)) {
+            ASSERT_TRUE(originalTuples.insert(*reinterpret_cast<int64_t*>(tuple.address() + TUPLE_HEADER_SIZE)).second);
+        }
+
+        m_table->activateCopyOnWrite(&serializer, 0);
+
+        std::set<int64_t> COWTuples;
+        char serializationBuffer[131072];
+        while (true) {
+            ReferenceSerializeOutput out( serializationBuffer, 131072);
+            m_table->serializeMore(&out);
+            const int serialized = static_cast<int>(out.position());
+            if (out.position() == 0) {
+                break;
+            }
+            // skip partition id, its CRC and the chunk CRC, the row count is at the end
+            const int32_t rowCount = ntohl(*reinterpret_cast<int32_t*>(&serializationBuffer[serialized - 4]));
+            ReferenceSerializeInput in(&serializationBuffer[12], serialized - 16);
+            TupleBlockReader reader(in);
+            ASSERT_TRUE(reader.matches(m_table->schema(), m_table->schema()->tupleLength() + TUPLE_HEADER_SIZE));
+            int32_t found = 0;
+            const char *storage;
+            while ((storage = reader.next()) != NULL) {
+                ASSERT_TRUE(COWTuples.insert(*reinterpret_cast<const int64_t*>(storage + TUPLE_HEADER_SIZE)).second);
+                found++;
+            }
+            ASSERT_EQ(rowCount, found);
+            ASSERT_EQ(0, in.numBytesNotYetRead());
+            for (int jj = 0; jj < 10; jj++) {
+                doRandomTableMutation(m_table);
+            }
+        }
+
+        ASSERT_EQ(originalTuples.size(), COWTuples.size());
+        ASSERT_TRUE(originalTuples == COWTuples);
+
+        iterator = voltdb::TableIterator(m_table);
+        while (iterator.next(tuple)) {
+            ASSERT_FALSE(tuple.isDirty());
+        }
+    }
+}
+
+/*
+ * Block copied chunks load back through loadTuplesFromNoHeader and can be
+ * re-encoded as regular rows.
+ */
+TEST_F(CopyOnWriteTest, BlockCopyLoad) {
+    initTable(true);
+    addRandomUniqueTuples( m_table, 5000);
+    DefaultTupleSerializer serializer(true);
+    m_table->activateCopyOnWrite(&serializer, 0);
+
+    TupleSchema *copySchema = TupleSchema::createTupleSchema(m_tableSchema);
+    voltdb::TableIndexScheme indexScheme = voltdb::TableIndexScheme("primaryKeyIndex",
+                                                                    voltdb::BALANCED_TREE_INDEX,
+                                                                    m_primaryKeyIndexColumns,
+                                                                    m_primaryKeyIndexSchemaTypes,
+                                                                    true, false, copySchema);
+    indexScheme.keySchema = m_primaryKeyIndexSchema;
+    std::vector<voltdb::TableIndexScheme> indexes;
+    boost::scoped_ptr<PersistentTable> copy(dynamic_cast<voltdb::PersistentTable*>(
+            voltdb::TableFactory::getPersistentTable(0, m_engine->getExecutorContext(), "Bar",
+                                                     copySchema, &m_columnNames[0], indexScheme, indexes, 0,
+                                                     false, false)));
+
+    char serializationBuffer[131072];
+    char rowBuffer[262144];
+    int rows = 0;
+    while (true) {
+        ReferenceSerializeOutput out( serializationBuffer, 131072);
+        m_table->serializeMore(&out);
+        const int serialized = static_cast<int>(out.position());
+        if (serialized == 0) {
+            break;
+        }
+        // replace the chunk CRC with the row count, as the snapshot reader does
+        ::memcpy(&serializationBuffer[8], &serializationBuffer[serialized - 4], 4);
+        const int32_t rowCount = ntohl(*reinterpret_cast<int32_t*>(&serializationBuffer[8]));
+
+        ReferenceSerializeInput blocks(&serializationBuffer[12], serialized - 16);
+        ReferenceSerializeOutput rowOut(rowBuffer, sizeof(rowBuffer));
+        TupleBlockReader reader(blocks);
+        ASSERT_EQ(rowCount, reader.expandTo(rowOut));
+
+        ReferenceSerializeInput in(&serializationBuffer[8], serialized - 12);
+        copy->loadTuplesFromNoHeader(false, in);
+        rows += rowCount;
+    }
+    ASSERT_EQ(5000, rows);
+    ASSERT_EQ(5000, copy->activeTupleCount());
+
+    TableTuple tuple(m_table->schema());
+    voltdb::TableIterator iterator(m_table);
+    while (iterator.next(tuple)) {
+        TableTuple found = copy->lookupTuple(tuple);
+        ASSERT_FALSE(found.isNullTuple());
+        ASSERT_TRUE(found.isActive());
+        ASSERT_FALSE(found.isDirty());
+    }
+}
+
+/**
+ * Ship a table to an empty copy through the recovery stream. Scan messages are
+ * compressed and the copy only builds its indexes once the completion message
+ * arrives.
+ */
+TEST_F(CopyOnWriteTest, RecoveryStream) {
+    initTable(true);
+    addRandomUniqueTuples( m_table, 5000);
+
+    TupleSchema *copySchema = TupleSchema::createTupleSchema(m_tableSchema);
+    voltdb::TableIndexScheme indexScheme = voltdb::TableIndexScheme("primaryKeyIndex",
+                                                                    voltdb::BALANCED_TREE_INDEX,
+                                                                    m_primaryKeyIndexColumns,
+                                                                    m_primaryKeyIndexSchemaTypes,
+                                                                    true, false, copySchema);
+    indexScheme.keySchema = m_primaryKeyIndexSchema;
+    std::vector<voltdb::TableIndexScheme> indexes;
+    boost::scoped_ptr<PersistentTable> copy(dynamic_cast<voltdb::PersistentTable*>(
+            voltdb::TableFactory::getPersistentTable(0, m_engine->getExecutorContext(), "Bar",
+                                                     copySchema, &m_columnNames[0], indexScheme, indexes, 0,
+                                                     false, false)));
+
+    ASSERT_FALSE(m_table->activateRecoveryStream(0));
+    char serializationBuffer[16384];
+    int scanMessages = 0;
+    bool complete = false;
+    while (true) {
+        ReferenceSerializeOutput out( serializationBuffer, sizeof(serializationBuffer));
+        m_table->nextRecoveryMessage(&out);
+        if (out.position() == 0) {
+            break;
+        }
+        ASSERT_FALSE(complete);
+
+        // the completion message stays with the host, like it does in Java
+        ReferenceSerializeInput in(serializationBuffer, out.position());
+        RecoveryProtoMsg message(&in);
+        if (message.msgType() == RECOVERY_MSG_TYPE_COMPLETE) {
+            complete = true;
+            continue;
+        }
+
+        // the marker follows type, table id, total and tuple count
+        const int32_t marker = ntohl(*reinterpret_cast<int32_t*>(&serializationBuffer[13]));
+        ASSERT_EQ(RecoveryProtoMsg::COMPRESSED_MARKER, marker);
+        copy->processRecoveryMessage(&message, NULL, false);
+        scanMessages++;
+        if (message.msgType() == RECOVERY_MSG_TYPE_SCAN_TUPLES) {
+            ASSERT_EQ(0, copy->primaryKeyIndex()->getSize());
+        } else {
+            ASSERT_EQ(RECOVERY_MSG_TYPE_SCAN_COMPLETE, message.msgType());
+            ASSERT_EQ(5000, copy->primaryKeyIndex()->getSize());
+        }
+    }
+    ASSERT_TRUE(complete);
+    ASSERT_TRUE(scanMessages > 1);
+    ASSERT_EQ(5000, copy->activeTupleCount());
+    ASSERT_EQ(5000, copy->primaryKeyIndex()->getSize());
+
+    TableTuple tuple(m_table->schema());
+    voltdb::TableIterator iterator(m_table);
+    while (iterator.next(tuple)) {
+        TableTuple found = copy->lookupTuple(tuple);
+        ASSERT_FALSE(found.isNullTuple());
+        ASSERT_EQ(ValuePeeker::peekAsInteger(tuple.getNValue(1)),
+                  ValuePeeker::peekAsInteger(found.getNValue(1)));
+    }
+}
+
 TEST_F(CopyOnWriteTest, BigTestWithUndo) {
     initTable(true);
     addRandomUniqueTuples( m_table, 699048);
@@ -996,6 +996,41 @@ TEST_F(TupleStreamWrapperTest, ResetInPartiallyAckedCommittedBlock)
     EXPECT_TRUE(results->offset() > 0);
 }
 
+/**
+ * Released blocks go back on the free list and are handed out again.
+ * Make sure a recycled block starts empty at the right uso.
+ */
+TEST_F(TupleStreamWrapperTest, ReuseReleasedBlocks)
+{
+    int64_t uso = 0;
+    for (int i = 1; i < 6; i++) {
+        appendTuple(i-1, i);
+        appendTuple(i, i+1);
+        m_wrapper->periodicFlush(-1, 0, i+1, i+1);
+        uso += MAGIC_TUPLE_SIZE * 2;
+
+        // the spare blocks are topped up once data has been written
+        EXPECT_EQ(m_wrapper->m_freeBlocks.size(), EL_FREE_BLOCKS);
+
+        StreamBlock* results = m_wrapper->getCommittedExportBytes();
+        EXPECT_EQ(results->uso(), uso - MAGIC_TUPLE_SIZE * 2);
+        EXPECT_EQ(results->unreleasedUso(), uso - MAGIC_TUPLE_SIZE * 2);
+        EXPECT_EQ(results->offset(), MAGIC_TUPLE_SIZE * 2);
+        EXPECT_EQ(results->unreleasedSize(), MAGIC_TUPLE_SIZE * 2);
+
+        bool released = m_wrapper->releaseExportBytes(uso);
+        EXPECT_TRUE(released);
+        EXPECT_EQ(m_wrapper->m_freeBlocks.size(), EL_FREE_BLOCKS);
+    }
+
+    // the current block was recycled and holds nothing yet
+    StreamBlock* results = m_wrapper->getCommittedExportBytes();
+    EXPECT_EQ(results->uso(), uso);
+    EXPECT_EQ(results->unreleasedUso(), uso);
+    EXPECT_EQ(results->offset(), 0);
+    EXPECT_EQ(results->unreleasedSize(), 0);
+}
+
 int main() {
     return TestSuite::globalInstance()->runAll();
 }
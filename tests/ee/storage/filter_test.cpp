@@ -58,6 +58,7 @@
 #include "expressions/abstractexpression.h"
 #include "expressions/expressions.h"
 #include "expressions/expressionutil.h"
+#include "executors/batchpredicate.h"
 #include "storage/temptable.h"
 #include "storage/tablefactory.h"
 #include "storage/tableiterator.h"
@@ -322,6 +323,144 @@ TEST_F(FilterTest, SubstituteFilter) {
     delete predicate;
 }
 
+TEST_F(FilterTest, BatchFilter) {
+
+    // WHERE val1=1 AND 20 < id AND val3<=$1
+
+    AbstractExpression *equal1 = comparisonFactory(EXPRESSION_TYPE_COMPARE_EQUAL,
+                                                   new TupleValueExpression(1, std::string("tablename"), std::string("colname")),
+                                                   constantValueFactory(ValueFactory::getBigIntValue(1)));
+    AbstractExpression *less2 = comparisonFactory(EXPRESSION_TYPE_COMPARE_LESSTHAN,
+                                                  constantValueFactory(ValueFactory::getIntegerValue(20)),
+                                                  new TupleValueExpression(0, std::string("tablename"), std::string("colname")));
+    AbstractExpression *lte3 = comparisonFactory(EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO,
+                                                 new TupleValueExpression(3, std::string("tablename"), std::string("colname")),
+                                                 parameterValueFactory(0));
+    AbstractExpression *predicate2 = conjunctionFactory(EXPRESSION_TYPE_CONJUNCTION_AND, less2, lte3);
+    AbstractExpression *predicate = conjunctionFactory(EXPRESSION_TYPE_CONJUNCTION_AND, equal1, predicate2);
+
+    BatchPredicate *batch = BatchPredicate::build(predicate, table->schema());
+    ASSERT_TRUE(batch != NULL);
+    ASSERT_EQ(3, batch->termCount());
+
+    // All of the tuples fit in the first block of the temp table
+    TableIterator iter = table->tableIterator();
+    TableTuple match(table->schema());
+    ASSERT_TRUE(iter.next(match));
+    const char *first = match.address();
+    const uint32_t tupleLength = table->schema()->tupleLength() + TUPLE_HEADER_SIZE;
+
+    for (int64_t implantedValue = 0; implantedValue < 5; ++implantedValue) {
+        NValueArray params(1);
+        params[0] = ValueFactory::getBigIntValue(implantedValue);
+        predicate->substitute(params);
+        ASSERT_TRUE(batch->bind());
+
+        int count = 0;
+        for (int start = 0; start < TUPLES; start += BatchPredicate::BATCH_SIZE) {
+            int batchSize = std::min(BatchPredicate::BATCH_SIZE, TUPLES - start);
+            const char *tuples = first + (start * tupleLength);
+            uint64_t selected = batch->evaluate(tuples, tupleLength, batchSize);
+            for (int i = 0; i < batchSize; i++) {
+                match.move(const_cast<char*>(tuples + (i * tupleLength)));
+                bool expected = predicate->eval(&match, NULL).isTrue();
+                ASSERT_EQ(expected, ((selected >> i) & 1) == 1);
+                if (expected) ++count;
+            }
+        }
+        ASSERT_TRUE(count > 0);
+    }
+
+    // A string parameter cannot be compared in batches
+    NValueArray params(1);
+    params[0] = ValueFactory::getStringValue("3");
+    predicate->substitute(params);
+    ASSERT_FALSE(batch->bind());
+    params[0].free();
+
+    delete batch;
+    delete predicate;
+}
+
+TEST_F(FilterTest, BatchFilterWideValues) {
+
+    // WHERE id <op> c for every comparison, over BIGINTs whose halves
+    // straddle the 32-bit sign bits and whose high words are equal
+    // while the low words differ
+
+    std::string *columnNames = new std::string[1];
+    columnNames[0] = "id";
+    std::vector<voltdb::ValueType> columnTypes(1, voltdb::VALUE_TYPE_BIGINT);
+    std::vector<int32_t> columnLengths(1, NValue::getTupleStorageSize(voltdb::VALUE_TYPE_BIGINT));
+    std::vector<bool> columnAllowNull(1, false);
+    TupleSchema *schema = TupleSchema::createTupleSchema(columnTypes, columnLengths, columnAllowNull, true);
+    Table *wide = TableFactory::getTempTable(1000, "wide_table", schema, columnNames, NULL);
+    delete[] columnNames;
+
+    const int64_t step = 0x7fffffffLL;
+    for (int64_t i = -200; i < 200; ++i) {
+        TableTuple &tuple = wide->tempTuple();
+        tuple.setNValue(0, ValueFactory::getBigIntValue(i * step + (i % 3)));
+        wide->insertTuple(tuple);
+    }
+
+    TableIterator iter = wide->tableIterator();
+    TableTuple match(wide->schema());
+    ASSERT_TRUE(iter.next(match));
+    const char *first = match.address();
+    const uint32_t tupleLength = wide->schema()->tupleLength() + TUPLE_HEADER_SIZE;
+
+    const ExpressionType ops[] = { EXPRESSION_TYPE_COMPARE_EQUAL,
+                                   EXPRESSION_TYPE_COMPARE_NOTEQUAL,
+                                   EXPRESSION_TYPE_COMPARE_LESSTHAN,
+                                   EXPRESSION_TYPE_COMPARE_GREATERTHAN,
+                                   EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO,
+                                   EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO };
+    const int64_t constants[] = { 0, -1, 7 * step + 1, -7 * step, 0x100000000LL, -0x100000000LL,
+                                  INT64_MAX, INT64_MIN + 1 };
+    for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+        for (size_t c = 0; c < sizeof(constants) / sizeof(constants[0]); c++) {
+            AbstractExpression *predicate =
+                comparisonFactory(ops[o],
+                                  new TupleValueExpression(0, std::string("tablename"), std::string("colname")),
+                                  constantValueFactory(ValueFactory::getBigIntValue(constants[c])));
+            BatchPredicate *batch = BatchPredicate::build(predicate, wide->schema());
+            ASSERT_TRUE(batch != NULL);
+            ASSERT_TRUE(batch->bind());
+
+            for (int start = 0; start < 400; start += BatchPredicate::BATCH_SIZE) {
+                int batchSize = std::min(BatchPredicate::BATCH_SIZE, 400 - start);
+                const char *tuples = first + (start * tupleLength);
+                uint64_t selected = batch->evaluate(tuples, tupleLength, batchSize);
+                for (int i = 0; i < batchSize; i++) {
+                    match.move(const_cast<char*>(tuples + (i * tupleLength)));
+                    bool expected = predicate->eval(&match, NULL).isTrue();
+                    ASSERT_EQ(expected, ((selected >> i) & 1) == 1);
+                }
+            }
+            delete batch;
+            delete predicate;
+        }
+    }
+    delete wide;
+}
+
+TEST_F(FilterTest, BatchFilterUnsupported) {
+
+    // WHERE id = 20 OR id = 30
+
+    AbstractExpression *equal1 = comparisonFactory(EXPRESSION_TYPE_COMPARE_EQUAL,
+                                                   new TupleValueExpression(0, std::string("tablename"), std::string("colname")),
+                                                   constantValueFactory(ValueFactory::getBigIntValue(20)));
+    AbstractExpression *equal2 = comparisonFactory(EXPRESSION_TYPE_COMPARE_EQUAL,
+                                                   new TupleValueExpression(0, std::string("tablename"), std::string("colname")),
+                                                   constantValueFactory(ValueFactory::getBigIntValue(30)));
+    AbstractExpression *predicate = conjunctionFactory(EXPRESSION_TYPE_CONJUNCTION_OR, equal1, equal2);
+
+    ASSERT_TRUE(BatchPredicate::build(predicate, table->schema()) == NULL);
+    delete predicate;
+}
+
 int main() {
     int ret = TestSuite::globalInstance()->runAll();
     FilterTest::releaseAll();// will be eventually done as its smart pointer, but safer is better.
@@ -0,0 +1,292 @@
+/* Copyright (C) 2014 by H-Store Project
+ * Brown University
+ * Massachusetts Institute of Technology
+ * Yale University
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "harness.h"
+#include "common/TupleSchema.h"
+#include "common/types.h"
+#include "common/NValue.hpp"
+#include "common/ValueFactory.hpp"
+#include "common/ValuePeeker.hpp"
+#include "common/tabletuple.h"
+#include "execution/VoltDBEngine.h"
+#include "indexes/tableindex.h"
+#include "storage/persistenttable.h"
+#include "storage/tablefactory.h"
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace voltdb;
+
+static const int NUM_TUPLES = 100;
+static const int COLUMN_COUNT = 5;
+static const string columnNames[COLUMN_COUNT] = { "ID", "GRP", "NAME", "NOTE", "AMOUNT" };
+
+/*
+ * Updates rolled back through the undo log. NAME is an inlined string,
+ * NOTE an uninlined one, ID is the primary key and GRP has an index of
+ * its own.
+ */
+class PersistentTableUndoTest : public Test {
+public:
+    PersistentTableUndoTest() : m_undoToken(INT64_MIN + 1) {
+        m_engine = new VoltDBEngine();
+        m_engine->initialize(1, 1, 0, 0, "");
+        m_engine->setUndoToken(m_undoToken);
+
+        vector<ValueType> types;
+        vector<int32_t> lengths;
+        types.push_back(VALUE_TYPE_BIGINT);
+        lengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        types.push_back(VALUE_TYPE_INTEGER);
+        lengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_INTEGER));
+        types.push_back(VALUE_TYPE_VARCHAR);
+        lengths.push_back(16);
+        types.push_back(VALUE_TYPE_VARCHAR);
+        lengths.push_back(300);
+        types.push_back(VALUE_TYPE_BIGINT);
+        lengths.push_back(NValue::getTupleStorageSize(VALUE_TYPE_BIGINT));
+        vector<bool> allowNull(COLUMN_COUNT, false);
+        TupleSchema *schema = TupleSchema::createTupleSchema(types, lengths, allowNull, true);
+
+        vector<int32_t> pkeyColumns(1, 0);
+        vector<ValueType> pkeyTypes(1, VALUE_TYPE_BIGINT);
+        TableIndexScheme pkey("UNDO_PK", BALANCED_TREE_INDEX, pkeyColumns,
+                              pkeyTypes, true, true, schema);
+        vector<int32_t> groupColumns(1, 1);
+        vector<ValueType> groupTypes(1, VALUE_TYPE_INTEGER);
+        vector<TableIndexScheme> indexes;
+        indexes.push_back(TableIndexScheme("UNDO_GRP", BALANCED_TREE_INDEX, groupColumns,
+                                           groupTypes, false, true, schema));
+
+        m_table = dynamic_cast<PersistentTable*>(
+            TableFactory::getPersistentTable(0, m_engine->getExecutorContext(), "UNDO",
+                                             schema, columnNames, pkey, indexes, 0,
+                                             false, false));
+
+        TableTuple &tuple = m_table->tempTuple();
+        for (int64_t id = 0; id < NUM_TUPLES; id++) {
+            setRow(tuple, id, static_cast<int32_t>(id % 10), name(id, 0), note(id, 0), id * 100);
+            m_table->insertTuple(tuple);
+            freeStrings(tuple);
+        }
+        m_engine->releaseUndoToken(m_undoToken);
+    }
+
+    ~PersistentTableUndoTest() {
+        delete m_table;
+        delete m_engine;
+    }
+
+    static string name(int64_t id, int version) {
+        ostringstream out;
+        out << "n" << id << "v" << version;
+        return out.str();
+    }
+
+    // long enough to live outside the tuple
+    static string note(int64_t id, int version) {
+        ostringstream out;
+        out << "note " << id << " version " << version << " " << string(100, 'x');
+        return out.str();
+    }
+
+    static void setRow(TableTuple &tuple, int64_t id, int32_t group, const string &name,
+                       const string &note, int64_t amount) {
+        tuple.setNValue(0, ValueFactory::getBigIntValue(id));
+        tuple.setNValue(1, ValueFactory::getIntegerValue(group));
+        NValue inlined = ValueFactory::getStringValue(name);
+        tuple.setNValue(2, inlined);
+        inlined.free();
+        tuple.setNValue(3, ValueFactory::getStringValue(note));
+        tuple.setNValue(4, ValueFactory::getBigIntValue(amount));
+    }
+
+    // the temporary string setRow left a tuple outside the table
+    static void freeStrings(TableTuple &tuple) {
+        tuple.getNValue(3).free();
+    }
+
+    void beginTransaction() {
+        m_engine->setUndoToken(++m_undoToken);
+    }
+
+    // the live tuple with primary key id, a null tuple if there is none
+    TableTuple lookup(int64_t id) {
+        TableTuple search(m_table->schema());
+        char data[512];
+        search.move(data);
+        search.setNValue(0, ValueFactory::getBigIntValue(id));
+        TableIndex *index = m_table->primaryKeyIndex();
+        if (!index->moveToTuple(&search))
+            return TableTuple();
+        return index->nextValueAtKey();
+    }
+
+    // tuples the GRP index has under group
+    int groupCount(int32_t group) {
+        TableTuple search(m_table->schema());
+        char data[512];
+        search.move(data);
+        search.setNValue(1, ValueFactory::getIntegerValue(group));
+        TableIndex *index = m_table->index("UNDO_GRP");
+        if (!index->moveToTuple(&search))
+            return 0;
+        int count = 0;
+        while (!index->nextValueAtKey().isNullTuple())
+            count++;
+        return count;
+    }
+
+    static string stringColumn(const TableTuple &tuple, int column) {
+        NValue value = tuple.getNValue(column);
+        return string(reinterpret_cast<const char*>(ValuePeeker::peekObjectValue(value)),
+                      ValuePeeker::peekObjectLength(value));
+    }
+
+    bool rowIs(int64_t id, int32_t group, const string &name, const string &note,
+               int64_t amount) {
+        TableTuple tuple = lookup(id);
+        return !tuple.isNullTuple()
+            && ValuePeeker::peekAsBigInt(tuple.getNValue(0)) == id
+            && ValuePeeker::peekAsInteger(tuple.getNValue(1)) == group
+            && stringColumn(tuple, 2) == name
+            && stringColumn(tuple, 3) == note
+            && ValuePeeker::peekAsBigInt(tuple.getNValue(4)) == amount;
+    }
+
+    bool rowIsOriginal(int64_t id) {
+        return rowIs(id, static_cast<int32_t>(id % 10), name(id, 0), note(id, 0), id * 100);
+    }
+
+    bool allRowsOriginal() {
+        if (m_table->activeTupleCount() != NUM_TUPLES)
+            return false;
+        for (int64_t id = 0; id < NUM_TUPLES; id++) {
+            if (!rowIsOriginal(id))
+                return false;
+        }
+        for (int32_t group = 0; group < 10; group++) {
+            if (groupCount(group) != NUM_TUPLES / 10)
+                return false;
+        }
+        return true;
+    }
+
+    // update the row with primary key id to the given values
+    void update(int64_t id, int64_t newId, int32_t group, const string &name,
+                const string &note, int64_t amount) {
+        TableTuple target = lookup(id);
+        TableTuple &source = m_table->getTempTupleInlined(target);
+        setRow(source, newId, group, name, note, amount);
+        m_table->updateTuple(source, target, true);
+        freeStrings(source);
+    }
+
+    VoltDBEngine *m_engine;
+    PersistentTable *m_table;
+    int64_t m_undoToken;
+};
+
+/*
+ * An update of every column, strings inlined and not, comes back whole;
+ * columns an update leaves alone stay as they are.
+ */
+TEST_F(PersistentTableUndoTest, MultiColumnUpdate) {
+    beginTransaction();
+    update(7, 7, 7, name(7, 1), note(7, 1), 1);
+    update(8, 8, 8, name(8, 0), note(8, 1), 800);
+    update(9, 9, 9, name(9, 1), note(9, 0), 9);
+    ASSERT_TRUE(rowIs(7, 7, name(7, 1), note(7, 1), 1));
+    ASSERT_TRUE(rowIs(8, 8, name(8, 0), note(8, 1), 800));
+    ASSERT_TRUE(rowIs(9, 9, name(9, 1), note(9, 0), 9));
+
+    m_engine->undoUndoToken(m_undoToken);
+    ASSERT_TRUE(allRowsOriginal());
+}
+
+/*
+ * Several updates of one row in a transaction undo in reverse order back
+ * to the first version, and a released update keeps the new strings.
+ */
+TEST_F(PersistentTableUndoTest, RepeatedUpdates) {
+    beginTransaction();
+    for (int version = 1; version <= 5; version++) {
+        update(3, 3, 3, name(3, version), note(3, version), version);
+    }
+    ASSERT_TRUE(rowIs(3, 3, name(3, 5), note(3, 5), 5));
+    m_engine->undoUndoToken(m_undoToken);
+    ASSERT_TRUE(allRowsOriginal());
+
+    beginTransaction();
+    update(3, 3, 3, name(3, 1), note(3, 1), 1);
+    update(3, 3, 3, name(3, 2), note(3, 2), 2);
+    m_engine->releaseUndoToken(m_undoToken);
+    ASSERT_TRUE(rowIs(3, 3, name(3, 2), note(3, 2), 2));
+}
+
+/*
+ * A row updated and then deleted in the same transaction is restored to
+ * its slot by the delete's undo, then reverted there by the update's.
+ */
+TEST_F(PersistentTableUndoTest, UpdateThenDelete) {
+    beginTransaction();
+    update(42, 42, 2, name(42, 1), note(42, 1), 1);
+    TableTuple target = lookup(42);
+    ASSERT_FALSE(target.isNullTuple());
+    m_table->deleteTuple(target, true);
+    ASSERT_TRUE(lookup(42).isNullTuple());
+    ASSERT_EQ(NUM_TUPLES - 1, m_table->activeTupleCount());
+
+    m_engine->undoUndoToken(m_undoToken);
+    ASSERT_TRUE(allRowsOriginal());
+}
+
+/*
+ * Updates that move a row to another primary key and another group are
+ * found under the new keys, and after undo only under the old ones.
+ */
+TEST_F(PersistentTableUndoTest, IndexKeyUpdate) {
+    beginTransaction();
+    update(5, NUM_TUPLES + 5, 9, name(5, 1), note(5, 1), 5);
+    update(6, NUM_TUPLES + 6, 6, name(6, 0), note(6, 0), 600);
+    ASSERT_TRUE(lookup(5).isNullTuple());
+    ASSERT_TRUE(lookup(6).isNullTuple());
+    ASSERT_TRUE(rowIs(NUM_TUPLES + 5, 9, name(5, 1), note(5, 1), 5));
+    ASSERT_TRUE(rowIs(NUM_TUPLES + 6, 6, name(6, 0), note(6, 0), 600));
+    ASSERT_EQ(NUM_TUPLES / 10 - 1, groupCount(5));
+    ASSERT_EQ(NUM_TUPLES / 10 + 1, groupCount(9));
+
+    m_engine->undoUndoToken(m_undoToken);
+    ASSERT_TRUE(lookup(NUM_TUPLES + 5).isNullTuple());
+    ASSERT_TRUE(lookup(NUM_TUPLES + 6).isNullTuple());
+    ASSERT_TRUE(allRowsOriginal());
+}
+
+int main() {
+    return TestSuite::globalInstance()->runAll();
+}
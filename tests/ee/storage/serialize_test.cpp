@@ -51,7 +51,9 @@
 
 #include <sstream>
 #include <iostream>
+#include <exception>
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
 #include "harness.h"
 #include "common/common.h"
 #include "common/serializeio.h"
@@ -60,6 +62,7 @@
 #include "storage/temptable.h"
 #include "storage/tablefactory.h"
 #include "storage/tableiterator.h"
+#include "storage/ResultTableStream.h"
 #include "common/ValueFactory.hpp"
 
 #define TUPLES 20
@@ -213,6 +216,149 @@ TEST_F(TableSerializeTest, NullStrings) {
     delete deserialized;
 }
 
+TEST_F(TableSerializeTest, StreamedRowsMatchSerializeTo) {
+    // what VoltDBEngine::send() writes for a materialized table
+    CopySerializeOutput expected;
+    expected.writeInt(42);
+    table_->serializeTo(expected);
+
+    // stream the same rows through an empty temp table
+    TupleSchema *schema = TupleSchema::createTupleSchema(table_->schema());
+    TempTable* streamed = TableFactory::getTempTable(this->database_id, "temp_table", schema, columnNames, NULL);
+    boost::scoped_array<char> buffer(new char[1024 * 1024]);
+    ReferenceSerializeOutput out(buffer.get(), 1024 * 1024);
+    ResultTableStream stream;
+    ASSERT_TRUE(stream.open(&out, streamed, 42));
+    EXPECT_TRUE(stream.isOpenFor(streamed));
+
+    TableIterator iter(table_);
+    TableTuple tuple(table_->schema());
+    while (iter.next(tuple)) {
+        streamed->insertTuple(tuple);
+    }
+    EXPECT_EQ(0, streamed->activeTupleCount());
+    stream.close();
+    EXPECT_FALSE(stream.isOpenFor(streamed));
+
+    ASSERT_EQ(expected.size(), out.size());
+    EXPECT_EQ(0, ::memcmp(expected.data(), out.data(), out.size()));
+
+    // once closed, inserts are stored again
+    streamed->insertTuple(tuple);
+    EXPECT_EQ(1, streamed->activeTupleCount());
+    delete streamed;
+}
+
+TEST_F(TableSerializeTest, AbandonedStreamRewindsOutput) {
+    TupleSchema *schema = TupleSchema::createTupleSchema(table_->schema());
+    TempTable* streamed = TableFactory::getTempTable(this->database_id, "temp_table", schema, columnNames, NULL);
+    boost::scoped_array<char> buffer(new char[1024 * 1024]);
+    ReferenceSerializeOutput out(buffer.get(), 1024 * 1024);
+    out.writeInt(7);
+    ResultTableStream stream;
+    ASSERT_TRUE(stream.open(&out, streamed, 42));
+
+    TableIterator iter(table_);
+    TableTuple tuple(table_->schema());
+    while (iter.next(tuple)) {
+        streamed->insertTuple(tuple);
+    }
+    stream.abandon();
+    EXPECT_EQ(sizeof(int32_t), out.size());
+    EXPECT_FALSE(stream.isOpenFor(streamed));
+    delete streamed;
+}
+
+TEST_F(TableSerializeTest, SpilledRowsFollowStreamedRows) {
+    TupleSchema *schema = TupleSchema::createTupleSchema(table_->schema());
+    TempTable* streamed = TableFactory::getTempTable(this->database_id, "temp_table", schema, columnNames, NULL);
+    schema = TupleSchema::createTupleSchema(table_->schema());
+    TempTable* stored = TableFactory::getTempTable(this->database_id, "temp_table", schema, columnNames, NULL);
+
+    // room for a few thousand rows; the overflow goes to the fallback buffer
+    const size_t capacity = 80 * 1024;
+    boost::scoped_array<char> buffer(new char[capacity]);
+    FallbackSerializeOutput out;
+    out.initializeWithPosition(buffer.get(), capacity, 0);
+    ResultTableStream stream;
+    ASSERT_TRUE(stream.open(&out, streamed, 42));
+
+    // insert until the stream spills, then two more rounds; every row
+    // inserted after the first spilled one is stored as well
+    int roundsAfterSpill = 0;
+    TableTuple tuple(table_->schema());
+    while (roundsAfterSpill < 2) {
+        if (streamed->activeTupleCount() > 0)
+            roundsAfterSpill++;
+        TableIterator iter(table_);
+        while (iter.next(tuple)) {
+            streamed->insertTuple(tuple);
+            stored->insertTuple(tuple);
+        }
+    }
+    ASSERT_TRUE(streamed->activeTupleCount() > 0);
+    ASSERT_TRUE(stream.streamedCount() > 0);
+    EXPECT_EQ(stored->activeTupleCount(),
+              streamed->activeTupleCount() + streamed->streamedTupleCount());
+    stream.close();
+    EXPECT_FALSE(stream.isOpenFor(streamed));
+    EXPECT_EQ(0, streamed->streamedTupleCount());
+
+    CopySerializeOutput expected;
+    expected.writeInt(42);
+    stored->serializeTo(expected);
+    ASSERT_EQ(expected.size(), out.size());
+    EXPECT_EQ(0, ::memcmp(expected.data(), out.data(), out.size()));
+
+    delete streamed;
+    delete stored;
+}
+
+TEST_F(TableSerializeTest, GuardAbandonsOpenStream) {
+    TupleSchema *schema = TupleSchema::createTupleSchema(table_->schema());
+    TempTable* streamed = TableFactory::getTempTable(this->database_id, "temp_table", schema, columnNames, NULL);
+    boost::scoped_array<char> buffer(new char[1024 * 1024]);
+    ReferenceSerializeOutput out(buffer.get(), 1024 * 1024);
+    out.writeInt(7);
+    ResultTableStream stream;
+
+    // an executor failing with something other than a SerializableEEException
+    bool threw = false;
+    try {
+        ResultTableStreamGuard guard(stream);
+        ASSERT_TRUE(stream.open(&out, streamed, 42));
+        TableIterator iter(table_);
+        TableTuple tuple(table_->schema());
+        while (iter.next(tuple)) {
+            streamed->insertTuple(tuple);
+        }
+        throw std::exception();
+    } catch (std::exception &e) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    EXPECT_FALSE(stream.isOpenFor(streamed));
+    EXPECT_EQ(sizeof(int32_t), out.size());
+
+    // the table stores its rows again
+    TableIterator iter(table_);
+    TableTuple tuple(table_->schema());
+    iter.next(tuple);
+    streamed->insertTuple(tuple);
+    EXPECT_EQ(1, streamed->activeTupleCount());
+
+    // a guard on a closed stream leaves the output alone
+    {
+        ResultTableStreamGuard guard(stream);
+        streamed->deleteAllTuples(false);
+        ASSERT_TRUE(stream.open(&out, streamed, 42));
+        streamed->insertTuple(tuple);
+        stream.close();
+    }
+    EXPECT_TRUE(out.size() > sizeof(int32_t));
+    delete streamed;
+}
+
 int main() {
     return TestSuite::globalInstance()->runAll();
 }
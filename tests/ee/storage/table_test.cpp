@@ -65,6 +65,7 @@
 #include "storage/tablefactory.h"
 #include "storage/tableiterator.h"
 #include "storage/tableutil.h"
+#include "indexes/masstreetupleid.h"
 
 using std::string;
 using std::vector;
@@ -197,6 +198,31 @@ TEST_F(TableTest, TupleInsert) {
     }
 }
 
+TEST_F(TableTest, TupleIds) {
+    //
+    // Tuples are numbered by their slot across the table's blocks, and
+    // the Masstree id encoding maps them back to the same address
+    //
+    MasstreeTupleId ids;
+    ids.setTables(this->table, NULL);
+    ASSERT_EQ(4, ids.valueLength());
+
+    voltdb::TableIterator iterator = this->table->tableIterator();
+    voltdb::TableTuple tuple(table->schema());
+    int expected = 0;
+    char value[8];
+    while (iterator.next(tuple)) {
+        EXPECT_EQ(expected++, this->table->getTupleID(tuple.address()));
+        EXPECT_TRUE(ids.encode(tuple.address(), value));
+        EXPECT_EQ(tuple.address(), ids.decode(value));
+    }
+    EXPECT_EQ(NUM_OF_TUPLES, expected);
+
+    char foreign[16];
+    EXPECT_EQ(-1, this->table->getTupleID(foreign));
+    EXPECT_FALSE(ids.encode(foreign, value));
+}
+
 TEST_F(TableTest, TupleUpdate) {
     //
     // Loop through and randomly update values
@@ -93,6 +93,9 @@ class query {
   template <typename T>
   void run_destroy_static(T &table, threadinfo &ti);
 
+  template <typename T>
+  size_t run_compact_static(T &table, double ratio, threadinfo &ti);
+
   template <typename T>
   void run_buildStatic(T &table, threadinfo &ti);
 
@@ -115,7 +118,10 @@ class query {
   void run_destroy_static_dynamicvalue(T &table, threadinfo &ti);
 
   template <typename T>
-  void run_buildStatic_dynamicvalue(T &table, threadinfo &ti);
+  size_t run_compact_static_dynamicvalue(T &table, double ratio, threadinfo &ti);
+
+  template <typename T, typename F>
+  void run_buildStatic_dynamicvalue(T &table, F &convert, threadinfo &ti);
 
   template <typename T>
   void run_merge_dynamicvalue(T &table, T &merge_table, threadinfo &ti, threadinfo &ti_merge);
@@ -483,6 +489,14 @@ void query<R>::run_destroy_static(T &table, threadinfo &ti) {
   table.set_static_root(NULL);
 }
 
+template <typename R> template <typename T>
+size_t query<R>::run_compact_static(T &table, double ratio, threadinfo &ti) {
+  typename T::static_cursor_type lp(table);
+  size_t ndead = lp.compact(ratio, ti);
+  table.set_static_root(lp.get_root());
+  return ndead;
+}
+
 template <typename R> template <typename T>
 void query<R>::run_buildStatic(T &table, threadinfo &ti) {
   typename T::unlocked_cursor_type lp(table);
@@ -531,9 +545,17 @@ void query<R>::run_destroy_static_dynamicvalue(T &table, threadinfo &ti) {
 }
 
 template <typename R> template <typename T>
-void query<R>::run_buildStatic_dynamicvalue(T &table, threadinfo &ti) {
+size_t query<R>::run_compact_static_dynamicvalue(T &table, double ratio, threadinfo &ti) {
+  typename T::static_dynamicvalue_cursor_type lp(table);
+  size_t ndead = lp.compact(ratio, ti);
+  table.set_static_root(lp.get_root());
+  return ndead;
+}
+
+template <typename R> template <typename T, typename F>
+void query<R>::run_buildStatic_dynamicvalue(T &table, F &convert, threadinfo &ti) {
   typename T::unlocked_cursor_type lp(table);
-  table.set_static_root(lp.buildStaticDynamicvalue(ti));
+  table.set_static_root(lp.buildStaticDynamicvalue(convert, ti));
 }
 
 template <typename R> template <typename T>
@@ -57,6 +57,7 @@ template <typename P> class stcursor;
 template <typename P> class stcursor_multivalue;
 template <typename P> class stcursor_dynamicvalue;
 template <typename P> class stcursor_scan;
+template <typename P> class scan_cursor;
 template <typename P> class stcursor_scan_multivalue;
 template <typename P> class stcursor_scan_dynamicvalue;
 template <typename P> class stcursor_merge;
@@ -76,6 +77,7 @@ class basic_table {
     typedef typename P::threadinfo_type threadinfo;
     typedef unlocked_tcursor<P> unlocked_cursor_type;
     typedef tcursor<P> cursor_type;
+    typedef scan_cursor<P> scan_cursor_type;
 
   //huanchen-static
   typedef stcursor<P> static_cursor_type;
@@ -305,8 +305,9 @@ massnode<P> *unlocked_tcursor<P>::buildStatic(threadinfo &ti) {
       massID++;
     }
     else {
-      newNode->set_lv(i, leafvalue_static<P>(lv_list[i].value()->col(0).s));
-      lv_list[i].value()->deallocate_rcu(ti);
+      // unique dynamic leaves hold the 8-byte value inline
+      uintptr_t v = lv_list[i].get_value();
+      newNode->set_lv(i, leafvalue_static<P>((const char*)&v));
     }
 
     newNode->set_ksuf_offset(i, (uint32_t)(ksuf_curpos - ksuf_startpos));
@@ -341,6 +342,10 @@ massnode<P> *unlocked_tcursor<P>::buildStatic(threadinfo &ti) {
     goto nextTrieNode;
   }
 
+  // front-code the suffixes before linking, while no parent points at the nodes yet
+  for (unsigned int i = 0; i < massnode_list.size(); i++)
+    massnode_list[i] = massnode_list[i]->pack_ksuf(ti);
+
   for (unsigned int i = 0; i < massnode_list.size(); i++)
     for (unsigned int j = 0; j < massnode_list[i]->nkeys_; j++)
       if (leaf<P>::keylenx_is_layer(massnode_list[i]->ikeylen(j)))
@@ -378,8 +383,8 @@ massnode<P> *unlocked_tcursor<P>::buildStatic_quick(int nkeys, threadinfo &ti) {
       massID++;
     }
     else {
-      newNode->set_lv(cur_pos, leafvalue_static<P>(n_->lv_[kp].value()->col(0).s));
-      n_->lv_[kp].value()->deallocate_rcu(ti);
+      uintptr_t v = n_->lv_[kp].get_value();
+      newNode->set_lv(cur_pos, leafvalue_static<P>((const char*)&v));
     }
 
     //newNode->set_ksuf_offset(cur_pos, 0);
@@ -546,8 +551,8 @@ massnode_multivalue<P> *unlocked_tcursor<P>::buildStaticMultivalue(threadinfo &t
 //**********************************************************************************
 // buildStaticDynamicvalue
 //**********************************************************************************
-template <typename P>
-massnode_dynamicvalue<P> *unlocked_tcursor<P>::buildStaticDynamicvalue(threadinfo &ti) {
+template <typename P> template <typename F>
+massnode_dynamicvalue<P> *unlocked_tcursor<P>::buildStaticDynamicvalue(F &convert, threadinfo &ti) {
   typedef typename P::ikey_type ikey_type;
 
   std::vector<uint8_t> ikeylen_list;
@@ -618,7 +623,7 @@ massnode_dynamicvalue<P> *unlocked_tcursor<P>::buildStaticDynamicvalue(threadinf
       massID++;
     }
     else {
-      newNode->set_lv(i, lv_list[i]);
+      newNode->set_lv(i, leafvalue<P>(convert(lv_list[i].value())));
     }
 
     newNode->set_ksuf_offset(i, (uint32_t)(ksuf_curpos - ksuf_startpos));
@@ -651,6 +656,10 @@ massnode_dynamicvalue<P> *unlocked_tcursor<P>::buildStaticDynamicvalue(threadinf
     goto nextTrieNode;
   }
 
+  // front-code the suffixes before linking, while no parent points at the nodes yet
+  for (unsigned int i = 0; i < massnode_list.size(); i++)
+    massnode_list[i] = massnode_list[i]->pack_ksuf(ti);
+
   for (unsigned int i = 0; i < massnode_list.size(); i++)
     for (unsigned int j = 0; j < massnode_list[i]->nkeys_; j++)
       if (leaf<P>::keylenx_is_layer(massnode_list[i]->ikeylen(j)))
@@ -982,6 +991,32 @@ void stcursor_dynamicvalue<P>::destroy(threadinfo &ti) {
 }
 
 
+//huanchen-static
+//**********************************************************************************
+// stcursor::compact
+//**********************************************************************************
+template <typename P>
+size_t stcursor<P>::compact(double ratio, threadinfo &ti) {
+  massnode<P> *root = static_cast<massnode<P>*>(root_);
+  size_t ndead = static_compactor::run(root, ratio, ti);
+  root_ = root;
+  return ndead;
+}
+
+
+//huanchen-static-dynamicvalue
+//**********************************************************************************
+// stcursor_dynamicvalue::compact
+//**********************************************************************************
+template <typename P>
+size_t stcursor_dynamicvalue<P>::compact(double ratio, threadinfo &ti) {
+  massnode_dynamicvalue<P> *root = static_cast<massnode_dynamicvalue<P>*>(root_);
+  size_t ndead = static_compactor::run(root, ratio, ti);
+  root_ = root;
+  return ndead;
+}
+
+
 //huanchen-static
 //**********************************************************************************
 // stcursor::lower_bound_binary
@@ -1093,10 +1128,10 @@ bool stcursor_scan<P>::find_upper_bound_or_equal() {
     goto nextNode;
   }
   if (isExact_)
-    if (memcmp(ka_.suffix().s, n_->ksuf(kp).s, ka_.suffix_length()) > 0)
+    if (memcmp(ka_.suffix().s, n_->ksuf(kp, cur_ksuf_buf_).s, ka_.suffix_length()) > 0)
       return next_item(kp);
 
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1181,10 +1216,10 @@ bool stcursor_scan_dynamicvalue<P>::find_upper_bound_or_equal() {
     goto nextNode;
   }
   if (isExact_)
-    if (memcmp(ka_.suffix().s, n_->ksuf(kp).s, ka_.suffix_length()) > 0)
+    if (memcmp(ka_.suffix().s, n_->ksuf(kp, cur_ksuf_buf_).s, ka_.suffix_length()) > 0)
       return next_item(kp);
 
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1226,7 +1261,7 @@ bool stcursor_scan<P>::find_upper_bound() {
   }
 
   if (!isExact_) {
-    cur_key_suffix_ = n_->ksuf(kp);
+    cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
     return true;
   }
 
@@ -1316,7 +1351,7 @@ bool stcursor_scan_dynamicvalue<P>::find_upper_bound() {
   }
 
   if (!isExact_) {
-    cur_key_suffix_ = n_->ksuf(kp);
+    cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
     return true;
   }
 
@@ -1332,16 +1367,24 @@ template <typename P>
 bool stcursor_scan<P>::find_leftmost() {
   if (!n_)
     return false;
-  int keylenx = 0;
+  int kp, keylenx = 0;
  nextNode:
-  cur_key_prefix_.push_back(n_->ikey(0));
-  keylenx = n_->ikeylen(0);
-  cur_lv_ = &(n_->get_lv()[0]);
+  //skip removed keys; a layer with none left continues after it
+  kp = 0;
+  while (kp < n_->nkeys_ && !n_->isValid(kp))
+    kp++;
+  if (kp >= n_->nkeys_)
+    return next_item_from_next_node(kp);
+  cur_key_prefix_.push_back(n_->ikey(kp));
+  nodeTrace_.push_back(n_);
+  posTrace_.push_back(kp);
+  keylenx = n_->ikeylen(kp);
+  cur_lv_ = &(n_->get_lv()[kp]);
   if (n_->keylenx_is_layer(keylenx)) {
     n_ = static_cast<massnode<P>*>(cur_lv_->layer());
     goto nextNode;
   }
-  cur_key_suffix_ = n_->ksuf(0);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1353,16 +1396,24 @@ template <typename P>
 bool stcursor_scan_multivalue<P>::find_leftmost() {
   if (!n_)
     return false;
-  int keylenx = 0;
+  int kp, keylenx = 0;
  nextNode:
-  cur_key_prefix_.push_back(n_->ikey(0));
-  keylenx = n_->ikeylen(0);
-  cur_lv_ = &(n_->get_lv()[0]);
+  //skip removed keys; a layer with none left continues after it
+  kp = 0;
+  while (kp < n_->nkeys_ && !n_->isValid(kp))
+    kp++;
+  if (kp >= n_->nkeys_)
+    return next_item_from_next_node(kp);
+  cur_key_prefix_.push_back(n_->ikey(kp));
+  nodeTrace_.push_back(n_);
+  posTrace_.push_back(kp);
+  keylenx = n_->ikeylen(kp);
+  cur_lv_ = &(n_->get_lv()[kp]);
   if (n_->keylenx_is_layer(keylenx)) {
     n_ = static_cast<massnode_multivalue<P>*>(cur_lv_->layer());
     goto nextNode;
   }
-  cur_key_suffix_ = n_->ksuf(0);
+  cur_key_suffix_ = n_->ksuf(kp);
   return true;
 }
 
@@ -1374,16 +1425,24 @@ template <typename P>
 bool stcursor_scan_dynamicvalue<P>::find_leftmost() {
   if (!n_)
     return false;
-  int keylenx = 0;
+  int kp, keylenx = 0;
  nextNode:
-  cur_key_prefix_.push_back(n_->ikey(0));
-  keylenx = n_->ikeylen(0);
-  cur_lv_ = &(n_->get_lv()[0]);
+  //skip removed keys; a layer with none left continues after it
+  kp = 0;
+  while (kp < n_->nkeys_ && !n_->isValid(kp))
+    kp++;
+  if (kp >= n_->nkeys_)
+    return next_item_from_next_node(kp);
+  cur_key_prefix_.push_back(n_->ikey(kp));
+  nodeTrace_.push_back(n_);
+  posTrace_.push_back(kp);
+  keylenx = n_->ikeylen(kp);
+  cur_lv_ = &(n_->get_lv()[kp]);
   if (n_->keylenx_is_layer(keylenx)) {
     n_ = static_cast<massnode_dynamicvalue<P>*>(cur_lv_->layer());
     goto nextNode;
   }
-  cur_key_suffix_ = n_->ksuf(0);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1408,18 +1467,18 @@ inline bool stcursor_scan<P>::next_item(int kp) {
       return next_item_from_next_node(kp);
   }
   cur_key_prefix_.pop_back();
-  posTrace_[posTrace_.size() - 1]++;
+  posTrace_[posTrace_.size() - 1] = kp;
   cur_key_prefix_.push_back(n_->ikey(kp));
 
   keylenx = n_->ikeylen(kp);
   cur_lv_ = &(n_->get_lv()[kp]);
       
   if (n_->keylenx_is_layer(keylenx)) {
-    n_ = static_cast<massnode<P>*>(next_lv_->layer());
+    n_ = static_cast<massnode<P>*>(cur_lv_->layer());
     return find_leftmost();
   }
 
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1442,14 +1501,14 @@ inline bool stcursor_scan_multivalue<P>::next_item(int kp) {
       return next_item_from_next_node(kp);
   }
   cur_key_prefix_.pop_back();
-  posTrace_[posTrace_.size() - 1]++;
+  posTrace_[posTrace_.size() - 1] = kp;
   cur_key_prefix_.push_back(n_->ikey(kp));
 
   keylenx = n_->ikeylen(kp);
   cur_lv_ = &(n_->get_lv()[kp]);
       
   if (n_->keylenx_is_layer(keylenx)) {
-    n_ = static_cast<massnode_multivalue<P>*>(next_lv_->layer());
+    n_ = static_cast<massnode_multivalue<P>*>(cur_lv_->layer());
     return find_leftmost();
   }
 
@@ -1476,18 +1535,18 @@ inline bool stcursor_scan_dynamicvalue<P>::next_item(int kp) {
       return next_item_from_next_node(kp);
   }
   cur_key_prefix_.pop_back();
-  posTrace_[posTrace_.size() - 1]++;
+  posTrace_[posTrace_.size() - 1] = kp;
   cur_key_prefix_.push_back(n_->ikey(kp));
 
   keylenx = n_->ikeylen(kp);
   cur_lv_ = &(n_->get_lv()[kp]);
       
   if (n_->keylenx_is_layer(keylenx)) {
-    n_ = static_cast<massnode_dynamicvalue<P>*>(next_lv_->layer());
+    n_ = static_cast<massnode_dynamicvalue<P>*>(cur_lv_->layer());
     return find_leftmost();
   }
 
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1543,7 +1602,7 @@ inline bool stcursor_scan<P>::next_item_from_next_node(int kp) {
     n_ = static_cast<massnode<P>*>(cur_lv_->layer());
     return find_leftmost();
   }
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1652,7 +1711,7 @@ inline bool stcursor_scan_dynamicvalue<P>::next_item_from_next_node(int kp) {
     n_ = static_cast<massnode_dynamicvalue<P>*>(cur_lv_->layer());
     return find_leftmost();
   }
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
   return true;
 }
 
@@ -1688,7 +1747,7 @@ bool stcursor_scan<P>::find_next() {
   }
   if (!n_->isValid(kp))
     return false;
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
 
   return next_item_next(kp);
 }
@@ -1757,7 +1816,7 @@ bool stcursor_scan_dynamicvalue<P>::find_next() {
   }
   if (!n_->isValid(kp))
     return false;
-  cur_key_suffix_ = n_->ksuf(kp);
+  cur_key_suffix_ = n_->ksuf(kp, cur_ksuf_buf_);
 
   return next_item_next(kp);
 }
@@ -1773,16 +1832,24 @@ template <typename P>
 bool stcursor_scan<P>::find_next_leftmost() {
   if (!n_)
     return false;
-  int keylenx = 0;
+  int kp, keylenx = 0;
  nextNode:
-  next_key_prefix_.push_back(n_->ikey(0));
-  keylenx = n_->ikeylen(0);
-  next_lv_ = &(n_->get_lv()[0]);
+  //skip removed keys; a layer with none left continues after it
+  kp = 0;
+  while (kp < n_->nkeys_ && !n_->isValid(kp))
+    kp++;
+  if (kp >= n_->nkeys_)
+    return next_item_from_next_node_next(kp);
+  next_key_prefix_.push_back(n_->ikey(kp));
+  nodeTrace_.push_back(n_);
+  posTrace_.push_back(kp);
+  keylenx = n_->ikeylen(kp);
+  next_lv_ = &(n_->get_lv()[kp]);
   if (n_->keylenx_is_layer(keylenx)) {
     n_ = static_cast<massnode<P>*>(next_lv_->layer());
     goto nextNode;
   }
-  next_key_suffix_ = n_->ksuf(0);
+  next_key_suffix_ = n_->ksuf(kp, next_ksuf_buf_);
   return true;
 }
 
@@ -1794,16 +1861,24 @@ template <typename P>
 bool stcursor_scan_multivalue<P>::find_next_leftmost() {
   if (!n_)
     return false;
-  int keylenx = 0;
+  int kp, keylenx = 0;
  nextNode:
-  next_key_prefix_.push_back(n_->ikey(0));
-  keylenx = n_->ikeylen(0);
-  next_lv_ = &(n_->get_lv()[0]);
+  //skip removed keys; a layer with none left continues after it
+  kp = 0;
+  while (kp < n_->nkeys_ && !n_->isValid(kp))
+    kp++;
+  if (kp >= n_->nkeys_)
+    return next_item_from_next_node_next(kp);
+  next_key_prefix_.push_back(n_->ikey(kp));
+  nodeTrace_.push_back(n_);
+  posTrace_.push_back(kp);
+  keylenx = n_->ikeylen(kp);
+  next_lv_ = &(n_->get_lv()[kp]);
   if (n_->keylenx_is_layer(keylenx)) {
     n_ = static_cast<massnode_multivalue<P>*>(next_lv_->layer());
     goto nextNode;
   }
-  next_key_suffix_ = n_->ksuf(0);
+  next_key_suffix_ = n_->ksuf(kp);
   return true;
 }
 
@@ -1815,16 +1890,24 @@ template <typename P>
 bool stcursor_scan_dynamicvalue<P>::find_next_leftmost() {
   if (!n_)
     return false;
-  int keylenx = 0;
+  int kp, keylenx = 0;
  nextNode:
-  next_key_prefix_.push_back(n_->ikey(0));
-  keylenx = n_->ikeylen(0);
-  next_lv_ = &(n_->get_lv()[0]);
+  //skip removed keys; a layer with none left continues after it
+  kp = 0;
+  while (kp < n_->nkeys_ && !n_->isValid(kp))
+    kp++;
+  if (kp >= n_->nkeys_)
+    return next_item_from_next_node_next(kp);
+  next_key_prefix_.push_back(n_->ikey(kp));
+  nodeTrace_.push_back(n_);
+  posTrace_.push_back(kp);
+  keylenx = n_->ikeylen(kp);
+  next_lv_ = &(n_->get_lv()[kp]);
   if (n_->keylenx_is_layer(keylenx)) {
     n_ = static_cast<massnode_dynamicvalue<P>*>(next_lv_->layer());
     goto nextNode;
   }
-  next_key_suffix_ = n_->ksuf(0);
+  next_key_suffix_ = n_->ksuf(kp, next_ksuf_buf_);
   return true;
 }
 
@@ -1838,7 +1921,6 @@ template <typename P>
 inline bool stcursor_scan<P>::next_item_next(int kp) {
   int keylenx = 0;
   kp++;
-  next_key_prefix_.pop_back();
   //out of bound, go back to parent
   if (kp >= n_->nkeys_)
     return next_item_from_next_node_next(kp);
@@ -1850,7 +1932,9 @@ inline bool stcursor_scan<P>::next_item_next(int kp) {
       return next_item_from_next_node_next(kp);
   }
 
-  posTrace_[posTrace_.size() - 1]++;
+  //next_item_from_next_node_next() pops this node's slice itself
+  next_key_prefix_.pop_back();
+  posTrace_[posTrace_.size() - 1] = kp;
   next_key_prefix_.push_back(n_->ikey(kp));
   keylenx = n_->ikeylen(kp);
   next_lv_ = &(n_->get_lv()[kp]);
@@ -1858,7 +1942,7 @@ inline bool stcursor_scan<P>::next_item_next(int kp) {
     n_ = static_cast<massnode<P>*>(next_lv_->layer());
     return find_next_leftmost();
   }
-  next_key_suffix_ = n_->ksuf(kp);
+  next_key_suffix_ = n_->ksuf(kp, next_ksuf_buf_);
   return true;
 }
 
@@ -1870,7 +1954,6 @@ template <typename P>
 inline bool stcursor_scan_multivalue<P>::next_item_next(int kp) {
   int keylenx = 0;
   kp++;
-  next_key_prefix_.pop_back();
   //out of bound, go back to parent
   if (kp >= n_->nkeys_)
     return next_item_from_next_node_next(kp);
@@ -1882,7 +1965,9 @@ inline bool stcursor_scan_multivalue<P>::next_item_next(int kp) {
       return next_item_from_next_node_next(kp);
   }
 
-  posTrace_[posTrace_.size() - 1]++;
+  //next_item_from_next_node_next() pops this node's slice itself
+  next_key_prefix_.pop_back();
+  posTrace_[posTrace_.size() - 1] = kp;
   next_key_prefix_.push_back(n_->ikey(kp));
   keylenx = n_->ikeylen(kp);
   next_lv_ = &(n_->get_lv()[kp]);
@@ -1903,7 +1988,6 @@ template <typename P>
 inline bool stcursor_scan_dynamicvalue<P>::next_item_next(int kp) {
   int keylenx = 0;
   kp++;
-  next_key_prefix_.pop_back();
   //out of bound, go back to parent
   if (kp >= n_->nkeys_)
     return next_item_from_next_node_next(kp);
@@ -1915,7 +1999,9 @@ inline bool stcursor_scan_dynamicvalue<P>::next_item_next(int kp) {
       return next_item_from_next_node_next(kp);
   }
 
-  posTrace_[posTrace_.size() - 1]++;
+  //next_item_from_next_node_next() pops this node's slice itself
+  next_key_prefix_.pop_back();
+  posTrace_[posTrace_.size() - 1] = kp;
   next_key_prefix_.push_back(n_->ikey(kp));
   keylenx = n_->ikeylen(kp);
   next_lv_ = &(n_->get_lv()[kp]);
@@ -1923,7 +2009,7 @@ inline bool stcursor_scan_dynamicvalue<P>::next_item_next(int kp) {
     n_ = static_cast<massnode_dynamicvalue<P>*>(next_lv_->layer());
     return find_next_leftmost();
   }
-  next_key_suffix_ = n_->ksuf(kp);
+  next_key_suffix_ = n_->ksuf(kp, next_ksuf_buf_);
 
   return true;
 }
@@ -1980,7 +2066,7 @@ bool stcursor_scan<P>::next_item_from_next_node_next(int kp) {
     n_ = static_cast<massnode<P>*>(next_lv_->layer());
     return find_next_leftmost();
   }
-  next_key_suffix_ = n_->ksuf(kp);
+  next_key_suffix_ = n_->ksuf(kp, next_ksuf_buf_);
   return true;
 }
 
@@ -2089,7 +2175,7 @@ bool stcursor_scan_dynamicvalue<P>::next_item_from_next_node_next(int kp) {
     n_ = static_cast<massnode_dynamicvalue<P>*>(next_lv_->layer());
     return find_next_leftmost();
   }
-  next_key_suffix_ = n_->ksuf(kp);
+  next_key_suffix_ = n_->ksuf(kp, next_ksuf_buf_);
 
   return true;
 }
@@ -2261,6 +2347,10 @@ bool stcursor_merge<P>::merge_nodes(merge_task t, threadinfo &ti, threadinfo &ti
   else
     n_ = t.n;
 
+  //the merge works on the plain suffix layout
+  m_ = m_->unpack_ksuf(ti_merge);
+  n_ = n_->unpack_ksuf(ti);
+
   //calculate size & num_keys of m, n and the tmp new node
   int m_size = m_->allocated_size();
   int n_size = n_->allocated_size();
@@ -2373,6 +2463,7 @@ bool stcursor_merge<P>::merge_nodes(merge_task t, threadinfo &ti, threadinfo &ti
       n_->set_has_ksuf((uint8_t)1);
     else
       n_->set_has_ksuf((uint8_t)0);
+    n_ = n_->pack_ksuf(ti);
     
     if (t.parent_node)
       t.parent_node->set_lv(t.parent_node_pos, leafvalue_static<P>(static_cast<node_base<P>*>(n_)));
@@ -2604,7 +2695,7 @@ bool stcursor_merge<P>::merge_nodes(merge_task t, threadinfo &ti, threadinfo &ti
 	    new_n_ksuf_offset[new_n_pos] = (uint32_t)(new_n_ksuf_pos - new_n_ksuf);
 	  }
 	  else if ((ksuflen_m == ksuflen_n) 
-		   && (strncmp(m_ksuf_pos, n_ksuf_pos, ksuflen_m) == 0)) {
+		   && (memcmp(m_ksuf_pos, n_ksuf_pos, ksuflen_m) == 0)) {
 	    new_n_ikeylen[new_n_pos] = m_ikeylen[m_pos];
 	    new_n_ikey[new_n_pos] = m_ikey[m_pos];
 	    new_n_lv[new_n_pos] = m_lv[m_pos];
@@ -2812,6 +2903,10 @@ bool stcursor_merge<P>::merge_nodes(merge_task t, threadinfo &ti, threadinfo &ti
   else
     n_->set_has_ksuf((uint8_t)0);
 
+  n_ = n_->pack_ksuf(ti);
+  for (unsigned int i = start_task_pos; i < task_.size(); i++)
+    task_[i].parent_node = n_;
+
   if (t.parent_node)
     t.parent_node->set_lv(t.parent_node_pos, leafvalue_static<P>(static_cast<node_base<P>*>(n_)));
   else
@@ -2833,7 +2928,7 @@ bool stcursor_merge<P>::add_item_to_node(merge_task t, threadinfo &ti) {
     return false;
   }
 
-  n_ = t.n;
+  n_ = t.n->unpack_ksuf(ti);
 
   int m_size = (int)(sizeof(uint8_t)
 		     + sizeof(ikey_type)
@@ -2913,6 +3008,8 @@ bool stcursor_merge<P>::add_item_to_node(merge_task t, threadinfo &ti) {
 
   int copy_ksuf_len = 0;
 
+  int start_task_pos = task_.size();
+
   while (!m_inserted && (n_pos < n_nkeys)) {
     //if deleted
     if (n_ikeylen[n_pos] == 0) {
@@ -3018,7 +3115,7 @@ bool stcursor_merge<P>::add_item_to_node(merge_task t, threadinfo &ti) {
 	    new_n_ksuf_offset[new_n_pos] = (uint32_t)(new_n_ksuf_pos - new_n_ksuf);
 	  }
 	  else if ((ksuflen_m == ksuflen_n) 
-		   && (strncmp(t.ksuf_m, n_ksuf_pos, ksuflen_m) == 0)) {
+		   && (memcmp(t.ksuf_m, n_ksuf_pos, ksuflen_m) == 0)) {
 	    new_n_ikeylen[new_n_pos] = t.ikeylen_m;
 	    new_n_ikey[new_n_pos] = t.ikey_m;
 	    new_n_lv[new_n_pos] = t.lv_m;
@@ -3189,12 +3286,17 @@ bool stcursor_merge<P>::add_item_to_node(merge_task t, threadinfo &ti) {
     n_ = n_->resize((size_t)new_size, ti);
 
     //resize may change the address, update the parent nodes addr in task_
-    task_[task_.size() - 1].parent_node = n_;
+    if (start_task_pos < task_.size())
+      task_[task_.size() - 1].parent_node = n_;
   }
 
   n_->set_size((uint32_t)new_nkeys);
   n_->set_allocated_size((uint32_t)new_size);
 
+  n_ = n_->pack_ksuf(ti);
+  for (unsigned int i = start_task_pos; i < task_.size(); i++)
+    task_[i].parent_node = n_;
+
   if (t.parent_node == NULL) {
     std::cout << "ERROR: add_item_to_node, parent_node is NULL!!!\n";
     return false;
@@ -3789,7 +3891,7 @@ bool stcursor_merge_multivalue<P>::merge_nodes(merge_task_multivalue t, threadin
 	    new_n_ksuf_offset[new_n_pos] = (uint32_t)(new_n_ksuf_pos - new_n_ksuf);
 	  }
 	  else if ((ksuflen_m == ksuflen_n) 
-		   && (strncmp(m_ksuf_pos, n_ksuf_pos, ksuflen_m) == 0)) {
+		   && (memcmp(m_ksuf_pos, n_ksuf_pos, ksuflen_m) == 0)) {
 	    //std::cout << "both NOT layer 2; m_pos = " << m_pos << ", n_pos = " << n_pos << "\n";
 	    new_n_ikeylen[new_n_pos] = n_ikeylen[n_pos];
 	    new_n_ikey[new_n_pos] = n_ikey[n_pos];
@@ -4336,7 +4438,7 @@ bool stcursor_merge_multivalue<P>::add_item_to_node(merge_task_multivalue t, thr
 	    new_n_ksuf_offset[new_n_pos] = (uint32_t)(new_n_ksuf_pos - new_n_ksuf);
 	  }
 	  else if ((ksuflen_m == ksuflen_n) 
-		   && (strncmp(t.ksuf_m, n_ksuf_pos, ksuflen_m) == 0)) {
+		   && (memcmp(t.ksuf_m, n_ksuf_pos, ksuflen_m) == 0)) {
 	    //std::cout << "both NOT layer 2; m_inserted = " << m_inserted << ", n_pos = " << n_pos << "\n";
 	    new_n_ikeylen[new_n_pos] = n_ikeylen[n_pos];
 	    new_n_ikey[new_n_pos] = n_ikey[n_pos];
@@ -4864,6 +4966,10 @@ bool stcursor_merge_dynamicvalue<P>::merge_nodes(merge_task_dynamicvalue t, thre
   else
     n_ = t.n;
 
+  //the merge works on the plain suffix layout
+  m_ = m_->unpack_ksuf(ti_merge);
+  n_ = n_->unpack_ksuf(ti);
+
   //calculate size & num_keys of m, n and the tmp new node
   int m_size = m_->allocated_size();
   int n_size = n_->allocated_size();
@@ -5120,7 +5226,7 @@ bool stcursor_merge_dynamicvalue<P>::merge_nodes(merge_task_dynamicvalue t, thre
 	    return false;
 	  }
 	  else if ((ksuflen_m == ksuflen_n) 
-		   && (strncmp(m_ksuf_pos, n_ksuf_pos, ksuflen_m) == 0)) {
+		   && (memcmp(m_ksuf_pos, n_ksuf_pos, ksuflen_m) == 0)) {
 	    std::cout << "Error2: same key!\n";
 	    return false;
 	  }
@@ -5299,6 +5405,10 @@ bool stcursor_merge_dynamicvalue<P>::merge_nodes(merge_task_dynamicvalue t, thre
   n_->set_size((uint32_t)new_nkeys);
   n_->set_allocated_size((size_t)new_size);
 
+  n_ = n_->pack_ksuf(ti);
+  for (int i = start_task_pos; i < task_.size(); i++)
+    task_[i].parent_node = n_;
+
   if (t.parent_node)
     t.parent_node->set_lv(t.parent_node_pos, leafvalue<P>(static_cast<node_base<P>*>(n_)));
   else
@@ -5320,7 +5430,7 @@ bool stcursor_merge_dynamicvalue<P>::add_item_to_node(merge_task_dynamicvalue t,
     return false;
   }
 
-  n_ = t.n;
+  n_ = t.n->unpack_ksuf(ti);
 
   int m_size = (int)(sizeof(uint8_t)
 		     + sizeof(ikey_type)
@@ -5508,7 +5618,7 @@ bool stcursor_merge_dynamicvalue<P>::add_item_to_node(merge_task_dynamicvalue t,
 	    return false;
 	  }
 	  else if ((ksuflen_m == ksuflen_n) 
-		   && (strncmp(t.ksuf_m, n_ksuf_pos, ksuflen_m) == 0)) {
+		   && (memcmp(t.ksuf_m, n_ksuf_pos, ksuflen_m) == 0)) {
 	    std::cout << "Error4: same key!\n";
 	    return false;
 	  }
@@ -5678,6 +5788,10 @@ bool stcursor_merge_dynamicvalue<P>::add_item_to_node(merge_task_dynamicvalue t,
   n_->set_size((uint32_t)new_nkeys);
   n_->set_allocated_size((uint32_t)new_size);
 
+  n_ = n_->pack_ksuf(ti);
+  for (int i = start_task_pos; i < task_.size(); i++)
+    task_[i].parent_node = n_;
+
   if (t.parent_node == NULL) {
     std::cout << "ERROR: add_item_to_node(dynamicvalue), parent_node is NULL!!!\n";
     return false;
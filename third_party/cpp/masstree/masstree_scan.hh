@@ -75,6 +75,7 @@ class scanstackelt {
     }
 
     template <typename PX> friend class basic_table;
+    template <typename PX> friend class scan_cursor;
 };
 
 struct forward_scan_helper {
@@ -376,6 +377,138 @@ int basic_table<P>::scan(H helper,
     return scancount;
 }
 
+/** A forward scan over a basic_table that can be suspended between keys.
+
+    It keeps the per-layer scanstackelt stack of basic_table::scan, so
+    next() walks the current leaf's permutation and next links and only
+    revalidates with the leaf's nodeversion when that leaf changed. Nodes
+    removed meanwhile are detected through their deleted bit and the scan
+    re-descends from the current key. The cursor must be re-seeked after
+    the tree reclaimed memory (rcu_quiesce) or was destroyed. */
+template <typename P>
+class scan_cursor {
+  public:
+    typedef typename P::ikey_type ikey_type;
+    typedef typename P::value_type value_type;
+    typedef typename P::threadinfo_type threadinfo;
+    typedef key<ikey_type> key_type;
+    typedef typename leaf<P>::leafvalue_type leafvalue_type;
+    typedef scanstackelt<P> stack_type;
+
+    scan_cursor()
+        : ka_(keybuf_.s, 0), stackpos_(0), valid_(false) {
+    }
+
+    /** Position on the first key >= firstkey (> firstkey if !emit_firstkey).
+        Returns false if there is none. */
+    bool seek(const basic_table<P>& table, Str firstkey, bool emit_firstkey,
+              threadinfo& ti);
+    /** Move to the following key. Returns false at the end of the tree. */
+    bool next(threadinfo& ti);
+
+    bool valid() const {
+        return valid_;
+    }
+    void invalidate() {
+        valid_ = false;
+    }
+    /** The current key; points into the cursor, valid until it moves. */
+    Str cur_key() const {
+        return ka_.full_string();
+    }
+    value_type cur_value() const {
+        return entry_.value();
+    }
+
+  private:
+    union {
+        ikey_type x[(MASSTREE_MAXKEYLEN + sizeof(ikey_type) - 1)/sizeof(ikey_type)];
+        char s[MASSTREE_MAXKEYLEN];
+    } keybuf_;
+    key_type ka_;
+    stack_type stack_[(MASSTREE_MAXKEYLEN + sizeof(ikey_type) - 1) / sizeof(ikey_type)];
+    int stackpos_;
+    leafvalue_type entry_;
+    forward_scan_helper helper_;
+    bool valid_;
+
+    bool run(int state, threadinfo& ti);
+
+    scan_cursor(const scan_cursor<P>&);
+    scan_cursor<P>& operator=(const scan_cursor<P>&);
+};
+
+template <typename P>
+bool scan_cursor<P>::seek(const basic_table<P>& table, Str firstkey,
+                          bool emit_firstkey, threadinfo& ti)
+{
+    masstree_precondition(firstkey.len <= (int) sizeof(keybuf_));
+    memcpy(keybuf_.s, firstkey.s, firstkey.len);
+    ka_ = key_type(keybuf_.s, firstkey.len);
+    stackpos_ = 0;
+    stack_[0].root_ = table.root();
+    entry_ = leafvalue_type::make_empty();
+
+    int state;
+    while (1) {
+        state = stack_[stackpos_].find_initial(helper_, ka_, emit_firstkey,
+                                               entry_, ti);
+        if (state != stack_type::scan_down)
+            break;
+        ka_.shift();
+        ++stackpos_;
+    }
+    return run(state, ti);
+}
+
+template <typename P>
+bool scan_cursor<P>::next(threadinfo& ti)
+{
+    if (!valid_)
+        return false;
+    stack_[stackpos_].ki_ = helper_.next(stack_[stackpos_].ki_);
+    return run(stack_[stackpos_].find_next(helper_, ka_, entry_), ti);
+}
+
+template <typename P>
+bool scan_cursor<P>::run(int state, threadinfo& ti)
+{
+    // same state machine as basic_table::scan, stopping at each emit
+    while (1) {
+        switch (state) {
+        case stack_type::scan_emit:
+            valid_ = true;
+            return true;
+
+        case stack_type::scan_find_next:
+            state = stack_[stackpos_].find_next(helper_, ka_, entry_);
+            break;
+
+        case stack_type::scan_up:
+            do {
+                if (--stackpos_ < 0) {
+                    valid_ = false;
+                    return false;
+                }
+                ka_.unshift();
+                stack_[stackpos_].ki_ = helper_.next(stack_[stackpos_].ki_);
+            } while (unlikely(ka_.empty()));
+            state = stack_[stackpos_].find_next(helper_, ka_, entry_);
+            break;
+
+        case stack_type::scan_down:
+            helper_.shift_clear(ka_);
+            ++stackpos_;
+            state = stack_[stackpos_].find_retry(helper_, ka_, ti);
+            break;
+
+        case stack_type::scan_retry:
+            state = stack_[stackpos_].find_retry(helper_, ka_, ti);
+            break;
+        }
+    }
+}
+
 template <typename P> template <typename F>
 int basic_table<P>::scan(Str firstkey, bool emit_firstkey,
                          F& scanner,
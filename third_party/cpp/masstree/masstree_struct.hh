@@ -20,6 +20,8 @@
 #include "stringbag.hh"
 #include "mtcounters.hh"
 #include "timestamp.hh"
+#include <string>
+#include <vector>
 namespace Masstree {
 
 template <typename P>
@@ -824,6 +826,207 @@ class leafvalue_static {
 };
 
 
+//huanchen-static
+//**********************************************************************************
+// ksuf_frontcode
+//**********************************************************************************
+// Front-coded key suffix area for static nodes. Each suffix is stored as
+// (varint shared, varint unshared, unshared bytes) against the previous
+// suffix; every restart_interval-th entry shares nothing, and only those
+// entries keep a uint32_t offset. A lookup jumps to the restart point
+// before p and decodes at most restart_interval entries from there.
+struct ksuf_frontcode {
+  static const uint32_t restart_interval = 16;
+
+  static uint32_t nrestarts(uint32_t nkeys) {
+    return (nkeys + restart_interval - 1) / restart_interval;
+  }
+
+  static size_t area_size(uint32_t nkeys, size_t datasize) {
+    return sizeof(uint32_t) * (nrestarts(nkeys) + 1) + datasize;
+  }
+
+  static void put_varint(std::string &out, uint32_t x) {
+    while (x >= 0x80) {
+      out.push_back((char)(x | 0x80));
+      x >>= 7;
+    }
+    out.push_back((char)x);
+  }
+
+  static uint32_t get_varint(const char *&s) {
+    uint32_t x = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+      b = (uint8_t)*s++;
+      x |= (uint32_t)(b & 0x7f) << shift;
+      shift += 7;
+    } while (b & 0x80);
+    return x;
+  }
+
+  // Encode the plain suffixes of n into restarts and data. Returns the
+  // size of the resulting area.
+  template <typename N>
+  static size_t encode(N *n, std::vector<uint32_t> &restarts, std::string &data) {
+    Str prev;
+    for (uint32_t p = 0; p < n->nkeys_; p++) {
+      Str s = n->ksuf(p);
+      uint32_t shared = 0;
+      if (p % restart_interval == 0)
+	restarts.push_back((uint32_t)data.size());
+      else
+	while ((int)shared < prev.len && (int)shared < s.len
+	       && prev.s[shared] == s.s[shared])
+	  shared++;
+      put_varint(data, shared);
+      put_varint(data, s.len - shared);
+      data.append(s.s + shared, s.len - shared);
+      prev = s;
+    }
+    restarts.push_back((uint32_t)data.size());
+    return area_size(n->nkeys_, data.size());
+  }
+
+  static const char *data(const uint32_t *restarts, uint32_t nkeys) {
+    return (const char*)(restarts + nrestarts(nkeys) + 1);
+  }
+
+  static Str decode(const uint32_t *restarts, uint32_t nkeys, int p, std::string &buf) {
+    const char *s = data(restarts, nkeys) + restarts[p / restart_interval];
+    buf.clear();
+    for (int i = p - p % restart_interval; i <= p; i++) {
+      uint32_t shared = get_varint(s);
+      uint32_t unshared = get_varint(s);
+      buf.resize(shared);
+      buf.append(s, unshared);
+      s += unshared;
+    }
+    return Str(buf.data(), buf.size());
+  }
+
+  // Compare suffix p against key without materializing it. matched is the
+  // common prefix of key and the entry decoded so far; an entry sharing
+  // more than that with its predecessor cannot match any further.
+  static bool equals(const uint32_t *restarts, uint32_t nkeys, int p, Str key) {
+    const char *s = data(restarts, nkeys) + restarts[p / restart_interval];
+    uint32_t matched = 0, len = 0;
+    for (int i = p - p % restart_interval; i <= p; i++) {
+      uint32_t shared = get_varint(s);
+      uint32_t unshared = get_varint(s);
+      if (shared <= matched) {
+	matched = shared;
+	while (matched - shared < unshared && (int)matched < key.len
+	       && s[matched - shared] == key.s[matched])
+	  matched++;
+      }
+      len = shared + unshared;
+      s += unshared;
+    }
+    return matched == len && (int)len == key.len;
+  }
+
+  template <typename N, typename TI>
+  static N *pack(N *n, TI &ti) {
+    std::vector<uint32_t> restarts;
+    std::string data;
+    uint32_t *area = n->get_ksuf_pos_offset();
+    size_t head = (char*)area - (char*)n;
+    size_t packed = encode(n, restarts, data);
+    if (head + packed >= n->allocated_size())
+      return n;
+    memcpy(area, restarts.data(), sizeof(uint32_t) * restarts.size());
+    memcpy(area + restarts.size(), data.data(), data.size());
+    n = n->resize(head + packed, ti);
+    n->set_allocated_size(head + packed);
+    n->ksufPacked_ = 1;
+    return n;
+  }
+
+  template <typename N, typename TI>
+  static N *unpack(N *n, TI &ti) {
+    uint32_t nkeys = n->nkeys_;
+    std::vector<uint32_t> offsets;
+    std::string plain, buf;
+    uint32_t *area = n->get_ksuf_pos_offset();
+    const char *s = data(area, nkeys);
+    for (uint32_t p = 0; p < nkeys; p++) {
+      uint32_t shared = get_varint(s);
+      uint32_t unshared = get_varint(s);
+      buf.resize(shared);
+      buf.append(s, unshared);
+      s += unshared;
+      offsets.push_back((uint32_t)plain.size());
+      plain.append(buf);
+    }
+    offsets.push_back((uint32_t)plain.size());
+    size_t sz = (char*)area - (char*)n + sizeof(uint32_t) * offsets.size() + plain.size();
+    n = n->resize(sz, ti);
+    area = n->get_ksuf_pos_offset();
+    memcpy(area, offsets.data(), sizeof(uint32_t) * offsets.size());
+    memcpy(area + offsets.size(), plain.data(), plain.size());
+    n->set_allocated_size(sz);
+    n->ksufPacked_ = 0;
+    return n;
+  }
+};
+
+
+//huanchen-static
+//**********************************************************************************
+// static_compactor
+//**********************************************************************************
+// Static remove() only clears a slot's keylenx, and a merge rewrites just the
+// nodes it reaches, so tombstones pile up everywhere else. run() refreshes
+// every node's ndead_ and rewrites the ones whose dead fraction reached
+// ratio. Nodes are visited bottom-up, so a layer that empties out is freed
+// and becomes a tombstone in its parent. Returns the tombstones left behind.
+struct static_compactor {
+  template <typename N, typename TI>
+  static size_t run(N *&root, double ratio, TI &ti) {
+    std::vector<N*> nodes;
+    std::vector<int> parent, slot;
+    if (root) {
+      nodes.push_back(root);
+      parent.push_back(-1);
+      slot.push_back(-1);
+    }
+    for (size_t c = 0; c < nodes.size(); c++) {
+      N *n = nodes[c];
+      uint32_t ndead = 0;
+      for (uint32_t i = 0; i < n->size(); i++) {
+	int keylenx = n->ikeylen(i);
+	if (keylenx == 0)
+	  ndead++;
+	else if (n->keylenx_is_layer(keylenx)) {
+	  nodes.push_back(static_cast<N*>(n->lv(i).layer()));
+	  parent.push_back((int)c);
+	  slot.push_back((int)i);
+	}
+      }
+      n->ndead_ = ndead;
+    }
+
+    size_t left = 0;
+    for (size_t c = nodes.size(); c-- > 0; ) {
+      N *n = nodes[c];
+      if (n->ndead_ == 0 || n->ndead_ < ratio * n->size()) {
+	left += n->ndead_;
+	continue;
+      }
+      n = n->compact(ti);
+      if (c == 0)
+	root = n;
+      else if (!n)
+	nodes[parent[c]]->invalidate(slot[c]);
+      else
+	nodes[parent[c]]->set_layer(slot[c], n);
+    }
+    return left;
+  }
+};
+
 //huanchen-static
 //**********************************************************************************
 // massnode
@@ -840,9 +1043,11 @@ public:
   uint32_t nkeys_;
   uint32_t size_;
   uint8_t hasKsuf_;
+  uint8_t ksufPacked_;
+  uint32_t ndead_; // invalidated slots, see static_compactor
 
   massnode (uint32_t nkeys, uint32_t size, uint8_t hasKsuf)
-    :node_base<P>(false), nkeys_(nkeys), size_(size), hasKsuf_(hasKsuf) {
+    :node_base<P>(false), nkeys_(nkeys), size_(size), hasKsuf_(hasKsuf), ksufPacked_(0), ndead_(0) {
 
   }
 
@@ -875,6 +1080,52 @@ public:
     return (massnode<P>*)ti.reallocate((void*)(this), size_, sz);
   }
 
+  // switch the suffix area between the plain and front-coded layouts;
+  // the merge code only understands the plain one
+  massnode<P> *pack_ksuf (threadinfo &ti) {
+    if (hasKsuf_ != 1 || ksufPacked_)
+      return this;
+    return ksuf_frontcode::pack(this, ti);
+  }
+
+  massnode<P> *unpack_ksuf (threadinfo &ti) {
+    if (!ksufPacked_)
+      return this;
+    return ksuf_frontcode::unpack(this, ti);
+  }
+
+  // copy the live slots into a right-sized node, or free the node and
+  // return NULL if none are left
+  massnode<P> *compact (threadinfo &ti) {
+    massnode<P> *n = unpack_ksuf(ti);
+    uint32_t nlive = n->nkeys_ - n->ndead_;
+    massnode<P> *c = NULL;
+    if (nlive > 0) {
+      size_t ksufSize = 0;
+      for (uint32_t p = 0; p < n->nkeys_; p++)
+	if (n->isValid(p))
+	  ksufSize += n->ksuflen(p);
+      c = make(ksufSize, n->has_ksuf(), nlive, ti);
+      uint32_t q = 0;
+      uint32_t offset = 0;
+      for (uint32_t p = 0; p < n->nkeys_; p++) {
+	if (!n->isValid(p))
+	  continue;
+	c->set_ikeylen(q, n->ikeylen(p));
+	c->set_ikey(q, n->ikey(p));
+	c->set_lv(q, n->lv(p));
+	c->set_ksuf_offset(q, offset);
+	memcpy(c->ksufpos(q), n->ksufpos(p), n->ksuflen(p));
+	offset += n->ksuflen(p);
+	q++;
+      }
+      c->set_ksuf_offset(nlive, offset);
+      c = c->pack_ksuf(ti);
+    }
+    n->deallocate(ti);
+    return c;
+  }
+
   uint8_t *get_keylenx() {
     return (uint8_t*)((char*)this + sizeof(massnode<P>));
   }
@@ -983,6 +1234,10 @@ public:
     get_lv()[p] = lv;
   }
 
+  void set_layer(int p, node_base<P> *n) {
+    set_lv(p, leafvalue_static_type(n));
+  }
+
   key_type get_key(int p) {
     int kl = get_keylenx()[p];
     if (!keylenx_has_ksuf(kl))
@@ -997,6 +1252,7 @@ public:
 
   void invalidate(int p) {
     set_ikeylen(p, (uint8_t)0);
+    ndead_++;
   }
 
   bool isValid(int p) {
@@ -1037,10 +1293,18 @@ public:
       return false;
   }
 
+  // plain layout only; readers that may see a packed node use the
+  // buffered overload below
   Str ksuf(int p) {
     return Str(ksufpos(p), ksuflen(p));
   }
 
+  Str ksuf(int p, std::string &buf) {
+    if (ksufPacked_)
+      return ksuf_frontcode::decode(get_ksuf_pos_offset(), nkeys_, p, buf);
+    return ksuf(p);
+  }
+
   static int keylenx_ikeylen(int keylenx) {
     return keylenx & 31;
   }
@@ -1058,6 +1322,8 @@ public:
   }
 
   bool equals_sloppy(int p, const key_type &ka) {
+    if (ksufPacked_)
+      return ksuf_frontcode::equals(get_ksuf_pos_offset(), nkeys_, p, ka.suffix());
     Str kp_str = ksuf(p);
     if (kp_str.len != ka.suffix().len)
       return false;
@@ -1457,9 +1723,11 @@ public:
 
   uint32_t nkeys_;
   uint32_t size_;
+  uint8_t ksufPacked_;
+  uint32_t ndead_; // invalidated slots, see static_compactor
 
   massnode_dynamicvalue (uint32_t nkeys, uint32_t size)
-    :node_base<P>(false), nkeys_(nkeys), size_(size) {
+    :node_base<P>(false), nkeys_(nkeys), size_(size), ksufPacked_(0), ndead_(0) {
 
   }
 
@@ -1479,6 +1747,50 @@ public:
     return (massnode_dynamicvalue<P>*)ti.reallocate((void*)(this), size_, sz);
   }
 
+  massnode_dynamicvalue<P> *pack_ksuf (threadinfo &ti) {
+    if (ksufPacked_)
+      return this;
+    return ksuf_frontcode::pack(this, ti);
+  }
+
+  massnode_dynamicvalue<P> *unpack_ksuf (threadinfo &ti) {
+    if (!ksufPacked_)
+      return this;
+    return ksuf_frontcode::unpack(this, ti);
+  }
+
+  // copy the live slots into a right-sized node, or free the node and
+  // return NULL if none are left
+  massnode_dynamicvalue<P> *compact (threadinfo &ti) {
+    massnode_dynamicvalue<P> *n = unpack_ksuf(ti);
+    uint32_t nlive = n->nkeys_ - n->ndead_;
+    massnode_dynamicvalue<P> *c = NULL;
+    if (nlive > 0) {
+      size_t ksufSize = 0;
+      for (uint32_t p = 0; p < n->nkeys_; p++)
+	if (n->isValid(p))
+	  ksufSize += n->ksuflen(p);
+      c = make(ksufSize, nlive, ti);
+      uint32_t q = 0;
+      uint32_t offset = 0;
+      for (uint32_t p = 0; p < n->nkeys_; p++) {
+	if (!n->isValid(p))
+	  continue;
+	c->set_ikeylen(q, n->ikeylen(p));
+	c->set_ikey(q, n->ikey(p));
+	c->set_lv(q, n->lv(p));
+	c->set_ksuf_offset(q, offset);
+	memcpy(c->ksufpos(q), n->ksufpos(p), n->ksuflen(p));
+	offset += n->ksuflen(p);
+	q++;
+      }
+      c->set_ksuf_offset(nlive, offset);
+      c = c->pack_ksuf(ti);
+    }
+    n->deallocate(ti);
+    return c;
+  }
+
   uint8_t *get_keylenx() {
     return (uint8_t*)((char*)this + sizeof(massnode_dynamicvalue<P>));
   }
@@ -1597,6 +1909,10 @@ public:
     get_lv()[p] = lv;
   }
 
+  void set_layer(int p, node_base<P> *n) {
+    set_lv(p, leafvalue_type(n));
+  }
+
   key_type get_key(int p) {
     int kl = get_keylenx()[p];
     if (!keylenx_has_ksuf(kl))
@@ -1611,6 +1927,7 @@ public:
 
   void invalidate(int p) {
     set_ikeylen(p, (uint8_t)0);
+    ndead_++;
   }
 
   bool isValid(int p) {
@@ -1638,10 +1955,18 @@ public:
     return get_ksuf_pos_offset()[p] != 0;
   }
 
+  // plain layout only; readers that may see a packed node use the
+  // buffered overload below
   Str ksuf(int p) {
     return Str(ksufpos(p), ksuflen(p));
   }
 
+  Str ksuf(int p, std::string &buf) {
+    if (ksufPacked_)
+      return ksuf_frontcode::decode(get_ksuf_pos_offset(), nkeys_, p, buf);
+    return ksuf(p);
+  }
+
   static int keylenx_ikeylen(int keylenx) {
     return keylenx & 31;
   }
@@ -1659,6 +1984,8 @@ public:
   }
 
   bool equals_sloppy(int p, const key_type &ka) {
+    if (ksufPacked_)
+      return ksuf_frontcode::equals(get_ksuf_pos_offset(), nkeys_, p, ka.suffix());
     Str kp_str = ksuf(p);
     if (kp_str.len != ka.suffix().len)
       return false;
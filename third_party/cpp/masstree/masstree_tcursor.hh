@@ -69,6 +69,7 @@ public:
   bool update(const char *nv);
 
   void destroy(threadinfo &ti);
+  size_t compact(double ratio, threadinfo &ti);
 
   int tree_size();
   
@@ -78,6 +79,9 @@ public:
   inline massnode<P>* node() const {
     return n_;
   }
+  inline node_base<P>* get_root() const {
+    return root_;
+  }
 
 private:
   key_type ka_;
@@ -215,6 +219,7 @@ public:
   bool remove(threadinfo &ti);
 
   void destroy(threadinfo &ti);
+  size_t compact(double ratio, threadinfo &ti);
 
   //int tree_size();
   
@@ -225,6 +230,9 @@ public:
   inline massnode_dynamicvalue<P>* node() const {
     return n_;
   }
+  inline node_base<P>* get_root() const {
+    return root_;
+  }
 
 private:
   key_type ka_;
@@ -333,9 +341,11 @@ private:
   std::vector<int> posTrace_;
   std::vector<ikey_type> cur_key_prefix_;
   Str cur_key_suffix_;
+  std::string cur_ksuf_buf_;
   leafvalue_static<P>* cur_lv_;
   std::vector<ikey_type> next_key_prefix_;
   Str next_key_suffix_;
+  std::string next_ksuf_buf_;
   leafvalue_static<P>* next_lv_;
 
   bool isExact_;
@@ -579,9 +589,11 @@ private:
   std::vector<int> posTrace_;
   std::vector<ikey_type> cur_key_prefix_;
   Str cur_key_suffix_;
+  std::string cur_ksuf_buf_;
   leafvalue<P>* cur_lv_;
   std::vector<ikey_type> next_key_prefix_;
   Str next_key_suffix_;
+  std::string next_ksuf_buf_;
   leafvalue<P>* next_lv_;
 
   bool isExact_;
@@ -866,7 +878,9 @@ class unlocked_tcursor {
   //huanchen-static-multivalue
   massnode_multivalue<P> *buildStaticMultivalue(threadinfo &ti);
   //huanchen-static-dynamicvalue
-  massnode_dynamicvalue<P> *buildStaticDynamicvalue(threadinfo &ti);
+  // convert(row) gives the value to store for each moved row
+  template <typename F>
+  massnode_dynamicvalue<P> *buildStaticDynamicvalue(F &convert, threadinfo &ti);
 
   void stats(threadinfo &ti, std::vector<uint32_t> &nkeys_stats); //huanchen-stats
 
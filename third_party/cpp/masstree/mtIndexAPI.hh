@@ -52,7 +52,10 @@
 #include "kvio.hh"
 #include "clp.h"
 #include <algorithm>
+#include <map>
 #include <numeric>
+#include <string>
+#include <vector>
 
 #include <stdint.h>
 #include "config.h"
@@ -61,6 +64,8 @@
 #define MERGE 1
 #define MERGE_THRESHOLD 100
 #define MERGE_RATIO 5
+#define COMPACT_DEAD_RATIO 0.25
+#define SHARE_STATIC_MIN_KEYS MERGE_THRESHOLD
 #define VALUE_LEN 8
 
 #define USE_BLOOM_FILTER 1
@@ -70,12 +75,51 @@
 
 #define SECONDARY_INDEX_TYPE 1
 
+#define MERGE_PAUSE_BUCKETS 24
+#define LEAF_FILL_BUCKETS 16
+
+// What an index reports about itself through mt_index::get_stats().
+// Lookups are counted once per point lookup by the stage that answered it;
+// the Bloom counters once per probe of a non-empty dynamic stage.
+// merge_pause[b] counts merges that took [2^b, 2^(b+1)) microseconds
+// (bucket 0 also takes anything shorter) and leaf_fill[n] the dynamic
+// leaves holding n keys. Byte counts are 64-bit.
+struct mt_index_stats {
+  uint64_t dynamic_hits;
+  uint64_t static_hits;
+  uint64_t misses;
+  uint64_t bloom_negatives;
+  uint64_t bloom_false_positives;
+  uint64_t merges;
+  uint64_t merge_usec_total;
+  uint64_t merge_usec_max;
+  uint64_t merge_pause[MERGE_PAUSE_BUCKETS];
+  int64_t dynamic_bytes;
+  int64_t static_bytes;
+  int64_t value_bytes;
+  int64_t filter_bytes;
+  uint64_t static_dead;
+  uint64_t static_holders;
+  uint64_t leaf_fill[LEAF_FILL_BUCKETS];
+};
+
 template <typename T>
 class mt_index {
+  typedef Masstree::massnode<typename T::param_type> static_node_type;
+  typedef Masstree::massnode_dynamicvalue<typename T::param_type> static_dynamicvalue_node_type;
+  typedef Masstree::node_base<typename T::param_type> static_base_node_type;
 public:
   mt_index() {}
   ~mt_index() {
-    table_->destroy(*ti_);
+    if (shared_ != NULL) {
+      release_shared();
+      static_table_->table().set_static_root(NULL);
+    }
+
+    if (multivalue_)
+      table_->destroy(*ti_);
+    else
+      table_->destroy_novalue(*ti_);
     delete table_;
     ti_->rcu_clean();
     ti_->deallocate_ti();
@@ -131,6 +175,14 @@ public:
 
     ic = 0;
     sic = 0;
+    sdead = 0;
+    memset(&stats_, 0, sizeof(stats_));
+    bulk_load_ = false;
+    shared_ = NULL;
+    dynamic_version_ = 0;
+    dcur_version_ = 0;
+    value_len_ = VALUE_LEN;
+    packed_static_values_ = false;
 
     srand(rdtsc_timer());
     merge_ratio = MERGE_RATIO + ((rand() % 100) * 0.1);
@@ -175,12 +227,27 @@ public:
     multivalue_ = multivalue;
   }
 
+  // Multivalue indexes may store shorter fixed-width values (e.g. 32-bit
+  // tuple ids); ic/sic count values in units of this width. Must be called
+  // before the first insert.
+  void set_value_len(int len) {
+    value_len_ = len;
+  }
+
+  // Keep each static multivalue key's values sorted and delta/varint
+  // encoded instead of as a flat array. Must be called before the first
+  // insert.
+  void set_packed_static_values(bool packed) {
+    packed_static_values_ = packed;
+  }
+
 
   //#####################################################################################
   // Garbage Collection
   //#####################################################################################
   inline void clean_rcu() {
     ti_->rcu_quiesce();
+    ++dynamic_version_;
   }
 
   inline void static_clean_rcu() {
@@ -218,6 +285,7 @@ public:
     table_ = new T;
     table_->initialize(*ti_);
     ic = 0;
+    ++dynamic_version_;
   }
 
   //#####################################################################################  
@@ -321,17 +389,16 @@ public:
       lp.finish(1, *ti_);
       return false;
     }
-    qtimes_.ts = ti_->update_timestamp();
-    qtimes_.prev_ts = 0;
-    lp.value() = row_type::create1(value, qtimes_.ts, *ti_);
+    lp.value() = inline_value(value);
     lp.finish(1, *ti_);
     ic++;
+    ++dynamic_version_;
 
     //bloom filter
     if (USE_BLOOM_FILTER)
       InsertToFilter(key.s, key.len, bloom_filter);
 
-    if ((MERGE == 1) && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
+    if ((MERGE == 1) && !bulk_load_ && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
       return merge_uv();
     return true;
   }
@@ -355,15 +422,21 @@ public:
       if (USE_BLOOM_FILTER)
 	InsertToFilter(key.s, key.len, bloom_filter);
     }
-    else {
+    else if (multivalue_) {
       qtimes_.ts = ti_->update_timestamp(lp.value()->timestamp());
       qtimes_.prev_ts = lp.value()->timestamp();
       lp.value()->deallocate_rcu(*ti_);
     }
-    lp.value() = row_type::create1(value, qtimes_.ts, *ti_);
+    if (multivalue_)
+      lp.value() = row_type::create1(value, qtimes_.ts, *ti_);
+    else
+      lp.value() = inline_value(value);
     lp.finish(1, *ti_);
     //ic++;
-    ic += (value.len/VALUE_LEN);
+    // an inline overwrite keeps the key count unchanged
+    if (multivalue_ || !found)
+      ic += (value.len/value_len_);
+    ++dynamic_version_;
   }
   void put(const char *key, int keylen, const char *value, int valuelen) {
     return put(Str(key, keylen), Str(value, valuelen));
@@ -402,9 +475,10 @@ public:
     }
     lp.finish(1, *ti_);
     //ic++;
-    ic += (value.len/VALUE_LEN);
+    ic += (value.len/value_len_);
+    ++dynamic_version_;
 
-    if ((MERGE == 1) && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
+    if ((MERGE == 1) && !bulk_load_ && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
       merge_nuv();
   }
   void put_nuv0(const char *key, int keylen, const char *value, int valuelen) {
@@ -428,19 +502,29 @@ public:
     char *put_value_string;
     int put_value_len;
     // if NOT found in dynamic, search static
-    if ((!found) && (sic != 0)) {
+    if ((!found) && (sic != 0) && own_static_for(key)) {
       typename T::static_dynamicvalue_cursor_type lp_d(static_table_->table(), key);
       bool found_s = lp_d.find();
       // if found in static, update the values and return
+      if (found_s && packed_static_values_ && value.len == value_len_) {
+	Str packed = lp_d.value()->col(0);
+	pack_buf_.assign(packed.s, packed.len);
+	packed_insert(packed_value(value));
+	lp_d.value()->deallocate_rcu(*ti_);
+	lp_d.value() = packed_row();
+	sic++;
+	return;
+      }
       if (found_s) {
-	put_value_len = value.len + lp_d.value()->col(0).len;
+	Str static_value = static_values(lp_d.value());
+	put_value_len = value.len + static_value.len;
 	put_value_string = (char*)malloc(put_value_len);
 	memcpy(put_value_string, value.s, value.len);
-	memcpy(put_value_string + value.len, lp_d.value()->col(0).s, lp_d.value()->col(0).len);
+	memcpy(put_value_string + value.len, static_value.s, static_value.len);
 	lp_d.value()->deallocate_rcu(*ti_);
-	lp_d.value() = row_type::create1(Str(put_value_string, put_value_len), qtimes_.ts, *ti_);
+	lp_d.value() = make_static_row(Str(put_value_string, put_value_len));
 	free(put_value_string);
-	sic += (value.len/VALUE_LEN);
+	sic += (value.len/value_len_);
 	return;
       }
     }
@@ -471,9 +555,10 @@ public:
       free(put_value_string);
     }
     lp.finish(1, *ti_);
-    ic += (value.len/VALUE_LEN);
+    ic += (value.len/value_len_);
+    ++dynamic_version_;
 
-    if ((MERGE == 1) && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
+    if ((MERGE == 1) && !bulk_load_ && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
       merge_nuv();
   }
   void put_nuv1(const char *key, int keylen, const char *value, int valuelen) {
@@ -493,20 +578,14 @@ public:
   // Get (unique value)
   //#################################################################################
   inline bool dynamic_get(const Str &key, Str &value) {
-    //bloom filter
-    if (USE_BLOOM_FILTER) {
-      if (ic == 0 || !KeyMayMatch(key.s, key.len, bloom_filter)) {
-	return false;
-      }
-    }
-    else {
-      if (ic == 0)
-	return false;
-    }
+    if (!dynamic_may_contain(key))
+      return false;
     typename T::unlocked_cursor_type lp(table_->table(), key);
     bool found = lp.find_unlocked(*ti_);
     if (found)
-      value = lp.value()->col(0);
+      value = dynamic_value(lp.value());
+    else
+      count_bloom_miss();
     return found;
   }
   bool dynamic_get(const char *key, int keylen, Str &value) {
@@ -529,7 +608,8 @@ public:
 
   inline bool get (const Str &key, Str &value) {
     if (!dynamic_get(key, value))
-      return static_get(key, value);
+      return count_static_lookup(static_get(key, value));
+    stats_.dynamic_hits++;
     return true;
   }
   bool get (const char *key, int keylen, Str &value) {
@@ -561,7 +641,7 @@ public:
     typename T::static_dynamicvalue_cursor_type lp(static_table_->table(), key);
     bool found = lp.find();
     if (found)
-      value = lp.value()->col(0);
+      value = static_values(lp.value());
     return found;
   }
   bool static_get_nuv1(const char *key, int keylen, Str &value) {
@@ -580,6 +660,10 @@ public:
 	static_get_success = static_get_nuv1(key, static_value);
     }
 
+    if (dynamic_get_success)
+      stats_.dynamic_hits++;
+    else
+      count_static_lookup(static_get_success);
     if ((!dynamic_get_success) && (!static_get_success))
       return false;
     if (!dynamic_get_success)
@@ -616,28 +700,21 @@ public:
   // Get (ordered, unique)
   //#################################################################################
   inline bool dynamic_get_ordered(const Str &key, Str &value) {
-    //bloom filter
-    if (USE_BLOOM_FILTER) {
-      if (ic == 0 || !KeyMayMatch(key.s, key.len, bloom_filter)) {
-	cur_keylen_ = 0;
-	return false;
-      }
-    }
-    else {
-      if (ic == 0) {
-	cur_keylen_ = 0;
-	return false;
-      }
+    if (!dynamic_may_contain(key)) {
+      cur_keylen_ = 0;
+      return false;
     }
     typename T::unlocked_cursor_type lp(table_->table(), key);
     bool found = lp.find_unlocked(*ti_);
     if (found) {
-      value = lp.value()->col(0);
+      value = dynamic_value(lp.value());
       memcpy(cur_key_, key.s, key.len);
       cur_keylen_ = key.len;
     }
-    else
+    else {
       cur_keylen_ = 0;
+      count_bloom_miss();
+    }
     return found;
   }
   inline bool dynamic_get_ordered(const char *key, int keylen, Str &value) {
@@ -666,10 +743,11 @@ public:
 
   inline bool get_ordered(const Str &key, Str &value) {
     if (dynamic_get_ordered(key, value)) {
+      stats_.dynamic_hits++;
       static_cur_keylen_ = 0;
       return true;
     }
-    if (static_get_ordered(key, value)) {
+    if (count_static_lookup(static_get_ordered(key, value))) {
       cur_keylen_ = 0;
       return true;
     }
@@ -711,7 +789,7 @@ public:
     typename T::static_dynamicvalue_cursor_type lp(static_table_->table(), key);
     bool found = lp.find();
     if (found) {
-      value = lp.value()->col(0);
+      value = static_values(lp.value());
       memcpy(static_cur_key_, key.s, key.len);
       static_cur_keylen_ = key.len;
     }
@@ -734,6 +812,10 @@ public:
 	static_get_success = static_get_ordered_nuv1(key, static_value);
     }
 
+    if (dynamic_get_success)
+      stats_.dynamic_hits++;
+    else
+      count_static_lookup(static_get_success);
     if ((!dynamic_get_success) && (!static_get_success))
       return false;
     if (!dynamic_get_success)
@@ -772,23 +854,18 @@ public:
   //#################################################################################
   inline bool exist(const Str &key) {
     bool found = false;
-    //bloom filter
-    if (USE_BLOOM_FILTER) {
-      if (ic != 0 && KeyMayMatch(key.s, key.len, bloom_filter)) {
-	typename T::unlocked_cursor_type lp(table_->table(), key);
-	found = lp.find_unlocked(*ti_);
-      }
-    }
-    else {
-      if (ic != 0) {
-	typename T::unlocked_cursor_type lp(table_->table(), key);
-	found = lp.find_unlocked(*ti_);
-      }
+    if (dynamic_may_contain(key)) {
+      typename T::unlocked_cursor_type lp(table_->table(), key);
+      found = lp.find_unlocked(*ti_);
+      if (!found)
+	count_bloom_miss();
     }
     if (!found) {
       typename T::static_cursor_type slp(static_table_->table(), key);
-      found = slp.find();
+      found = count_static_lookup(slp.find());
     }
+    else
+      stats_.dynamic_hits++;
     return found;
   }
   bool exist(const char *key, int keylen) {
@@ -798,16 +875,10 @@ public:
   inline bool exist_nuv(const Str &key) {
     typename T::unlocked_cursor_type lp(table_->table(), key);
     bool found = false;
-    //bloom filter
-    if (USE_BLOOM_FILTER) {
-      if (ic != 0 && KeyMayMatch(key.s, key.len, bloom_filter)) {
-	found = lp.find_unlocked(*ti_);
-      }
-    }
-    else {
-      if (ic != 0) {
-	found = lp.find_unlocked(*ti_);
-      }
+    if (dynamic_may_contain(key)) {
+      found = lp.find_unlocked(*ti_);
+      if (!found)
+	count_bloom_miss();
     }
     if (!found) {
       if (SECONDARY_INDEX_TYPE == 0) {
@@ -818,7 +889,10 @@ public:
 	typename T::static_dynamicvalue_cursor_type slp_d(static_table_->table(), key);
 	found = slp_d.find();
       }
+      count_static_lookup(found);
     }
+    else
+      stats_.dynamic_hits++;
     return found;
   }
   bool exist_nuv(const char *key, int keylen) {
@@ -973,24 +1047,72 @@ public:
   //#################################################################################
   // Partial Key Get (ordered)
   //#################################################################################
+  //---------------------------------------------------------------------------------
+  // The dynamic stage keeps one scan cursor, dcur_, parked on cur_key_ between
+  // calls, so stepping a range scan walks the current leaf instead of
+  // descending from the root. Any change to the dynamic tree bumps
+  // dynamic_version_, after which the cursor is re-seeked from cur_key_.
+  //---------------------------------------------------------------------------------
+  inline bool dynamic_cursor_seek(const Str &key, bool emit_equal) {
+    bool found = dcur_.seek(table_->table(), key, emit_equal, *ti_);
+    while (found && multivalue_ && row_is_marker(dcur_.cur_value()))
+      found = dcur_.next(*ti_);
+    dcur_version_ = dynamic_version_;
+    return found;
+  }
+
+  inline bool dynamic_cursor_next() {
+    bool found = dcur_.next(*ti_);
+    while (found && multivalue_ && row_is_marker(dcur_.cur_value()))
+      found = dcur_.next(*ti_);
+    return found;
+  }
+
+  // Make dcur_ sit on cur_key_ (or the first key after it, if it is gone).
+  inline bool dynamic_cursor_sync() {
+    if (dcur_.valid() && dcur_version_ == dynamic_version_) {
+      Str key = dcur_.cur_key();
+      if ((key.len == cur_keylen_) && (memcmp(key.s, cur_key_, key.len) == 0))
+	return true;
+    }
+    return dynamic_cursor_seek(Str(cur_key_, cur_keylen_), true);
+  }
+
+  inline void dynamic_cursor_save(char *buf, int &len) {
+    Str key = dcur_.cur_key();
+    memcpy(buf, key.s, key.len);
+    len = key.len;
+  }
+
+  // Bring cur_key_ up to date before it is compared with static_cur_key_:
+  // the pending dynamic key may have been removed since the last call.
+  inline void dynamic_cursor_refresh() {
+    if (cur_keylen_ == 0)
+      return;
+    if (dynamic_cursor_sync())
+      dynamic_cursor_save(cur_key_, cur_keylen_);
+    else
+      cur_keylen_ = 0;
+  }
+
   inline bool dynamic_get_upper_bound_or_equal(const char *key, int keylen) {
-    if (ic == 0)
+    if (ic == 0) {
+      cur_keylen_ = 0;
       return false;
-    Json req = Json::array(0, 0, Str(key, keylen), 1);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    if (req.size() == 2) {
+    }
+    if (!dynamic_cursor_seek(Str(key, keylen), true)) {
       cur_keylen_ = 0;
       return false;
     }
-    Str retKey = req[2].as_s();
-    memcpy(cur_key_, retKey.s, retKey.len);
-    cur_keylen_ = retKey.len;
+    dynamic_cursor_save(cur_key_, cur_keylen_);
     return true;
   }
 
   inline bool static_get_upper_bound_or_equal(const char *key, int keylen) {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_cursor_scan_type lp(static_table_->table(), Str(key, keylen));
     bool found = lp.find_upper_bound_or_equal();
     if (!found) {
@@ -1006,8 +1128,10 @@ public:
   }
 
   inline bool static_get_upper_bound_or_equal_nuv0(const char *key, int keylen) {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_multivalue_cursor_scan_type lp(static_table_->table(), Str(key, keylen));
     bool found = lp.find_upper_bound_or_equal();
     if (!found) {
@@ -1023,8 +1147,10 @@ public:
   }
 
   inline bool static_get_upper_bound_or_equal_nuv1(const char *key, int keylen) {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_dynamicvalue_cursor_scan_type lp(static_table_->table(), Str(key, keylen));
     bool found = lp.find_upper_bound_or_equal();
     if (!found) {
@@ -1057,23 +1183,23 @@ public:
   }
 
   inline bool dynamic_get_upper_bound(const char *key, int keylen) {
-    if (ic == 0)
-      return false;
-    if (!dynamic_get_upper_bound_or_equal(key, keylen))
+    if (ic == 0) {
+      cur_keylen_ = 0;
       return false;
-    if (dynamic_exist(key, keylen)) {
-      Str value;
-      if (dynamic_get_next(value))
-	return true;
+    }
+    if (!dynamic_cursor_seek(Str(key, keylen), false)) {
       cur_keylen_ = 0;
       return false;
     }
+    dynamic_cursor_save(cur_key_, cur_keylen_);
     return true;
   }
 
   inline bool static_get_upper_bound(const char *key, int keylen) {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_cursor_scan_type lp(static_table_->table(), Str(key, keylen));
     bool found = lp.find_upper_bound();
     if (!found) {
@@ -1089,8 +1215,10 @@ public:
   }
 
   inline bool static_get_upper_bound_nuv0(const char *key, int keylen) {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_multivalue_cursor_scan_type lp(static_table_->table(), Str(key, keylen));
     bool found = lp.find_upper_bound();
     if (!found) {
@@ -1106,8 +1234,10 @@ public:
   }
 
   inline bool static_get_upper_bound_nuv1(const char *key, int keylen) {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_dynamicvalue_cursor_scan_type lp(static_table_->table(), Str(key, keylen));
     bool found = lp.find_upper_bound();
     if (!found) {
@@ -1140,22 +1270,22 @@ public:
   }
 
   inline bool dynamic_get_first() {
-    if (ic == 0)
+    if (ic == 0) {
+      cur_keylen_ = 0;
       return false;
-    Json req = Json::array(0, 0, Str("\0", 1), 1);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    if (req.size() == 2) {
+    }
+    if (!dynamic_cursor_seek(Str("\0", 1), true)) {
       cur_keylen_ = 0;
       return false;
     }
-    Str retKey = req[2].as_s();
-    memcpy(cur_key_, retKey.s, retKey.len);
-    cur_keylen_ = retKey.len;
+    dynamic_cursor_save(cur_key_, cur_keylen_);
     return true;
   }
   inline bool static_get_first() {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_cursor_scan_type lp(static_table_->table(), Str("\0", 1));
     bool found = lp.find_upper_bound_or_equal();
     if (!found) {
@@ -1171,8 +1301,10 @@ public:
   }
 
   inline bool static_get_first_nuv0() {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_multivalue_cursor_scan_type lp(static_table_->table(), Str("\0", 1));
     bool found = lp.find_upper_bound_or_equal();
     if (!found) {
@@ -1188,8 +1320,10 @@ public:
   }
 
   inline bool static_get_first_nuv1() {
-    if (sic == 0)
+    if (sic == 0) {
+      static_cur_keylen_ = 0;
       return false;
+    }
     typename T::static_dynamicvalue_cursor_scan_type lp(static_table_->table(), Str("\0", 1));
     bool found = lp.find_upper_bound_or_equal();
     if (!found) {
@@ -1226,41 +1360,15 @@ public:
   // Get Next
   //#################################################################################
   bool get_next(const Str &cur_key, Str &key, Str &value) {
-    std::vector<Str> keys;
-    std::vector<Str> values;
-    Json req = Json::array(0, 0, cur_key, 2);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    keys.clear();
-    values.clear();
-    for (int i = 2; i != req.size(); i += 2) {
-      keys.push_back(req[i].as_s());
-      values.push_back(req[i + 1].as_s());
-    }
-    if ((keys.size() < 2) || (values.size() < 2))
-      return false;
-    key = keys[1];
-    value = values[1];
-    if ((key.len == 0) || (value.len == 0))
+    if (ic == 0 || !dynamic_cursor_seek(cur_key, false))
       return false;
+    key = dcur_.cur_key();
+    value = dynamic_value(dcur_.cur_value());
     return true;
   }
 
   bool get_next(const char *cur_key, int cur_keylen, Str &key, Str &value) {
-    std::vector<Str> keys;
-    std::vector<Str> values;
-    Json req = Json::array(0, 0, Str(cur_key, cur_keylen), 2);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    keys.clear();
-    values.clear();
-    for (int i = 2; i != req.size(); i += 2) {
-      keys.push_back(req[i].as_s());
-      values.push_back(req[i + 1].as_s());
-    }
-    if ((keys.size() < 2) || (values.size() < 2))
-      return false;
-    key = keys[1];
-    value = values[1];
-    return true;
+    return get_next(Str(cur_key, cur_keylen), key, value);
   }
 
 
@@ -1268,19 +1376,13 @@ public:
   // Get Next (ordered)
   //#################################################################################
   inline bool dynamic_get_next(Str &value) {
-    Json req = Json::array(0, 0, Str(cur_key_, cur_keylen_), 2);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    if (req.size() < 4)
+    if (!dynamic_cursor_sync())
       return false;
-    value = req[3].as_s();
-    if (req.size() < 6) {
+    value = dynamic_value(dcur_.cur_value());
+    if (!dynamic_cursor_next())
       cur_keylen_ = 0;
-    }
-    else {
-      Str cur_key_str = req[4].as_s();
-      memcpy(cur_key_, cur_key_str.s, cur_key_str.len);
-      cur_keylen_ = cur_key_str.len;
-    }
+    else
+      dynamic_cursor_save(cur_key_, cur_keylen_);
     return true;
   }
 
@@ -1330,7 +1432,7 @@ public:
     typename T::static_dynamicvalue_cursor_scan_type lp(static_table_->table(), 
 							Str(static_cur_key_, static_cur_keylen_));
     bool found = lp.find_next();
-    value = lp.cur_value()->col(0);
+    value = static_values(lp.cur_value());
     if (!found) {
       static_cur_keylen_ = 0;
     }
@@ -1345,6 +1447,7 @@ public:
   }
 
   bool get_next(Str &value) {
+    dynamic_cursor_refresh();
     if ((cur_keylen_ == 0) && (static_cur_keylen_ == 0))
       return false;
     if (cur_keylen_ == 0)
@@ -1378,6 +1481,7 @@ public:
   }
 
   bool get_next_nuv(Str &value) {
+    dynamic_cursor_refresh();
     if ((cur_keylen_ == 0) && (static_cur_keylen_ == 0))
       return false;
     if (cur_keylen_ == 0) {
@@ -1450,14 +1554,10 @@ public:
   }
   */
   inline bool dynamic_peek_static_cur(Str &value) {
-    Json req = Json::array(0, 0, Str(static_cur_key_, static_cur_keylen_), 1);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    if (req.size() < 4)
+    if (!dynamic_cursor_seek(Str(static_cur_key_, static_cur_keylen_), true))
       return false;
-    value = req[3].as_s();
-    Str next_key_str = req[2].as_s();
-    memcpy(next_key_, next_key_str.s, next_key_str.len);
-    next_keylen_ = next_key_str.len;
+    value = dynamic_value(dcur_.cur_value());
+    dynamic_cursor_save(next_key_, next_keylen_);
     return true;
   }
 
@@ -1502,7 +1602,7 @@ public:
     bool found = lp.find_upper_bound_or_equal();
     if (!found)
       return false;
-    value = lp.cur_value()->col(0);
+    value = static_values(lp.cur_value());
     char *retKey = lp.cur_key();
     int retKeyLen = lp.cur_keylen();
     memcpy(static_next_key_, retKey, retKeyLen);
@@ -1512,14 +1612,14 @@ public:
   }
 
   inline bool dynamic_peek_next(Str &value) {
-    Json req = Json::array(0, 0, Str(cur_key_, cur_keylen_), 2);
-    q_[0].run_scan(table_->table(), req, *ti_);
-    if (req.size() < 6)
+    if (!dynamic_cursor_sync())
       return false;
-    value = req[5].as_s();
-    Str next_key_str = req[4].as_s();
-    memcpy(next_key_, next_key_str.s, next_key_str.len);
-    next_keylen_ = next_key_str.len;
+    // the cursor moves on to the peeked key; if the caller does not advance
+    // cur_key_ to it, the next sync re-seeks
+    if (!dynamic_cursor_next())
+      return false;
+    value = dynamic_value(dcur_.cur_value());
+    dynamic_cursor_save(next_key_, next_keylen_);
     return true;
   }
 
@@ -1565,7 +1665,7 @@ public:
     bool found = lp.find_next();
     if (!found)
       return false;
-    value = lp.next_value()->col(0);
+    value = static_values(lp.next_value());
     char *retKey = lp.next_key();
     int retKeyLen = lp.next_keylen();
     memcpy(static_next_key_, retKey, retKeyLen);
@@ -1803,19 +1903,31 @@ public:
       ti_->dealloc_rcu += ti_->limbo;
       ti_->limbo = 0;
     }
-    bool remove_success = q_[0].run_remove(table_->table(), key, *ti_);
-    if (remove_success)
+    bool remove_success;
+    if (multivalue_)
+      remove_success = q_[0].run_remove(table_->table(), key, *ti_);
+    else {
+      // inline values own no row to reclaim
+      typename T::cursor_type lp(table_->table(), key);
+      remove_success = lp.find_locked(*ti_);
+      lp.finish(-1, *ti_);
+    }
+    if (remove_success) {
       ic--;
+      ++dynamic_version_;
+    }
     return remove_success;
   }
   inline bool static_remove(const Str &key) {
-    if (sic == 0)
+    if (sic == 0 || !own_static_for(key))
       return false;
     //static_clean_rcu();
     typename T::static_cursor_type lp(static_table_->table(), key);
     bool remove_success = lp.remove();
-    if (remove_success)
+    if (remove_success) {
       sic--;
+      sdead++;
+    }
     return remove_success;
   }
 
@@ -1872,7 +1984,7 @@ public:
     put(key, Str(put_back_value_string, put_back_value_len));
     free(put_back_value_string);
     ic--;
-    ic -= (put_back_value_len/VALUE_LEN);
+    ic -= (put_back_value_len/value_len_);
     return true;
   }
 
@@ -1887,12 +1999,14 @@ public:
   }
 
   inline bool static_remove_nuv1(const Str &key) {
-    if (sic == 0)
+    if (sic == 0 || !own_static_for(key))
       return false;
     typename T::static_dynamicvalue_cursor_type lp(static_table_->table(), key);
     bool remove_success = lp.remove(*ti_);
-    if (remove_success)
+    if (remove_success) {
       sic--;
+      sdead++;
+    }
     return remove_success;
   }
 
@@ -1928,19 +2042,29 @@ public:
       put_nuv0(key, Str(put_back_value_string, put_back_value_len));
       free(put_back_value_string);
 
-      sic -= (put_back_value_len/VALUE_LEN);
+      sic -= (put_back_value_len/value_len_);
     }
     return true;
   }
 
   inline bool static_remove_nuv1(const Str &key, const Str &value) {
-    if (sic == 0)
+    if (sic == 0 || !own_static_for(key))
       return false;
     typename T::static_dynamicvalue_cursor_type lp(static_table_->table(), key);
     bool  found = lp.find();
     if (!found)
       return false;
-    Str get_value = lp.value()->col(0);
+    if (packed_static_values_ && value.len == value_len_) {
+      if (!packed_remove(lp.value()->col(0), packed_value(value)))
+	return false;
+      if (pack_buf_.empty())
+	return static_remove_nuv1(key);
+      lp.value()->deallocate_rcu(*ti_);
+      lp.value() = packed_row();
+      sic--;
+      return true;
+    }
+    Str get_value = static_values(lp.value());
 
     int i = 0;
     int j = 0;
@@ -1965,16 +2089,14 @@ public:
       memcpy(put_back_value_string + found_pos, get_value.s + found_pos + value.len, get_value.len - found_pos - value.len);
 
       lp.value()->deallocate_rcu(*ti_);
-      lp.value() = row_type::create1(Str(put_back_value_string, put_back_value_len), qtimes_.ts, *ti_);
+      lp.value() = make_static_row(Str(put_back_value_string, put_back_value_len));
 
       free(put_back_value_string);
-      sic -= (value.len/VALUE_LEN);
+      sic -= (value.len/value_len_);
       return true;
     }
-    else if (get_value.len == value.len) {
-      sic -= (value.len/VALUE_LEN);
+    else if (get_value.len == value.len)
       return static_remove_nuv1(key);
-    }
     return false;
    }
 
@@ -2102,6 +2224,7 @@ public:
 
     lp.finish(1, *ti_);
     free(put_value_string);
+    ++dynamic_version_;
     return true;
   }
 
@@ -2136,7 +2259,7 @@ public:
   }
 
   inline bool static_replace1(const Str &key, const Str &value, const Str &old_value) {
-    if (sic == 0)
+    if (sic == 0 || !own_static_for(key))
       return false;
     if (value.len != old_value.len)
       return false;
@@ -2144,7 +2267,15 @@ public:
     bool found = lp.find();
     if (!found)
       return false;
-    Str get_value = lp.value()->col(0);
+    if (packed_static_values_ && value.len == value_len_) {
+      if (!packed_remove(lp.value()->col(0), packed_value(old_value)))
+	return false;
+      packed_insert(packed_value(value));
+      lp.value()->deallocate_rcu(*ti_);
+      lp.value() = packed_row();
+      return true;
+    }
+    Str get_value = static_values(lp.value());
 
     int i = 0;
     int j = 0;
@@ -2168,7 +2299,7 @@ public:
     memcpy(put_back_value_string + found_pos, value.s, value.len);
 
     lp.value()->deallocate_rcu(*ti_);
-    lp.value() = row_type::create1(Str(put_back_value_string, put_back_value_len), qtimes_.ts, *ti_);
+    lp.value() = make_static_row(Str(put_back_value_string, put_back_value_len));
     free(put_back_value_string);
     return true;
   }
@@ -2192,6 +2323,8 @@ public:
   // Update
   //#################################################################################
   inline bool static_update_uv(const Str &key, const char *value) {
+    if (!own_static_for(key))
+      return false;
     typename T::static_cursor_type lp(static_table_->table(), key);
     return lp.update(value);
   }
@@ -2219,6 +2352,7 @@ public:
   // Merge
   //#################################################################################
   bool merge_uv() {
+    uint64_t merge_start = merge_clock();
     //std::cout << "merge unique\n";
     //std::cout << "ic = " << ic << "\n";
     //std::cout << "sic = " << sic << "\n";
@@ -2238,9 +2372,11 @@ public:
     else {
       q_[0].run_buildStatic(table_->table(), *ti_);
     }
+    unshare_static();
     q_[0].run_merge(static_table_->table(), table_->table(), *sti_, *ti_);
     sic += ic;
     reset();
+    compact_static();
 
     //bloom filter
     if (USE_BLOOM_FILTER) {
@@ -2248,11 +2384,14 @@ public:
       bloom_filter = CreateEmptyFilter(sic/merge_ratio);
     }
 
+    note_merge(merge_start);
     //static_print_items();
     return true;
   }
 
   bool merge_nuv() {
+    uint64_t merge_start = merge_clock();
+    unshare_static();
     //std::cout << "merge non-unique\n";
     //std::cout << "ic = " << ic << "\n";
     //std::cout << "sic = " << sic << "\n";
@@ -2265,12 +2404,14 @@ public:
       //std::cout << "merge non-unique\n";
       //std::cout << "ic = " << ic << "\n";
       //std::cout << "sic = " << sic << "\n";
-      q_[0].run_buildStatic_dynamicvalue(table_->table(), *ti_);
+      static_row_packer packer = {*this};
+      q_[0].run_buildStatic_dynamicvalue(table_->table(), packer, *ti_);
       q_[0].run_merge_dynamicvalue(static_table_->table(), table_->table(), *sti_, *ti_);
     }
 
     sic += ic;
     reset();
+    compact_static();
 
     //bloom filter
     if (USE_BLOOM_FILTER) {
@@ -2278,10 +2419,115 @@ public:
       bloom_filter = CreateEmptyFilter(sic/merge_ratio);
     }
 
+    note_merge(merge_start);
     //static_print_items();
     return true;
   }
 
+  // Rewrite the static nodes whose tombstones reached COMPACT_DEAD_RATIO
+  // of their slots. Every merge that finds tombstones ends with this, and
+  // it can also be run on its own while the index is idle.
+  void compact_static() {
+    if (sdead == 0 || shared_ != NULL)
+      return;
+    if (!multivalue_)
+      sdead = q_[0].run_compact_static(static_table_->table(), COMPACT_DEAD_RATIO, *sti_);
+    else if (SECONDARY_INDEX_TYPE == 1)
+      sdead = q_[0].run_compact_static_dynamicvalue(static_table_->table(), COMPACT_DEAD_RATIO, *sti_);
+  }
+
+  //#################################################################################
+  // Shared Static Stage
+  //#################################################################################
+  // Indexes in one process that hold the same entries (e.g. the copies of a
+  // replicated table's index in every partition) can point at a single
+  // static stage. share_static() folds the dynamic stage in and registers
+  // the static stage under key; an index whose stage has the same content,
+  // checked by a digest over every live key and value, drops its own nodes
+  // and attaches to the registered ones. Each index keeps its own dynamic
+  // stage, and the first change to the static stage (a merge, a remove or
+  // an update of a static entry) gives that index a private copy again.
+  // Values must not depend on the holder (tuple ids, not addresses).
+  bool share_static(const char *key) {
+    if (multivalue_ && SECONDARY_INDEX_TYPE != 1)
+      return false;
+    if (ic > 0)
+      merge();
+    if (shared_ != NULL)
+      return true;
+    if (sic < SHARE_STATIC_MIN_KEYS)
+      return false;
+    uint64_t digest;
+    if (multivalue_)
+      digest = static_digest<static_dynamicvalue_node_type>();
+    else
+      digest = static_digest<static_node_type>();
+
+    shared_static *s = NULL;
+    pthread_mutex_lock(&shared_statics_lock());
+    std::pair<typename shared_static_map::iterator, typename shared_static_map::iterator> range
+      = shared_statics().equal_range(key);
+    for (typename shared_static_map::iterator it = range.first; it != range.second; ++it) {
+      shared_static *c = it->second;
+      if (c->digest == digest && c->sic == sic && c->multivalue == multivalue_
+	  && c->packed == packed_static_values_ && c->value_len == value_len_) {
+	s = c;
+	break;
+      }
+    }
+    if (s != NULL)
+      s->refs++;
+    else {
+      s = new shared_static;
+      s->digest = digest;
+      s->root = static_table_->table().static_root();
+      s->sic = sic;
+      s->sdead = sdead;
+      s->multivalue = multivalue_;
+      s->packed = packed_static_values_;
+      s->value_len = value_len_;
+      s->refs = 1;
+      shared_statics().insert(std::make_pair(std::string(key), s));
+    }
+    pthread_mutex_unlock(&shared_statics_lock());
+
+    if (s->root != static_table_->table().static_root()) {
+      free_static(static_table_->table().static_root());
+      static_table_->table().set_static_root(s->root);
+      sdead = s->sdead;
+    }
+    shared_ = s;
+    return true;
+  }
+
+  bool is_static_shared() const {
+    return shared_ != NULL;
+  }
+
+  // Give this index a private static stage again. The last holder just
+  // takes the registered nodes over; anyone else copies them.
+  void unshare_static() {
+    if (shared_ == NULL)
+      return;
+    bool last = false;
+    pthread_mutex_lock(&shared_statics_lock());
+    if (shared_->refs == 1) {
+      erase_shared(shared_);
+      last = true;
+    }
+    pthread_mutex_unlock(&shared_statics_lock());
+    if (last) {
+      delete shared_;
+      shared_ = NULL;
+      return;
+    }
+    if (multivalue_)
+      clone_static<static_dynamicvalue_node_type>();
+    else
+      clone_static<static_node_type>();
+    release_shared();
+  }
+
   /*
   bool merge_uv() {
     return true;
@@ -2343,7 +2589,7 @@ public:
   //#################################################################################
   // Memory Stats
   //#################################################################################
-  int memory_consumption () const {
+  int64_t memory_consumption () const {
     /*
     std::cout << "pool_alloc = " << ti_->pool_alloc << "\n";
     std::cout << "pool_dealloc = " << ti_->pool_dealloc << "\n";
@@ -2359,7 +2605,7 @@ public:
       std::cout << nkeys_stats[i] << " ";
     std::cout << "\n";
     */
-    return (ti_->pool_alloc 
+    return ((int64_t)ti_->pool_alloc
 	    + ti_->alloc 
 	    - ti_->pool_dealloc 
 	    - ti_->dealloc 
@@ -2417,6 +2663,46 @@ public:
   int get_sic () {
     return sic;
   }
+  // tombstoned static slots not yet reclaimed by compact_static()
+  int get_sdead () const {
+    return sdead;
+  }
+  // dynamic-to-static merges run so far
+  uint64_t get_merge_count () const {
+    return stats_.merges;
+  }
+
+  // Counters plus a fresh look at memory and dynamic leaf fill. The
+  // static byte counts walk the static stage, so this is meant for
+  // periodic stats polling, not hot paths. A shared static stage's
+  // values stay charged to the dynamic bytes of the index that built it.
+  void get_stats (mt_index_stats &s) {
+    s = stats_;
+    s.static_bytes = 0;
+    s.value_bytes = 0;
+    if (multivalue_)
+      static_stage_bytes<static_dynamicvalue_node_type>(s.static_bytes, s.value_bytes);
+    else
+      static_stage_bytes<static_node_type>(s.static_bytes, s.value_bytes);
+    s.dynamic_bytes = (int64_t)ti_->pool_alloc + ti_->alloc
+      - ti_->pool_dealloc - ti_->dealloc - ti_->pool_dealloc_rcu - ti_->dealloc_rcu;
+    if (shared_ == NULL)
+      s.dynamic_bytes -= s.value_bytes;
+    if (s.dynamic_bytes < 0)
+      s.dynamic_bytes = 0;
+    s.filter_bytes = bits/8;
+    s.static_dead = sdead;
+    s.static_holders = 0;
+    if (shared_ != NULL) {
+      pthread_mutex_lock(&shared_statics_lock());
+      s.static_holders = (uint64_t)shared_->refs;
+      pthread_mutex_unlock(&shared_statics_lock());
+    }
+    std::vector<uint32_t> nkeys_stats;
+    q_[0].run_stats(table_->table(), *ti_, nkeys_stats);
+    for (size_t i = 0; i < nkeys_stats.size() && i < LEAF_FILL_BUCKETS; i++)
+      s.leaf_fill[i] = nkeys_stats[i];
+  }
 
   bool merge() {
     if (multivalue_)
@@ -2425,12 +2711,48 @@ public:
       return merge_uv();
   }
 
+  //#################################################################################
+  // Bulk Load
+  //#################################################################################
+  // Between begin_bulk_load() and end_bulk_load() the per-insert merge check
+  // is skipped, so a batch of (ideally key-sorted) inserts lands in the
+  // dynamic tree and is folded into the static stage by a single merge.
+  void begin_bulk_load() {
+    bulk_load_ = true;
+  }
+
+  bool end_bulk_load() {
+    bulk_load_ = false;
+    if ((MERGE == 1) && ((ic * merge_ratio) >= sic) && (ic >= MERGE_THRESHOLD))
+      return merge();
+    return true;
+  }
+
 
 private:
+  // One registered static stage. Nodes and rows are immutable while
+  // registered; the last holder to let go frees them.
+  struct shared_static {
+    uint64_t digest;
+    static_base_node_type *root;
+    int sic;
+    int sdead;
+    bool multivalue;
+    bool packed;
+    int value_len;
+    int refs;
+  };
+  typedef std::multimap<std::string, shared_static*> shared_static_map;
+
   T *table_;
   T *static_table_;
   int ic;
   int sic;
+  int sdead;
+  mt_index_stats stats_;
+  bool bulk_load_;
+  // registered static stage this index is attached to, or NULL
+  shared_static *shared_;
   threadinfo *ti_;
   threadinfo *sti_;
   query<row_type> q_[1];
@@ -2438,6 +2760,11 @@ private:
 
   char* cur_key_;
   int cur_keylen_;
+  // dynamic stage range cursor, positioned on cur_key_ while
+  // dcur_version_ == dynamic_version_
+  typename T::scan_cursor_type dcur_;
+  uint64_t dynamic_version_;
+  uint64_t dcur_version_;
   char* next_key_;
   int next_keylen_;
   char* static_cur_key_;
@@ -2446,11 +2773,433 @@ private:
   int static_next_keylen_;
 
   bool multivalue_;
+  int value_len_;
   double merge_ratio;
   int key_size_;
 
   size_t bits;
   char* bloom_filter;
+
+  // Unique indexes keep the 8-byte tuple address directly in the dynamic
+  // leaf's value slot instead of hanging a row_type off it; value_buf_
+  // gives callers a stable Str over those bytes.
+  uint64_t value_buf_;
+
+  // Static (dynamicvalue) rows of a packed index hold the key's values in
+  // ascending order, each stored as the LEB128 varint of its difference to
+  // the previous one. static_values() expands a row into the flat array of
+  // value_len_-byte values every caller works on (valid until the next
+  // call); make_static_row() goes the other way. Removing or replacing
+  // one value splices the list in place (packed_remove/packed_insert).
+  bool packed_static_values_;
+  std::vector<uint64_t> pack_values_;
+  std::string pack_buf_;
+  std::string unpack_buf_;
+
+  // every node of the static tree under root, parents before children
+  template <typename N>
+  static void static_stage_nodes(N *root, std::vector<N*> &nodes) {
+    if (root)
+      nodes.push_back(root);
+    for (size_t c = 0; c < nodes.size(); c++)
+      for (uint32_t i = 0; i < nodes[c]->size(); i++)
+	if (N::keylenx_is_layer(nodes[c]->ikeylen(i)))
+	  nodes.push_back(static_cast<N*>(nodes[c]->lv(i).layer()));
+  }
+
+  static shared_static_map &shared_statics() {
+    static shared_static_map stages;
+    return stages;
+  }
+
+  static pthread_mutex_t &shared_statics_lock() {
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    return lock;
+  }
+
+  // caller holds shared_statics_lock()
+  static void erase_shared(shared_static *s) {
+    for (typename shared_static_map::iterator it = shared_statics().begin();
+	 it != shared_statics().end(); ++it)
+      if (it->second == s) {
+	shared_statics().erase(it);
+	return;
+      }
+  }
+
+  void release_shared() {
+    shared_static *s = shared_;
+    shared_ = NULL;
+    pthread_mutex_lock(&shared_statics_lock());
+    bool last = (--s->refs == 0);
+    if (last)
+      erase_shared(s);
+    pthread_mutex_unlock(&shared_statics_lock());
+    if (last) {
+      free_static(s->root);
+      delete s;
+    }
+  }
+
+  inline bool own_static_for(const Str &key) {
+    if (shared_ == NULL)
+      return true;
+    if (multivalue_ ? !static_exist_nuv(key) : !static_exist(key))
+      return false;
+    unshare_static();
+    return true;
+  }
+
+  static inline uint64_t digest_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  // Sum of one hash per live (key, value) pair, so two stages holding the
+  // same entries agree however their nodes and layers happen to be laid out.
+  template <typename N>
+  uint64_t static_digest() {
+    std::vector<N*> nodes;
+    std::vector<std::string> prefixes;
+    N *root = static_cast<N*>(static_table_->table().static_root());
+    if (root) {
+      nodes.push_back(root);
+      prefixes.push_back(std::string());
+    }
+    uint64_t digest = 0;
+    std::string key;
+    std::string buf;
+    for (size_t c = 0; c < nodes.size(); c++) {
+      N *n = nodes[c];
+      for (uint32_t i = 0; i < n->size(); i++) {
+	int keylenx = n->ikeylen(i);
+	if (!n->isValid(i))
+	  continue;
+	uint64_t slice = host_to_net_order(n->ikey(i));
+	key.assign(prefixes[c]);
+	if (N::keylenx_is_layer(keylenx)) {
+	  key.append((const char*)&slice, sizeof(slice));
+	  nodes.push_back(static_cast<N*>(n->lv(i).layer()));
+	  prefixes.push_back(key);
+	  continue;
+	}
+	key.append((const char*)&slice, keylenx < (int)sizeof(slice) ? keylenx : sizeof(slice));
+	if (N::keylenx_has_ksuf(keylenx)) {
+	  Str suffix = n->ksuf(i, buf);
+	  key.append(suffix.s, suffix.len);
+	}
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t b = 0; b < key.size(); b++)
+	  h = (h ^ (unsigned char)key[b]) * 1099511628211ULL;
+	digest += static_value_digest(h, n, i);
+      }
+    }
+    return digest;
+  }
+
+  uint64_t static_value_digest(uint64_t h, static_node_type *n, uint32_t i) {
+    uint64_t v;
+    memcpy(&v, &n->get_lv()[i], sizeof(v));
+    return digest_mix(h + digest_mix(v));
+  }
+
+  uint64_t static_value_digest(uint64_t h, static_dynamicvalue_node_type *n, uint32_t i) {
+    Str values = static_values(n->lv(i).value());
+    uint64_t digest = 0;
+    for (int v = 0; v < values.len; v += value_len_) {
+      uint64_t x = 0;
+      memcpy(&x, values.s + v, value_len_);
+      digest += digest_mix(h + digest_mix(x));
+    }
+    return digest;
+  }
+
+  // Replace the current (shared) static stage with a private copy.
+  template <typename N>
+  void clone_static() {
+    std::vector<N*> nodes;
+    static_stage_nodes(static_cast<N*>(static_table_->table().static_root()), nodes);
+    std::vector<N*> copies(nodes.size());
+    for (size_t c = 0; c < nodes.size(); c++) {
+      size_t sz = nodes[c]->allocated_size();
+      copies[c] = (N*)sti_->allocate(sz, memtag_masstree_leaf);
+      memcpy((void*)copies[c], (const void*)nodes[c], sz);
+    }
+    // children sit in the BFS order static_stage_nodes() produced
+    size_t child = 1;
+    for (size_t c = 0; c < copies.size(); c++) {
+      N *n = copies[c];
+      for (uint32_t i = 0; i < n->size(); i++) {
+	if (N::keylenx_is_layer(n->ikeylen(i)))
+	  n->set_layer(i, copies[child++]);
+	else if (n->isValid(i))
+	  clone_static_value(n, i);
+      }
+    }
+    static_table_->table().set_static_root(copies.empty() ? NULL : copies[0]);
+  }
+
+  void clone_static_value(static_node_type *n, uint32_t i) {
+  }
+
+  void clone_static_value(static_dynamicvalue_node_type *n, uint32_t i) {
+    row_type *row = row_type::create1(n->lv(i).value()->col(0), qtimes_.ts, *ti_);
+    memcpy((void*)&n->get_lv()[i], &row, sizeof(row));
+  }
+
+  void free_static(static_base_node_type *root) {
+    if (multivalue_)
+      free_static_nodes(static_cast<static_dynamicvalue_node_type*>(root));
+    else
+      free_static_nodes(static_cast<static_node_type*>(root));
+  }
+
+  template <typename N>
+  void free_static_nodes(N *root) {
+    std::vector<N*> nodes;
+    static_stage_nodes(root, nodes);
+    for (size_t c = 0; c < nodes.size(); c++) {
+      free_static_values(nodes[c]);
+      nodes[c]->deallocate(*sti_);
+    }
+  }
+
+  void free_static_values(static_node_type *n) {
+  }
+
+  void free_static_values(static_dynamicvalue_node_type *n) {
+    for (uint32_t i = 0; i < n->size(); i++)
+      if (n->isValid(i) && !n->keylenx_is_layer(n->ikeylen(i)))
+	n->lv(i).value()->deallocate(*ti_);
+  }
+
+  // Bloom filter probe ahead of a dynamic point lookup
+  inline bool dynamic_may_contain(const Str &key) {
+    if (ic == 0)
+      return false;
+    if (!USE_BLOOM_FILTER || KeyMayMatch(key.s, key.len, bloom_filter))
+      return true;
+    stats_.bloom_negatives++;
+    return false;
+  }
+
+  // the dynamic lookup after a passing probe came up empty
+  inline void count_bloom_miss() {
+    if (USE_BLOOM_FILTER)
+      stats_.bloom_false_positives++;
+  }
+
+  inline bool count_static_lookup(bool found) {
+    if (found)
+      stats_.static_hits++;
+    else
+      stats_.misses++;
+    return found;
+  }
+
+  static uint64_t merge_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  }
+
+  void note_merge(uint64_t start) {
+    uint64_t usec = merge_clock() - start;
+    int b = 0;
+    while (b < MERGE_PAUSE_BUCKETS - 1 && (usec >> (b + 1)) != 0)
+      b++;
+    stats_.merges++;
+    stats_.merge_usec_total += usec;
+    if (usec > stats_.merge_usec_max)
+      stats_.merge_usec_max = usec;
+    stats_.merge_pause[b]++;
+  }
+
+  template <typename N>
+  void static_stage_bytes(int64_t &node_bytes, int64_t &value_bytes) {
+    std::vector<N*> nodes;
+    static_stage_nodes(static_cast<N*>(static_table_->table().static_root()), nodes);
+    for (size_t c = 0; c < nodes.size(); c++) {
+      node_bytes += nodes[c]->allocated_size();
+      value_bytes += static_row_bytes(nodes[c]);
+    }
+  }
+
+  // unique indexes keep their values in the node slots
+  int64_t static_row_bytes(static_node_type *n) {
+    return 0;
+  }
+
+  int64_t static_row_bytes(static_dynamicvalue_node_type *n) {
+    int64_t bytes = 0;
+    for (uint32_t i = 0; i < n->size(); i++)
+      if (n->isValid(i) && !n->keylenx_is_layer(n->ikeylen(i)))
+	bytes += n->lv(i).value()->size();
+    return bytes;
+  }
+
+  struct static_row_packer {
+    mt_index<T> &index_;
+    row_type *operator()(row_type *row) const {
+      return index_.pack_row(row);
+    }
+  };
+
+  inline Str static_values(row_type *row) {
+    Str packed = row->col(0);
+    if (!packed_static_values_)
+      return packed;
+    const unsigned char *p = (const unsigned char *)packed.s;
+    const unsigned char *end = p + packed.len;
+    int n = 0;
+    for (const unsigned char *q = p; q < end; q++)
+      n += !(*q & 0x80);
+    unpack_buf_.resize(n * value_len_);
+    char *out = &unpack_buf_[0];
+    uint64_t v = 0;
+    while (p < end) {
+      uint64_t delta;
+      p = read_varint(p, delta);
+      v += delta;
+      memcpy(out, &v, value_len_);
+      out += value_len_;
+    }
+    return Str(unpack_buf_.data(), (int)unpack_buf_.size());
+  }
+
+  inline row_type *make_static_row(const Str &values) {
+    if (!packed_static_values_)
+      return row_type::create1(values, qtimes_.ts, *ti_);
+    int n = values.len / value_len_;
+    pack_values_.resize(n);
+    for (int i = 0; i < n; i++) {
+      uint64_t v = 0;
+      memcpy(&v, values.s + i * value_len_, value_len_);
+      pack_values_[i] = v;
+    }
+    std::sort(pack_values_.begin(), pack_values_.end());
+    pack_buf_.resize(n * 10);
+    unsigned char *out = (unsigned char *)&pack_buf_[0];
+    uint64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+      uint64_t delta = pack_values_[i] - prev;
+      prev = pack_values_[i];
+      while (delta >= 0x80) {
+	*out++ = (unsigned char)(delta | 0x80);
+	delta >>= 7;
+      }
+      *out++ = (unsigned char)delta;
+    }
+    int len = (int)(out - (unsigned char *)&pack_buf_[0]);
+    return row_type::create1(Str(pack_buf_.data(), len), qtimes_.ts, *ti_);
+  }
+
+  static inline const unsigned char *read_varint(const unsigned char *p, uint64_t &v) {
+    v = *p & 0x7f;
+    int shift = 7;
+    while (*p++ & 0x80) {
+      v |= (uint64_t)(*p & 0x7f) << shift;
+      shift += 7;
+    }
+    return p;
+  }
+
+  static inline void append_varint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+      out += (char)(v | 0x80);
+      v >>= 7;
+    }
+    out += (char)v;
+  }
+
+  // Copy a packed list into pack_buf_ without one occurrence of value.
+  // Only the deltas on either side of it are decoded: they become the
+  // single delta that steps over it, and the bytes before and after are
+  // copied as they are.
+  bool packed_remove(const Str &packed, uint64_t value) {
+    const unsigned char *begin = (const unsigned char *)packed.s;
+    const unsigned char *end = begin + packed.len;
+    const unsigned char *p = begin;
+    uint64_t v = 0;
+    while (p < end) {
+      const unsigned char *at = p;
+      uint64_t delta;
+      p = read_varint(p, delta);
+      v += delta;
+      if (v > value)
+	return false;
+      if (v == value) {
+	pack_buf_.assign(packed.s, at - begin);
+	if (p < end) {
+	  uint64_t next_delta;
+	  const unsigned char *after = read_varint(p, next_delta);
+	  append_varint(pack_buf_, delta + next_delta);
+	  pack_buf_.append((const char *)after, end - after);
+	}
+	return true;
+      }
+    }
+    return false;
+  }
+
+  // Splice value into the packed list in pack_buf_ at its sorted place:
+  // the delta of the first larger value is split in two around it.
+  void packed_insert(uint64_t value) {
+    const unsigned char *begin = (const unsigned char *)pack_buf_.data();
+    const unsigned char *end = begin + pack_buf_.size();
+    const unsigned char *p = begin;
+    uint64_t prev = 0;
+    while (p < end) {
+      const unsigned char *at = p;
+      uint64_t delta;
+      p = read_varint(p, delta);
+      if (prev + delta > value) {
+	std::string split;
+	append_varint(split, value - prev);
+	append_varint(split, prev + delta - value);
+	pack_buf_.replace(at - begin, p - at, split);
+	return;
+      }
+      prev += delta;
+    }
+    append_varint(pack_buf_, value - prev);
+  }
+
+  inline uint64_t packed_value(const Str &value) const {
+    uint64_t v = 0;
+    memcpy(&v, value.s, value_len_);
+    return v;
+  }
+
+  inline row_type *packed_row() {
+    return row_type::create1(Str(pack_buf_.data(), (int)pack_buf_.size()), qtimes_.ts, *ti_);
+  }
+
+  // a dynamic row moving into the static stage at merge time
+  inline row_type *pack_row(row_type *row) {
+    if (!packed_static_values_)
+      return row;
+    row_type *packed = make_static_row(row->col(0));
+    row->deallocate_rcu(*ti_);
+    return packed;
+  }
+
+  static inline row_type *inline_value(const Str &value) {
+    row_type *v = NULL;
+    memcpy(&v, value.s, VALUE_LEN);
+    return v;
+  }
+
+  inline Str dynamic_value(row_type *v) {
+    if (multivalue_)
+      return v->col(0);
+    memcpy(&value_buf_, &v, VALUE_LEN);
+    return Str((const char *)&value_buf_, VALUE_LEN);
+  }
 };
 
 #endif //MTINDEXAPI_H
@@ -30,6 +30,7 @@ class query_table {
     typedef typename P::threadinfo_type threadinfo;
     typedef unlocked_tcursor<P> unlocked_cursor_type;
     typedef tcursor<P> cursor_type;
+    typedef scan_cursor<P> scan_cursor_type;
 
   //huanchen-static
   typedef stcursor<P> static_cursor_type;